@@ -12,7 +12,7 @@
  *		it on Windows XP, and possibly also Vista. Use the
  *		-DANSI_CFG for use on these systems.
  *
- * Version:	@(#)config.c	1.0.33	2018/09/03
+ * Version:	@(#)config.c	1.0.36	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -274,6 +274,7 @@ load_general(const char *cat)
     vid_cga_contrast = !!config_get_int(cat, "vid_cga_contrast", 0);
     vid_grayscale = config_get_int(cat, "video_grayscale", 0);
     vid_graytype = config_get_int(cat, "video_graytype", 0);
+    vid_render_thread = !!config_get_int(cat, "video_render_thread", 0);
 
     rctrl_is_lalt = config_get_int(cat, "rctrl_is_lalt", 0);
 
@@ -359,6 +360,11 @@ save_general(const char *cat)
       else
 	config_set_int(cat, "video_graytype", vid_graytype);
 
+    if (vid_render_thread == 0)
+	config_delete_var(cat, "video_render_thread");
+      else
+	config_set_int(cat, "video_render_thread", vid_render_thread);
+
     if (rctrl_is_lalt == 0)
 	config_delete_var(cat, "rctrl_is_lalt");
       else
@@ -419,6 +425,8 @@ load_machine(const char *cat)
 
     cpu_use_dynarec = !!config_get_int(cat, "cpu_use_dynarec", 0);
 
+    cpu_fast_interp = !!config_get_int(cat, "cpu_fast_interp", 0);
+
     enable_external_fpu = !!config_get_int(cat, "cpu_enable_fpu", 0);
 
     enable_sync = !!config_get_int(cat, "enable_sync", 1);
@@ -453,6 +461,11 @@ save_machine(const char *cat)
 
     config_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_fast_interp == 0)
+	config_delete_var(cat, "cpu_fast_interp");
+      else
+	config_set_int(cat, "cpu_fast_interp", cpu_fast_interp);
+
     if (enable_external_fpu == 0)
 	config_delete_var(cat, "cpu_enable_fpu");
       else
@@ -1724,7 +1737,8 @@ config_load(void)
 	/* Mark the configuration as changed. */
 	config_changed = 1;
     } else {
-	pclog("CONFIG: file not present or invalid, using defaults!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_WARNING,
+		"CONFIG: file not present or invalid, using defaults!\n");
 
 	config_default();
 
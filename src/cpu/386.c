@@ -8,7 +8,7 @@
  *
  *		Implementation of the CPU.
  *
- * Version:	@(#)386.c	1.0.4	2018/05/06
+ * Version:	@(#)386.c	1.0.5	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -60,6 +60,7 @@
 #define CPU_BLOCK_END()
 
 extern int codegen_flags_changed;
+extern int cpu_block_end;
 
 extern int nmi_enable;
 
@@ -285,6 +286,9 @@ void exec386(int cycs)
 /*                        testr[8]=flags;*/
                 /* oldcs2=oldcs; */
                 /* oldpc2=oldpc; */
+                cpu_block_end = 0;
+                do
+                {
                 oldcs=CS;
                 cpu_state.oldpc = cpu_state.pc;
                 oldcpl=CPL;
@@ -313,11 +317,24 @@ dontprint=0;
                         x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
 			if (x86_was_reset)
 				break;
-			if(x86_was_reset) break;
                 }
 
                 if (!use32) cpu_state.pc &= 0xffff;
 
+                /*In fast mode, keep going until the end of the basic
+                  block (or the timer period) before looking at aborts,
+                  traps and interrupts, as the dynarec does for blocks it
+                  interprets. Any instruction that can change what those
+                  checks see (jumps, calls, returns, STI, HLT, REP) ends
+                  the block.*/
+                ins++;
+                insc++;
+                } while (cpu_fast_interp && !cpu_block_end && !cpu_state.abrt && !trap &&
+                         !(nmi && nmi_enable) && (oldcyc - cycles) < cycle_period);
+
+                if (x86_was_reset)
+                        break;
+
                 if (cpu_state.abrt)
                 {
                         flags_rebuild();
@@ -420,9 +437,6 @@ dontprint=0;
                         }
                 }
 
-                ins++;
-                insc++;
-
                 if (timetolive)
                 {
                         timetolive--;
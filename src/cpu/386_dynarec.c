@@ -8,7 +8,7 @@
  *
  *		Implementation of the CPU's dynamic recompiler.
  *
- * Version:	@(#)386_dynarec.c	1.0.4	2018/05/09
+ * Version:	@(#)386_dynarec.c	1.0.11	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -53,12 +53,14 @@
 #include "../devices/system/nmi.h"
 #include "../devices/system/pic.h"
 #include "../timer.h"
+#include "../plat.h"
 //#include "../devices/floppy/fdd.h"
 //#include "../devices/floppy/fdc.h"
 #ifdef USE_DYNAREC
 #include "codegen.h"
 #endif
 #include "386_common.h"
+#include "cpu_prof.h"
 
 
 #define CPU_BLOCK_END() cpu_block_end = 1
@@ -71,6 +73,8 @@ int cpu_notreps, cpu_notreps_latched;
 int inrecomp = 0;
 int cpu_recomp_blocks, cpu_recomp_full_ins, cpu_new_blocks;
 int cpu_recomp_blocks_latched, cpu_recomp_ins_latched, cpu_recomp_full_ins_latched, cpu_new_blocks_latched;
+int cpu_recomp_flags_dropped, cpu_recomp_flags_dropped_latched;
+int cpu_recomp_cached, cpu_recomp_cached_latched;
 
 int cpu_block_end = 0;
 
@@ -583,8 +587,12 @@ void exec386_dynarec(int cycs)
 
                 cycdiff=0;
                 oldcyc=cycles;
+                /*This already runs a whole basic block between the
+                  interrupt and timer checks below, the same batching that
+                  cpu_fast_interp gives exec386, so it needs no option*/
                 if (!CACHE_ON()) /*Interpret block*/
                 {
+                        codegen_chain_from = NULL;
                         cpu_block_end = 0;
 			x86_was_reset = 0;
                         while (!cpu_block_end)
@@ -640,6 +648,7 @@ void exec386_dynarec(int cycs)
                 {
                 uint32_t phys_addr = get_phys(cs+cpu_state.pc);
                 int hash = HASH(phys_addr);
+                uint64_t prof_start = 0;
                 codeblock_t *block = codeblock_hash[hash];
                 int valid_block = 0;
                 trap = 0;
@@ -711,29 +720,57 @@ void exec386_dynarec(int cycs)
                         }
                 }
 
+                if (!valid_block && !cpu_state.abrt)
+                {
+                        /*Code seen in an earlier run can be recompiled
+                          straight away*/
+                        codeblock_t *new_block = codegen_cache_block(phys_addr);
+
+                        if (new_block)
+                        {
+                                block = new_block;
+                                valid_block = 1;
+                        }
+                }
+
                 if (valid_block && block->was_recompiled)
                 {
                         void (*code)() = (void *)&block->data[BLOCK_START];
 
                         codeblock_hash[hash] = block;
 
+                        /*Link the previous block straight to this one, so
+                          next time it does not come back here. Not while
+                          profiling, as the profiler would only see the
+                          first block of a chain*/
+                        if (codegen_chain_from && !cpu_prof_blocks && cpu_prof_rate <= 0)
+                                codegen_chain_link(codegen_chain_from, block);
+
+                        if (cpu_prof_blocks)
+                                prof_start = plat_timer_read();
 inrecomp=1;
                         code();
 inrecomp=0;
+                        if (cpu_prof_blocks)
+                                cpu_prof_block(phys_addr, CPU_PROF_EXEC, prof_start);
                         if (!use32) cpu_state.pc &= 0xffff;
                         cpu_recomp_blocks++;
 /*                        ins += codeblock_ins[index];
                         insc += codeblock_ins[index];*/
 /*                        pclog("Exit block now %04X:%04X\n", CS, pc);*/
                 }
-                else if (valid_block && !cpu_state.abrt)
+                else if (valid_block && !cpu_state.abrt && !(block->flags & CODEBLOCK_NO_RECOMPILE))
                 {
                         start_pc = cpu_state.pc;
+                        codegen_chain_from = NULL;
                         
                         cpu_block_end = 0;
                         x86_was_reset = 0;
 
                         cpu_new_blocks++;
+
+                        if (cpu_prof_blocks)
+                                prof_start = plat_timer_read();
                         
                         codegen_block_start_recompile(block);
                         codegen_in_recompile = 1;
@@ -780,7 +817,6 @@ inrecomp=0;
                                 if (nmi && nmi_enable && nmi_mask)
                                         CPU_BLOCK_END();
 
-
                                 if (cpu_state.abrt)
                                 {
                                         codegen_block_remove();
@@ -798,16 +834,33 @@ inrecomp=0;
                                 codegen_reset();
 
                         codegen_in_recompile = 0;
+
+                        if (cpu_prof_blocks)
+                                cpu_prof_block(phys_addr, CPU_PROF_TRANSLATE, prof_start);
                 }
                 else if (!cpu_state.abrt)
                 {
-                        /*Mark block but do not recompile*/
+                        /*Mark block but do not recompile. Blocks that keep
+                          being rewritten are left marked, and interpreted*/
                         start_pc = cpu_state.pc;
+                        codegen_chain_from = NULL;
 
                         cpu_block_end = 0;
                         x86_was_reset = 0;
 
-                        codegen_block_init(phys_addr);
+                        if (cpu_prof_blocks)
+                                prof_start = plat_timer_read();
+
+                        if (valid_block)
+                        {
+                                codegen_smc_block_retry(block);
+                                cpu_recomp_smc_interp++;
+                        }
+                        else
+                        {
+                                codegen_block_init(phys_addr);
+                                codegen_smc_block_init(&codeblock[block_current]);
+                        }
 
                         while (!cpu_block_end)
                         {
@@ -854,7 +907,8 @@ inrecomp=0;
 
                                 if (cpu_state.abrt)
                                 {
-                                        codegen_block_remove();
+                                        if (!valid_block)
+                                                codegen_block_remove();
                                         CPU_BLOCK_END();
                                 }
 
@@ -862,11 +916,14 @@ inrecomp=0;
                                 insc++;
                         }
                         
-                        if (!cpu_state.abrt && !x86_was_reset)
+                        if (!cpu_state.abrt && !x86_was_reset && !valid_block)
                                 codegen_block_end();
                         
                         if (x86_was_reset)
                                 codegen_reset();
+
+                        if (cpu_prof_blocks)
+                                cpu_prof_block(phys_addr, CPU_PROF_INTERP, prof_start);
                 }
                 }
 
@@ -875,6 +932,7 @@ inrecomp=0;
                 
                 if (cpu_state.abrt)
                 {
+                        codegen_chain_from = NULL;
                         flags_rebuild();
                         tempi = cpu_state.abrt;
                         cpu_state.abrt = 0;
@@ -922,6 +980,7 @@ inrecomp=0;
                         cpu_state.oldpc = cpu_state.pc;
                         oldcs = CS;
                         pclog("NMI\n");
+                        codegen_chain_from = NULL;
                         x86_int(2);
                         nmi_enable = 0;
                         if (nmi_auto_clear)
@@ -936,6 +995,7 @@ inrecomp=0;
                         if (temp!=0xFF)
                         {
                                 CPU_BLOCK_END();
+                                codegen_chain_from = NULL;
                                 flags_rebuild();
                                 if (msw&1)
                                 {
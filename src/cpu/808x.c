@@ -18,7 +18,7 @@
  *		2 clocks - fetch opcode 1       2 clocks - execute
  *		2 clocks - fetch opcode 2  etc
  *
- * Version:	@(#)808x.c	1.0.5	2018/05/06
+ * Version:	@(#)808x.c	1.0.10	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -83,9 +83,10 @@ int		ins = 0;
 int		fetchcycles = 0,
 		memcycs,
 		fetchclocks;
-uint8_t		prefetchqueue[6];
+uint8_t		prefetchqueue[8];		/* ring buffer, see FETCH() */
 uint16_t	prefetchpc;
 int		prefetchw = 0;
+static int	prefetchr = 0;
 
 
 #undef readmemb
@@ -177,28 +178,20 @@ writememl(uint32_t s, uint32_t a, uint32_t v)
 }
 
 
+/*
+ * The prefetch queue is kept as a ring buffer of 8 entries, with
+ * prefetchr pointing at the oldest byte and prefetchw holding the
+ * number of bytes queued, so taking a byte out does not have to
+ * shift the rest of the queue down.
+ */
+#define PFQ(n)	prefetchqueue[(prefetchr + (n)) & 7]
+
+
 static __inline uint8_t
 FETCH(void)
 {
         uint8_t temp;
 
-#if 0
-        temp=prefetchqueue[0];
-        prefetchqueue[0]=prefetchqueue[1];
-        prefetchqueue[1]=prefetchqueue[2];
-        prefetchqueue[2]=prefetchqueue[3];
-        prefetchqueue[3]=prefetchqueue[4];
-        prefetchqueue[4]=prefetchqueue[5];
-        if (prefetchw<=((is8086)?4:3))
-        {
-                prefetchqueue[prefetchw++]=readmembf(cs+prefetchpc); prefetchpc++;
-                if (is8086 && (prefetchpc&1))
-                {
-                        prefetchqueue[prefetchw++]=readmembf(cs+prefetchpc); prefetchpc++;
-                }
-        }
-#endif
-
         if (prefetchw==0)
         {
                 cycles-=(4-(fetchcycles&3));
@@ -208,19 +201,15 @@ FETCH(void)
                 prefetchpc = cpu_state.pc = cpu_state.pc + 1;
                 if (is8086 && (cpu_state.pc&1))
                 {
-                        prefetchqueue[0]=readmembf(cs+cpu_state.pc);
+                        PFQ(0)=readmembf(cs+cpu_state.pc);
                         prefetchpc++;
                         prefetchw++;
                 }
         }
         else
         {
-                temp=prefetchqueue[0];
-                prefetchqueue[0]=prefetchqueue[1];
-                prefetchqueue[1]=prefetchqueue[2];
-                prefetchqueue[2]=prefetchqueue[3];
-                prefetchqueue[3]=prefetchqueue[4];
-                prefetchqueue[4]=prefetchqueue[5];
+                temp=PFQ(0);
+                prefetchr=(prefetchr+1)&7;
                 prefetchw--;
                 fetchcycles-=4;
                 cpu_state.pc++;
@@ -241,13 +230,13 @@ FETCHADD(int c)
                 d-=4;
                 if (is8086 && !(prefetchpc&1))
                 {
-                        prefetchqueue[prefetchw]=readmembf(cs+prefetchpc);
+                        PFQ(prefetchw)=readmembf(cs+prefetchpc);
                         prefetchpc++;
                         prefetchw++;
                 }
                 if (prefetchw<6)
                 {
-                        prefetchqueue[prefetchw]=readmembf(cs+prefetchpc);
+                        PFQ(prefetchw)=readmembf(cs+prefetchpc);
                         prefetchpc++;
                         prefetchw++;
                 }
@@ -277,13 +266,13 @@ FETCHCOMPLETE(void)
         fetchclocks+=(4-(fetchcycles&3));
                 if (is8086 && !(prefetchpc&1))
                 {
-                        prefetchqueue[prefetchw]=readmembf(cs+prefetchpc);
+                        PFQ(prefetchw)=readmembf(cs+prefetchpc);
                         prefetchpc++;
                         prefetchw++;
                 }
                 if (prefetchw<6)
                 {
-                        prefetchqueue[prefetchw]=readmembf(cs+prefetchpc);
+                        PFQ(prefetchw)=readmembf(cs+prefetchpc);
                         prefetchpc++;
                         prefetchw++;
                 }
@@ -418,33 +407,69 @@ void makemod1table()
         mod1seg[4]=&ds; mod1seg[5]=&ds; mod1seg[6]=&ss; mod1seg[7]=&ds;
 }
 
-static void fetcheal()
+/*
+ * Pre-decoded ModR/M bytes (with the reg field masked out), so the
+ * effective address of an instruction is found with one table walk
+ * instead of a switch on mod and rm. The cycle counts are the 8088
+ * EA calculation times, which are fed to the prefetcher.
+ */
+typedef struct {
+        uint16_t *base, *index;
+        uint32_t *seg;
+        uint8_t  disp;                  /* 0, 1 or 2 displacement bytes */
+        uint8_t  ea_cycles;
+} modrm_t;
+
+static modrm_t modrm_table[256];
+
+static void makemodrmtable()
 {
-        if (!cpu_mod && cpu_rm==6) { cpu_state.eaaddr=getword(); easeg=ds; FETCHADD(6); }
-        else
+        modrm_t *m;
+        int c, mod, rm;
+
+        for (c = 0; c < 256; c++)
         {
-                switch (cpu_mod)
+                m = &modrm_table[c];
+                mod = (c >> 6) & 3;
+                rm = c & 7;
+
+                m->base = mod1add[0][rm];
+                m->index = mod1add[1][rm];
+                m->seg = mod1seg[rm];
+                m->disp = (mod == 3) ? 0 : mod;
+                if (mod == 0)
+                        m->ea_cycles = (rm & 4) ? 5 : (7 + slowrm[rm]);
+                else
+                        m->ea_cycles = (rm & 4) ? 9 : (11 + slowrm[rm]);
+                if (!mod && rm == 6)
                 {
-                        case 0:
-                        cpu_state.eaaddr=0;
-                        if (cpu_rm&4) FETCHADD(5);
-                        else      FETCHADD(7+slowrm[cpu_rm]);
-                        break;
-                        case 1:
-                        cpu_state.eaaddr=(uint16_t)(int8_t)FETCH();
-                        if (cpu_rm&4) FETCHADD(9);
-                        else      FETCHADD(11+slowrm[cpu_rm]);
-                        break;
-                        case 2:
-                        cpu_state.eaaddr=getword();
-                        if (cpu_rm&4) FETCHADD(9);
-                        else      FETCHADD(11+slowrm[cpu_rm]);
-                        break;
+                        m->base = m->index = &zero;
+                        m->seg = &ds;
+                        m->disp = 2;
+                        m->ea_cycles = 6;
                 }
-                cpu_state.eaaddr+=(*mod1add[0][cpu_rm])+(*mod1add[1][cpu_rm]);
-                easeg=*mod1seg[cpu_rm];
-                cpu_state.eaaddr&=0xFFFF;
         }
+}
+
+static void fetcheal()
+{
+        const modrm_t *m = &modrm_table[rmdat & 0xff];
+
+        switch (m->disp)
+        {
+                case 0:
+                cpu_state.eaaddr=0;
+                break;
+                case 1:
+                cpu_state.eaaddr=(uint16_t)(int8_t)FETCH();
+                break;
+                case 2:
+                cpu_state.eaaddr=getword();
+                break;
+        }
+        FETCHADD(m->ea_cycles);
+        cpu_state.eaaddr=(cpu_state.eaaddr+(*m->base)+(*m->index))&0xFFFF;
+        easeg=*m->seg;
 
 	cpu_state.last_ea = cpu_state.eaaddr;
 }
@@ -676,6 +701,7 @@ void resetx86()
         makeznptable();
         resetreadlookup();
         makemod1table();
+        makemodrmtable();
         resetmcr();
         FETCHCLEAR();
         x87_reset();
@@ -845,14 +871,27 @@ static void setsbc16(uint16_t a, uint16_t b)
         if (((a&0xF)-(b&0xF))&0x10)      flags|=A_FLAG;
 }
 
-int current_diff = 0;
-void clockhardware()
+/*
+ * Timer accounting is batched over instructions: timer_start is only
+ * moved on once the elapsed time has reached the next timer deadline
+ * (or at the end of execx86), instead of after every instruction. This
+ * runs the timers at exactly the same instruction boundaries as doing
+ * the sync each time, so timing does not change.
+ */
+static __inline void clockhardware()
 {
-        int diff = cycdiff - cycles - current_diff;
-        
-        current_diff += diff;
-  
-        timer_end_period(cycles*xt_cpu_multi);
+        if ((cycles*xt_cpu_multi) <= (timer_start - timer_count))
+                timer_end_period(cycles*xt_cpu_multi);
+}
+
+/*Cycle count at the last instruction boundary*/
+static int synccyc;
+
+/*Devices can look at the timer state when they are accessed, so bring
+  it up to date with the last instruction boundary before doing I/O*/
+static __inline void timersync()
+{
+        timer_end_period(synccyc*xt_cpu_multi);
 }
 
 static int takeint = 0;
@@ -904,6 +943,7 @@ void rep(int fv)
                 if (c>0)
                 {
                         temp2=readmemb(ds+SI);
+                        timersync();
                         outb(DX,temp2);
                         if (flags&D_FLAG) SI--;
                         else              SI++;
@@ -1090,11 +1130,11 @@ void execx86(int cycs)
         int trap;
 
         cycles+=cycs;
+        timer_start_period(cycles*xt_cpu_multi);
+        synccyc=cycles;
         while (cycles>0)
         {
                 cycdiff=cycles;
-                timer_start_period(cycles*xt_cpu_multi);
-                current_diff = 0;
                 cycles-=nextcyc;
                 nextcyc=0;
                 fetchclocks=0;
@@ -2868,22 +2908,26 @@ void execx86(int cycs)
                         break;
 
                         case 0xE4: /*IN AL*/
+                        timersync();
                         temp=FETCH();
                         AL=inb(temp);
                         cycles-=14;
                         break;
                         case 0xE5: /*IN AX*/
+                        timersync();
                         temp=FETCH();
                         AL=inb(temp);
                         AH=inb(temp+1);
                         cycles-=14;
                         break;
                         case 0xE6: /*OUT AL*/
+                        timersync();
                         temp=FETCH();
                         outb(temp,AL);
                         cycles-=14;
                         break;
                         case 0xE7: /*OUT AX*/
+                        timersync();
                         temp=FETCH();
                         outb(temp,AL);
                         outb(temp+1,AH);
@@ -2921,19 +2965,23 @@ void execx86(int cycs)
                         FETCHCLEAR();
                         break;
                         case 0xEC: /*IN AL,DX*/
+                        timersync();
                         AL=inb(DX);
                         cycles-=12;
                         break;
                         case 0xED: /*IN AX,DX*/
+                        timersync();
                         AL=inb(DX);
                         AH=inb(DX+1);
                         cycles-=12;
                         break;
                         case 0xEE: /*OUT DX,AL*/
+                        timersync();
                         outb(DX,AL);
                         cycles-=12;
                         break;
                         case 0xEF: /*OUT DX,AX*/
+                        timersync();
                         outb(DX,AL);
                         outb(DX+1,AH);
                         cycles-=12;
@@ -2956,6 +3004,8 @@ void execx86(int cycs)
                         cpu_state.pc--;
                         FETCHCLEAR();
                         cycles-=2;
+                        if ((flags & I_FLAG) && !pic_intpending)
+                                cpu_idle_skip();
                         break;
                         case 0xF5: /*CMC*/
                         flags^=C_FLAG;
@@ -3288,8 +3338,12 @@ void execx86(int cycs)
                 memcycs=0;
 
                 insc++;
+                synccyc=cycles;
                 clockhardware();
 
+                /*Unlike exec386, these are not batched per block; on the
+                  808x, when an interrupt is taken is part of the cycle
+                  timing, and they are cheap next to clockhardware()*/
                 if (trap && (flags&T_FLAG) && !noint)
                 {
                         writememw(ss,(SP-2)&0xFFFF,flags|0xF000);
@@ -3319,6 +3373,7 @@ void execx86(int cycs)
                 }
                 else if (takeint && !cpu_state.ssegs && !noint)
                 {
+                        timersync();
                         temp=picinterrupt();
                         if (temp!=0xFF)
                         {
@@ -3339,6 +3394,15 @@ void execx86(int cycs)
 
                 if (noint) noint=0;
                 ins++;
+
+                /*Cycles used after the timer sync point (by timer callbacks
+                  such as the DRAM refresh, or by taking an interrupt) are
+                  not timer time*/
+                if (cycles!=synccyc)
+                        timer_start-=(synccyc-cycles)*xt_cpu_multi;
+                synccyc=cycles;
         }
+
+        timer_end_period(cycles*xt_cpu_multi);
 }
 
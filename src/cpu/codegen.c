@@ -8,7 +8,7 @@
  *
  *		Instruction parsing and generation.
  *
- * Version:	@(#)codegen.c	1.0.2	2018/05/06
+ * Version:	@(#)codegen.c	1.0.6	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -62,3 +62,144 @@ void codegen_timing_set(codegen_timing_t *timing)
 }
 
 int codegen_in_recompile;
+
+/*Last block to exit back to the dispatcher, and the chain generation.*/
+codeblock_t *codegen_chain_from;
+uint32_t codegen_chain_gen;
+
+/*Adaptive self-modifying code handling.
+
+  Dirty tracking works at 16 byte granularity, so a write to data sharing a
+  line with code, or a write that stores the bytes already there, evicts
+  every block covering the line. Pages that see many such evictions get
+  their blocks verified byte-for-byte instead: a hash of the guest code is
+  taken when the block is recompiled, and a block whose code still hashes
+  the same survives the flush.
+
+  Code that really is rewritten and then executed again (unpacking loops,
+  self-patching inner loops) would be recompiled after every write. Each
+  eviction is counted per physical address, and once an address has been
+  evicted often enough its block is only marked, and interpreted from then
+  on. After running a while without being written to it gets another chance
+  at being recompiled.*/
+#define SMC_HOT_PAGE            32      /*Evictions before page is hashed*/
+#define SMC_INTERP_THRESHOLD    8       /*Evictions before block is interpreted*/
+#define SMC_RETRY_THRESHOLD     1024    /*Clean runs before block is retried*/
+
+#define SMC_HISTORY_SIZE        1024
+#define SMC_HISTORY_HASH(a)     (((a) >> 2) & (SMC_HISTORY_SIZE - 1))
+
+static struct
+{
+        uint32_t phys;
+        int count;
+} smc_history[SMC_HISTORY_SIZE];
+
+int cpu_recomp_smc_saved, cpu_recomp_smc_saved_latched;
+int cpu_recomp_smc_interp, cpu_recomp_smc_interp_latched;
+
+/*Hash a range of guest code, FNV-1a style.*/
+uint64_t codegen_code_hash(uint32_t phys, uint32_t len)
+{
+        uint64_t h = 0xcbf29ce484222325ULL;
+
+        while (len--)
+        {
+                h ^= mem_readb_phys_dma(phys++);
+                h *= 0x100000001b3ULL;
+        }
+
+        return h;
+}
+
+/*Number of guest code bytes to hash for a block.*/
+uint32_t codegen_code_hash_len(codeblock_t *block)
+{
+        /*Cover the last instruction, but stay within the page*/
+        uint32_t len = (block->endpc - block->pc) + 8;
+
+        if (len > 0x1000 - (block->phys & 0xfff))
+                len = 0x1000 - (block->phys & 0xfff);
+
+        return len;
+}
+
+/*Called by codegen_check_flush() for each block hit by a write. Returns
+  non-zero if the block can be kept.*/
+int codegen_smc_keep(page_t *page, codeblock_t *block)
+{
+        int h;
+
+        if (block->flags & CODEBLOCK_NO_RECOMPILE)
+        {
+                /*Interpreted anyway, just restart the retry count*/
+                block->smc_clean_runs = 0;
+                cpu_recomp_smc_saved++;
+                return 1;
+        }
+        if ((block->flags & CODEBLOCK_SMC_HASHED) &&
+            codegen_code_hash(block->phys, codegen_code_hash_len(block)) == block->code_hash)
+        {
+                cpu_recomp_smc_saved++;
+                return 1;
+        }
+
+        page->smc_count++;
+
+        h = SMC_HISTORY_HASH(block->phys);
+        if (smc_history[h].phys != block->phys)
+        {
+                smc_history[h].phys = block->phys;
+                smc_history[h].count = 0;
+        }
+        smc_history[h].count++;
+
+        return 0;
+}
+
+/*Called after codegen_block_init() when marking a block.*/
+void codegen_smc_block_init(codeblock_t *block)
+{
+        int h = SMC_HISTORY_HASH(block->phys);
+
+        if (smc_history[h].phys == block->phys && smc_history[h].count >= SMC_INTERP_THRESHOLD)
+        {
+                block->flags |= CODEBLOCK_NO_RECOMPILE;
+                block->smc_clean_runs = 0;
+        }
+}
+
+/*Called by the dispatcher each time an interpreted block is run. Returns
+  non-zero once the block has run long enough without being written to.*/
+int codegen_smc_block_retry(codeblock_t *block)
+{
+        int h;
+
+        if (++block->smc_clean_runs < SMC_RETRY_THRESHOLD)
+                return 0;
+
+        h = SMC_HISTORY_HASH(block->phys);
+        if (smc_history[h].phys == block->phys)
+                smc_history[h].count = 0;
+        block->flags &= ~CODEBLOCK_NO_RECOMPILE;
+        block->smc_clean_runs = 0;
+
+        return 1;
+}
+
+/*Called at the end of codegen_block_end_recompile().*/
+void codegen_smc_block_end(codeblock_t *block)
+{
+        block->flags &= ~CODEBLOCK_SMC_HASHED;
+
+        if (pages[block->phys >> 12].smc_count >= SMC_HOT_PAGE && !block->page_mask2)
+        {
+                block->code_hash = codegen_code_hash(block->phys, codegen_code_hash_len(block));
+                block->flags |= CODEBLOCK_SMC_HASHED;
+        }
+}
+
+void codegen_smc_reset()
+{
+        memset(smc_history, 0, sizeof(smc_history));
+}
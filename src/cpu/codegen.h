@@ -8,7 +8,7 @@
  *
  *		Definitions for the code generator.
  *
- * Version:	@(#)codegen.h	1.0.3	2018/05/04
+ * Version:	@(#)codegen.h	1.0.12	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -73,6 +73,28 @@
   same page).
 */
 
+/*Block chaining :
+
+  On x86-64, a recompiled block does not always return to exec386_dynarec()
+  when it finishes. Its exit path checks the cycle count, pending aborts,
+  interrupts and the trap flag, and then compares the new CS:PC against up to
+  two link slots. A slot holds the PC, CS base and cpu_cur_status of a
+  successor block, plus the value of codegen_chain_gen at the time the link
+  was made; if all of them match, the block jumps straight into the chain
+  entry of the successor, which repeats the dirty mask check normally done by
+  the dispatcher. If that fails, the successor exits without becoming the
+  chain source, as it has not run.
+
+  Links are made by the dispatcher, when it runs a block directly after
+  another one exited normally. They are removed when either block is deleted
+  or recompiled, and are made stale wholesale by bumping codegen_chain_gen
+  whenever the MMU cache is flushed (CR0/CR3 writes, INVLPG, task switches and
+  memory remaps), since the PC -> physical address translation is no longer
+  checked on a chained transfer. Blocks spanning two pages, or built for a
+  static FPU top-of-stack (which the dispatcher checks), are never link
+  targets. A block may be linked to itself, which is what a tight loop needs.
+*/
+
 typedef struct codeblock_t
 {
         uint64_t page_mask, page_mask2;
@@ -104,6 +126,23 @@ typedef struct codeblock_t
         uint32_t status;
         uint32_t flags;
 
+        /*Block chaining. link_to[] are the successors patched into our two
+          link slots, link_in is the list of (block, slot) pairs that jump
+          into us, threaded through the link_next[] fields of those blocks.
+          Offsets into data[] are 0 when not present.*/
+        struct codeblock_t *link_to[2], *link_next[2], *link_in;
+        uint8_t link_next_slot[2], link_in_slot;
+        uint16_t chain_slot, chain_exit, chain_entry;
+
+        /*Number of runs of a CODEBLOCK_NO_RECOMPILE block since its code
+          was last written to, see codegen_smc_block_retry(). Used for
+          nothing else.*/
+        int smc_clean_runs;
+
+        /*Hash of the guest code, for blocks on pages with a history of
+          self-modifying code. See codegen_smc_keep().*/
+        uint64_t code_hash;
+
         uint8_t data[2048];
 } codeblock_t;
 
@@ -111,6 +150,10 @@ typedef struct codeblock_t
 #define CODEBLOCK_HAS_FPU 1
 /*Code block is always entered with the same FPU top-of-stack*/
 #define CODEBLOCK_STATIC_TOP 2
+/*Code block keeps being rewritten, and should be interpreted instead*/
+#define CODEBLOCK_NO_RECOMPILE 16
+/*Code block is checked against code_hash when its page is written to*/
+#define CODEBLOCK_SMC_HASHED 32
 
 static inline codeblock_t *codeblock_tree_find(uint32_t phys, uint32_t __cs)
 {
@@ -304,6 +347,21 @@ void codegen_generate_seg_restore();
 void codegen_set_op32();
 void codegen_flush();
 void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr);
+void codegen_chain_link(codeblock_t *from, codeblock_t *to);
+
+uint64_t codegen_code_hash(uint32_t phys, uint32_t len);
+uint32_t codegen_code_hash_len(codeblock_t *block);
+int codegen_smc_keep(page_t *page, codeblock_t *block);
+void codegen_smc_block_init(codeblock_t *block);
+int codegen_smc_block_retry(codeblock_t *block);
+void codegen_smc_block_end(codeblock_t *block);
+void codegen_smc_reset();
+
+codeblock_t *codegen_cache_block(uint32_t phys_addr);
+void codegen_cache_save(void);
+
+extern codeblock_t *codegen_chain_from;
+extern uint32_t codegen_chain_gen;
 
 extern int cpu_block_end;
 extern uint32_t codegen_endpc;
@@ -314,6 +372,10 @@ extern int cpu_recomp_flushes, cpu_recomp_flushes_latched;
 extern int cpu_recomp_evicted, cpu_recomp_evicted_latched;
 extern int cpu_recomp_reuse, cpu_recomp_reuse_latched;
 extern int cpu_recomp_removed, cpu_recomp_removed_latched;
+extern int cpu_recomp_flags_dropped, cpu_recomp_flags_dropped_latched;
+extern int cpu_recomp_cached, cpu_recomp_cached_latched;
+extern int cpu_recomp_smc_saved, cpu_recomp_smc_saved_latched;
+extern int cpu_recomp_smc_interp, cpu_recomp_smc_interp_latched;
 
 extern int cpu_reps, cpu_reps_latched;
 extern int cpu_notreps, cpu_notreps_latched;
@@ -403,6 +465,11 @@ extern int codegen_flags_changed;
 extern int codegen_fpu_entered;
 extern int codegen_mmx_entered;
 
+/*Called after emitting a store to the lazy flags state, which started at
+  block offset start. Such stores can be dropped later on if the next
+  instruction overwrites all flags.*/
+void codegen_flags_store(int start);
+
 extern int codegen_fpu_loaded_iq[8];
 extern int codegen_reg_loaded[8];
 
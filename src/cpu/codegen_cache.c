@@ -0,0 +1,265 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Persistent block cache for the dynamic recompiler.
+ *
+ *		This is not a cache of translated code. Generated host code
+ *		is full of absolute addresses (of the emulator's own
+ *		variables, of heap data and of the block itself), and the
+ *		emitter picks shorter encodings when they happen to fit,
+ *		so it cannot be reused by another run without a fixup for
+ *		every one of them. What we keep instead is the list of
+ *		blocks the recompiler found worth recompiling. With that, a
+ *		block seen in an earlier run is recompiled on its first
+ *		visit instead of being interpreted once first; it is still
+ *		translated again.
+ *
+ *		Entries are keyed on the physical address, CS:PC and the
+ *		cpu_cur_status of the block, and carry a hash of the guest
+ *		code bytes. An entry is only used if the code currently in
+ *		memory has the same hash, so stale entries are ignored.
+ *		A mismatch is remembered, so the code is only hashed once.
+ *
+ * Version:	@(#)codegen_cache.c	1.0.6	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "cpu.h"
+#include "x86.h"
+#include "../mem.h"
+#include "../plat.h"
+#include "codegen.h"
+
+
+#define TC_MAGIC	"VCTC"
+#define TC_VERSION	2
+#define TC_HASH_SIZE	4096
+#define TC_HASH(a)	(((a) >> 4) & (TC_HASH_SIZE - 1))
+
+
+#pragma pack(push,1)
+typedef struct {
+    char	magic[4];
+    uint32_t	version,
+		entry_size,
+		count;
+} tc_header_t;
+
+typedef struct {
+    uint32_t	phys,			/* physical address of block */
+		pc,			/* linear address (CS base + IP) */
+		cs_base,		/* CS base */
+		status,			/* cpu_cur_status when compiled */
+		len,			/* number of code bytes hashed */
+		flags;			/* CODEBLOCK_xxx flags */
+    uint64_t	hash;			/* hash of the code bytes */
+} tc_entry_t;
+#pragma pack(pop)
+
+
+static int		tc_loaded;
+static tc_entry_t	*tc_entries;
+static int		*tc_next;
+static uint8_t		*tc_stale;		/* code does not match */
+static int		tc_count,
+			tc_size;
+static int		tc_head[TC_HASH_SIZE];
+
+
+static tc_entry_t *
+tc_find(uint32_t phys, uint32_t pc, uint32_t _cs, uint32_t status)
+{
+    tc_entry_t *e;
+    int i;
+
+    for (i = tc_head[TC_HASH(phys)]; i != -1; i = tc_next[i]) {
+	e = &tc_entries[i];
+	if (e->phys == phys && e->pc == pc &&
+	    e->cs_base == _cs && e->status == status) return(e);
+    }
+
+    return(NULL);
+}
+
+
+static tc_entry_t *
+tc_add(uint32_t phys)
+{
+    int i;
+
+    if (tc_count == tc_size) {
+	tc_size = (tc_size) ? tc_size * 2 : 1024;
+	tc_entries = (tc_entry_t *)realloc(tc_entries,
+					   tc_size * sizeof(tc_entry_t));
+	tc_next = (int *)realloc(tc_next, tc_size * sizeof(int));
+	tc_stale = (uint8_t *)realloc(tc_stale, tc_size);
+	if (tc_entries == NULL || tc_next == NULL || tc_stale == NULL)
+		fatal("CODEGEN: out of memory for block cache\n");
+    }
+
+    i = tc_count++;
+    tc_next[i] = tc_head[TC_HASH(phys)];
+    tc_head[TC_HASH(phys)] = i;
+    tc_stale[i] = 0;
+
+    memset(&tc_entries[i], 0x00, sizeof(tc_entry_t));
+    tc_entries[i].phys = phys;
+
+    return(&tc_entries[i]);
+}
+
+
+static void
+tc_load(void)
+{
+    tc_header_t hdr;
+    tc_entry_t e;
+    FILE *fp;
+    uint32_t i;
+
+    tc_loaded = 1;
+    for (i = 0; i < TC_HASH_SIZE; i++)
+	tc_head[i] = -1;
+
+    fp = plat_fopen(tcache_path, L"rb");
+    if (fp == NULL) return;
+
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	memcmp(hdr.magic, TC_MAGIC, 4) ||
+	hdr.version != TC_VERSION ||
+	hdr.entry_size != sizeof(tc_entry_t)) {
+	pclog_lvl(PCLOG_CAT_CPU, PCLOG_WARNING,
+		"CODEGEN: ignoring invalid block cache '%ls'\n",
+							tcache_path);
+	(void)fclose(fp);
+	return;
+    }
+
+    for (i = 0; i < hdr.count; i++) {
+	if (fread(&e, sizeof(e), 1, fp) != 1) break;
+	*tc_add(e.phys) = e;
+    }
+    (void)fclose(fp);
+
+    pclog("CODEGEN: loaded %d cached translations from '%ls'\n",
+						tc_count, tcache_path);
+}
+
+
+/*
+ * Called by the dispatcher when no block exists for the current
+ * CS:PC. If the cache knows the code at this address, create a
+ * block for it that is ready to be recompiled right away.
+ */
+codeblock_t *
+codegen_cache_block(uint32_t phys_addr)
+{
+    codeblock_t *block;
+    tc_entry_t *e;
+
+    if (tcache_path[0] == L'\0') return(NULL);
+
+    if (! tc_loaded)
+	tc_load();
+
+    e = tc_find(phys_addr, cs + cpu_state.pc, cs, cpu_cur_status);
+    if (e == NULL || tc_stale[e - tc_entries]) return(NULL);
+
+    if (codegen_code_hash(phys_addr, e->len) != e->hash) {
+	/* Different code now, do not hash it again on the next miss. */
+	tc_stale[e - tc_entries] = 1;
+	return(NULL);
+    }
+
+    codegen_block_init(phys_addr);
+    block = &codeblock[block_current];
+    cpu_recomp_cached++;
+
+    return(block);
+}
+
+
+/* Merge the blocks we have now into the cache, and write it out. */
+void
+codegen_cache_save(void)
+{
+    tc_header_t hdr;
+    codeblock_t *block;
+    tc_entry_t *e;
+    FILE *fp;
+    int c;
+
+    if (tcache_path[0] == L'\0') return;
+
+    if (! tc_loaded)
+	tc_load();
+
+    for (c = 0; c < BLOCK_SIZE; c++) {
+	block = &codeblock[c];
+
+	/* Only single-page blocks that actually got recompiled. */
+	if (!block->valid || !block->was_recompiled || block->page_mask2)
+		continue;
+
+	e = tc_find(block->phys, block->pc, block->_cs, block->status);
+	if (e == NULL)
+		e = tc_add(block->phys);
+	tc_stale[e - tc_entries] = 0;
+	e->pc = block->pc;
+	e->cs_base = block->_cs;
+	e->status = block->status;
+	e->len = codegen_code_hash_len(block);
+	e->flags = block->flags & CODEBLOCK_HAS_FPU;
+	e->hash = codegen_code_hash(block->phys, e->len);
+    }
+
+    fp = plat_fopen(tcache_path, L"wb");
+    if (fp == NULL) {
+	pclog_lvl(PCLOG_CAT_CPU, PCLOG_ERROR,
+		"CODEGEN: unable to write block cache '%ls'\n",
+							tcache_path);
+	return;
+    }
+
+    memcpy(hdr.magic, TC_MAGIC, 4);
+    hdr.version = TC_VERSION;
+    hdr.entry_size = sizeof(tc_entry_t);
+    hdr.count = tc_count;
+    (void)fwrite(&hdr, sizeof(hdr), 1, fp);
+    (void)fwrite(tc_entries, sizeof(tc_entry_t), tc_count, fp);
+    (void)fclose(fp);
+
+    pclog("CODEGEN: saved %d cached translations to '%ls'\n",
+						tc_count, tcache_path);
+}
@@ -8,7 +8,7 @@
  *
  *		Miscellaneous instructions.
  *
- * Version:	@(#)codegen_ops_fpu.h	1.0.1	2018/02/14
+ * Version:	@(#)codegen_ops_fpu.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -523,12 +523,36 @@ static uint32_t ropFCOMPP(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uin
         return op_pc;
 }
 
+static uint32_t ropFUCOM(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
+{
+        FP_ENTER();
+        FP_COMPARE_REG(0, opcode & 7);
+       
+        return op_pc;
+}
+static uint32_t ropFUCOMP(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
+{
+        FP_ENTER();
+        FP_COMPARE_REG(0, opcode & 7);
+        FP_POP();
+       
+        return op_pc;
+}
+static uint32_t ropFUCOMPP(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
+{
+        FP_ENTER();
+        FP_COMPARE_REG(0, 1);
+        FP_POP2();
+       
+        return op_pc;
+}
+
 static uint32_t ropFSTSW_AX(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
 {
         int host_reg;
         
         FP_ENTER();
-        host_reg = LOAD_VAR_W((uintptr_t)&cpu_state.npxs);
+        host_reg = FP_LOAD_SW();
         STORE_REG_TARGET_W_RELEASE(host_reg, REG_AX);
         
         return op_pc;
@@ -654,6 +678,20 @@ static uint32_t ropFCHS(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint3
        
         return op_pc;
 }
+static uint32_t ropFABS(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
+{
+        FP_ENTER();
+        FP_FABS();
+       
+        return op_pc;
+}
+
+static uint32_t ropFNOP(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)
+{
+        FP_ENTER();
+       
+        return op_pc;
+}
 
 #define opFLDimm(name, v)                                                                                                       \
         static uint32_t ropFLD ## name(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t op_pc, codeblock_t *block)   \
@@ -8,7 +8,7 @@
  *
  *		Miscellaneous Instructions.
  *
- * Version:	@(#)codegen_ops_mmx.h	1.0.1	2018/02/14
+ * Version:	@(#)codegen_ops_mmx.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -45,6 +45,7 @@ static uint32_t ropMOVQ_q_mm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
         if ((fetchdat & 0xc0) == 0xc0)
         {
                 STORE_MMX_Q(fetchdat & 7, host_reg1, host_reg2);
+                MMX_CACHE_KEEP();
         }
         else
         {
@@ -71,6 +72,7 @@ static uint32_t ropMOVQ_mm_q(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
         
                 LOAD_MMX_Q(fetchdat & 7, &host_reg1, &host_reg2);
                 STORE_MMX_Q((fetchdat >> 3) & 7, host_reg1, host_reg2);
+                MMX_CACHE_KEEP();
         }
         else
         {
@@ -98,6 +100,7 @@ static uint32_t ropMOVD_l_mm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
         if ((fetchdat & 0xc0) == 0xc0)
         {
                 STORE_REG_TARGET_L_RELEASE(host_reg, fetchdat & 7);
+                MMX_CACHE_KEEP();
         }
         else
         {
@@ -121,6 +124,7 @@ static uint32_t ropMOVD_mm_l(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
         {
                 int host_reg = LOAD_REG_L(fetchdat & 7);
                 STORE_MMX_LQ((fetchdat >> 3) & 7, host_reg);
+                MMX_CACHE_KEEP();
         }
         else
         {
@@ -157,6 +161,7 @@ static uint32_t name(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t
                                                                                                                 \
                 CHECK_SEG_READ(target_seg);                                                                     \
                                                                                                                 \
+                MMX_CACHE_FLUSH();                                                                              \
                 MEM_LOAD_ADDR_EA_Q(target_seg);                                                                 \
                 src_reg1 = LOAD_Q_REG_1;                                                                        \
                 src_reg2 = LOAD_Q_REG_2;                                                                        \
@@ -165,6 +170,7 @@ static uint32_t name(uint8_t opcode, uint32_t fetchdat, uint32_t op_32, uint32_t
         xmm_dst = LOAD_MMX_Q_MMX((fetchdat >> 3) & 7);                                                          \
         func(xmm_dst, xmm_src);                                                                              \
         STORE_MMX_Q_MMX((fetchdat >> 3) & 7, xmm_dst);                                                          \
+        MMX_CACHE_KEEP();                                                                                       \
                                                                                                                 \
         return op_pc + 1;                                                                                       \
 }
@@ -245,6 +251,7 @@ static uint32_t ropPSxxW_imm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
                 break;
         }
         STORE_MMX_Q_MMX(fetchdat & 7, xmm_dst);
+        MMX_CACHE_KEEP();
         
         return op_pc + 2;
 }
@@ -273,6 +280,7 @@ static uint32_t ropPSxxD_imm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
                 break;
         }
         STORE_MMX_Q_MMX(fetchdat & 7, xmm_dst);
+        MMX_CACHE_KEEP();
         
         return op_pc + 2;
 }
@@ -284,6 +292,8 @@ static uint32_t ropPSxxQ_imm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
                 return 0;
         if ((fetchdat & 0x08) || !(fetchdat & 0x30))
                 return 0;
+        if ((fetchdat & 0x38) == 0x20) /*No PSRAQ on the host, leave it to the interpreter*/
+                return 0;
         
         MMX_ENTER();
         
@@ -293,14 +303,12 @@ static uint32_t ropPSxxQ_imm(uint8_t opcode, uint32_t fetchdat, uint32_t op_32,
                 case 0x10: /*PSRLQ*/
                 MMX_PSRLQ_imm(xmm_dst, (fetchdat >> 8) & 0xff);
                 break;
-                case 0x20: /*PSRAQ*/
-                MMX_PSRAQ_imm(xmm_dst, (fetchdat >> 8) & 0xff);
-                break;
                 case 0x30: /*PSLLQ*/
                 MMX_PSLLQ_imm(xmm_dst, (fetchdat >> 8) & 0xff);
                 break;
         }
         STORE_MMX_Q_MMX(fetchdat & 7, xmm_dst);
+        MMX_CACHE_KEEP();
         
         return op_pc + 2;
 }
@@ -8,7 +8,7 @@
  *
  *		Code generator definitions (64-bit)
  *
- * Version:	@(#)x86_ops_x86-64.h	1.0.1	2018/02/14
+ * Version:	@(#)x86_ops_x86-64.h	1.0.6	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -45,17 +45,36 @@
 
 #define IS_32_ADDR(x) !(((uintptr_t)x) & 0xffffffff00000000)
 
+/*Stores to the lazy flags state are reported to codegen_flags_store(), as
+  they can be dropped if the next instruction overwrites them anyway*/
+#define IS_FLAGS_ADDR(x) ((x) >= (uintptr_t)&cpu_state.flags_op && (x) <= (uintptr_t)&cpu_state.flags_op2)
+
 static inline int find_host_xmm_reg()
 {
-        int c;
+        int c, d;
         for (c = HOST_REG_XMM_START; c < HOST_REG_XMM_END; c++)
         {
                 if (host_reg_xmm_mapping[c] == -1)
+                        return c;
+        }
+
+        /*No free register, take one only caching MM registers. These are
+          always written through to cpu_state.MM, so can just be forgotten*/
+        for (c = HOST_REG_XMM_START; c < HOST_REG_XMM_END; c++)
+        {
+                if (host_reg_xmm_mapping[c] == XMM_MMX_CACHED)
                         break;
         }
         
         if (c == HOST_REG_XMM_END)
                 fatal("Out of host XMM regs!\n");
+
+        for (d = 0; d < 8; d++)
+        {
+                if (codegen_mmx_xmm[d] == c)
+                        codegen_mmx_xmm[d] = -1;
+        }
+        host_reg_xmm_mapping[c] = -1;
         return c;
 }
 static inline void call(codeblock_t *block, uintptr_t func)
@@ -538,6 +557,8 @@ static inline void STORE_IMM_REG_L(int reg, uint32_t val)
 
 static inline void STORE_IMM_ADDR_L(uintptr_t addr, uint32_t val)
 {
+        int start = block_pos;
+
         if (addr >= (uintptr_t)&cpu_state && addr < ((uintptr_t)&cpu_state)+0x100)
         {
                 addbyte(0xC7); /*MOVL [addr],val*/
@@ -562,6 +583,9 @@ static inline void STORE_IMM_ADDR_L(uintptr_t addr, uint32_t val)
                 addbyte(0x00 | REG_ESI);
                 addlong(val);
         }
+
+        if (IS_FLAGS_ADDR(addr))
+                codegen_flags_store(start);
 }
 
 
@@ -1737,7 +1761,8 @@ static inline void MEM_STORE_ADDR_IMM_L(x86seg *seg, uint32_t addr, int host_reg
 static inline void STORE_HOST_REG_ADDR_BL(uintptr_t addr, int host_reg)
 {
         int temp_reg = REG_ECX;
-        
+        int start = block_pos;
+
         if (host_reg_mapping[REG_ECX] != -1)
                 temp_reg = REG_EBX;
                 
@@ -1781,11 +1806,15 @@ static inline void STORE_HOST_REG_ADDR_BL(uintptr_t addr, int host_reg)
                 addbyte(0x89); /*MOV [RSI], temp_reg*/
                 addbyte(0x06 | (temp_reg << 3));
         }
+
+        if (IS_FLAGS_ADDR(addr))
+                codegen_flags_store(start);
 }
 static inline void STORE_HOST_REG_ADDR_WL(uintptr_t addr, int host_reg)
 {
         int temp_reg = REG_ECX;
-        
+        int start = block_pos;
+
         if (host_reg_mapping[REG_ECX] != -1)
                 temp_reg = REG_EBX;
                 
@@ -1815,9 +1844,14 @@ static inline void STORE_HOST_REG_ADDR_WL(uintptr_t addr, int host_reg)
                 addbyte(0x89); /*MOV [RSI], temp_reg*/
                 addbyte(0x06 | (temp_reg << 3));
         }
+
+        if (IS_FLAGS_ADDR(addr))
+                codegen_flags_store(start);
 }
 static inline void STORE_HOST_REG_ADDR_W(uintptr_t addr, int host_reg)
 {
+        int start = block_pos;
+
         if (addr >= (uintptr_t)&cpu_state && addr < ((uintptr_t)&cpu_state)+0x100)
         {
                 addbyte(0x66); /*MOVW [addr],host_reg*/
@@ -1849,9 +1883,14 @@ static inline void STORE_HOST_REG_ADDR_W(uintptr_t addr, int host_reg)
                 addbyte(0x89); /*MOVW [RSI],host_reg*/
                 addbyte(0x06 | ((host_reg & 7) << 3));
         }
+
+        if (IS_FLAGS_ADDR(addr))
+                codegen_flags_store(start);
 }
 static inline void STORE_HOST_REG_ADDR(uintptr_t addr, int host_reg)
 {
+        int start = block_pos;
+
         if (addr >= (uintptr_t)&cpu_state && addr < ((uintptr_t)&cpu_state)+0x100)
         {
                 if (host_reg & 8)
@@ -1880,6 +1919,9 @@ static inline void STORE_HOST_REG_ADDR(uintptr_t addr, int host_reg)
                 addbyte(0x89); /*MOVL [RSI],host_reg*/
                 addbyte(0x06 | ((host_reg & 7) << 3));
         }
+
+        if (IS_FLAGS_ADDR(addr))
+                codegen_flags_store(start);
 }
 
 static inline void AND_HOST_REG_B(int dst_reg, int src_reg)
@@ -3848,6 +3890,27 @@ static inline void FP_FXCH(int reg)
         addbyte(0x4c);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(MM));
+
+        addbyte(0x66); /*MOV DX, MM_w4[RBX*2]*/
+        addbyte(0x8b);
+        addbyte(0x54);
+        addbyte(0x5d);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x66); /*MOV CX, MM_w4[RAX*2]*/
+        addbyte(0x8b);
+        addbyte(0x4c);
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x66); /*MOV MM_w4[RAX*2], DX*/
+        addbyte(0x89);
+        addbyte(0x54);
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x66); /*MOV MM_w4[RBX*2], CX*/
+        addbyte(0x89);
+        addbyte(0x4c);
+        addbyte(0x5d);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
         reg = reg;
 }
 
@@ -3892,10 +3955,6 @@ static inline void FP_FLD(int reg)
         addbyte(0x54);
         addbyte(0xc5);
         addbyte((uint8_t)cpu_state_offset(MM));
-        addbyte(0x8a); /*MOV AL, [tag+EAX]*/
-        addbyte(0x44);
-        addbyte(0x05);
-        addbyte((uint8_t)cpu_state_offset(tag));
         addbyte(0x48); /*MOV ST[EBX*8], RCX*/
         addbyte(0x89);
         addbyte(0x4c);
@@ -3906,6 +3965,20 @@ static inline void FP_FLD(int reg)
         addbyte(0x54);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(MM));
+        addbyte(0x66); /*MOV DX, MM_w4[EAX*2]*/
+        addbyte(0x8b);
+        addbyte(0x54);
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x8a); /*MOV AL, [tag+EAX]*/
+        addbyte(0x44);
+        addbyte(0x05);
+        addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0x66); /*MOV MM_w4[EBX*2], DX*/
+        addbyte(0x89);
+        addbyte(0x54);
+        addbyte(0x5d);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
         addbyte(0x88); /*MOV [tag+EBX], AL*/
         addbyte(0x44);
         addbyte(0x1d);
@@ -3921,35 +3994,57 @@ static inline void FP_FST(int reg)
         addbyte(0x8b); /*MOV EAX, [TOP]*/
         addbyte(0x45);
         addbyte((uint8_t)cpu_state_offset(TOP));
-        addbyte(0x48); /*MOV RCX, ST[EAX*8]*/
-        addbyte(0x8b);
-        addbyte(0x4c);
-        addbyte(0xc5);
-        addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x8a); /*MOV BL, [tag+EAX]*/
-        addbyte(0x5c);
-        addbyte(0x05);
-        addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0x89); /*MOV EBX, EAX*/
+        addbyte(0xc3);
 
         if (reg)
         {
-                addbyte(0x83); /*ADD EAX, reg*/
-                addbyte(0xc0);
+                addbyte(0x83); /*ADD EBX, reg*/
+                addbyte(0xc3);
                 addbyte(reg);
-                addbyte(0x83); /*AND EAX, 7*/
-                addbyte(0xe0);
+                addbyte(0x83); /*AND EBX, 7*/
+                addbyte(0xe3);
                 addbyte(0x07);
         }
 
-        addbyte(0x48); /*MOV ST[EAX*8], RCX*/
-        addbyte(0x89);
+        addbyte(0x48); /*MOV RCX, ST[EAX*8]*/
+        addbyte(0x8b);
         addbyte(0x4c);
         addbyte(0xc5);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x88); /*MOV [tag+EAX], BL*/
-        addbyte(0x5c);
+        addbyte(0x48); /*MOV RDX, ST_i64[EAX*8]*/
+        addbyte(0x8b);
+        addbyte(0x54);
+        addbyte(0xc5);
+        addbyte((uint8_t)cpu_state_offset(MM));
+        addbyte(0x48); /*MOV ST[EBX*8], RCX*/
+        addbyte(0x89);
+        addbyte(0x4c);
+        addbyte(0xdd);
+        addbyte((uint8_t)cpu_state_offset(ST));
+        addbyte(0x48); /*MOV ST_i64[EBX*8], RDX*/
+        addbyte(0x89);
+        addbyte(0x54);
+        addbyte(0xdd);
+        addbyte((uint8_t)cpu_state_offset(MM));
+        addbyte(0x66); /*MOV CX, MM_w4[EAX*2]*/
+        addbyte(0x8b);
+        addbyte(0x4c);
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x8a); /*MOV DL, [tag+EAX]*/
+        addbyte(0x54);
         addbyte(0x05);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0x66); /*MOV MM_w4[EBX*2], CX*/
+        addbyte(0x89);
+        addbyte(0x4c);
+        addbyte(0x5d);
+        addbyte((uint8_t)cpu_state_offset(MM_w4));
+        addbyte(0x88); /*MOV [tag+EBX], DL*/
+        addbyte(0x54);
+        addbyte(0x1d);
+        addbyte((uint8_t)cpu_state_offset(tag));
 }
 
 static inline void FP_POP()
@@ -4012,8 +4107,6 @@ static inline void FP_LOAD_S()
         addbyte(0x83); /*AND EBX, 7*/
         addbyte(0xe3);
         addbyte(7);
-        addbyte(0x85); /*TEST EAX, EAX*/
-        addbyte(0xc0);
         addbyte(0x89); /*MOV TOP, EBX*/
         addbyte(0x5d);
         addbyte((uint8_t)cpu_state_offset(TOP));
@@ -4023,11 +4116,11 @@ static inline void FP_LOAD_S()
         addbyte(0x44);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x0f); /*SETE [tag+EBX]*/
-        addbyte(0x94);
+        addbyte(0xc6); /*MOVB [tag+EBX], 0*/
         addbyte(0x44);
         addbyte(0x1d);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0);
 }
 static inline void FP_LOAD_D()
 {
@@ -4040,9 +4133,6 @@ static inline void FP_LOAD_D()
         addbyte(0x83); /*AND EBX, 7*/
         addbyte(0xe3);
         addbyte(7);
-        addbyte(0x48); /*TEST RAX, RAX*/
-        addbyte(0x85);
-        addbyte(0xc0);
         addbyte(0x89); /*MOV TOP, EBX*/
         addbyte(0x5d);
         addbyte((uint8_t)cpu_state_offset(TOP));
@@ -4051,11 +4141,11 @@ static inline void FP_LOAD_D()
         addbyte(0x44);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x0f); /*SETE [tag+EBX]*/
-        addbyte(0x94);
+        addbyte(0xc6); /*MOVB [tag+EBX], 0*/
         addbyte(0x44);
         addbyte(0x1d);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0);
 }
 
 static inline void FP_LOAD_IW()
@@ -4076,8 +4166,6 @@ static inline void FP_LOAD_IW()
         addbyte(0x83); /*AND EBX, 7*/
         addbyte(0xe3);
         addbyte(7);
-        addbyte(0x85); /*TEST EAX, EAX*/
-        addbyte(0xc0);
         addbyte(0x89); /*MOV TOP, EBX*/
         addbyte(0x5d);
         addbyte((uint8_t)cpu_state_offset(TOP));
@@ -4087,11 +4175,11 @@ static inline void FP_LOAD_IW()
         addbyte(0x44);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x0f); /*SETE [tag+EBX]*/
-        addbyte(0x94);
+        addbyte(0xc6); /*MOVB [tag+EBX], 0*/
         addbyte(0x44);
         addbyte(0x1d);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0);
 }
 static inline void FP_LOAD_IL()
 {
@@ -4108,8 +4196,6 @@ static inline void FP_LOAD_IL()
         addbyte(0x83); /*AND EBX, 7*/
         addbyte(0xe3);
         addbyte(7);
-        addbyte(0x85); /*TEST EAX, EAX*/
-        addbyte(0xc0);
         addbyte(0x89); /*MOV TOP, EBX*/
         addbyte(0x5d);
         addbyte((uint8_t)cpu_state_offset(TOP));
@@ -4119,11 +4205,11 @@ static inline void FP_LOAD_IL()
         addbyte(0x44);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x0f); /*SETE [tag+EBX]*/
-        addbyte(0x94);
+        addbyte(0xc6); /*MOVB [tag+EBX], 0*/
         addbyte(0x44);
         addbyte(0x1d);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(0);
 }
 static inline void FP_LOAD_IQ()
 {
@@ -4141,9 +4227,6 @@ static inline void FP_LOAD_IQ()
         addbyte(0x83); /*AND EBX, 7*/
         addbyte(0xe3);
         addbyte(7);
-        addbyte(0x48); /*TEST RAX, RAX*/
-        addbyte(0x85);
-        addbyte(0xc0);
         addbyte(0x48); /*MOV [ST_i64+EBX*8], RAX*/
         addbyte(0x89);
         addbyte(0x44);
@@ -4152,21 +4235,17 @@ static inline void FP_LOAD_IQ()
         addbyte(0x89); /*MOV TOP, EBX*/
         addbyte(0x5d);
         addbyte((uint8_t)cpu_state_offset(TOP));
-        addbyte(0x0f); /*SETE AL*/
-        addbyte(0x94);
-        addbyte(0xc0);
         addbyte(0x66); /*MOVQ [ST+EBX*8], XMM0*/
         addbyte(0x0f);
         addbyte(0xd6);
         addbyte(0x44);
         addbyte(0xdd);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x0c); /*OR AL, TAG_UINT64*/
-        addbyte(TAG_UINT64);
-        addbyte(0x88); /*MOV [tag+EBX], AL*/
+        addbyte(0xc6); /*MOVB [tag+EBX], TAG_UINT64*/
         addbyte(0x44);
         addbyte(0x1d);
         addbyte((uint8_t)cpu_state_offset(tag));
+        addbyte(TAG_UINT64);
 }
 
 static inline void FP_LOAD_IMM_Q(uint64_t v)
@@ -4215,11 +4294,11 @@ static inline void FP_FCHS()
         addbyte(0x44);
         addbyte(0xc5);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x80); /*AND tag[EAX], ~TAG_UINT64*/
+        addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
         addbyte(0x64);
         addbyte(0x05);
         addbyte((uint8_t)cpu_state_offset(tag[0]));
-        addbyte(~TAG_UINT64);
+        addbyte(~TAG_EXACT);
         addbyte(0xf2); /*MOVSD ST[EAX*8], XMM0*/
         addbyte(0x0f);
         addbyte(0x11);
@@ -4228,6 +4307,45 @@ static inline void FP_FCHS()
         addbyte((uint8_t)cpu_state_offset(ST));
 }
 
+/*Status word with TOP merged in, as x87_getsw()*/
+static inline int FP_LOAD_SW()
+{
+        addbyte(0x8b); /*MOV EAX, [TOP]*/
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(TOP));
+        addbyte(0x0f); /*MOVZX EBX, [npxs]*/
+        addbyte(0xb7);
+        addbyte(0x5d);
+        addbyte((uint8_t)cpu_state_offset(npxs));
+        addbyte(0xc1); /*SHL EAX, 11*/
+        addbyte(0xe0);
+        addbyte(11);
+        addbyte(0x81); /*AND EBX, 0xc7ff*/
+        addbyte(0xe3);
+        addlong(0xc7ff);
+        addbyte(0x09); /*OR EBX, EAX*/
+        addbyte(0xc3);
+
+        return REG_EBX;
+}
+
+static inline void FP_FABS()
+{
+        addbyte(0x8b); /*MOV EAX, TOP*/
+        addbyte(0x45);
+        addbyte((uint8_t)cpu_state_offset(TOP));
+        addbyte(0x80); /*AND ST[EAX*8]+7, 0x7f*/
+        addbyte(0x64);
+        addbyte(0xc5);
+        addbyte((uint8_t)cpu_state_offset(ST) + 7);
+        addbyte(0x7f);
+        addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
+        addbyte(0x64);
+        addbyte(0x05);
+        addbyte((uint8_t)cpu_state_offset(tag[0]));
+        addbyte(~TAG_EXACT);
+}
+
 static inline int FP_LOAD_REG(int reg)
 {
         addbyte(0x8b); /*MOV EBX, TOP*/
@@ -4468,11 +4586,11 @@ static inline void FP_OP_REG(int op, int dst, int src)
                 addbyte(0xe0 | REG_EBX);
                 addbyte(0x07);
         }
-        addbyte(0x80); /*AND tag[EAX], ~TAG_UINT64*/
+        addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
         addbyte(0x64);
         addbyte(0x05);
         addbyte((uint8_t)cpu_state_offset(tag));
-        addbyte(~TAG_UINT64);
+        addbyte(~TAG_EXACT);
         if (op == FPU_DIVR || op == FPU_SUBR)
         {
                 addbyte(0xf3); /*MOVQ XMM0, ST[RBX*8]*/
@@ -4561,11 +4679,11 @@ static inline void FP_OP_MEM(int op)
         addbyte(0x44);
         addbyte(0xc5);
         addbyte((uint8_t)cpu_state_offset(ST));
-        addbyte(0x80); /*AND tag[EAX], ~TAG_UINT64*/
+        addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
         addbyte(0x64);
         addbyte(0x05);
         addbyte((uint8_t)cpu_state_offset(tag));
-        addbyte(~TAG_UINT64);
+        addbyte(~TAG_EXACT);
 
         switch (op)
         {
@@ -5014,10 +5132,61 @@ static inline void LOAD_MMX_Q(int guest_reg, int *host_reg1, int *host_reg2)
         
         *host_reg1 = host_reg;
 }
+/*MM registers stay cached in XMM registers across a run of recompiled
+  MMX instructions. Every store is written through to cpu_state.MM, so
+  the cache can be dropped at any point without losing state; it is
+  dropped by codegen_generate_call() after any instruction that did not
+  call MMX_CACHE_KEEP(), and before anything that may call out to C.
+  Registers cached by earlier instructions are marked XMM_MMX_CACHED, and
+  are taken back by find_host_xmm_reg() when it runs out. Several MM
+  registers may share an XMM register after a MOVQ between them.*/
+static inline void MMX_CACHE_FLUSH()
+{
+        int c;
+        
+        for (c = 0; c < 8; c++)
+        {
+                if (codegen_mmx_xmm[c] != -1)
+                        host_reg_xmm_mapping[codegen_mmx_xmm[c]] = -1;
+                codegen_mmx_xmm[c] = -1;
+        }
+}
+static inline void MMX_CACHE_KEEP()
+{
+        codegen_mmx_keep = 1;
+}
+static inline void MMX_CACHE_DROP(int guest_reg)
+{
+        int host_reg = codegen_mmx_xmm[guest_reg];
+        int c;
+
+        codegen_mmx_xmm[guest_reg] = -1;
+        if (host_reg == -1)
+                return;
+
+        /*Keep the XMM register if another MM register still lives in it*/
+        for (c = 0; c < 8; c++)
+        {
+                if (codegen_mmx_xmm[c] == host_reg)
+                        return;
+        }
+        host_reg_xmm_mapping[host_reg] = -1;
+}
+
 static inline int LOAD_MMX_Q_MMX(int guest_reg)
 {
-        int dst_reg = find_host_xmm_reg();
+        int dst_reg;
+        
+        if (codegen_mmx_xmm[guest_reg] != -1)
+        {
+                /*In use by this instruction now, so must not be taken back*/
+                host_reg_xmm_mapping[codegen_mmx_xmm[guest_reg]] = 100;
+                return codegen_mmx_xmm[guest_reg];
+        }
+        
+        dst_reg = find_host_xmm_reg();
         host_reg_xmm_mapping[dst_reg] = 100;
+        codegen_mmx_xmm[guest_reg] = dst_reg;
 
         addbyte(0xf3); /*MOV XMMx, reg*/
         addbyte(0x0f);
@@ -5048,6 +5217,8 @@ static inline int LOAD_INT_TO_MMX(int src_reg1, int src_reg2)
 
 static inline void STORE_MMX_LQ(int guest_reg, int host_reg1)
 {
+        MMX_CACHE_DROP(guest_reg);
+
         addbyte(0xC7); /*MOVL [reg],0*/
         addbyte(0x44);
         addbyte(0x25);
@@ -5062,6 +5233,8 @@ static inline void STORE_MMX_LQ(int guest_reg, int host_reg1)
 }
 static inline void STORE_MMX_Q(int guest_reg, int host_reg1, int host_reg2)
 {
+        MMX_CACHE_DROP(guest_reg);
+
         if (host_reg1 & 8)
                 addbyte(0x4c);
         else
@@ -5073,6 +5246,22 @@ static inline void STORE_MMX_Q(int guest_reg, int host_reg1, int host_reg2)
 }
 static inline void STORE_MMX_Q_MMX(int guest_reg, int host_reg)
 {
+        int c;
+
+        /*host_reg now holds the new value of guest_reg, so any other MM
+          register cached in it is out of date*/
+        for (c = 0; c < 8; c++)
+        {
+                if (c != guest_reg && codegen_mmx_xmm[c] == host_reg)
+                        codegen_mmx_xmm[c] = -1;
+        }
+        if (codegen_mmx_xmm[guest_reg] != host_reg)
+        {
+                MMX_CACHE_DROP(guest_reg);
+                codegen_mmx_xmm[guest_reg] = host_reg;
+        }
+        host_reg_xmm_mapping[host_reg] = 100;
+
         addbyte(0x66); /*MOVQ [guest_reg],host_reg*/
         addbyte(0x0f);
         addbyte(0xd6);
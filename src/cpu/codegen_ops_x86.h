@@ -8,7 +8,7 @@
  *
  *		Code generator definitions (32-bit)
  *
- * Version:	@(#)x86_ops_x86.h	1.0.1	2018/02/14
+ * Version:	@(#)x86_ops_x86.h	1.0.3	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -1773,6 +1773,8 @@ static inline void FP_FLD(int reg)
                 addbyte(0x8a); /*MOV AL, tag[reg][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(tag[(cpu_state.TOP + reg) & 7]));
+                addbyte(0x24); /*AND AL, ~TAG_FLOAT80*/
+                addbyte(~TAG_FLOAT80);
                 addbyte(0x66); /*MOVQ MM[-1][EBP], XMM1*/
                 addbyte(0x0f);
                 addbyte(0xd6);
@@ -1827,6 +1829,8 @@ static inline void FP_FLD(int reg)
                 addbyte(0x44);
                 addbyte(0x05);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
+                addbyte(0x24); /*AND AL, ~TAG_FLOAT80*/
+                addbyte(~TAG_FLOAT80);
                 addbyte(0xdd); /*FSTP [ST+EBX*8]*/
                 addbyte(0x5c);
                 addbyte(0xdd);
@@ -1862,6 +1866,8 @@ static inline void FP_FST(int reg)
                 addbyte(0x8a); /*MOV AL, tag[0][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
+                addbyte(0x24); /*AND AL, ~TAG_EXACT*/
+                addbyte(~TAG_EXACT);
                 addbyte(0x66); /*MOVQ ST[reg][EBP], XMM0*/
                 addbyte(0x0f);
                 addbyte(0xd6);
@@ -1884,6 +1890,9 @@ static inline void FP_FST(int reg)
                 addbyte(0x5c);
                 addbyte(0x05);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
+                addbyte(0x80); /*AND BL, ~TAG_EXACT*/
+                addbyte(0xe3);
+                addbyte(~TAG_EXACT);
 
                 if (reg)
                 {
@@ -1956,6 +1965,9 @@ static inline void FP_FXCH(int reg)
                 addbyte(0x8a); /*MOV AH, tag[reg][EBP]*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[(cpu_state.TOP + reg) & 7]));
+                addbyte(0x66); /*AND AX, ~(TAG_FLOAT80 * 0x101)*/
+                addbyte(0x25);
+                addword(~(TAG_FLOAT80 * 0x101));
                 addbyte(0x88); /*MOV tag[reg][EBP], AL*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(tag[(cpu_state.TOP + reg) & 7]));
@@ -2001,6 +2013,12 @@ static inline void FP_FXCH(int reg)
                 addbyte(0x54);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
+                addbyte(0x80); /*AND CL, ~TAG_FLOAT80*/
+                addbyte(0xe1);
+                addbyte(~TAG_FLOAT80);
+                addbyte(0x80); /*AND DL, ~TAG_FLOAT80*/
+                addbyte(0xe2);
+                addbyte(~TAG_FLOAT80);
                 addbyte(0x88); /*MOV tag[EBX], CL*/
                 addbyte(0x4c);
                 addbyte(0x1d);
@@ -2720,10 +2738,10 @@ static inline void FP_OP_S(int op)
                 addbyte(0xdd); /*FLD ST[dst][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
-                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xd8); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2743,11 +2761,11 @@ static inline void FP_OP_S(int op)
                 addbyte(0x44);
                 addbyte(0xdd);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xd8); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2777,10 +2795,10 @@ static inline void FP_OP_D(int op)
                 addbyte(0xdd); /*FLD ST[dst][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
-                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdc); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2816,11 +2834,11 @@ static inline void FP_OP_D(int op)
                 addbyte(0x44);
                 addbyte(0xdd);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdc); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2847,10 +2865,10 @@ static inline void FP_OP_IW(int op)
                 addbyte(0xdd); /*FLD ST[0][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
-                addbyte(0x80); /*AND tag[0][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[0][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xde); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2870,11 +2888,11 @@ static inline void FP_OP_IW(int op)
                 addbyte(0x44);
                 addbyte(0xdd);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xde); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2894,10 +2912,10 @@ static inline void FP_OP_IL(int op)
                 addbyte(0xdd); /*FLD ST[0][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
-                addbyte(0x80); /*AND tag[0][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[0][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xda); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2917,11 +2935,11 @@ static inline void FP_OP_IL(int op)
                 addbyte(0x44);
                 addbyte(0xdd);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xda); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2946,10 +2964,10 @@ static inline void FP_OP_IQ(int op)
                 addbyte(0xdd); /*FLD ST[0][EBP]*/
                 addbyte(0x45);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
-                addbyte(0x80); /*AND tag[0][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[0][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdc); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -2973,11 +2991,11 @@ static inline void FP_OP_IQ(int op)
                 addbyte(0x44);
                 addbyte(0xdd);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x1d);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdc); /*FADD [ESP]*/
                 addbyte(0x04 | op);
                 addbyte(0x24);
@@ -3281,10 +3299,10 @@ static inline void FP_OP_REG(int op, int dst, int src)
                 addbyte(0xdc); /*FADD ST[src][EBP]*/
                 addbyte(0x45 | op);
                 addbyte((uint8_t)cpu_state_offset(ST[(cpu_state.TOP + src) & 7]));
-                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[(cpu_state.TOP + dst) & 7]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdd); /*FSTP ST[dst][EBP]*/
                 addbyte(0x5d);
                 addbyte((uint8_t)cpu_state_offset(ST[(cpu_state.TOP + dst) & 7]));
@@ -3312,11 +3330,11 @@ static inline void FP_OP_REG(int op, int dst, int src)
                         addbyte(0x44);
                         addbyte(0xdd);
                         addbyte((uint8_t)cpu_state_offset(ST));
-                        addbyte(0x80); /*AND tag[EBX], ~TAG_UINT64*/
+                        addbyte(0x80); /*AND tag[EBX], ~TAG_EXACT*/
                         addbyte(0x64);
                         addbyte(0x1d);
                         addbyte((uint8_t)cpu_state_offset(tag[0]));
-                        addbyte(~TAG_UINT64);
+                        addbyte(~TAG_EXACT);
                         addbyte(0xdc); /*FADD ST[EAX*8]*/
                         addbyte(0x44 | op);
                         addbyte(0xc5);
@@ -3332,11 +3350,11 @@ static inline void FP_OP_REG(int op, int dst, int src)
                         addbyte(0x44);
                         addbyte(0xc5);
                         addbyte((uint8_t)cpu_state_offset(ST));
-                        addbyte(0x80); /*AND tag[EAX], ~TAG_UINT64*/
+                        addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
                         addbyte(0x64);
                         addbyte(0x05);
                         addbyte((uint8_t)cpu_state_offset(tag[0]));
-                        addbyte(~TAG_UINT64);
+                        addbyte(~TAG_EXACT);
                         addbyte(0xdc); /*FADD ST[EBX*8]*/
                         addbyte(0x44 | op);
                         addbyte(0xdd);
@@ -3449,10 +3467,10 @@ static inline void FP_FCHS()
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
                 addbyte(0xd9); /*FCHS*/
                 addbyte(0xe0);
-                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_EXACT*/
                 addbyte(0x65);
                 addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xdd); /*FSTP ST[dst][EBP]*/
                 addbyte(0x5d);
                 addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]));
@@ -3467,11 +3485,11 @@ static inline void FP_FCHS()
                 addbyte(0x44);
                 addbyte(0xc5);
                 addbyte((uint8_t)cpu_state_offset(ST));
-                addbyte(0x80); /*AND tag[EAX], ~TAG_UINT64*/
+                addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
                 addbyte(0x64);
                 addbyte(0x05);
                 addbyte((uint8_t)cpu_state_offset(tag[0]));
-                addbyte(~TAG_UINT64);
+                addbyte(~TAG_EXACT);
                 addbyte(0xd9); /*FCHS*/
                 addbyte(0xe0);
                 addbyte(0xdd); /*FSTP ST[EAX*8]*/
@@ -3481,6 +3499,51 @@ static inline void FP_FCHS()
         }
 }
 
+/*Status word with TOP merged in, as x87_getsw()*/
+static inline int FP_LOAD_SW()
+{
+        int host_reg = LOAD_VAR_WL((uintptr_t)&cpu_state.npxs);
+        int host_reg2 = LOAD_VAR_L((uintptr_t)&cpu_state.TOP);
+
+        AND_HOST_REG_IMM(host_reg, 0xc7ff);
+        SHL_L_IMM(host_reg2, 11);
+        OR_HOST_REG_L(host_reg, host_reg2);
+        RELEASE_REG(host_reg2);
+
+        return host_reg;
+}
+
+static inline void FP_FABS()
+{
+        if (codeblock[block_current].flags & CODEBLOCK_STATIC_TOP)
+        {
+                addbyte(0x80); /*AND ST[0][EBP]+7, 0x7f*/
+                addbyte(0x65);
+                addbyte((uint8_t)cpu_state_offset(ST[cpu_state.TOP]) + 7);
+                addbyte(0x7f);
+                addbyte(0x80); /*AND tag[dst][EBP], ~TAG_EXACT*/
+                addbyte(0x65);
+                addbyte((uint8_t)cpu_state_offset(tag[cpu_state.TOP]));
+                addbyte(~TAG_EXACT);
+        }
+        else
+        {
+                addbyte(0x8b); /*MOV EAX, TOP*/
+                addbyte(0x45);
+                addbyte((uint8_t)cpu_state_offset(TOP));
+                addbyte(0x80); /*AND ST[EAX*8]+7, 0x7f*/
+                addbyte(0x64);
+                addbyte(0xc5);
+                addbyte((uint8_t)cpu_state_offset(ST) + 7);
+                addbyte(0x7f);
+                addbyte(0x80); /*AND tag[EAX], ~TAG_EXACT*/
+                addbyte(0x64);
+                addbyte(0x05);
+                addbyte((uint8_t)cpu_state_offset(tag[0]));
+                addbyte(~TAG_EXACT);
+        }
+}
+
 static inline void UPDATE_NPXC(int reg)
 {
         addbyte(0x66); /*AND cpu_state.new_npxc, ~0xc00*/
@@ -3639,6 +3702,15 @@ static inline void MMX_ENTER()
 
 extern int mmx_ebx_ecx_loaded;
 
+/*There are not enough XMM registers free to cache MM registers between
+  instructions here, so every instruction reloads from cpu_state.*/
+static inline void MMX_CACHE_FLUSH()
+{
+}
+static inline void MMX_CACHE_KEEP()
+{
+}
+
 static inline int LOAD_MMX_D(int guest_reg)
 {
         int host_reg = find_host_reg();
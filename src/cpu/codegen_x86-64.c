@@ -8,7 +8,7 @@
  *
  *		Dynamic Recompiler for Intel x64 systems.
  *
- * Version:	@(#)codegen_x86-64.c	1.0.1	2018/02/14
+ * Version:	@(#)codegen_x86-64.c	1.0.11	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -39,6 +39,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "../emu.h"
 #include "cpu.h"
 #include "x86.h"
@@ -46,6 +47,8 @@
 #include "x86_ops.h"
 #include "x87.h"
 #include "../mem.h"
+#include "../devices/system/nmi.h"
+#include "../devices/system/pic.h"
 
 #include "386_common.h"
 
@@ -77,6 +80,8 @@ int host_reg_xmm_mapping[NR_HOST_XMM_REGS];
 codeblock_t *codeblock;
 codeblock_t **codeblock_hash;
 int codegen_mmx_entered = 0;
+int codegen_mmx_xmm[8];
+int codegen_mmx_keep = 0;
 
 int block_current = 0;
 static int block_num;
@@ -97,6 +102,205 @@ static uint32_t last_op32;
 static x86seg *last_ea_seg;
 static int last_ssegs;
 
+/*Size of a link slot, and offsets of its patchable fields.*/
+#define CHAIN_SLOT_SIZE 38
+#define CHAIN_SLOT_PC   3
+#define CHAIN_SLOT_CS   11
+#define CHAIN_SLOT_STAT 19
+#define CHAIN_SLOT_GEN  27
+#define CHAIN_SLOT_JMP  34
+/*Offset of the page mask in the chain entry code.*/
+#define CHAIN_ENTRY_MASK 15
+
+static int codegen_block_body;
+
+/*Returns 1 if an instruction overwrites all arithmetic flags, does not read
+  any, and can not fault, ie a register-only ADD, OR, AND, SUB, XOR, CMP or
+  TEST. Flags set by the previous instruction are dead in that case.*/
+static int codegen_flags_writer(uint8_t opcode, uint32_t fetchdat)
+{
+        int reg_only = ((fetchdat & 0xc0) == 0xc0);
+
+        switch (opcode)
+        {
+                case 0x00: case 0x01: case 0x02: case 0x03: /*ADD*/
+                case 0x08: case 0x09: case 0x0a: case 0x0b: /*OR*/
+                case 0x20: case 0x21: case 0x22: case 0x23: /*AND*/
+                case 0x28: case 0x29: case 0x2a: case 0x2b: /*SUB*/
+                case 0x30: case 0x31: case 0x32: case 0x33: /*XOR*/
+                case 0x38: case 0x39: case 0x3a: case 0x3b: /*CMP*/
+                case 0x84: case 0x85:                       /*TEST*/
+                return reg_only;
+
+                case 0x04: case 0x05: case 0x0c: case 0x0d:
+                case 0x24: case 0x25: case 0x2c: case 0x2d:
+                case 0x34: case 0x35: case 0x3c: case 0x3d:
+                case 0xa8: case 0xa9:
+                return 1;
+
+                case 0x80: case 0x81: case 0x83:
+                /*Not ADC or SBB, which read the carry flag*/
+                return reg_only && ((fetchdat & 0x38) != 0x10) && ((fetchdat & 0x38) != 0x18);
+        }
+
+        return 0;
+}
+
+/*Lazy flags stores of the last instruction recompiled, as (start, end)
+  offsets into the block.*/
+#define FLAGS_STORES_MAX 8
+
+static int codegen_flags_stores[FLAGS_STORES_MAX][2];
+static int codegen_flags_nr_stores;
+
+void codegen_flags_store(int start)
+{
+        if (codegen_flags_nr_stores < FLAGS_STORES_MAX)
+        {
+                codegen_flags_stores[codegen_flags_nr_stores][0] = start;
+                codegen_flags_stores[codegen_flags_nr_stores][1] = block_pos;
+                codegen_flags_nr_stores++;
+        }
+}
+
+/*Overwrite the lazy flags stores of the last instruction with NOPs. Only
+  called when the instruction being recompiled directly follows it in the
+  block and overwrites all flags, so the stored values can never be seen.*/
+static void codegen_flags_kill(codeblock_t *block)
+{
+        static const uint8_t nops[9][9] =
+        {
+                {0x90},
+                {0x66, 0x90},
+                {0x0f, 0x1f, 0x00},
+                {0x0f, 0x1f, 0x40, 0x00},
+                {0x0f, 0x1f, 0x44, 0x00, 0x00},
+                {0x66, 0x0f, 0x1f, 0x44, 0x00, 0x00},
+                {0x0f, 0x1f, 0x80, 0x00, 0x00, 0x00, 0x00},
+                {0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+                {0x66, 0x0f, 0x1f, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00}
+        };
+        int c;
+
+        for (c = 0; c < codegen_flags_nr_stores; c++)
+        {
+                int pos = codegen_flags_stores[c][0];
+                int end = codegen_flags_stores[c][1];
+
+                while (pos < end)
+                {
+                        int len = end - pos;
+
+                        if (len > 9)
+                                len = 9;
+                        memcpy(&block->data[pos], nops[len - 1], len);
+                        pos += len;
+                }
+                cpu_recomp_flags_dropped++;
+        }
+        codegen_flags_nr_stores = 0;
+}
+
+static void codegen_chain_patch(codeblock_t *block, int slot, codeblock_t *to)
+{
+        uint8_t *p = &block->data[block->chain_slot + slot * CHAIN_SLOT_SIZE];
+
+        if (to)
+        {
+                *(uint32_t *)&p[CHAIN_SLOT_PC] = to->pc - to->_cs;
+                *(uint32_t *)&p[CHAIN_SLOT_CS] = to->_cs;
+                *(uint32_t *)&p[CHAIN_SLOT_STAT] = cpu_cur_status;
+                *(uint32_t *)&p[CHAIN_SLOT_GEN] = codegen_chain_gen;
+                *(uint32_t *)&p[CHAIN_SLOT_JMP] = (uint32_t)(&to->data[to->chain_entry] - &p[CHAIN_SLOT_SIZE]);
+        }
+        else
+        {
+                /*Unlinked slots jump to the next instruction, ie fall through
+                  to the next slot or the block epilogue*/
+                *(uint32_t *)&p[CHAIN_SLOT_JMP] = 0;
+        }
+}
+
+static void codegen_chain_unlink_slot(codeblock_t *block, int slot)
+{
+        codeblock_t *to = block->link_to[slot];
+        codeblock_t **pb;
+        uint8_t *ps;
+
+        if (!to)
+                return;
+
+        pb = &to->link_in;
+        ps = &to->link_in_slot;
+        while (*pb)
+        {
+                codeblock_t *b = *pb;
+                int s = *ps;
+
+                if (b == block && s == slot)
+                {
+                        *pb = block->link_next[slot];
+                        *ps = block->link_next_slot[slot];
+                        break;
+                }
+                pb = &b->link_next[s];
+                ps = &b->link_next_slot[s];
+        }
+
+        block->link_to[slot] = NULL;
+        block->link_next[slot] = NULL;
+        codegen_chain_patch(block, slot, NULL);
+}
+
+/*Remove all links into and out of a block.*/
+static void codegen_chain_unlink(codeblock_t *block)
+{
+        codegen_chain_unlink_slot(block, 0);
+        codegen_chain_unlink_slot(block, 1);
+
+        while (block->link_in)
+                codegen_chain_unlink_slot(block->link_in, block->link_in_slot);
+}
+
+void codegen_chain_link(codeblock_t *from, codeblock_t *to)
+{
+        int slot;
+
+        if (!from->valid || !from->was_recompiled || !from->chain_slot)
+                return;
+        if (!to->valid || !to->was_recompiled || !to->chain_entry)
+                return;
+        /*The dispatcher recompiles blocks built for a static top-of-stack
+          when TOP has changed, a linked jump would skip that check*/
+        if (to->flags & CODEBLOCK_STATIC_TOP)
+                return;
+
+        if (from->link_to[0] == to)
+                slot = 0;
+        else if (from->link_to[1] == to)
+                slot = 1;
+        else if (!from->link_to[0])
+                slot = 0;
+        else
+                slot = 1;
+
+        if (from->link_to[slot] == to)
+        {
+                /*Refresh a link made stale by an MMU flush or status change*/
+                codegen_chain_patch(from, slot, to);
+                return;
+        }
+
+        codegen_chain_unlink_slot(from, slot);
+
+        from->link_to[slot] = to;
+        from->link_next[slot] = to->link_in;
+        from->link_next_slot[slot] = to->link_in_slot;
+        to->link_in = from;
+        to->link_in_slot = slot;
+        codegen_chain_patch(from, slot, to);
+}
+
 void codegen_init()
 {
         int c;
@@ -140,9 +344,12 @@ void codegen_reset()
         memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
         memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
         mem_reset_page_blocks();
+        codegen_smc_reset();
 
         for (c = 0; c < BLOCK_SIZE; c++)
                 codeblock[c].valid = 0;
+
+        codegen_chain_from = NULL;
 }
 
 void dump_block()
@@ -260,6 +467,10 @@ static void delete_block(codeblock_t *block)
                 fatal("Deleting deleted block\n");
         block->valid = 0;
 
+        codegen_chain_unlink(block);
+        if (codegen_chain_from == block)
+                codegen_chain_from = NULL;
+
         codeblock_tree_delete(block);
         remove_from_block_list(block, old_pc);
 }
@@ -270,7 +481,7 @@ void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
 
         while (block)
         {
-                if (mask & block->page_mask)
+                if ((mask & block->page_mask) && !codegen_smc_keep(page, block))
                 {
                         delete_block(block);
                         cpu_recomp_evicted++;
@@ -284,7 +495,7 @@ void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
         
         while (block)
         {
-                if (mask & block->page_mask2)
+                if ((mask & block->page_mask2) && !codegen_smc_keep(page, block))
                 {
                         delete_block(block);
                         cpu_recomp_evicted++;
@@ -333,6 +544,12 @@ void codegen_block_init(uint32_t phys_addr)
         
         block->was_recompiled = 0;
 
+        block->link_to[0] = block->link_to[1] = NULL;
+        block->link_next[0] = block->link_next[1] = NULL;
+        block->link_in = NULL;
+        block->chain_slot = block->chain_exit = block->chain_entry = 0;
+        block->smc_clean_runs = 0;
+
         recomp_page = block->phys & ~0xfff;
         
         codeblock_tree_add(block);
@@ -341,6 +558,7 @@ void codegen_block_init(uint32_t phys_addr)
 void codegen_block_start_recompile(codeblock_t *block)
 {
         page_t *page = &pages[block->phys >> 12];
+        int c;
         
         if (!page->block[(block->phys >> 10) & 3])
                 mem_flush_write_page(block->phys, cs+cpu_state.pc);
@@ -352,6 +570,10 @@ void codegen_block_start_recompile(codeblock_t *block)
                 fatal("Recompile to used block!\n");
 
         block->status = cpu_cur_status;
+
+        /*Old code is about to be overwritten*/
+        codegen_chain_unlink(block);
+        block->chain_slot = block->chain_exit = block->chain_entry = 0;
         
         block_pos = BLOCK_GPF_OFFSET;
 #if WIN64
@@ -409,6 +631,7 @@ void codegen_block_start_recompile(codeblock_t *block)
         addbyte(0x48); /*MOVL RBP, &cpu_state*/
         addbyte(0xBD);
         addquad(((uintptr_t)&cpu_state) + 128);
+        codegen_block_body = block_pos;
 
 //        pclog("New block %i for %08X   %03x\n", block_current, cs+pc, block_num);
 
@@ -422,11 +645,16 @@ void codegen_block_start_recompile(codeblock_t *block)
         codegen_block_ins = 0;
         codegen_block_full_ins = 0;
 
+        codegen_flags_nr_stores = 0;
+
         recomp_page = block->phys & ~0xfff;
         
         codegen_flags_changed = 0;
         codegen_fpu_entered = 0;
         codegen_mmx_entered = 0;
+        codegen_mmx_keep = 0;
+        for (c = 0; c < 8; c++)
+                codegen_mmx_xmm[c] = -1;
         
         codegen_fpu_loaded_iq[0] = codegen_fpu_loaded_iq[1] = codegen_fpu_loaded_iq[2] = codegen_fpu_loaded_iq[3] =
         codegen_fpu_loaded_iq[4] = codegen_fpu_loaded_iq[5] = codegen_fpu_loaded_iq[6] = codegen_fpu_loaded_iq[7] = 0;
@@ -526,6 +754,10 @@ void codegen_block_end()
 
 void codegen_block_end_recompile(codeblock_t *block)
 {
+        int exit_fixup[6], nr_fixups = 0;
+        int chain_guard, chain_entry, entry_exit;
+        int c;
+
         codegen_timing_block_end();
 
         if (codegen_block_cycles)
@@ -552,6 +784,113 @@ void codegen_block_end_recompile(codeblock_t *block)
                 addlong(codegen_block_full_ins);
         }
 #endif
+        /*Chain exit. All exits from the block, including the shared exit
+          code at BLOCK_EXIT_OFFSET, come through here.*/
+        chain_guard = block_pos;
+        addbyte(0x83); /*CMP cycles, 0*/
+        addbyte(0x7d);
+        addbyte((uint8_t)cpu_state_offset(_cycles));
+        addbyte(0);
+        addbyte(0x0f); /*JLE exit*/
+        addbyte(0x8e);
+        exit_fixup[nr_fixups++] = block_pos;
+        addlong(0);
+        addbyte(0x80); /*CMP abrt, 0*/
+        addbyte(0x7d);
+        addbyte((uint8_t)cpu_state_offset(abrt));
+        addbyte(0);
+        addbyte(0x0f); /*JNE exit*/
+        addbyte(0x85);
+        exit_fixup[nr_fixups++] = block_pos;
+        addlong(0);
+        addbyte(0x48); /*MOV RAX, &flags*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&flags);
+        addbyte(0xf6); /*TEST [RAX+1], T_FLAG >> 8*/
+        addbyte(0x40);
+        addbyte(1);
+        addbyte(T_FLAG >> 8);
+        addbyte(0x0f); /*JNE exit*/
+        addbyte(0x85);
+        exit_fixup[nr_fixups++] = block_pos;
+        addlong(0);
+        addbyte(0x48); /*MOV RAX, &pic_intpending*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&pic_intpending);
+        addbyte(0x83); /*CMP [RAX], 0*/
+        addbyte(0x38);
+        addbyte(0);
+        addbyte(0x0f); /*JNE exit*/
+        addbyte(0x85);
+        exit_fixup[nr_fixups++] = block_pos;
+        addlong(0);
+        addbyte(0x48); /*MOV RAX, &nmi*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&nmi);
+        addbyte(0x83); /*CMP [RAX], 0*/
+        addbyte(0x38);
+        addbyte(0);
+        addbyte(0x0f); /*JNE exit*/
+        addbyte(0x85);
+        exit_fixup[nr_fixups++] = block_pos;
+        addlong(0);
+        addbyte(0x48); /*MOV RAX, &cpu_cur_status*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&cpu_cur_status);
+        addbyte(0x48); /*MOV RCX, &codegen_chain_gen*/
+        addbyte(0xb9);
+        addquad((uintptr_t)&codegen_chain_gen);
+        addbyte(0x48); /*MOV RDX, &cs*/
+        addbyte(0xba);
+        addquad((uintptr_t)&cs);
+
+        block->chain_slot = block_pos;
+        for (c = 0; c < 2; c++)
+        {
+                /*Link slot, patched by codegen_chain_link()*/
+                addbyte(0x81); /*CMP pc, imm32*/
+                addbyte(0x7d);
+                addbyte((uint8_t)cpu_state_offset(pc));
+                addlong(0);
+                addbyte(0x75); /*JNE next*/
+                addbyte(29);
+                addbyte(0x81); /*CMP [RDX], imm32*/
+                addbyte(0x3a);
+                addlong(0);
+                addbyte(0x75); /*JNE next*/
+                addbyte(21);
+                addbyte(0x81); /*CMP [RAX], imm32*/
+                addbyte(0x38);
+                addlong(0);
+                addbyte(0x75); /*JNE next*/
+                addbyte(13);
+                addbyte(0x81); /*CMP [RCX], imm32*/
+                addbyte(0x39);
+                addlong(0);
+                addbyte(0x75); /*JNE next*/
+                addbyte(5);
+                addbyte(0xe9); /*JMP successor*/
+                addlong(0);
+        }
+
+        /*Exit taken by the chain entry. The block has not run, so it must
+          not be linked from, least of all to itself*/
+        entry_exit = block_pos;
+        addbyte(0x31); /*XOR ECX, ECX*/
+        addbyte(0xc9);
+        addbyte(0xeb); /*JMP store*/
+        addbyte(10);
+
+        block->chain_exit = block_pos;
+        addbyte(0x48); /*MOV RCX, block*/
+        addbyte(0xb9);
+        addquad((uintptr_t)block);
+        addbyte(0x48); /*MOV RAX, &codegen_chain_from*/
+        addbyte(0xb8);
+        addquad((uintptr_t)&codegen_chain_from);
+        addbyte(0x48); /*MOV [RAX], RCX*/
+        addbyte(0x89);
+        addbyte(0x08);
         addbyte(0x48); /*ADDL $40,%rsp*/
         addbyte(0x83);
         addbyte(0xC4);
@@ -569,21 +908,60 @@ void codegen_block_end_recompile(codeblock_t *block)
         addbyte(0x5d); /*POP RBP*/
         addbyte(0x5b); /*POP RDX*/
         addbyte(0xC3); /*RET*/
-        
+
+        /*Chain entry. Linked blocks jump here instead of to the prologue, so
+          the dirty mask check normally done by the dispatcher is repeated.*/
+        chain_entry = block_pos;
+        addbyte(0x48); /*MOV RAX, dirty_mask*/
+        addbyte(0xb8);
+        addquad((uintptr_t)block->dirty_mask);
+        addbyte(0x48); /*MOV RAX, [RAX]*/
+        addbyte(0x8b);
+        addbyte(0x00);
+        addbyte(0x48); /*MOV RCX, page_mask*/
+        addbyte(0xb9);
+        addquad(0);
+        addbyte(0x48); /*TEST RAX, RCX*/
+        addbyte(0x85);
+        addbyte(0xc8);
+        addbyte(0x0f); /*JNE entry_exit*/
+        addbyte(0x85);
+        addlong(entry_exit - (block_pos + 4));
+        addbyte(0xe9); /*JMP body*/
+        addlong(codegen_block_body - (block_pos + 4));
+
         if (block_pos > BLOCK_GPF_OFFSET)
                 fatal("Over limit!\n");
 
+        for (c = 0; c < nr_fixups; c++)
+                *(uint32_t *)&block->data[exit_fixup[c]] = block->chain_exit - (exit_fixup[c] + 4);
+
+        /*Redirect the shared exit code to the chain exit*/
+        block->data[BLOCK_EXIT_OFFSET] = 0xe9; /*JMP chain_guard*/
+        *(uint32_t *)&block->data[BLOCK_EXIT_OFFSET + 1] = chain_guard - (BLOCK_EXIT_OFFSET + 5);
+
         remove_from_block_list(block, block->pc);
         block->next = block->prev = NULL;
         block->next_2 = block->prev_2 = NULL;
         codegen_block_generate_end_mask();
         add_to_block_list(block);
+
+        /*Blocks spanning two pages need the second page translation checked
+          by the dispatcher, so are never link targets*/
+        if (!block->page_mask2)
+        {
+                *(uint64_t *)&block->data[chain_entry + CHAIN_ENTRY_MASK] = block->page_mask;
+                block->chain_entry = chain_entry;
+        }
+
+        codegen_smc_block_end(block);
 //        pclog("End block %i\n", block_num);
 }
 
 void codegen_flush()
 {
-        return;
+        /*Translations may have changed, invalidate all block links*/
+        codegen_chain_gen++;
 }
 
 static int opcode_modrm[256] =
@@ -987,6 +1365,16 @@ void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t
                 host_reg_mapping[c] = -1;
         for (c = 0; c < NR_HOST_XMM_REGS; c++)
                 host_reg_xmm_mapping[c] = -1;
+        /*MM registers cached by the previous instruction stay valid only if
+          it was recompiled MMX code that asked for them to be kept*/
+        for (c = 0; c < 8; c++)
+        {
+                if (!codegen_mmx_keep)
+                        codegen_mmx_xmm[c] = -1;
+                else if (codegen_mmx_xmm[c] != -1)
+                        host_reg_xmm_mapping[codegen_mmx_xmm[c]] = XMM_MMX_CACHED;
+        }
+        codegen_mmx_keep = 0;
         
         codegen_timing_start();
 
@@ -1134,6 +1522,14 @@ void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t
         
 generate_call:
         codegen_timing_opcode(opcode, fetchdat, op_32);
+
+        /*The flags stores of the previous instruction are dropped if this one
+          overwrites all flags. It would not be recompiled into this block if
+          the previous one had ended it, so nothing in between can look at
+          the dropped values.*/
+        if (op_table == x86_dynarec_opcodes && codegen_flags_writer(opcode, fetchdat))
+                codegen_flags_kill(block);
+        codegen_flags_nr_stores = 0;
         
         if ((op_table == x86_dynarec_opcodes &&
               ((opcode & 0xf0) == 0x70 || (opcode & 0xfc) == 0xe0 || opcode == 0xc2 ||
@@ -1180,6 +1576,8 @@ generate_call:
         if (recomp_op_table && recomp_op_table[(opcode | op_32) & 0x1ff])
         {
                 uint32_t new_pc = recomp_op_table[(opcode | op_32) & 0x1ff](opcode, fetchdat, op_32, op_pc, block);
+                if (!new_pc)
+                        codegen_mmx_keep = 0;
                 if (new_pc)
                 {
                         if (new_pc != -1)
@@ -8,7 +8,7 @@
  *
  *		Definitions for the 64-bit code generator.
  *
- * Version:	@(#)codegen_x86-64.h	1.0.1	2018/02/14
+ * Version:	@(#)codegen_x86-64.h	1.0.5	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -46,7 +46,8 @@
 #define BLOCK_EXIT_OFFSET 0x7e0
 #define BLOCK_GPF_OFFSET (BLOCK_EXIT_OFFSET - 20)
 
-#define BLOCK_MAX 1620
+/*Leaves room for the block chaining exit code (see codegen_block_end_recompile)*/
+#define BLOCK_MAX 1360
 
 enum
 {
@@ -57,3 +58,8 @@ enum
 extern int host_reg_mapping[NR_HOST_REGS];
 #define NR_HOST_XMM_REGS 8
 extern int host_reg_xmm_mapping[NR_HOST_XMM_REGS];
+/*host_reg_xmm_mapping[] value of an XMM register that only holds MM registers
+  cached by earlier instructions, and can be taken back if needed*/
+#define XMM_MMX_CACHED 101
+extern int codegen_mmx_xmm[8];
+extern int codegen_mmx_keep;
@@ -8,7 +8,7 @@
  *
  *		Dynamic Recompiler for Intel 32-bit systems.
  *
- * Version:	@(#)codegen_x86.c	1.0.3	2018/05/05
+ * Version:	@(#)codegen_x86.c	1.0.5	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -1256,6 +1256,7 @@ void codegen_reset()
         memset(codeblock, 0, BLOCK_SIZE * sizeof(codeblock_t));
         memset(codeblock_hash, 0, HASH_SIZE * sizeof(codeblock_t *));
         mem_reset_page_blocks();
+        codegen_smc_reset();
 }
 
 void dump_block()
@@ -1382,7 +1383,7 @@ void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
 
         while (block)
         {
-                if (mask & block->page_mask)
+                if ((mask & block->page_mask) && !codegen_smc_keep(page, block))
                 {
                         delete_block(block);
                         cpu_recomp_evicted++;
@@ -1396,7 +1397,7 @@ void codegen_check_flush(page_t *page, uint64_t mask, uint32_t phys_addr)
         
         while (block)
         {
-                if (mask & block->page_mask2)
+                if ((mask & block->page_mask2) && !codegen_smc_keep(page, block))
                 {
                         delete_block(block);
                         cpu_recomp_evicted++;
@@ -1648,6 +1649,8 @@ void codegen_block_end_recompile(codeblock_t *block)
 
         if (!(block->flags & CODEBLOCK_HAS_FPU))
                 block->flags &= ~CODEBLOCK_STATIC_TOP;
+
+        codegen_smc_block_end(block);
 }
 
 void codegen_flush()
@@ -1655,6 +1658,13 @@ void codegen_flush()
         return;
 }
 
+void codegen_chain_link(codeblock_t *from, codeblock_t *to)
+{
+        /*Block chaining is not implemented on 32-bit hosts, all blocks
+          return to the dispatcher*/
+        return;
+}
+
 static int opcode_modrm[256] =
 {
         1, 1, 1, 1,  0, 0, 0, 0,  1, 1, 1, 1,  0, 0, 0, 0,  /*00*/
@@ -8,7 +8,7 @@
  *
  *		CPU type handler.
  *
- * Version:	@(#)cpu.c	1.0.7	2018/05/06
+ * Version:	@(#)cpu.c	1.0.11	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -47,9 +47,13 @@
 #include "../device.h"
 #include "../machines/machine.h"
 #include "../io.h"
+#include "x86.h"
+#include "x87.h"
 #include "x86_ops.h"
 #include "../mem.h"
 #include "../devices/system/pci.h"
+#include "../timer.h"
+#include "../state.h"
 #ifdef USE_DYNAREC
 # include "codegen.h"
 #endif
@@ -131,6 +135,7 @@ int		cpu_prefetch_cycles, cpu_prefetch_width,
 int		cpu_waitstates;
 int		cpu_cache_int_enabled, cpu_cache_ext_enabled;
 int		cpu_pci_speed;
+int		cpu_idle_cycles;
 
 int		is286,
 		is386,
@@ -1808,7 +1813,8 @@ void cpu_RDMSR()
                         break;
 			default:
 #ifndef RELEASE_BUILD
-			pclog("Invalid MSR: %08X\n", ECX);
+			pclog_lvl(PCLOG_CAT_CPU, PCLOG_WARNING,
+				"Invalid MSR: %08X\n", ECX);
 #endif
 			x86gpf(NULL, 0);
 			break;
@@ -1961,7 +1967,8 @@ void cpu_RDMSR()
 			default:
 i686_invalid_rdmsr:
 #ifndef RELEASE_BUILD
-			pclog("Invalid MSR: %08X\n", ECX);
+			pclog_lvl(PCLOG_CAT_CPU, PCLOG_WARNING,
+				"Invalid MSR: %08X\n", ECX);
 #endif
 			x86gpf(NULL, 0);
 			break;
@@ -2143,7 +2150,8 @@ void cpu_WRMSR()
 			default:
 i686_invalid_wrmsr:
 #ifndef RELEASE_BUILD
-			pclog("Invalid MSR: %08X\n", ECX);
+			pclog_lvl(PCLOG_CAT_CPU, PCLOG_WARNING,
+				"Invalid MSR: %08X\n", ECX);
 #endif
 			x86gpf(NULL, 0);
 			break;
@@ -2288,3 +2296,278 @@ cpu_update_waitstates(void)
         if (cpu_s->rspeed <= 8000000)
                 cpu_rom_prefetch_cycles = cpu_mem_prefetch_cycles;
 }
+
+
+/*
+ * Called by HLT when interrupts are enabled and none is pending.
+ *
+ * Nothing can wake the CPU up before the next timer event, so
+ * rather than running HLT over and over until that happens, we
+ * use up all cycles up to that event (or to the end of the frame)
+ * right away. The skipped cycles are counted as idle time, which
+ * the main loop uses to give the host its time back.
+ */
+void
+cpu_idle_skip(void)
+{
+    int64_t left;
+
+    if (AT)
+	left = (timer_count - (timer_start - ((int64_t)cycles << TIMER_SHIFT))) >> TIMER_SHIFT;
+      else
+	left = (timer_count - (timer_start - ((int64_t)cycles * xt_cpu_multi))) / xt_cpu_multi;
+    if (left > cycles)
+	left = cycles;
+    if (left <= 0) return;
+
+    cycles -= (int)left;
+    cpu_idle_cycles += (int)left;
+}
+
+
+/*
+ * Registers that only exist in some builds. These are saved by
+ * name, so a snapshot taken by a build that has a different set
+ * of them can still be loaded.
+ */
+#define CPU_STATE_VERSION	1		/* layout of the CPU section */
+
+#define CPU_REG(x)	{ #x, &(x), sizeof(x) }
+static const struct {
+    const char	*name;
+    void	*ptr;
+    uint32_t	size;
+} cpu_opt_regs[] = {
+#if defined(DEV_BRANCH) && defined(USE_I686)
+    CPU_REG(cs_msr),
+    CPU_REG(esp_msr),
+    CPU_REG(eip_msr),
+    CPU_REG(apic_base_msr),
+    CPU_REG(mtrr_physbase_msr),
+    CPU_REG(mtrr_physmask_msr),
+    CPU_REG(mtrr_fix64k_8000_msr),
+    CPU_REG(mtrr_fix16k_8000_msr),
+    CPU_REG(mtrr_fix16k_a000_msr),
+    CPU_REG(mtrr_fix4k_msr),
+    CPU_REG(pat_msr),
+    CPU_REG(mtrr_deftype_msr),
+    CPU_REG(msr_ia32_pmc),
+    CPU_REG(ecx17_msr),
+    CPU_REG(ecx79_msr),
+    CPU_REG(ecx8x_msr),
+    CPU_REG(ecx116_msr),
+    CPU_REG(ecx11x_msr),
+    CPU_REG(ecx11e_msr),
+    CPU_REG(ecx186_msr),
+    CPU_REG(ecx187_msr),
+    CPU_REG(ecx1e0_msr),
+    CPU_REG(ecx570_msr),
+#endif
+#if defined(DEV_BRANCH) && defined(USE_AMD_K)
+    CPU_REG(ecx83_msr),
+    CPU_REG(star),
+    CPU_REG(sfmask),
+#endif
+    { NULL, NULL, 0 }
+};
+
+
+/*
+ * Save the state of the processor.
+ *
+ * The cpu_state structure is saved field by field, as it holds
+ * a pointer, and its layout is not the same in all builds.
+ */
+void
+cpu_save_state(void)
+{
+    uint32_t ver = CPU_STATE_VERSION;
+    int c;
+
+    state_put(ver);
+
+    state_put(cpu_state.regs);
+    state_put(cpu_state.tag);
+    state_put(cpu_state.eaaddr);
+    state_put(cpu_state.flags_op);
+    state_put(cpu_state.flags_res);
+    state_put(cpu_state.flags_op1);
+    state_put(cpu_state.flags_op2);
+    state_put(cpu_state.pc);
+    state_put(cpu_state.oldpc);
+    state_put(cpu_state.op32);
+    state_put(cpu_state.TOP);
+    state_put(cpu_state.ismmx);
+    state_put(cpu_state.npxs);
+    state_put(cpu_state.npxc);
+    state_put(cpu_state.ST);
+    state_put(cpu_state.MM_w4);
+    state_put(cpu_state.MM);
+    state_put(cpu_state.old_npxc);
+    state_put(cpu_state.new_npxc);
+
+    state_put(flags);
+    state_put(eflags);
+    state_put(CR0);
+    state_put(cr2);
+    state_put(cr3);
+    state_put(cr4);
+    state_put(dr);
+
+    state_put(gdt);
+    state_put(ldt);
+    state_put(idt);
+    state_put(tr);
+    state_put(_cs);
+    state_put(_ds);
+    state_put(_es);
+    state_put(_ss);
+    state_put(_fs);
+    state_put(_gs);
+    state_put(_oldds);
+    state_put(oldcs);
+    state_put(use32);
+    state_put(stack32);
+    state_put(cpu_cur_status);
+    state_put(nmi_enable);
+
+    state_put(x87_pc_off);
+    state_put(x87_op_off);
+    state_put(x87_pc_seg);
+    state_put(x87_op_seg);
+
+    state_put(tsc);
+    state_put(pmc);
+    state_put(msr);
+
+    state_put(cpu_cache_int_enabled);
+    state_put(cpu_cache_ext_enabled);
+    state_put(ccr0);
+    state_put(ccr1);
+    state_put(ccr2);
+    state_put(ccr3);
+    state_put(ccr4);
+    state_put(ccr5);
+    state_put(ccr6);
+
+    /* The optional registers go last, ended by an empty name. */
+    for (c = 0; cpu_opt_regs[c].name != NULL; c++) {
+	state_write_str(cpu_opt_regs[c].name);
+	state_put(cpu_opt_regs[c].size);
+	state_write(cpu_opt_regs[c].ptr, cpu_opt_regs[c].size);
+    }
+    state_write_str("");
+}
+
+
+/* Restore the state of the processor. */
+void
+cpu_load_state(int version)
+{
+    char name[32];
+    uint8_t skip[64];
+    uint32_t ver, size;
+    int c;
+
+    /* Version 1 files have the old (raw) layout, no version. */
+    ver = 0;
+    if (version >= 2)
+	state_get(ver);
+    if (ver != CPU_STATE_VERSION) {
+	pclog("CPU: state version %lu, expected %i\n",
+				(unsigned long)ver, CPU_STATE_VERSION);
+	state_set_error();
+	return;
+    }
+
+    state_get(cpu_state.regs);
+    state_get(cpu_state.tag);
+    state_get(cpu_state.eaaddr);
+    state_get(cpu_state.flags_op);
+    state_get(cpu_state.flags_res);
+    state_get(cpu_state.flags_op1);
+    state_get(cpu_state.flags_op2);
+    state_get(cpu_state.pc);
+    state_get(cpu_state.oldpc);
+    state_get(cpu_state.op32);
+    state_get(cpu_state.TOP);
+    state_get(cpu_state.ismmx);
+    state_get(cpu_state.npxs);
+    state_get(cpu_state.npxc);
+    state_get(cpu_state.ST);
+    state_get(cpu_state.MM_w4);
+    state_get(cpu_state.MM);
+    state_get(cpu_state.old_npxc);
+    state_get(cpu_state.new_npxc);
+
+    /* These only live during an instruction. */
+    cpu_state.ea_seg = &_ds;
+    cpu_state.ssegs = 0;
+    cpu_state.abrt = 0;
+
+    state_get(flags);
+    state_get(eflags);
+    state_get(CR0);
+    state_get(cr2);
+    state_get(cr3);
+    state_get(cr4);
+    state_get(dr);
+
+    state_get(gdt);
+    state_get(ldt);
+    state_get(idt);
+    state_get(tr);
+    state_get(_cs);
+    state_get(_ds);
+    state_get(_es);
+    state_get(_ss);
+    state_get(_fs);
+    state_get(_gs);
+    state_get(_oldds);
+    state_get(oldcs);
+    state_get(use32);
+    state_get(stack32);
+    state_get(cpu_cur_status);
+    state_get(nmi_enable);
+
+    state_get(x87_pc_off);
+    state_get(x87_op_off);
+    state_get(x87_pc_seg);
+    state_get(x87_op_seg);
+
+    state_get(tsc);
+    state_get(pmc);
+    state_get(msr);
+
+    state_get(cpu_cache_int_enabled);
+    state_get(cpu_cache_ext_enabled);
+    state_get(ccr0);
+    state_get(ccr1);
+    state_get(ccr2);
+    state_get(ccr3);
+    state_get(ccr4);
+    state_get(ccr5);
+    state_get(ccr6);
+
+    for (;;) {
+	state_read_str(name, sizeof(name));
+	if (state_error() || (name[0] == '\0')) break;
+	state_get(size);
+
+	for (c = 0; cpu_opt_regs[c].name != NULL; c++)
+		if (! strcmp(cpu_opt_regs[c].name, name)) break;
+
+	if ((cpu_opt_regs[c].name != NULL) &&
+	    (cpu_opt_regs[c].size == size)) {
+		state_read(cpu_opt_regs[c].ptr, size);
+		continue;
+	}
+
+	pclog("CPU: skipping register '%s' in state\n", name);
+	while (size > 0) {
+		c = (size > sizeof(skip)) ? (int)sizeof(skip) : (int)size;
+		state_read(skip, c);
+		size -= c;
+	}
+    }
+}
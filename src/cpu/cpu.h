@@ -8,7 +8,7 @@
  *
  *		CPU type handler.
  *
- * Version:	@(#)cpu.h	1.0.6	2018/03/27
+ * Version:	@(#)cpu.h	1.0.8	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		leilei,
@@ -337,6 +337,7 @@ extern uint64_t		tsc;
 extern msr_t		msr;
 extern int		cpuspeed;
 extern int		cycles_lost;
+extern int		cpu_idle_cycles;
 extern uint8_t		opcode;
 extern int		insc;
 extern int		fpucount;
@@ -441,6 +442,9 @@ extern char	*cpu_current_pc(char *bufp);
 extern void	cpu_dynamic_switch(int new_cpu);
 
 extern void	cpu_update_waitstates(void);
+extern void	cpu_idle_skip(void);
+extern void	cpu_save_state(void);
+extern void	cpu_load_state(int version);
 extern void	cpu_set(void);
 
 extern void	cpu_CPUID(void);
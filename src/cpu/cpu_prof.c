@@ -0,0 +1,317 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Sampling profiler for the emulated CPU.
+ *
+ *		A timer samples the guest at a fixed rate (in emulated
+ *		time), and records the CPU mode, CS:EIP, the physical page
+ *		and the dynarec block (if any) that is about to run. The
+ *		samples are kept in a hash table, and on exit written to
+ *		"profile.txt" as folded stacks, one line per distinct
+ *		sample:
+ *
+ *		  mode;page;block;cs:eip count
+ *
+ *		which can be fed straight into flamegraph.pl and friends.
+ *
+ *		Optionally, the host time spent on each dynarec block is
+ *		measured as well, split into translating, running and
+ *		interpreting it. Time spent in device (timer) callbacks
+ *		is counted separately. These go into "profile_blocks.txt"
+ *		in the same format, with microseconds as the counts.
+ *
+ *		The recompiler does not chain blocks while profiling, so
+ *		that every block returns to the dispatcher, where it gets
+ *		timed and where the sampling timer can fire. This makes
+ *		the recompiler a little slower than it is otherwise.
+ *
+ * Version:	@(#)cpu_prof.c	1.0.3	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "cpu.h"
+#include "x86.h"
+#include "../mem.h"
+#include "../timer.h"
+#include "../plat.h"
+#ifdef USE_DYNAREC
+# include "codegen.h"
+#endif
+#include "cpu_prof.h"
+
+
+#define PROF_SAMPLES	65536			/* distinct samples kept */
+#define PROF_BLOCKS	65536			/* distinct blocks timed */
+
+#define MODE_REAL	0
+#define MODE_V86	1
+#define MODE_PM16	2			/* + CPL */
+#define MODE_PM32	6			/* + CPL */
+
+
+typedef struct {
+    uint32_t	eip;
+    uint32_t	phys;				/* 0xffffffff if unmapped */
+    int32_t	block;				/* codeblock index, or -1 */
+    uint16_t	sel;				/* CS selector */
+    uint8_t	mode;
+    uint32_t	count;				/* 0 if slot is free */
+} sample_t;
+
+typedef struct {
+    uint32_t	phys;
+    uint32_t	count[CPU_PROF_MAX];
+    uint64_t	time[CPU_PROF_MAX];
+} blkprof_t;
+
+
+static int64_t	prof_timer = -1;
+static sample_t	*samples = NULL;
+static blkprof_t *blocks = NULL;
+static uint32_t	samples_lost,
+		blocks_lost;
+
+
+static const char *mode_names[] = {
+    "real", "v86",
+    "pm16-ring0", "pm16-ring1", "pm16-ring2", "pm16-ring3",
+    "pm32-ring0", "pm32-ring1", "pm32-ring2", "pm32-ring3"
+};
+
+
+static uint32_t
+hash32(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    h *= 0x846ca68b;
+    h ^= h >> 16;
+
+    return(h);
+}
+
+
+static void
+prof_sample(void *priv)
+{
+    sample_t s, *p;
+    uint32_t addr, h;
+    int c;
+
+    timer_reschedule(prof_timer, (TIMER_USEC * 1000000LL) / cpu_prof_rate);
+
+    memset(&s, 0x00, sizeof(s));
+    s.sel = CS;
+    s.eip = cpu_state.pc;
+    if (! (msw & 1))
+	s.mode = MODE_REAL;
+      else if (eflags & VM_FLAG)
+	s.mode = MODE_V86;
+      else
+	s.mode = (use32 ? MODE_PM32 : MODE_PM16) + CPL;
+
+    addr = cs + cpu_state.pc;
+    if (cr0 >> 31)
+	s.phys = mmutranslate_noabrt(addr, 0);
+      else
+	s.phys = addr;
+
+    s.block = -1;
+#ifdef USE_DYNAREC
+    if (cpu_use_dynarec && s.phys != 0xffffffff) {
+	codeblock_t *block = codeblock_hash[HASH(s.phys)];
+
+	if (block == NULL || block->pc != addr || block->phys != s.phys)
+		block = codeblock_tree_find(s.phys, cs);
+	if (block != NULL && block->pc == addr && block->valid)
+		s.block = (int32_t)(block - codeblock);
+    }
+#endif
+
+    h = hash32(s.eip ^ (s.sel << 16) ^ hash32(s.phys) ^ ((uint32_t)s.block << 4) ^ s.mode);
+    for (c = 0; c < PROF_SAMPLES; c++) {
+	p = &samples[(h + c) & (PROF_SAMPLES - 1)];
+	if (p->count == 0) {
+		*p = s;
+		p->count = 1;
+		return;
+	}
+	if (p->eip == s.eip && p->sel == s.sel && p->phys == s.phys &&
+	    p->block == s.block && p->mode == s.mode) {
+		p->count++;
+		return;
+	}
+    }
+
+    /* Table is full, we only count these. */
+    samples_lost++;
+}
+
+
+/*
+ * Set up for a new run, after the timers have been reset.
+ *
+ * The time spent in device callbacks is measured by the timer
+ * module itself, the main loop enables that for us.
+ */
+void
+cpu_prof_reset(void)
+{
+    if (cpu_prof_blocks) {
+	if (blocks == NULL)
+		blocks = (blkprof_t *)malloc(PROF_BLOCKS * sizeof(blkprof_t));
+	memset(blocks, 0x00, PROF_BLOCKS * sizeof(blkprof_t));
+	blocks_lost = 0;
+    }
+
+    if (cpu_prof_rate <= 0) return;
+
+    if (samples == NULL)
+	samples = (sample_t *)malloc(PROF_SAMPLES * sizeof(sample_t));
+    memset(samples, 0x00, PROF_SAMPLES * sizeof(sample_t));
+    samples_lost = 0;
+
+    prof_timer = timer_new(prof_sample, NULL);
+    timer_arm(prof_timer, timer_get_time());
+
+    pclog("PROF: sampling at %d Hz%s\n", cpu_prof_rate,
+	  cpu_prof_blocks ? ", timing blocks" : "");
+}
+
+
+/* Account the host time since 'start' to a dynarec block. */
+void
+cpu_prof_block(uint32_t phys, int what, uint64_t start)
+{
+    uint64_t t = plat_timer_read() - start;
+    blkprof_t *p;
+    uint32_t h;
+    int c;
+
+    h = hash32(phys);
+    for (c = 0; c < PROF_BLOCKS; c++) {
+	p = &blocks[(h + c) & (PROF_BLOCKS - 1)];
+	if (p->phys == phys || (p->count[0] | p->count[1] | p->count[2]) == 0) {
+		p->phys = phys;
+		p->count[what]++;
+		p->time[what] += t;
+		return;
+	}
+    }
+
+    blocks_lost++;
+}
+
+
+static FILE *
+prof_open(const wchar_t *name)
+{
+    wchar_t temp[1024], fn[128];
+    FILE *fp;
+
+#ifndef _WIN32
+    /* Each child writes a profile of its own. */
+    if (fork_id > 0)
+	swprintf(fn, sizeof_w(fn), L"%ls.%d", name, fork_id);
+      else
+#endif
+	wcscpy(fn, name);
+
+    memset(temp, 0x00, sizeof(temp));
+    plat_append_filename(temp, usr_path, fn);
+    fp = plat_fopen(temp, L"w");
+    if (fp == NULL)
+	pclog_lvl(PCLOG_CAT_CPU, PCLOG_ERROR,
+		"PROF: unable to create '%ls'\n", temp);
+
+    return(fp);
+}
+
+
+/* Write the profiles collected so far. */
+void
+cpu_prof_dump(void)
+{
+    static const char *what_names[] = { "translate", "execute", "interpret" };
+    sample_t *p;
+    blkprof_t *b;
+    uint64_t total;
+    char block[32];
+    FILE *fp;
+    int c, i;
+
+    if ((samples != NULL) && ((fp = prof_open(L"profile.txt")) != NULL)) {
+	for (c = 0; c < PROF_SAMPLES; c++) {
+		p = &samples[c];
+		if (p->count == 0) continue;
+
+		if (p->block >= 0)
+			sprintf(block, "block_%d", p->block);
+		  else
+			strcpy(block, "interp");
+		if (p->phys == 0xffffffff)
+			fprintf(fp, "%s;unmapped;%s;%04x:%08x %u\n",
+				mode_names[p->mode], block, p->sel, p->eip,
+				p->count);
+		  else
+			fprintf(fp, "%s;page_%05x;%s;%04x:%08x %u\n",
+				mode_names[p->mode], p->phys >> 12, block,
+				p->sel, p->eip, p->count);
+	}
+	if (samples_lost > 0)
+		fprintf(fp, "lost %u\n", samples_lost);
+	fclose(fp);
+    }
+
+    if ((blocks != NULL) && ((fp = prof_open(L"profile_blocks.txt")) != NULL)) {
+	for (c = 0; c < PROF_BLOCKS; c++) {
+		b = &blocks[c];
+		for (i = 0; i < CPU_PROF_MAX; i++) {
+			if (b->count[i] == 0) continue;
+
+			fprintf(fp, "%s;page_%05x;block_%08x %llu\n",
+				what_names[i], b->phys >> 12, b->phys,
+				(unsigned long long)(b->time[i] * 1000000ULL / timer_freq));
+		}
+	}
+
+	/* Device callbacks are not part of any block. */
+	total = timer_host_time * 1000000ULL / timer_freq;
+	fprintf(fp, "devices %llu\n", (unsigned long long)total);
+	if (blocks_lost > 0)
+		fprintf(fp, "lost %u\n", blocks_lost);
+	fclose(fp);
+    }
+}
@@ -0,0 +1,59 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the guest code profiler.
+ *
+ * Version:	@(#)cpu_prof.h	1.0.1	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef EMU_CPU_PROF_H
+# define EMU_CPU_PROF_H
+
+
+/* Where the host time of a dynarec block went. */
+#define CPU_PROF_TRANSLATE	0		/* recompiling the block */
+#define CPU_PROF_EXEC		1		/* running recompiled code */
+#define CPU_PROF_INTERP		2		/* interpreting the block */
+#define CPU_PROF_MAX		3
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern void	cpu_prof_reset(void);
+extern void	cpu_prof_block(uint32_t phys, int what, uint64_t start);
+extern void	cpu_prof_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/*EMU_CPU_PROF_H*/
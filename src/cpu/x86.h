@@ -8,7 +8,7 @@
  *
  *		Definitions for the X86 architecture.
  *
- * Version:	@(#)x86.h	1.0.1	2018/02/14
+ * Version:	@(#)x86.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -133,6 +133,8 @@ extern int inscounts[256];
 void x86illegal();
 
 void x86seg_reset();
+extern uint32_t seg_cache_gen;
+void seg_cache_flush();
 void x86gpf(char *s, uint16_t error);
 
 extern uint16_t zero;
@@ -8,7 +8,7 @@
  *
  *		x86 i686 (Pentium Pro/Pentium II) CPU Instructions.
  *
- * Version:	@(#)x86_ops_i686.h	1.0.1	2018/02/14
+ * Version:	@(#)x86_ops_i686.h	1.0.2	2018/09/16
  *
  * Author:	Miran Grca, <mgrca8@gmail.com>
  *
@@ -296,7 +296,7 @@ static int opFXSAVESTOR_a16(uint32_t fetchdat)
 		if ((twd & 0xC000) == 0xC000)  ftwb |= 0x80;
 
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememb(easeg,cpu_state.eaaddr+4,ftwb);
 
                 writememw(easeg,cpu_state.eaaddr+6,(x87_op_off>>16)<<12);
@@ -474,7 +474,7 @@ static int opFXSAVESTOR_a32(uint32_t fetchdat)
 		if ((twd & 0xC000) == 0xC000)  ftwb |= 0x80;
 
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememb(easeg,cpu_state.eaaddr+4,ftwb);
 
                 writememw(easeg,cpu_state.eaaddr+6,(x87_op_off>>16)<<12);
@@ -8,7 +8,7 @@
  *
  *		Miscellaneous x86 CPU Instructions.
  *
- * Version:	@(#)x86_ops_misc.h	1.0.1	2018/02/14
+ * Version:	@(#)x86_ops_misc.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -615,6 +615,8 @@ static int opHLT(uint32_t fetchdat)
         if (!((flags&I_FLAG) && pic_intpending))
         {
                 CLOCK_CYCLES_ALWAYS(100);
+                if (flags & I_FLAG)
+                        cpu_idle_skip();
                 cpu_state.pc--;
         }
         else
@@ -8,7 +8,7 @@
  *
  *		Miscellaneous x86 CPU Instructions.
  *
- * Version:	@(#)x86_ops_rep.h	1.0.2	2018/05/09
+ * Version:	@(#)x86_ops_rep.h	1.0.3	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -37,6 +37,187 @@
 
 extern int trap;
 
+
+/*
+ * Bulk paths for the REP string instructions.
+ *
+ * The loops below do one element at a time, through the memory
+ * access macros. If the next run of elements stays within a single
+ * page on both ends, and those pages are plain RAM mapped through
+ * readlookup2/writelookup2 (pages holding translated code or page
+ * tables never are), the whole run is done directly on host memory
+ * instead. This is only done going forward (D_FLAG clear) and with
+ * the trap flag clear; everything else takes the per-element path.
+ */
+
+/*CMPS restarts after each element, so it gets a budget of its own.*/
+#define REP_BULK_CYCLES ((is386 && cpu_use_dynarec) ? 1000 : 100)
+
+/* Number of elements we may do in bulk, given the cycles left. */
+static __inline uint32_t rep_bulk_max(uint32_t count, int left, int cyc)
+{
+        uint32_t n;
+
+        if (left < 0)
+                return 0;
+        n = (left / cyc) + 1;
+        return (count < n) ? count : n;
+}
+
+/* Number of elements until the next page or address size wrap. */
+static __inline uint32_t rep_bulk_len(uint32_t addr, uint32_t reg, int regsize, int size, uint32_t count)
+{
+        uint64_t room = ((regsize == 2) ? 0x10000ull : 0x100000000ull) - reg;
+        uint32_t n = (0x1000 - (addr & 0xfff)) / size;
+
+        if ((room / size) < n)
+                n = (uint32_t)(room / size);
+        return (count < n) ? count : n;
+}
+
+/* Set up a run of 'count' elements at ES:dreg, and return its length. */
+static __inline uint32_t rep_bulk_dest(uint8_t **d, uint32_t dreg, int regsize, int size, uint32_t count, int write)
+{
+        uint32_t dst = es + dreg;
+        uintptr_t l;
+        uint32_t n;
+
+        if ((flags & D_FLAG) || trap || (es == 0xFFFFFFFF))
+                return 0;
+        l = write ? writelookup2[dst >> 12] : readlookup2[dst >> 12];
+        if (l == (uintptr_t)-1)
+                return 0;
+
+        n = rep_bulk_len(dst, dreg, regsize, size, count);
+        if (write && ((uint64_t)dreg + (uint64_t)n * size - 1) > _es.limit_high)
+                n = (uint32_t)(((uint64_t)_es.limit_high + 1 - dreg) / size);
+        *d = (uint8_t *)(l + dst);
+
+        return n;
+}
+
+/* Set up a run of 'count' elements at seg:sreg, and return its length. */
+static __inline uint32_t rep_bulk_src(uint8_t **s, uint32_t base, uint32_t sreg, int regsize, int size, uint32_t count)
+{
+        uint32_t src = base + sreg;
+
+        if ((base == 0xFFFFFFFF) || (readlookup2[src >> 12] == (uintptr_t)-1))
+                return 0;
+        *s = (uint8_t *)(readlookup2[src >> 12] + src);
+
+        return rep_bulk_len(src, sreg, regsize, size, count);
+}
+
+static __inline uint32_t rep_bulk_movs(uint32_t base, uint32_t sreg, uint32_t dreg, int regsize, int size, uint32_t count)
+{
+        uint8_t *s, *d;
+        uint32_t n;
+
+        n = rep_bulk_dest(&d, dreg, regsize, size, count, 1);
+        if (n)
+                n = rep_bulk_src(&s, base, sreg, regsize, size, n);
+
+        /*A destination just above the source replicates the data
+          in between, which memmove() would not do.*/
+        if (n && (d > s) && (d < (s + n * size)))
+                n = (uint32_t)(d - s) / size;
+        if (n < 2)
+                return 0;
+
+        memmove(d, s, n * size);
+        return n;
+}
+
+static __inline uint32_t rep_bulk_stos(uint32_t dreg, int regsize, int size, uint32_t count, uint32_t val)
+{
+        uint8_t *d;
+        uint32_t c, n;
+
+        n = rep_bulk_dest(&d, dreg, regsize, size, count, 1);
+        if (n < 2)
+                return 0;
+
+        switch (size)
+        {
+                case 1:
+                memset(d, val, n);
+                break;
+                case 2:
+                for (c = 0; c < n; c++)
+                        ((uint16_t *)d)[c] = val;
+                break;
+                case 4:
+                for (c = 0; c < n; c++)
+                        ((uint32_t *)d)[c] = val;
+                break;
+        }
+        return n;
+}
+
+/*For SCAS and CMPS, we skip over the elements that would let the
+  loop go on. The element that ends it (or the very last one) is left
+  to the per-element path, as that one has to set the flags.*/
+static __inline uint32_t rep_bulk_scas(uint32_t dreg, int regsize, int size, uint32_t count, uint32_t val, int fv)
+{
+        uint8_t *d, *p;
+        uint32_t c, n;
+
+        n = rep_bulk_dest(&d, dreg, regsize, size, count, 0);
+        if (n < 2)
+                return 0;
+
+        if (size == 1 && !fv)
+        {
+                p = memchr(d, val, n);
+                return p ? (uint32_t)(p - d) : n;
+        }
+        for (c = 0; c < n; c++)
+        {
+                if (size == 1)
+                {
+                        if ((d[c] == (uint8_t)val) != fv)
+                                break;
+                }
+                else if (size == 2)
+                {
+                        if ((((uint16_t *)d)[c] == (uint16_t)val) != fv)
+                                break;
+                }
+                else if ((((uint32_t *)d)[c] == val) != fv)
+                        break;
+        }
+        return c;
+}
+
+static __inline uint32_t rep_bulk_cmps(uint32_t base, uint32_t sreg, uint32_t dreg, int regsize, int size, uint32_t count, int fv)
+{
+        uint8_t *s, *d;
+        uint32_t c, n;
+
+        n = rep_bulk_dest(&d, dreg, regsize, size, count, 0);
+        if (n)
+                n = rep_bulk_src(&s, base, sreg, regsize, size, n);
+        if (n < 2)
+                return 0;
+
+        for (c = 0; c < n; c++)
+        {
+                if (size == 1)
+                {
+                        if ((s[c] == d[c]) != fv)
+                                break;
+                }
+                else if (size == 2)
+                {
+                        if ((((uint16_t *)s)[c] == ((uint16_t *)d)[c]) != fv)
+                                break;
+                }
+                else if ((((uint32_t *)s)[c] == ((uint32_t *)d)[c]) != fv)
+                        break;
+        }
+        return c;
+}
+
 #define REP_OPS(size, CNT_REG, SRC_REG, DEST_REG) \
 static int opREP_INSB_ ## size(uint32_t fetchdat)                               \
 {                                                                               \
@@ -204,6 +385,7 @@ static int opREP_OUTSL_ ## size(uint32_t fetchdat)
 static int opREP_MOVSB_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, writes = 0, total_cycles = 0;                            \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
@@ -212,6 +394,19 @@ static int opREP_MOVSB_ ## size(uint32_t fetchdat)
                 uint8_t temp;                                                   \
                                                                                 \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG);                      \
+                bulk = rep_bulk_movs(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 1,   \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 3 : 4)));   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk; SRC_REG += bulk;                      \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 3 : 4);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; writes += bulk; total_cycles += bulk * (is486 ? 3 : 4);   \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 temp = readmemb(cpu_state.ea_seg->base, SRC_REG); if (cpu_state.abrt) return 1;    \
                 writememb(es, DEST_REG, temp); if (cpu_state.abrt) return 1;       \
                                                                                 \
@@ -237,6 +432,7 @@ static int opREP_MOVSB_ ## size(uint32_t fetchdat)
 static int opREP_MOVSW_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, writes = 0, total_cycles = 0;                            \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
@@ -245,6 +441,19 @@ static int opREP_MOVSW_ ## size(uint32_t fetchdat)
                 uint16_t temp;                                                  \
                                                                                 \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG);                      \
+                bulk = rep_bulk_movs(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 2,   \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 3 : 4)));   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 2; SRC_REG += bulk * 2;              \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 3 : 4);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; writes += bulk; total_cycles += bulk * (is486 ? 3 : 4);   \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 temp = readmemw(cpu_state.ea_seg->base, SRC_REG); if (cpu_state.abrt) return 1;    \
                 writememw(es, DEST_REG, temp); if (cpu_state.abrt) return 1;       \
                                                                                 \
@@ -270,6 +479,7 @@ static int opREP_MOVSW_ ## size(uint32_t fetchdat)
 static int opREP_MOVSL_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, writes = 0, total_cycles = 0;                            \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
@@ -278,6 +488,19 @@ static int opREP_MOVSL_ ## size(uint32_t fetchdat)
                 uint32_t temp;                                                  \
                                                                                 \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG);                      \
+                bulk = rep_bulk_movs(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 4,   \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 3 : 4)));   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 4; SRC_REG += bulk * 4;              \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 3 : 4);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; writes += bulk; total_cycles += bulk * (is486 ? 3 : 4);   \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 temp = readmeml(cpu_state.ea_seg->base, SRC_REG); if (cpu_state.abrt) return 1;    \
                 writememl(es, DEST_REG, temp); if (cpu_state.abrt) return 1;       \
                                                                                 \
@@ -305,12 +528,26 @@ static int opREP_MOVSL_ ## size(uint32_t fetchdat)
 static int opREP_STOSB_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int writes = 0, total_cycles = 0;                                       \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         while (CNT_REG > 0)                                                     \
         {                                                                       \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG);                      \
+                bulk = rep_bulk_stos(DEST_REG, sizeof(DEST_REG), 1,             \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 4 : 5)), AL);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk;                                       \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 4 : 5);                       \
+                        ins += bulk;                                            \
+                        writes += bulk; total_cycles += bulk * (is486 ? 4 : 5); \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 writememb(es, DEST_REG, AL); if (cpu_state.abrt) return 1;         \
                 if (flags & D_FLAG) DEST_REG--;                                 \
                 else                DEST_REG++;                                 \
@@ -333,12 +570,26 @@ static int opREP_STOSB_ ## size(uint32_t fetchdat)
 static int opREP_STOSW_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int writes = 0, total_cycles = 0;                                       \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         while (CNT_REG > 0)                                                     \
         {                                                                       \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG+1);                    \
+                bulk = rep_bulk_stos(DEST_REG, sizeof(DEST_REG), 2,             \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 4 : 5)), AX);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 2;                                   \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 4 : 5);                       \
+                        ins += bulk;                                            \
+                        writes += bulk; total_cycles += bulk * (is486 ? 4 : 5); \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 writememw(es, DEST_REG, AX); if (cpu_state.abrt) return 1;         \
                 if (flags & D_FLAG) DEST_REG -= 2;                              \
                 else                DEST_REG += 2;                              \
@@ -361,12 +612,26 @@ static int opREP_STOSW_ ## size(uint32_t fetchdat)
 static int opREP_STOSL_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int writes = 0, total_cycles = 0;                                       \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         while (CNT_REG > 0)                                                     \
         {                                                                       \
                 CHECK_WRITE_REP(&_es, DEST_REG, DEST_REG+3);                    \
+                bulk = rep_bulk_stos(DEST_REG, sizeof(DEST_REG), 4,             \
+                                     rep_bulk_max(CNT_REG, cycles - cycles_end, (is486 ? 4 : 5)), EAX);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 4;                                   \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 4 : 5);                       \
+                        ins += bulk;                                            \
+                        writes += bulk; total_cycles += bulk * (is486 ? 4 : 5); \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                        continue;                                               \
+                }                                                               \
                 writememl(es, DEST_REG, EAX); if (cpu_state.abrt) return 1;        \
                 if (flags & D_FLAG) DEST_REG -= 4;                              \
                 else                DEST_REG += 4;                              \
@@ -474,12 +739,24 @@ static int opREP_LODSL_ ## size(uint32_t fetchdat)
 static int opREP_CMPSB_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, total_cycles = 0, tempz;                                 \
+        uint32_t bulk;                                                          \
                                                                                 \
         tempz = FV;                                                             \
         if ((CNT_REG > 0) && (FV == tempz))                                     \
         {                                                                       \
-                uint8_t temp = readmemb(cpu_state.ea_seg->base, SRC_REG);       \
-                uint8_t temp2 = readmemb(es, DEST_REG); if (cpu_state.abrt) return 1;      \
+                uint8_t temp, temp2;                                            \
+                                                                                \
+                bulk = rep_bulk_cmps(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 1,   \
+                                     rep_bulk_max(CNT_REG - 1, REP_BULK_CYCLES, (is486 ? 7 : 9)), FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk; SRC_REG += bulk;                      \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 7 : 9);                       \
+                        reads += bulk * 2; total_cycles += bulk * (is486 ? 7 : 9);   \
+                }                                                               \
+                temp = readmemb(cpu_state.ea_seg->base, SRC_REG);               \
+                temp2 = readmemb(es, DEST_REG); if (cpu_state.abrt) return 1;   \
                                                                                 \
                 if (flags & D_FLAG) { DEST_REG--; SRC_REG--; }                  \
                 else                { DEST_REG++; SRC_REG++; }                  \
@@ -501,12 +778,24 @@ static int opREP_CMPSB_ ## size(uint32_t fetchdat)
 static int opREP_CMPSW_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, total_cycles = 0, tempz;                                 \
+        uint32_t bulk;                                                          \
                                                                                 \
         tempz = FV;                                                             \
         if ((CNT_REG > 0) && (FV == tempz))                                     \
         {                                                                       \
-                uint16_t temp = readmemw(cpu_state.ea_seg->base, SRC_REG);      \
-                uint16_t temp2 = readmemw(es, DEST_REG); if (cpu_state.abrt) return 1;     \
+                uint16_t temp, temp2;                                           \
+                                                                                \
+                bulk = rep_bulk_cmps(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 2,   \
+                                     rep_bulk_max(CNT_REG - 1, REP_BULK_CYCLES, (is486 ? 7 : 9)), FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 2; SRC_REG += bulk * 2;              \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 7 : 9);                       \
+                        reads += bulk * 2; total_cycles += bulk * (is486 ? 7 : 9);   \
+                }                                                               \
+                temp = readmemw(cpu_state.ea_seg->base, SRC_REG);               \
+                temp2 = readmemw(es, DEST_REG); if (cpu_state.abrt) return 1;   \
                                                                                 \
                 if (flags & D_FLAG) { DEST_REG -= 2; SRC_REG -= 2; }            \
                 else                { DEST_REG += 2; SRC_REG += 2; }            \
@@ -528,12 +817,24 @@ static int opREP_CMPSW_ ## size(uint32_t fetchdat)
 static int opREP_CMPSL_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0,  total_cycles = 0, tempz;                                \
+        uint32_t bulk;                                                          \
                                                                                 \
         tempz = FV;                                                             \
         if ((CNT_REG > 0) && (FV == tempz))                                     \
         {                                                                       \
-                uint32_t temp = readmeml(cpu_state.ea_seg->base, SRC_REG);      \
-                uint32_t temp2 = readmeml(es, DEST_REG); if (cpu_state.abrt) return 1;     \
+                uint32_t temp, temp2;                                           \
+                                                                                \
+                bulk = rep_bulk_cmps(cpu_state.ea_seg->base, SRC_REG, DEST_REG, sizeof(DEST_REG), 4,   \
+                                     rep_bulk_max(CNT_REG - 1, REP_BULK_CYCLES, (is486 ? 7 : 9)), FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 4; SRC_REG += bulk * 4;              \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 7 : 9);                       \
+                        reads += bulk * 2; total_cycles += bulk * (is486 ? 7 : 9);   \
+                }                                                               \
+                temp = readmeml(cpu_state.ea_seg->base, SRC_REG);               \
+                temp2 = readmeml(es, DEST_REG); if (cpu_state.abrt) return 1;   \
                                                                                 \
                 if (flags & D_FLAG) { DEST_REG -= 4; SRC_REG -= 4; }            \
                 else                { DEST_REG += 4; SRC_REG += 4; }            \
@@ -556,13 +857,28 @@ static int opREP_CMPSL_ ## size(uint32_t fetchdat)
 static int opREP_SCASB_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, total_cycles = 0, tempz;                                 \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         tempz = FV;                                                             \
         while ((CNT_REG > 0) && (FV == tempz))                                  \
         {                                                                       \
-                uint8_t temp = readmemb(es, DEST_REG); if (cpu_state.abrt) break;\
+                uint8_t temp;                                                   \
+                                                                                \
+                bulk = rep_bulk_scas(DEST_REG, sizeof(DEST_REG), 1,             \
+                                     rep_bulk_max(CNT_REG - 1, cycles - cycles_end, (is486 ? 5 : 8)), AL, FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk;                                       \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 5 : 8);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; total_cycles += bulk * (is486 ? 5 : 8);  \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                }                                                               \
+                temp = readmemb(es, DEST_REG); if (cpu_state.abrt) break;       \
                 setsub8(AL, temp);                                              \
                 tempz = (ZF_SET()) ? 1 : 0;                                     \
                 if (flags & D_FLAG) DEST_REG--;                                 \
@@ -587,13 +903,28 @@ static int opREP_SCASB_ ## size(uint32_t fetchdat)
 static int opREP_SCASW_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, total_cycles = 0, tempz;                                 \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         tempz = FV;                                                             \
         while ((CNT_REG > 0) && (FV == tempz))                                  \
         {                                                                       \
-                uint16_t temp = readmemw(es, DEST_REG); if (cpu_state.abrt) break;\
+                uint16_t temp;                                                  \
+                                                                                \
+                bulk = rep_bulk_scas(DEST_REG, sizeof(DEST_REG), 2,             \
+                                     rep_bulk_max(CNT_REG - 1, cycles - cycles_end, (is486 ? 5 : 8)), AX, FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 2;                                   \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 5 : 8);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; total_cycles += bulk * (is486 ? 5 : 8);  \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                }                                                               \
+                temp = readmemw(es, DEST_REG); if (cpu_state.abrt) break;       \
                 setsub16(AX, temp);                                             \
                 tempz = (ZF_SET()) ? 1 : 0;                                     \
                 if (flags & D_FLAG) DEST_REG -= 2;                              \
@@ -618,13 +949,28 @@ static int opREP_SCASW_ ## size(uint32_t fetchdat)
 static int opREP_SCASL_ ## size(uint32_t fetchdat)                              \
 {                                                                               \
         int reads = 0, total_cycles = 0, tempz;                                 \
+        uint32_t bulk;                                                          \
         int cycles_end = cycles - ((is386 && cpu_use_dynarec) ? 1000 : 100);    \
         if (trap)                                                               \
                 cycles_end = cycles+1; /*Force the instruction to end after only one iteration when trap flag set*/     \
         tempz = FV;                                                             \
         while ((CNT_REG > 0) && (FV == tempz))                                  \
         {                                                                       \
-                uint32_t temp = readmeml(es, DEST_REG); if (cpu_state.abrt) break;\
+                uint32_t temp;                                                  \
+                                                                                \
+                bulk = rep_bulk_scas(DEST_REG, sizeof(DEST_REG), 4,             \
+                                     rep_bulk_max(CNT_REG - 1, cycles - cycles_end, (is486 ? 5 : 8)), EAX, FV);   \
+                if (bulk)                                                       \
+                {                                                               \
+                        DEST_REG += bulk * 4;                                   \
+                        CNT_REG -= bulk;                                        \
+                        cycles -= bulk * (is486 ? 5 : 8);                       \
+                        ins += bulk;                                            \
+                        reads += bulk; total_cycles += bulk * (is486 ? 5 : 8);  \
+                        if (cycles < cycles_end)                                \
+                                break;                                          \
+                }                                                               \
+                temp = readmeml(es, DEST_REG); if (cpu_state.abrt) break;       \
                 setsub32(EAX, temp);                                            \
                 tempz = (ZF_SET()) ? 1 : 0;                                     \
                 if (flags & D_FLAG) DEST_REG -= 4;                              \
@@ -8,7 +8,7 @@
  *
  *		x86 CPU segment emulation.
  *
- * Version:	@(#)x86seg.c	1.0.3	2018/05/06
+ * Version:	@(#)x86seg.c	1.0.5	2018/09/16
  *
  * Authors:	Sarah Walker, <http://pcem-emulator.co.uk/>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -79,6 +79,7 @@ FILE *pclogf;
 void x86abort(const char *format, ...)
 {
    va_list ap;
+   pclog_flush();
    va_start(ap, format);
    vfprintf(stdlog, format, ap);
    va_end(ap);
@@ -120,6 +121,7 @@ void x86seg_reset()
         seg_reset(&_fs);
         seg_reset(&_gs);
         seg_reset(&_ss);
+        seg_cache_flush();
 }
 
 void x86_doabrt(int x86_abrt)
@@ -319,6 +321,73 @@ static void check_seg_valid(x86seg *s)
                 loadseg(0, s);
 }
 
+/*Descriptor cache. Segment loads in protected mode code are frequent,
+  and most of them reload a descriptor that was read just before. Entries
+  are keyed on the linear address of the descriptor (the table base plus
+  the selector index, the limit has been checked by the caller). The pages
+  holding cached descriptors are marked, so that the page write handlers
+  flush the cache when one is written to, and the TLB flushes it whenever
+  a translation it was read through may have gone.*/
+#define SEG_CACHE_SIZE 256
+
+typedef struct
+{
+        uint32_t gen;
+        uint32_t addr;
+        uint16_t segdat[4];
+} seg_cache_t;
+
+static seg_cache_t seg_cache[SEG_CACHE_SIZE];
+uint32_t seg_cache_gen = 1;
+
+void seg_cache_flush()
+{
+        seg_cache_gen++;
+        if (!seg_cache_gen)
+                seg_cache_gen++;
+}
+
+/*Read the descriptor at linear address addr. The caller sets cpl_override
+  and checks for aborts as before.*/
+static void seg_read_desc(uint32_t addr, uint16_t *segdat)
+{
+        seg_cache_t *c = &seg_cache[(addr >> 3) & (SEG_CACHE_SIZE - 1)];
+        uint32_t phys;
+
+        if (c->gen == seg_cache_gen && c->addr == addr)
+        {
+                segdat[0] = c->segdat[0];
+                segdat[1] = c->segdat[1];
+                segdat[2] = c->segdat[2];
+                segdat[3] = c->segdat[3];
+                return;
+        }
+
+        segdat[0]=readmemw(0,addr);
+        segdat[1]=readmemw(0,addr+2);
+        segdat[2]=readmemw(0,addr+4);
+        segdat[3]=readmemw(0,addr+6);
+        if (cpu_state.abrt)
+                return;
+
+        /*Only descriptors in RAM that do not cross a page are cached*/
+        if ((addr & 0xfff) > 0xff8 || readlookup2[addr >> 12] == -1)
+                return;
+        phys = (uint32_t)((uint8_t *)(readlookup2[addr >> 12] + (addr & ~0xfff)) - ram);
+        if (pages[phys >> 12].dt_gen != seg_cache_gen)
+        {
+                pages[phys >> 12].dt_gen = seg_cache_gen;
+                mem_flush_write_page(phys, addr);
+        }
+
+        c->gen = seg_cache_gen;
+        c->addr = addr;
+        c->segdat[0] = segdat[0];
+        c->segdat[1] = segdat[1];
+        c->segdat[2] = segdat[2];
+        c->segdat[3] = segdat[3];
+}
+
 void loadseg(uint16_t seg, x86seg *s)
 {
         uint16_t segdat[4];
@@ -361,10 +430,7 @@ void loadseg(uint16_t seg, x86seg *s)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat[0]=readmemw(0,addr);
-                segdat[1]=readmemw(0,addr+2);
-                segdat[2]=readmemw(0,addr+4);
-                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
                 dpl=(segdat[2]>>13)&3;
                 if (s==&_ss)
                 {
@@ -429,9 +495,12 @@ void loadseg(uint16_t seg, x86seg *s)
                 {
 #endif                   
 #ifdef SEL_ACCESSED         
-                        cpl_override = 1;
-                        writememw(0, addr+4, segdat[2] | 0x100); /*Set accessed bit*/
-                        cpl_override = 0;
+                        if (!(segdat[2] & 0x100)) /*Only written when not set yet, so cached descriptors stay valid*/
+                        {
+                                cpl_override = 1;
+                                writememw(0, addr+4, segdat[2] | 0x100); /*Set accessed bit*/
+                                cpl_override = 0;
+                        }
 #endif
 #ifndef CS_ACCESSED
                 }
@@ -512,10 +581,7 @@ void loadcs(uint16_t seg)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat[0]=readmemw(0,addr);
-                segdat[1]=readmemw(0,addr+2);
-                segdat[2]=readmemw(0,addr+4);
-                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
                 if (segdat[2]&0x1000) /*Normal code segment*/
                 {
                         if (!(segdat[2]&0x400)) /*Not conforming*/
@@ -548,9 +614,12 @@ void loadcs(uint16_t seg)
                         if (CPL==3 && oldcpl!=3) flushmmucache_cr3();
 
 #ifdef CS_ACCESSED                        
-                        cpl_override = 1;
-                        writememw(0, addr+4, segdat[2] | 0x100); /*Set accessed bit*/
-                        cpl_override = 0;
+                        if (!(segdat[2] & 0x100))
+                        {
+                                cpl_override = 1;
+                                writememw(0, addr+4, segdat[2] | 0x100); /*Set accessed bit*/
+                                cpl_override = 0;
+                        }
 #endif
                 }
                 else /*System segment*/
@@ -614,10 +683,7 @@ void loadcsjmp(uint16_t seg, uint32_t oxpc)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat[0]=readmemw(0,addr);
-                segdat[1]=readmemw(0,addr+2);
-                segdat[2]=readmemw(0,addr+4);
-                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
                 if (output) pclog("%04X %04X %04X %04X\n",segdat[0],segdat[1],segdat[2],segdat[3]);
                 if (segdat[2]&0x1000) /*Normal code segment*/
                 {
@@ -724,10 +790,7 @@ void loadcsjmp(uint16_t seg, uint32_t oxpc)
                                         addr+=gdt.base;
                                 }
                                 cpl_override=1;
-                                segdat[0]=readmemw(0,addr);
-                                segdat[1]=readmemw(0,addr+2);
-                                segdat[2]=readmemw(0,addr+4);
-                                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
 
                                 if (DPL > CPL)
                                 {
@@ -907,10 +970,7 @@ void loadcscall(uint16_t seg)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat[0]=readmemw(0,addr);
-                segdat[1]=readmemw(0,addr+2);
-                segdat[2]=readmemw(0,addr+4);
-                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
                 type=segdat[2]&0xF00;
                 newpc=segdat[0];
                 if (type&0x800) newpc|=segdat[3]<<16;
@@ -1021,10 +1081,7 @@ void loadcscall(uint16_t seg)
                                         addr+=gdt.base;
                                 }
                                 cpl_override=1;
-                                segdat[0]=readmemw(0,addr);
-                                segdat[1]=readmemw(0,addr+2);
-                                segdat[2]=readmemw(0,addr+4);
-                                segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                                seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) return;
                                 
                                 if (output) pclog("Code seg2 call - %04X - %04X %04X %04X\n",seg2,segdat[0],segdat[1],segdat[2]);
                                 
@@ -1094,10 +1151,7 @@ void loadcscall(uint16_t seg)
                                                 }
                                                 cpl_override=1;
                                                 if (output) pclog("Read stack seg\n");
-                                                segdat2[0]=readmemw(0,addr);
-                                                segdat2[1]=readmemw(0,addr+2);
-                                                segdat2[2]=readmemw(0,addr+4);
-                                                segdat2[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                                                seg_read_desc(addr, segdat2); cpl_override=0; if (cpu_state.abrt) return;
                                                 if (output) pclog("Read stack seg done!\n");
                                                 if (((newss & 3) != DPL) || (DPL2 != DPL))
                                                 {
@@ -1308,10 +1362,7 @@ void pmoderetf(int is32, uint16_t off)
                 addr+=gdt.base;
         }
         cpl_override=1;
-        segdat[0]=readmemw(0,addr);
-        segdat[1]=readmemw(0,addr+2);
-        segdat[2]=readmemw(0,addr+4);
-        segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) { ESP=oldsp; return; }
+        seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) { ESP=oldsp; return; }
         oaddr = addr;
         
         if (output) pclog("CPL %i RPL %i %i\n",CPL,seg&3,is32);
@@ -1442,10 +1493,7 @@ void pmoderetf(int is32, uint16_t off)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat2[0]=readmemw(0,addr);
-                segdat2[1]=readmemw(0,addr+2);
-                segdat2[2]=readmemw(0,addr+4);
-                segdat2[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) { ESP=oldsp; return; }
+                seg_read_desc(addr, segdat2); cpl_override=0; if (cpu_state.abrt) { ESP=oldsp; return; }
                 if (output) pclog("Segment data %04X %04X %04X %04X\n", segdat2[0], segdat2[1], segdat2[2], segdat2[3]);
                 if ((newss & 3) != (seg & 3))
                 {
@@ -1601,10 +1649,7 @@ void pmodeint(int num, int soft)
                                 addr+=gdt.base;
                         }
                         cpl_override=1;
-                        segdat2[0]=readmemw(0,addr);
-                        segdat2[1]=readmemw(0,addr+2);
-                        segdat2[2]=readmemw(0,addr+4);
-                        segdat2[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                        seg_read_desc(addr, segdat2); cpl_override=0; if (cpu_state.abrt) return;
                         oaddr = addr;
                         
                         if (DPL2 > CPL)
@@ -1669,10 +1714,7 @@ void pmodeint(int num, int soft)
                                                 addr+=gdt.base;
                                         }
                                         cpl_override=1;
-                                        segdat3[0]=readmemw(0,addr);
-                                        segdat3[1]=readmemw(0,addr+2);
-                                        segdat3[2]=readmemw(0,addr+4);
-                                        segdat3[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) return;
+                                        seg_read_desc(addr, segdat3); cpl_override=0; if (cpu_state.abrt) return;
                                         if (((newss & 3) != DPL2) || (DPL3 != DPL2))
                                         {
                                                 x86ss(NULL,newss&~3);
@@ -1997,10 +2039,7 @@ void pmodeiret(int is32)
                 return;
         }
         cpl_override=1;
-        segdat[0]=readmemw(0,addr);
-        segdat[1]=readmemw(0,addr+2);
-        segdat[2]=readmemw(0,addr+4);
-        segdat[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) { ESP = oldsp; return; }
+        seg_read_desc(addr, segdat); cpl_override=0; if (cpu_state.abrt) { ESP = oldsp; return; }
         
         switch (segdat[2]&0x1F00)
         {
@@ -2091,10 +2130,7 @@ void pmodeiret(int is32)
                         addr+=gdt.base;
                 }
                 cpl_override=1;
-                segdat2[0]=readmemw(0,addr);
-                segdat2[1]=readmemw(0,addr+2);
-                segdat2[2]=readmemw(0,addr+4);
-                segdat2[3]=readmemw(0,addr+6); cpl_override=0; if (cpu_state.abrt) { ESP = oldsp; return; }
+                seg_read_desc(addr, segdat2); cpl_override=0; if (cpu_state.abrt) { ESP = oldsp; return; }
                 if ((newss & 3) != (seg & 3))
                 {
                         ESP = oldsp;
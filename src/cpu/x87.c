@@ -8,7 +8,7 @@
  *
  *		Implementation of 8087 opcodes.
  *
- * Version:	@(#)x87.c	1.0.2	2018/05/06
+ * Version:	@(#)x87.c	1.0.3	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -56,12 +56,25 @@ uint16_t x87_gettag()
         uint16_t ret = 0;
         int c;
         
+        /*Pushes only mark a register as in use; the zero/special
+          classification is derived here, when the tag word is stored*/
         for (c = 0; c < 8; c++)
         {
-                if (cpu_state.tag[c] & TAG_UINT64)
-                        ret |= 2 << (c*2);
+                uint16_t t;
+
+                if ((cpu_state.tag[c] & 3) == 3)
+                        t = 3;
+                else if (cpu_state.tag[c] & TAG_UINT64)
+                        t = 2;
+                else if (cpu_state.ismmx)
+                        t = 0;
+                else if (cpu_state.ST[c] == 0.0)
+                        t = 1;
+                else if (!isfinite(cpu_state.ST[c]) || fpclassify(cpu_state.ST[c]) == FP_SUBNORMAL)
+                        t = 2;
                 else
-                        ret |= (cpu_state.tag[c] << (c*2));
+                        t = 0;
+                ret |= t << (c*2);
         }
 
         return ret;
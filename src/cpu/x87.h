@@ -8,7 +8,7 @@
  *
  *		Definitions for the X87 FPU.
  *
- * Version:	@(#)x87.h	1.0.1	2018/02/14
+ * Version:	@(#)x87.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -43,3 +43,8 @@ void x87_settag(uint16_t new_tag);
 
 /*Hack for FPU copy. If set then MM[].q contains the 64-bit integer loaded by FILD*/
 #define TAG_UINT64 (1 << 2)
+/*If set then MM[].q and MM_w4[] hold the 80-bit value exactly as loaded by FLD
+  m80 or FRSTOR, so FSTP m80 and FSAVE can write it back bit-for-bit*/
+#define TAG_FLOAT80 (1 << 3)
+/*Any exact-copy flag; cleared whenever ST() is modified in place*/
+#define TAG_EXACT (TAG_UINT64 | TAG_FLOAT80)
@@ -8,7 +8,7 @@
  *
  *		x87 FPU instructions core.
  *
- * Version:	@(#)x87_ops.h	1.0.5	2018/05/05
+ * Version:	@(#)x87_ops.h	1.0.6	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -96,11 +96,13 @@ static __inline void x87_checkexceptions()
 {
 }
 
+/*The tag is only marked valid here; zero/special is worked out by
+  x87_gettag() when the tag word is actually stored*/
 static __inline void x87_push(double i)
 {
         cpu_state.TOP=(cpu_state.TOP-1)&7;
         cpu_state.ST[cpu_state.TOP] = i;
-        cpu_state.tag[cpu_state.TOP&7] = (i == 0.0) ? 1 : 0;
+        cpu_state.tag[cpu_state.TOP&7] = 0;
 }
 
 static __inline double x87_pop()
@@ -111,6 +113,13 @@ static __inline double x87_pop()
         return t;
 }
 
+/*TOP is kept separately and only merged into the status word when it is
+  stored (FSTSW, FSTENV, FSAVE)*/
+static __inline uint16_t x87_getsw()
+{
+        return (cpu_state.npxs & 0xC7FF) | ((cpu_state.TOP & 7) << 11);
+}
+
 static __inline int64_t x87_fround(double b)
 {
         int64_t a, c;
@@ -139,7 +148,7 @@ static __inline int64_t x87_fround(double b)
 #define BIAS80 16383
 #define BIAS64 1023
 
-static __inline double x87_ld80()
+static __inline double x87_from80(uint64_t ll, uint16_t begin)
 {
        	int64_t exp64;
        	int64_t blah;
@@ -154,9 +163,8 @@ static __inline double x87_ld80()
                         uint64_t ll;
                 } eind;
 	} test;
-	test.eind.ll = readmeml(easeg,cpu_state.eaaddr);
-	test.eind.ll |= (uint64_t)readmeml(easeg,cpu_state.eaaddr+4)<<32;
-	test.begin = readmemw(easeg,cpu_state.eaaddr+8);
+	test.eind.ll = ll;
+	test.begin = begin;
 
        	exp64 = (((test.begin&0x7fff) - BIAS80));
        	blah = ((exp64 >0)?exp64:-exp64)&0x3ff;
@@ -177,6 +185,36 @@ static __inline double x87_ld80()
 	return test.eind.d;
 }
 
+static __inline double x87_ld80()
+{
+        uint64_t ll;
+        uint16_t begin;
+
+	ll = readmeml(easeg,cpu_state.eaaddr);
+	ll |= (uint64_t)readmeml(easeg,cpu_state.eaaddr+4)<<32;
+	begin = readmemw(easeg,cpu_state.eaaddr+8);
+
+        return x87_from80(ll, begin);
+}
+
+/*FLD m80 - keep the raw bytes alongside the double so that a following
+  FSTP m80 (or FSAVE) reproduces them without a round trip through 64 bits*/
+static __inline void x87_ld80_push()
+{
+        uint64_t ll;
+        uint16_t begin;
+
+	ll = readmeml(easeg,cpu_state.eaaddr);
+	ll |= (uint64_t)readmeml(easeg,cpu_state.eaaddr+4)<<32;
+	begin = readmemw(easeg,cpu_state.eaaddr+8);
+        if (cpu_state.abrt) return;
+
+        x87_push(x87_from80(ll, begin));
+        cpu_state.MM[cpu_state.TOP].q = ll;
+        cpu_state.MM_w4[cpu_state.TOP] = begin;
+        cpu_state.tag[cpu_state.TOP] |= TAG_FLOAT80;
+}
+
 static __inline void x87_st80(double d)
 {
        	int64_t sign80;
@@ -221,6 +259,19 @@ static __inline void x87_st80(double d)
 	writememw(easeg,cpu_state.eaaddr+8,test.begin);
 }
 
+/*Store physical register reg as m80, using the exact loaded form if any*/
+static __inline void x87_st80_reg(int reg)
+{
+        if (cpu_state.tag[reg] & TAG_FLOAT80)
+        {
+        	writememl(easeg, cpu_state.eaaddr, cpu_state.MM[reg].q & 0xffffffff);
+        	writememl(easeg, cpu_state.eaaddr + 4, cpu_state.MM[reg].q >> 32);
+        	writememw(easeg, cpu_state.eaaddr + 8, cpu_state.MM_w4[reg]);
+        }
+        else
+                x87_st80(cpu_state.ST[reg]);
+}
+
 static __inline void x87_st_fsave(int reg)
 {
         reg = (cpu_state.TOP + reg) & 7;
@@ -232,7 +283,7 @@ static __inline void x87_st_fsave(int reg)
         	writememw(easeg, cpu_state.eaaddr + 8, 0x5555);
         }
         else
-                x87_st80(cpu_state.ST[reg]);
+                x87_st80_reg(reg);
 }
 
 static __inline void x87_ld_frstor(int reg)
@@ -248,7 +299,11 @@ static __inline void x87_ld_frstor(int reg)
                 cpu_state.ST[reg] = (double)cpu_state.MM[reg].q;
         }
         else
-                cpu_state.ST[reg] = x87_ld80();
+        {
+                cpu_state.ST[reg] = x87_from80(cpu_state.MM[reg].q, cpu_state.MM_w4[reg]);
+                if (cpu_state.tag[reg] != 3)
+                        cpu_state.tag[reg] |= TAG_FLOAT80;
+        }
 }
 
 static __inline void x87_ldmmx(MMX_REG *r, uint16_t *w4)
@@ -333,7 +388,7 @@ static __inline uint16_t x87_compare(double a, double b)
 #else
         /* Generic C version is known to give incorrect results in some
          * situations, eg comparison of infinity (Unreal) */
-        uint32_t out = 0;
+        uint32_t result = 0;
 
 	if (is386)
 	{
@@ -8,7 +8,7 @@
  *
  *		x87 FPU instructions core.
  *
- * Version:	@(#)x87_ops_loadstore.h	1.0.1	2018/02/14
+ * Version:	@(#)x87_ops_loadstore.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -314,25 +314,21 @@ static int opFISTPil_a32(uint32_t fetchdat)
 
 static int opFLDe_a16(uint32_t fetchdat)
 {
-        double t;
         FP_ENTER();
         fetch_ea_16(fetchdat);
         if (fplog) pclog("FLDe %08X:%08X\n", easeg, cpu_state.eaaddr);                        
-        t=x87_ld80(); if (cpu_state.abrt) return 1;
-        if (fplog) pclog("  %f\n", t);
-        x87_push(t);
+        x87_ld80_push(); if (cpu_state.abrt) return 1;
+        if (fplog) pclog("  %f\n", ST(0));
         CLOCK_CYCLES(6);
         return 0;
 }
 static int opFLDe_a32(uint32_t fetchdat)
 {
-        double t;
         FP_ENTER();
         fetch_ea_32(fetchdat);
         if (fplog) pclog("FLDe %08X:%08X\n", easeg, cpu_state.eaaddr);                        
-        t=x87_ld80(); if (cpu_state.abrt) return 1;
-        if (fplog) pclog("  %f\n", t);
-        x87_push(t);
+        x87_ld80_push(); if (cpu_state.abrt) return 1;
+        if (fplog) pclog("  %f\n", ST(0));
         CLOCK_CYCLES(6);
         return 0;
 }
@@ -342,7 +338,7 @@ static int opFSTPe_a16(uint32_t fetchdat)
         FP_ENTER();
         fetch_ea_16(fetchdat);
         if (fplog) pclog("FSTPe %08X:%08X\n", easeg, cpu_state.eaaddr);
-        x87_st80(ST(0)); if (cpu_state.abrt) return 1;
+        x87_st80_reg(cpu_state.TOP); if (cpu_state.abrt) return 1;
         x87_pop();
         CLOCK_CYCLES(6);
         return 0;
@@ -352,7 +348,7 @@ static int opFSTPe_a32(uint32_t fetchdat)
         FP_ENTER();
         fetch_ea_32(fetchdat);
         if (fplog) pclog("FSTPe %08X:%08X\n", easeg, cpu_state.eaaddr);
-        x87_st80(ST(0)); if (cpu_state.abrt) return 1;
+        x87_st80_reg(cpu_state.TOP); if (cpu_state.abrt) return 1;
         x87_pop();
         CLOCK_CYCLES(6);
         return 0;
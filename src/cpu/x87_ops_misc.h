@@ -8,7 +8,7 @@
  *
  *		Miscellaneous x87 FPU Instructions.
  *
- * Version:	@(#)x87_ops_loadstore.h	1.0.1	2018/02/14
+ * Version:	@(#)x87_ops_misc.h	1.0.2	2018/09/16
  *
  * Authors:	Sarah Walker, <tommowalker@tommowalker.co.uk>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -40,7 +40,7 @@ static int opFSTSW_AX(uint32_t fetchdat)
         FP_ENTER();
         cpu_state.pc++;
         if (fplog) pclog("FSTSW\n");
-        AX = cpu_state.npxs;
+        AX = x87_getsw();
         CLOCK_CYCLES(3);
         return 0;
 }
@@ -109,6 +109,8 @@ static int opFST(uint32_t fetchdat)
         if (fplog) pclog("FST\n");
         ST(fetchdat & 7) = ST(0);
         cpu_state.tag[(cpu_state.TOP + fetchdat) & 7] = cpu_state.tag[cpu_state.TOP & 7];
+        cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q = cpu_state.MM[cpu_state.TOP & 7].q;
+        cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7] = cpu_state.MM_w4[cpu_state.TOP & 7];
         CLOCK_CYCLES(3);
         return 0;
 }
@@ -120,6 +122,8 @@ static int opFSTP(uint32_t fetchdat)
         if (fplog) pclog("FSTP\n");
         ST(fetchdat & 7) = ST(0);
         cpu_state.tag[(cpu_state.TOP + fetchdat) & 7] = cpu_state.tag[cpu_state.TOP & 7];
+        cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q = cpu_state.MM[cpu_state.TOP & 7].q;
+        cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7] = cpu_state.MM_w4[cpu_state.TOP & 7];
         x87_pop();
         CLOCK_CYCLES(3);
         return 0;
@@ -196,13 +200,11 @@ static int FSAVE()
 
         FP_ENTER();
         if (fplog) pclog("FSAVE %08X:%08X %i\n", easeg, cpu_state.eaaddr, cpu_state.ismmx);
-        cpu_state.npxs = (cpu_state.npxs & ~(7 << 11)) | (cpu_state.TOP << 11);
-
         switch ((cr0 & 1) | (cpu_state.op32 & 0x100))
         {
                 case 0x000: /*16-bit real mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+4,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+6,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+10,x87_op_off);
@@ -232,7 +234,7 @@ static int FSAVE()
                 break;
                 case 0x001: /*16-bit protected mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+4,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+6,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+8,x87_pc_seg);
@@ -264,7 +266,7 @@ static int FSAVE()
                 break;
                 case 0x100: /*32-bit real mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+4,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+4,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+8,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+12,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+20,x87_op_off);
@@ -295,7 +297,7 @@ static int FSAVE()
                 break;
                 case 0x101: /*32-bit protected mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+4,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+4,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+8,x87_gettag());
                 writememl(easeg,cpu_state.eaaddr+12,x87_pc_off);
                 writememl(easeg,cpu_state.eaaddr+16,x87_pc_seg);
@@ -358,7 +360,7 @@ static int opFSTSW_a16(uint32_t fetchdat)
         FP_ENTER();
         fetch_ea_16(fetchdat);
         if (fplog) pclog("FSTSW %08X:%08X\n", easeg, cpu_state.eaaddr);
-        seteaw((cpu_state.npxs & 0xC7FF) | (cpu_state.TOP << 11));
+        seteaw(x87_getsw());
         CLOCK_CYCLES(3);
         return cpu_state.abrt;
 }
@@ -367,7 +369,7 @@ static int opFSTSW_a32(uint32_t fetchdat)
         FP_ENTER();
         fetch_ea_32(fetchdat);
         if (fplog) pclog("FSTSW %08X:%08X\n", easeg, cpu_state.eaaddr);
-        seteaw((cpu_state.npxs & 0xC7FF) | (cpu_state.TOP << 11));
+        seteaw(x87_getsw());
         CLOCK_CYCLES(3);
         return cpu_state.abrt;
 }
@@ -377,15 +379,18 @@ static int opFLD(uint32_t fetchdat)
 {
         int old_tag;
         uint64_t old_i64;
+        uint16_t old_w4;
         
         FP_ENTER();
         cpu_state.pc++;
         if (fplog) pclog("FLD %f\n", ST(fetchdat & 7));
         old_tag = cpu_state.tag[(cpu_state.TOP + fetchdat) & 7];
         old_i64 = cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q;
+        old_w4 = cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7];
         x87_push(ST(fetchdat&7));
         cpu_state.tag[cpu_state.TOP] = old_tag;
         cpu_state.MM[cpu_state.TOP].q = old_i64;
+        cpu_state.MM_w4[cpu_state.TOP] = old_w4;
         CLOCK_CYCLES(4);
         return 0;
 }
@@ -395,6 +400,7 @@ static int opFXCH(uint32_t fetchdat)
         double td;
         uint8_t old_tag;
         uint64_t old_i64;
+        uint16_t old_w4;
         FP_ENTER();
         cpu_state.pc++;
         if (fplog) pclog("FXCH\n");
@@ -407,6 +413,9 @@ static int opFXCH(uint32_t fetchdat)
         old_i64 = cpu_state.MM[cpu_state.TOP].q;
         cpu_state.MM[cpu_state.TOP].q = cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q;
         cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q = old_i64;
+        old_w4 = cpu_state.MM_w4[cpu_state.TOP];
+        cpu_state.MM_w4[cpu_state.TOP] = cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7];
+        cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7] = old_w4;
         
         CLOCK_CYCLES(4);
         return 0;
@@ -418,7 +427,7 @@ static int opFCHS(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FCHS\n");
         ST(0) = -ST(0);
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         CLOCK_CYCLES(6);
         return 0;
 }
@@ -429,7 +438,7 @@ static int opFABS(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FABS %f\n", ST(0));
         ST(0) = fabs(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         CLOCK_CYCLES(3);
         return 0;
 }
@@ -537,7 +546,7 @@ static int opF2XM1(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("F2XM1\n");
         ST(0) = pow(2.0, ST(0)) - 1.0;
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         CLOCK_CYCLES(200);
         return 0;
 }
@@ -548,7 +557,7 @@ static int opFYL2X(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FYL2X\n");
         ST(1) = ST(1) * (log(ST(0)) / log(2.0));
-        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_UINT64;
+        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_EXACT;
         x87_pop();
         CLOCK_CYCLES(250);
         return 0;
@@ -560,7 +569,7 @@ static int opFYL2XP1(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FYL2XP1\n");
         ST(1) = ST(1) * (log1p(ST(0)) / log(2.0));
-        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_UINT64;
+        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_EXACT;
         x87_pop();
         CLOCK_CYCLES(250);
         return 0;
@@ -572,7 +581,7 @@ static int opFPTAN(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FPTAN\n");
         ST(0) = tan(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         x87_push(1.0);
         cpu_state.npxs &= ~C2;
         CLOCK_CYCLES(235);
@@ -585,7 +594,7 @@ static int opFPATAN(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FPATAN\n");
         ST(1) = atan2(ST(1), ST(0));
-        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_UINT64;
+        cpu_state.tag[(cpu_state.TOP + 1) & 7] &= ~TAG_EXACT;
         x87_pop();
         CLOCK_CYCLES(250);
         return 0;
@@ -619,7 +628,7 @@ static int opFPREM(uint32_t fetchdat)
         if (fplog) pclog("FPREM %f %f  ", ST(0), ST(1));
         temp64 = (int64_t)(ST(0) / ST(1));
         ST(0) = ST(0) - (ST(1) * (double)temp64);
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         if (fplog) pclog("%f\n", ST(0));
         cpu_state.npxs &= ~(C0|C1|C2|C3);
         if (temp64 & 4) cpu_state.npxs|=C0;
@@ -636,7 +645,7 @@ static int opFPREM1(uint32_t fetchdat)
         if (fplog) pclog("FPREM1 %f %f  ", ST(0), ST(1));
         temp64 = (int64_t)(ST(0) / ST(1));
         ST(0) = ST(0) - (ST(1) * (double)temp64);
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         if (fplog) pclog("%f\n", ST(0));
         cpu_state.npxs &= ~(C0|C1|C2|C3);
         if (temp64 & 4) cpu_state.npxs|=C0;
@@ -652,7 +661,7 @@ static int opFSQRT(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FSQRT\n");
         ST(0) = sqrt(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         CLOCK_CYCLES(83);
         return 0;
 }
@@ -665,7 +674,7 @@ static int opFSINCOS(uint32_t fetchdat)
         if (fplog) pclog("FSINCOS\n");
         td = ST(0);
         ST(0) = sin(td);
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         x87_push(cos(td));
         cpu_state.npxs &= ~C2;
         CLOCK_CYCLES(330);
@@ -678,7 +687,7 @@ static int opFRNDINT(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FRNDINT %g ", ST(0));
         ST(0) = (double)x87_fround(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         if (fplog) pclog("%g\n", ST(0));
         CLOCK_CYCLES(21);
         return 0;
@@ -692,7 +701,7 @@ static int opFSCALE(uint32_t fetchdat)
         if (fplog) pclog("FSCALE\n");
         temp64 = (int64_t)ST(1);
         ST(0) = ST(0) * pow(2.0, (double)temp64);
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         CLOCK_CYCLES(30);
         return 0;
 }
@@ -703,7 +712,7 @@ static int opFSIN(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FSIN\n");
         ST(0) = sin(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         cpu_state.npxs &= ~C2;
         CLOCK_CYCLES(300);
         return 0;
@@ -715,7 +724,7 @@ static int opFCOS(uint32_t fetchdat)
         cpu_state.pc++;
         if (fplog) pclog("FCOS\n");
         ST(0) = cos(ST(0));
-        cpu_state.tag[cpu_state.TOP] &= ~TAG_UINT64;
+        cpu_state.tag[cpu_state.TOP] &= ~TAG_EXACT;
         cpu_state.npxs &= ~C2;
         CLOCK_CYCLES(300);
         return 0;
@@ -799,14 +808,14 @@ static int FSTENV()
         {
                 case 0x000: /*16-bit real mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+4,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+6,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+10,x87_op_off);
                 break;
                 case 0x001: /*16-bit protected mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+2,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+2,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+4,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+6,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+8,x87_pc_seg);
@@ -815,7 +824,7 @@ static int FSTENV()
                 break;
                 case 0x100: /*32-bit real mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+4,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+4,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+8,x87_gettag());
                 writememw(easeg,cpu_state.eaaddr+12,x87_pc_off);
                 writememw(easeg,cpu_state.eaaddr+20,x87_op_off);
@@ -823,7 +832,7 @@ static int FSTENV()
                 break;
                 case 0x101: /*32-bit protected mode*/
                 writememw(easeg,cpu_state.eaaddr,cpu_state.npxc);
-                writememw(easeg,cpu_state.eaaddr+4,cpu_state.npxs);
+                writememw(easeg,cpu_state.eaaddr+4,x87_getsw());
                 writememw(easeg,cpu_state.eaaddr+8,x87_gettag());
                 writememl(easeg,cpu_state.eaaddr+12,x87_pc_off);
                 writememl(easeg,cpu_state.eaaddr+16,x87_pc_seg);
@@ -879,6 +888,7 @@ static int opFSTCW_a32(uint32_t fetchdat)
                 {                                                                       \
                         cpu_state.tag[cpu_state.TOP] = cpu_state.tag[(cpu_state.TOP + fetchdat) & 7];                           \
                         cpu_state.MM[cpu_state.TOP].q = cpu_state.MM[(cpu_state.TOP + fetchdat) & 7].q;                     \
+                        cpu_state.MM_w4[cpu_state.TOP] = cpu_state.MM_w4[(cpu_state.TOP + fetchdat) & 7];                   \
                         ST(0) = ST(fetchdat & 7);                                       \
                 }                                                                       \
                 CLOCK_CYCLES(4);                                                        \
@@ -9,7 +9,7 @@
  *		Implementation of the generic device interface to handle
  *		all devices attached to the emulator.
  *
- * Version:	@(#)device.c	1.0.14	2018/04/02
+ * Version:	@(#)device.c	1.0.16	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -50,6 +50,7 @@
 #include "devices/sound/sound.h"
 #include "ui/ui.h"
 #include "plat.h"
+#include "state.h"
 
 
 #define DEVICE_MAX	256			/* max # of devices */
@@ -172,9 +173,11 @@ device_add(const device_t *d)
 	priv = d->init(d);
 	if (priv == NULL) {
 		if (d->name)
-			pclog("DEVICE: device '%s' init failed\n", d->name);
+			pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+				"DEVICE: device '%s' init failed\n", d->name);
 		  else
-			pclog("DEVICE: device init failed\n");
+			pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+				"DEVICE: device init failed\n");
 		return(NULL);
 	}
     }
@@ -283,6 +286,45 @@ device_speed_changed(void)
 }
 
 
+/* Save the state of all devices that know how to. */
+void
+device_save_state(void)
+{
+    int c;
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if ((devices[c] == NULL) || (devices[c]->save == NULL)) continue;
+
+	state_begin("DEV ");
+	state_write_str(devices[c]->name);
+	devices[c]->save(device_priv[c]);
+	state_end();
+    }
+}
+
+
+/* Restore the state of the device named in this section. */
+void
+device_load_state(int version)
+{
+    char temp[128];
+    int c;
+
+    state_read_str(temp, sizeof(temp));
+
+    for (c = 0; c < DEVICE_MAX; c++) {
+	if ((devices[c] == NULL) || (devices[c]->load == NULL)) continue;
+
+	if (! strcmp(devices[c]->name, temp)) {
+		devices[c]->load(device_priv[c], version);
+		return;
+	}
+    }
+
+    pclog("DEVICE: no device '%s' to restore, ignored\n", temp);
+}
+
+
 void
 device_force_redraw(void)
 {
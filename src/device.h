@@ -8,7 +8,7 @@
  *
  *		Definitions for the device handler.
  *
- * Version:	@(#)device.h	1.0.7	2018/08/20
+ * Version:	@(#)device.h	1.0.8	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -107,6 +107,9 @@ typedef struct _device_ {
     void	(*add_status_info)(char *s, int max_len, void *priv);
 
     const device_config_t *config;
+
+    void	(*save)(void *priv);	/* save state, see state.c */
+    void	(*load)(void *priv, int version);
 } device_t;
 
 
@@ -125,6 +128,8 @@ extern int		device_available(const device_t *);
 extern void		device_speed_changed(void);
 extern void		device_force_redraw(void);
 extern void		device_add_status_info(char *s, int max_len);
+extern void		device_save_state(void);
+extern void		device_load_state(int version);
 
 extern int		device_is_valid(const device_t *, int machine_flags);
 
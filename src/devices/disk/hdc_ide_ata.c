@@ -14,7 +14,7 @@
  *		Devices currently implemented are hard disk, CD-ROM and
  *		ZIP IDE/ATAPI devices.
  *
- * Version:	@(#)hdc_ide_ata.c	1.0.22	2018/05/06
+ * Version:	@(#)hdc_ide_ata.c	1.0.23	2018/09/16
  *
  * Authors:	Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -59,6 +59,7 @@
 #include "../../device.h"
 #include "../../ui/ui.h"
 #include "../../plat.h"
+#include "../../state.h"
 #include "../system/pic.h"
 #include "../system/pci.h"
 #include "../cdrom/cdrom.h"
@@ -3014,13 +3015,146 @@ ide_saclose(void *priv)
 }
 
 
+/*
+ * Save the state of the drives. All controllers share the same
+ * (global) drive data, so it does not matter which one does it.
+ * The state of ATAPI drives lives in the CD-ROM and ZIP modules,
+ * which do not save it, see state.c. The channel timers are saved
+ * with all other timers.
+ */
+static void
+ide_sasave(void *priv)
+{
+    IDE *ide;
+    uint8_t buf;
+    int d;
+
+    state_put(cur_ide);
+
+    for (d = 0; d < IDE_NUM; d++) {
+	ide = &ide_drives[d];
+
+	state_put(ide->atastat);
+	state_put(ide->error);
+	state_put(ide->secount);
+	state_put(ide->sector);
+	state_put(ide->cylinder);
+	state_put(ide->head);
+	state_put(ide->drive);
+	state_put(ide->cylprecomp);
+	state_put(ide->command);
+	state_put(ide->fdisk);
+	state_put(ide->pos);
+	state_put(ide->packlen);
+	state_put(ide->spt);
+	state_put(ide->hpc);
+	state_put(ide->t_spt);
+	state_put(ide->t_hpc);
+	state_put(ide->tracks);
+	state_put(ide->packetstatus);
+	state_put(ide->asc);
+	state_put(ide->reset);
+	state_put(ide->irqstat);
+	state_put(ide->service);
+	state_put(ide->lba);
+	state_put(ide->lba_addr);
+	state_put(ide->skip512);
+	state_put(ide->blocksize);
+	state_put(ide->blockcount);
+	state_put(ide->dma_identify_data);
+	state_put(ide->specify_success);
+	state_put(ide->mdma_mode);
+	state_put(ide->do_initial_read);
+	state_put(ide->sector_pos);
+
+	buf = (ide->buffer != NULL);
+	state_put(buf);
+	if (buf)
+		state_write_block((uint8_t *)ide->buffer,
+				  65536 * sizeof(uint16_t));
+	buf = (ide->sector_buffer != NULL);
+	state_put(buf);
+	if (buf)
+		state_write_block(ide->sector_buffer, 256 * 512);
+    }
+}
+
+
+static void
+ide_saload(void *priv, int version)
+{
+    IDE *ide;
+    uint8_t buf;
+    int d;
+
+    state_get(cur_ide);
+
+    for (d = 0; d < IDE_NUM; d++) {
+	ide = &ide_drives[d];
+
+	state_get(ide->atastat);
+	state_get(ide->error);
+	state_get(ide->secount);
+	state_get(ide->sector);
+	state_get(ide->cylinder);
+	state_get(ide->head);
+	state_get(ide->drive);
+	state_get(ide->cylprecomp);
+	state_get(ide->command);
+	state_get(ide->fdisk);
+	state_get(ide->pos);
+	state_get(ide->packlen);
+	state_get(ide->spt);
+	state_get(ide->hpc);
+	state_get(ide->t_spt);
+	state_get(ide->t_hpc);
+	state_get(ide->tracks);
+	state_get(ide->packetstatus);
+	state_get(ide->asc);
+	state_get(ide->reset);
+	state_get(ide->irqstat);
+	state_get(ide->service);
+	state_get(ide->lba);
+	state_get(ide->lba_addr);
+	state_get(ide->skip512);
+	state_get(ide->blocksize);
+	state_get(ide->blockcount);
+	state_get(ide->dma_identify_data);
+	state_get(ide->specify_success);
+	state_get(ide->mdma_mode);
+	state_get(ide->do_initial_read);
+	state_get(ide->sector_pos);
+
+	/* The drives must be the same as when the state was saved. */
+	state_get(buf);
+	if (buf != (ide->buffer != NULL)) {
+		pclog("IDE: drive %i does not match state\n", d);
+		state_set_error();
+		return;
+	}
+	if (buf)
+		state_read_block((uint8_t *)ide->buffer,
+				 65536 * sizeof(uint16_t));
+	state_get(buf);
+	if (buf != (ide->sector_buffer != NULL)) {
+		pclog("IDE: drive %i does not match state\n", d);
+		state_set_error();
+		return;
+	}
+	if (buf)
+		state_read_block(ide->sector_buffer, 256 * 512);
+    }
+}
+
+
 const device_t ide_isa_device = {
     "ISA PC/AT IDE Controller",
     DEVICE_ISA | DEVICE_AT,
     0,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_isa_2ch_device = {
@@ -3029,7 +3163,8 @@ const device_t ide_isa_2ch_device = {
     2,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_isa_2ch_opt_device = {
@@ -3038,7 +3173,8 @@ const device_t ide_isa_2ch_opt_device = {
     3,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_vlb_device = {
@@ -3047,7 +3183,8 @@ const device_t ide_vlb_device = {
     4,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_vlb_2ch_device = {
@@ -3056,7 +3193,8 @@ const device_t ide_vlb_2ch_device = {
     6,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_pci_device = {
@@ -3065,7 +3203,8 @@ const device_t ide_pci_device = {
     8,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
 
 const device_t ide_pci_2ch_device = {
@@ -3074,5 +3213,6 @@ const device_t ide_pci_2ch_device = {
     10,
     ide_sainit, ide_saclose, NULL,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    ide_sasave, ide_saload
 };
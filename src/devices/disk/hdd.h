@@ -8,7 +8,7 @@
  *
  *		Definitions for the hard disk image handler.
  *
- * Version:	@(#)hdd.h	1.0.9	2018/06/06
+ * Version:	@(#)hdd.h	1.0.10	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -127,6 +127,7 @@ extern uint8_t	hdd_image_get_type(uint8_t id);
 extern void	hdd_image_specify(uint8_t id, int hpc, int spt);
 extern void	hdd_image_unload(uint8_t id, int fn_preserve);
 extern void	hdd_image_close(uint8_t id);
+extern int	hdd_image_cow(uint8_t id);
 
 extern int	image_is_hdi(const wchar_t *s);
 extern int	image_is_hdx(const wchar_t *s, int check_signature);
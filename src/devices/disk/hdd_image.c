@@ -8,7 +8,7 @@
  *
  *		Handling of hard disk image files.
  *
- * Version:	@(#)hdd_image.c	1.0.5	2018/05/06
+ * Version:	@(#)hdd_image.c	1.0.8	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -48,12 +48,31 @@
 #include "hdd.h"
 
 
+/*
+ * Copy-on-write overlay, used by forked child processes.
+ *
+ * The image file itself is only read; all sectors written are
+ * kept in memory, in chunks of COW_SECTORS sectors that get
+ * allocated on their first write.
+ */
+#define COW_SHIFT	6
+#define COW_SECTORS	(1 << COW_SHIFT)
+#define COW_MASK	(COW_SECTORS - 1)
+
+typedef struct {
+    uint64_t	valid;				/* sectors present */
+    uint8_t	data[COW_SECTORS * 512];
+} cow_chunk_t;
+
+
 typedef struct {
     FILE *file;
     uint32_t base;
     uint32_t last_sector;
     uint8_t type;
     uint8_t loaded;
+    uint32_t cow_size;				/* number of chunks */
+    cow_chunk_t **cow;				/* overlay, or NULL */
 } hdd_image_t;
 
 
@@ -62,6 +81,109 @@ hdd_image_t	hdd_images[HDD_NUM];
 
 static char	empty_sector[512];
 static char	*empty_sector_1mb;
+static int	cow_mode;
+
+
+static void
+cow_free(hdd_image_t *img)
+{
+    uint32_t i;
+
+    if (img->cow == NULL) return;
+
+    for (i = 0; i < img->cow_size; i++) {
+	if (img->cow[i] != NULL)
+		free(img->cow[i]);
+    }
+    free(img->cow);
+
+    img->cow = NULL;
+    img->cow_size = 0;
+}
+
+
+/* Find the overlay chunk for a sector, optionally creating it. */
+static cow_chunk_t *
+cow_chunk(hdd_image_t *img, uint32_t sector, int alloc)
+{
+    uint32_t c = sector >> COW_SHIFT;
+
+    if (c >= img->cow_size) return(NULL);
+
+    if ((img->cow[c] == NULL) && alloc) {
+	img->cow[c] = (cow_chunk_t *)calloc(1, sizeof(cow_chunk_t));
+
+	/*
+	 * The image may be shared with the parent, so we cannot write
+	 * through to it, and dropping the write would silently corrupt
+	 * the guest's view of the disk.
+	 */
+	if (img->cow[c] == NULL)
+		fatal("HDD: out of memory for copy-on-write overlay\n");
+    }
+
+    return(img->cow[c]);
+}
+
+
+static int
+cow_present(hdd_image_t *img, uint32_t sector)
+{
+    cow_chunk_t *ch = cow_chunk(img, sector, 0);
+
+    return((ch != NULL) && (ch->valid & (1ULL << (sector & COW_MASK))));
+}
+
+
+static void
+cow_read(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *bufp)
+{
+    uint32_t n;
+
+    while (count > 0) {
+	if (cow_present(img, sector)) {
+		memcpy(bufp,
+		       &img->cow[sector >> COW_SHIFT]->data[(sector & COW_MASK) * 512], 512);
+		n = 1;
+	} else {
+		/* Read a run of unmodified sectors from the file. */
+		for (n = 1; n < count; n++)
+			if (cow_present(img, sector + n)) break;
+
+		fseeko64(img->file, ((uint64_t)sector * 512) + img->base, SEEK_SET);
+		fread(bufp, 1, n * 512, img->file);
+	}
+
+	sector += n;
+	count -= n;
+	bufp += (n * 512);
+    }
+}
+
+
+/* Write sectors to the overlay; a NULL buffer writes zeroes. */
+static void
+cow_write(hdd_image_t *img, uint32_t sector, uint32_t count, const uint8_t *bufp)
+{
+    cow_chunk_t *ch;
+    uint8_t *ptr;
+
+    while (count-- > 0) {
+	/* Past the end of the image, nothing to write to. */
+	ch = cow_chunk(img, sector, 1);
+	if (ch == NULL) break;
+
+	ptr = &ch->data[(sector & COW_MASK) * 512];
+	if (bufp != NULL) {
+		memcpy(ptr, bufp, 512);
+		bufp += 512;
+	} else
+		memset(ptr, 0x00, 512);
+	ch->valid |= (1ULL << (sector & COW_MASK));
+
+	sector++;
+    }
+}
 
 
 int
@@ -143,6 +265,7 @@ hdd_image_load(int id)
 	}
 	hdd_images[id].loaded = 0;
     }
+    cow_free(&hdd_images[id]);
 
     is_hdx[0] = image_is_hdx(fn, 0);
     is_hdx[1] = image_is_hdx(fn, 1);
@@ -331,6 +454,10 @@ prepare_new_hard_disk:
 
     hdd_images[id].loaded = 1;
 
+    /* In a forked child, images never get written to. */
+    if (cow_mode)
+	(void)hdd_image_cow(id);
+
     return 1;
 }
 
@@ -348,6 +475,11 @@ hdd_image_seek(uint8_t id, uint32_t sector)
 void
 hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
+    if (hdd_images[id].cow != NULL) {
+	cow_read(&hdd_images[id], sector, count, buffer);
+	return;
+    }
+
     fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
     fread(buffer, 1, count * 512, hdd_images[id].file);
 }
@@ -371,8 +503,12 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     if ((sectors - sector) < transfer_sectors)
 	transfer_sectors = sectors - sector;
 
-    fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
-    fread(buffer, 1, transfer_sectors * 512, hdd_images[id].file);
+    if (hdd_images[id].cow != NULL)
+	cow_read(&hdd_images[id], sector, transfer_sectors, buffer);
+      else {
+	fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
+	fread(buffer, 1, transfer_sectors * 512, hdd_images[id].file);
+    }
 
     if (count != transfer_sectors)
 	return 1;
@@ -384,6 +520,11 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 void
 hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
+    if (hdd_images[id].cow != NULL) {
+	cow_write(&hdd_images[id], sector, count, buffer);
+	return;
+    }
+
     fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
     fwrite(buffer, count * 512, 1, hdd_images[id].file);
 }
@@ -398,8 +539,12 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     if ((sectors - sector) < transfer_sectors)
 	transfer_sectors = sectors - sector;
 
-    fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
-    fwrite(buffer, transfer_sectors * 512, 1, hdd_images[id].file);
+    if (hdd_images[id].cow != NULL)
+	cow_write(&hdd_images[id], sector, transfer_sectors, buffer);
+      else {
+	fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
+	fwrite(buffer, transfer_sectors * 512, 1, hdd_images[id].file);
+    }
 
     if (count != transfer_sectors)
 	return 1;
@@ -413,6 +558,11 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
 {
     uint32_t i;
 
+    if (hdd_images[id].cow != NULL) {
+	cow_write(&hdd_images[id], sector, count, NULL);
+	return;
+    }
+
     fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
     for (i = 0; i < count; i++)
 	fwrite(empty_sector, 512, 1, hdd_images[id].file);
@@ -429,9 +579,13 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
     if ((sectors - sector) < transfer_sectors)
 	transfer_sectors = sectors - sector;
 
-    fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
-    for (i = 0; i < transfer_sectors; i++)
-	fwrite(empty_sector, 1, 512, hdd_images[id].file);
+    if (hdd_images[id].cow != NULL)
+	cow_write(&hdd_images[id], sector, transfer_sectors, NULL);
+      else {
+	fseeko64(hdd_images[id].file, ((uint64_t)sector * 512) + hdd_images[id].base, SEEK_SET);
+	for (i = 0; i < transfer_sectors; i++)
+		fwrite(empty_sector, 1, 512, hdd_images[id].file);
+    }
 
     if (count != transfer_sectors)
 	return 1;
@@ -460,6 +614,7 @@ hdd_image_specify(uint8_t id, int hpc, int spt)
     if (hdd_images[id].type == 2) {
 	hdd[id].at_hpc = (uint8_t)hpc;
 	hdd[id].at_spt = (uint8_t)spt;
+	if (hdd_images[id].cow != NULL) return;
 	fseeko64(hdd_images[id].file, 0x20, SEEK_SET);
 	fwrite(&(hdd[id].at_spt), 1, 4, hdd_images[id].file);
 	fwrite(&(hdd[id].at_hpc), 1, 4, hdd_images[id].file);
@@ -479,6 +634,7 @@ hdd_image_unload(uint8_t id, int fn_preserve)
 	}
 	hdd_images[id].loaded = 0;
     }
+    cow_free(&hdd_images[id]);
 
     hdd_images[id].last_sector = -1;
 
@@ -496,6 +652,48 @@ hdd_image_close(uint8_t id)
 	fclose(hdd_images[id].file);
 	hdd_images[id].file = NULL;
     }
+    cow_free(&hdd_images[id]);
 
     hdd_images[id].loaded = 0;
 }
+
+
+/*
+ * Switch an image to copy-on-write mode.
+ *
+ * This is used by forked child processes, which all share the
+ * same image files. We re-open the file read-only (so we get a
+ * private file position), and from then on keep all writes in
+ * a private overlay, which is lost when the image is closed.
+ * Failing to do so is fatal, there is no safe way to go on.
+ */
+int
+hdd_image_cow(uint8_t id)
+{
+    hdd_image_t *img = &hdd_images[id];
+    FILE *f;
+
+    cow_mode = 1;
+
+    if (! img->loaded || (img->file == NULL) || (img->cow != NULL))
+	return(0);
+
+    /*
+     * The inherited file shares its descriptor and offset with the
+     * parent and the other children, so carrying on with it would
+     * corrupt their image.
+     */
+    f = plat_fopen(hdd[id].fn, L"rb");
+    if (f == NULL)
+	fatal("HDD: cannot re-open image %i for copy-on-write\n", id);
+
+    img->cow_size = (hdd_sectors(id) + COW_SECTORS - 1) >> COW_SHIFT;
+    img->cow = (cow_chunk_t **)calloc(img->cow_size, sizeof(cow_chunk_t *));
+    if (img->cow == NULL)
+	fatal("HDD: out of memory for copy-on-write overlay\n");
+
+    fclose(img->file);
+    img->file = f;
+
+    return(1);
+}
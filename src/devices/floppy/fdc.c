@@ -9,7 +9,7 @@
  *		Implementation of the NEC uPD-765 and compatible floppy disk
  *		controller.
  *
- * Version:	@(#)fdc.c	1.0.14	2018/06/25
+ * Version:	@(#)fdc.c	1.0.15	2018/09/16
  *
  * Authors:	Miran Grca, <mgrca8@gmail.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -50,6 +50,7 @@
 #include "../../rom.h"
 #include "../../timer.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../../ui/ui.h"
 #include "../system/dma.h"
 #include "../system/pic.h"
@@ -2213,6 +2214,60 @@ fdc_init(const device_t *info)
 }
 
 
+/*
+ * Save the state of the controller, and that of the drives.
+ * The structure holds no pointers, so it is saved as-is, with
+ * its size to catch a build that lays it out differently.
+ */
+static void
+fdc_save(void *priv)
+{
+    fdc_t *fdc = (fdc_t *)priv;
+    uint32_t size = sizeof(fdc_t);
+
+    state_put(size);
+    state_write(fdc, size);
+
+    fdd_save_state();
+}
+
+
+static void
+fdc_load(void *priv, int version)
+{
+    fdc_t *fdc = (fdc_t *)priv;
+    uint32_t size;
+    int flags, base;
+
+    state_get(size);
+    if (size != sizeof(fdc_t)) {
+	pclog("FDC: state size %lu, expected %lu\n",
+		(unsigned long)size, (unsigned long)sizeof(fdc_t));
+	state_set_error();
+	return;
+    }
+
+    /* The I/O handlers are owned by the machine, keep them. */
+    flags = fdc->flags;
+    base = fdc->base_address;
+    state_read(fdc, size);
+    fdc->flags = flags;
+    fdc->base_address = base;
+
+    fdd_load_state(version);
+
+    /*
+     * The image handlers did not save what they were doing, so
+     * a transfer that was going on can not go on. Fail it, like
+     * a real drive would, and have the guest try again.
+     */
+    if (fdc->inread) {
+	fdc->inread = 0;
+	fdc_noidam(fdc);
+    }
+}
+
+
 void
 fdc_3f1_enable(fdc_t *fdc, int enable)
 {
@@ -2226,7 +2281,8 @@ const device_t fdc_xt_device = {
     0,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_pcjr_device = {
@@ -2235,7 +2291,8 @@ const device_t fdc_pcjr_device = {
     FDC_FLAG_PCJR,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_device = {
@@ -2244,7 +2301,8 @@ const device_t fdc_at_device = {
     FDC_FLAG_AT,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_actlow_device = {
@@ -2253,7 +2311,8 @@ const device_t fdc_at_actlow_device = {
     FDC_FLAG_AT|FDC_FLAG_DISKCHG_ACTLOW,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_ps1_device = {
@@ -2262,7 +2321,8 @@ const device_t fdc_at_ps1_device = {
     FDC_FLAG_AT|FDC_FLAG_PS1|FDC_FLAG_DISKCHG_ACTLOW,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_smc_device = {
@@ -2271,7 +2331,8 @@ const device_t fdc_at_smc_device = {
     FDC_FLAG_AT|FDC_FLAG_SUPERIO,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_winbond_device = {
@@ -2282,7 +2343,8 @@ const device_t fdc_at_winbond_device = {
     fdc_close,
     fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
 
 const device_t fdc_at_nsc_device = {
@@ -2291,5 +2353,6 @@ const device_t fdc_at_nsc_device = {
     FDC_FLAG_AT|FDC_FLAG_MORE_TRACKS|FDC_FLAG_NSC,
     fdc_init, fdc_close, fdc_reset,
     NULL, NULL, NULL, NULL,
-    NULL
+    NULL,
+    fdc_save, fdc_load
 };
@@ -8,7 +8,7 @@
  *
  *		Implementation of the floppy drive emulation.
  *
- * Version:	@(#)fdd.c	1.0.13	2018/05/14
+ * Version:	@(#)fdd.c	1.0.14	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -50,6 +50,7 @@
 #include "../../timer.h"
 #include "../../ui/ui.h"
 #include "../../plat.h"
+#include "../../state.h"
 #include "fdd.h"
 #include "fdd_86f.h"
 #include "fdd_fdi.h"
@@ -745,3 +746,43 @@ void fdd_set_fdc(void *fdc)
 {
 	fdd_fdc = (fdc_t *) fdc;
 }
+
+/*
+ * Save the state of the drive mechanics, called by the FDC. The
+ * motor timers are saved with all other timers. What the image
+ * handlers are doing (a sector being read) is not saved, the FDC
+ * aborts such a transfer when it is restored.
+ */
+void fdd_save_state(void)
+{
+        int d;
+
+        for (d = 0; d < FDD_NUM; d++) {
+                state_put(fdd[d].track);
+                state_put(fdd[d].head);
+                state_put(fdd[d].densel);
+                state_put(fdd_changed[d]);
+        }
+        state_put(curdrive);
+        state_put(motorspin);
+        state_put(fdd_period);
+}
+
+void fdd_load_state(int version)
+{
+        int d;
+
+        for (d = 0; d < FDD_NUM; d++) {
+                fdd_stop(d);
+
+                state_get(fdd[d].track);
+                state_get(fdd[d].head);
+                state_get(fdd[d].densel);
+                state_get(fdd_changed[d]);
+
+                fdd_do_seek(d, fdd[d].track);
+        }
+        state_get(curdrive);
+        state_get(motorspin);
+        state_get(fdd_period);
+}
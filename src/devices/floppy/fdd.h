@@ -8,7 +8,7 @@
  *
  *		Definitions for the floppy drive emulation.
  *
- * Version:	@(#)fdd.h	1.0.6	2018/05/14
+ * Version:	@(#)fdd.h	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -135,6 +135,8 @@ extern double	fdd_byteperiod(int drive);
 extern void	fdd_stop(int drive);
 extern int	fdd_empty(int drive);
 extern void	fdd_set_rate(int drive, int drvden, int rate);
+extern void	fdd_save_state(void);
+extern void	fdd_load_state(int version);
 
 extern int	motorspin;
 extern int64_t	motoron[FDD_NUM];
@@ -151,7 +151,7 @@ lzf_compress (const void *const in_data, unsigned int in_len,
       hval = NEXT (hval, ip);
       hslot = htab + IDX (hval);
       ref = *hslot + LZF_HSLOT_BIAS;
-      *hslot = *(LZF_HSLOT *)(ip - LZF_HSLOT_BIAS);
+      *hslot = ip - LZF_HSLOT_BIAS;
 
       if (1
 #if INIT_HTAB
@@ -241,7 +241,7 @@ lzf_compress (const void *const in_data, unsigned int in_len,
           hval = FRST (ip);
 
           hval = NEXT (hval, ip);
-          htab[IDX (hval)] = *(LZF_HSLOT *)(ip - LZF_HSLOT_BIAS);
+          htab[IDX (hval)] = ip - LZF_HSLOT_BIAS;
           ip++;
 
 # if VERY_FAST && !ULTRA_FAST
@@ -11,7 +11,7 @@
  * NOTE:	Several changes to disable Mode1 for now, as this breaks 
  *		 the TSX32 operating system. More cleanups needed..
  *
- * Version:	@(#)keyboard_at.c	1.0.16	2018/09/11
+ * Version:	@(#)keyboard_at.c	1.0.17	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -41,6 +41,7 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
@@ -51,6 +52,7 @@
 #include "../../mem.h"
 #include "../../timer.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../system/pic.h"
 #include "../system/pit.h"
 #include "../system/ppi.h"
@@ -2312,6 +2314,67 @@ kbd_close(void *priv)
 }
 
 
+/*
+ * Save the controller state. The vendor hooks at the end of
+ * the structure are set up by the init code, so we leave them
+ * out. The timers are saved by the timer module.
+ */
+static void
+kbd_save(void *priv)
+{
+    atkbd_t *kbd = (atkbd_t *)priv;
+
+    state_write(kbd, offsetof(atkbd_t, write60_ven));
+
+    state_put(keyboard_set3_flags);
+    state_put(keyboard_set3_all_repeat);
+    state_put(keyboard_set3_all_break);
+    state_put(keyboard_mode);
+    state_put(keyboard_scan);
+    state_put(mouse_scan);
+    state_put(sc_or);
+
+    state_put(key_ctrl_queue);
+    state_put(key_ctrl_queue_start);
+    state_put(key_ctrl_queue_end);
+    state_put(key_queue);
+    state_put(key_queue_start);
+    state_put(key_queue_end);
+    state_put(mouse_queue);
+    state_put(mouse_queue_start);
+    state_put(mouse_queue_end);
+}
+
+
+static void
+kbd_load(void *priv, int version)
+{
+    atkbd_t *kbd = (atkbd_t *)priv;
+
+    state_read(kbd, offsetof(atkbd_t, write60_ven));
+
+    state_get(keyboard_set3_flags);
+    state_get(keyboard_set3_all_repeat);
+    state_get(keyboard_set3_all_break);
+    state_get(keyboard_mode);
+    state_get(keyboard_scan);
+    state_get(mouse_scan);
+    state_get(sc_or);
+
+    state_get(key_ctrl_queue);
+    state_get(key_ctrl_queue_start);
+    state_get(key_ctrl_queue_end);
+    state_get(key_queue);
+    state_get(key_queue_start);
+    state_get(key_queue_end);
+    state_get(mouse_queue);
+    state_get(mouse_queue_start);
+    state_get(mouse_queue_end);
+
+    kbd_setmap(kbd);
+}
+
+
 const device_t keyboard_at_device = {
     "PC/AT Keyboard",
     0,
@@ -2319,7 +2382,8 @@ const device_t keyboard_at_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_at_ami_device = {
@@ -2329,7 +2393,8 @@ const device_t keyboard_at_ami_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_at_toshiba_device = {
@@ -2339,7 +2404,8 @@ const device_t keyboard_at_toshiba_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_ps2_device = {
@@ -2349,7 +2415,8 @@ const device_t keyboard_ps2_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_ps2_ami_device = {
@@ -2359,7 +2426,8 @@ const device_t keyboard_ps2_ami_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_ps2_mca_device = {
@@ -2369,7 +2437,8 @@ const device_t keyboard_ps2_mca_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_ps2_mca_2_device = {
@@ -2379,7 +2448,8 @@ const device_t keyboard_ps2_mca_2_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 const device_t keyboard_ps2_quadtel_device = {
@@ -2389,7 +2459,8 @@ const device_t keyboard_ps2_quadtel_device = {
     kbd_init,
     kbd_close,
     kbd_reset,
-    NULL, NULL, NULL, NULL
+    NULL, NULL, NULL, NULL, NULL,
+    kbd_save, kbd_load
 };
 
 
@@ -32,7 +32,7 @@
  * TODO:	The EV159 is supposed to support 16b EMS transfers, but the
  *		EMM.sys driver for it doesn't seem to want to do that..
  *
- * Version:	@(#)isamem.c	1.0.4	2018/09/02
+ * Version:	@(#)isamem.c	1.0.5	2018/09/02
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -467,14 +467,16 @@ dev->frame_addr = 0xE0000;
     if (dev->flags & FLAG_WIDE) {
 	if (AT) {
 		if (! cpu_16bitbus)
-			pclog("ISAMEM: *WARNING* this board will slow down your PC!\n");
+			pclog_lvl(PCLOG_CAT_DEV, PCLOG_WARNING,
+				"ISAMEM: *WARNING* this board will slow down your PC!\n");
 	} else {
 		pclog("ISAMEM: not AT+ system, forcing 8-bit mode!\n");
 		dev->flags &= ~FLAG_WIDE;
 	}
     } else {
 	if (AT) {
-		pclog("ISAMEM: *WARNING* this board will slow down your PC!\n");
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_WARNING,
+			"ISAMEM: *WARNING* this board will slow down your PC!\n");
 	}
     }
 
@@ -69,6 +69,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <wchar.h>
+#include <time.h>
 #include "../../emu.h"
 #include "../../cpu/cpu.h"
 #include "../../machines/machine.h"
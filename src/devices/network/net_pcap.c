@@ -8,7 +8,7 @@
  *
  *		Handle WinPcap library processing.
  *
- * Version:	@(#)net_pcap.c	1.0.6	2018/05/06
+ * Version:	@(#)net_pcap.c	1.0.7	2018/05/06
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -183,7 +183,8 @@ net_pcap_prepare(netdev_t *list)
 
     /* Retrieve the device list from the local machine */
     if (f_pcap_findalldevs(&devlist, errbuf) == -1) {
-	pclog("PCAP: error in pcap_findalldevs: %s\n", errbuf);
+	pclog_lvl(PCLOG_CAT_NET, PCLOG_ERROR,
+		"PCAP: error in pcap_findalldevs: %s\n", errbuf);
 	return(-1);
     }
 
@@ -316,7 +317,8 @@ net_pcap_reset(const netcard_t *card, uint8_t *mac)
 				 1,			/* promiscuous mode? */
 				 10,			/* timeout in msec */
 			         errbuf)) == NULL) {	/* error buffer */
-	pclog(" Unable to open device: %s!\n", network_host);
+	pclog_lvl(PCLOG_CAT_NET, PCLOG_ERROR,
+		" Unable to open device: %s!\n", network_host);
 	return(-1);
     }
     pclog("PCAP: interface: %s\n", network_host);
@@ -330,7 +332,8 @@ net_pcap_reset(const netcard_t *card, uint8_t *mac)
 		mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
     if (f_pcap_compile((pcap_t *)pcap, &fp, filter_exp, 0, 0xffffffff) != -1) {
 	if (f_pcap_setfilter((pcap_t *)pcap, &fp) != 0) {
-		pclog("PCAP: error installing filter (%s) !\n", filter_exp);
+		pclog_lvl(PCLOG_CAT_NET, PCLOG_ERROR,
+			"PCAP: error installing filter (%s) !\n", filter_exp);
 		f_pcap_close((pcap_t *)pcap);
 		return(-1);
 	}
@@ -8,7 +8,7 @@
  *
  *		Implementation of the Generic ESC/P Dot-Matrix printer.
  *
- * Version:	@(#)prt_escp.c	1.0.1	2018/09/02
+ * Version:	@(#)prt_escp.c	1.0.2	2018/09/02
  *
  * Authors:	Michael Dring, <michael@drueing.de>
  *		Fred N. van Kempen, <decwiz@yahoo.com>
@@ -48,7 +48,6 @@
  * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING  IN ANY  WAY OUT OF THE USE
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
-#include <windows.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
@@ -81,7 +80,11 @@
 #define PAGE_LPI	6.0			/* standard 6 lpi */
 
 
-#define PATH_FREETYPE_DLL	"freetype.dll"
+#ifdef _WIN32
+# define PATH_FREETYPE_DLL	"freetype.dll"
+#else
+# define PATH_FREETYPE_DLL	"libfreetype.so.6"
+#endif
 
 
 /* FreeType library handles - global so they can be shared. */
@@ -414,7 +417,8 @@ update_font(escp_t *dev)
 
     /* Load the new font. */
     if (ft_New_Face(ft_lib, temp, 0, &dev->fontface)) {
-	pclog("ESC/P: unable to load font '%s'\n", temp);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"ESC/P: unable to load font '%s'\n", temp);
 	pclog("ESC/P: text printing disabled\n");
 	dev->fontface = 0;
     }
@@ -494,7 +498,8 @@ dump_pgm(const wchar_t *fn, int inv, uint8_t *pix, int16_t w, int16_t h)
     /* Create the image file. */
     fp = plat_fopen(fn, L"wb");
     if (fp == NULL) {
-	pclog("ESC/P: unable to create print page '%ls'\n", fn);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"ESC/P: unable to create print page '%ls'\n", fn);
 	return(0);
     }
 
@@ -844,7 +849,8 @@ process_char(escp_t *dev, uint8_t ch)
 			return 1;
 
 		default:
-			pclog("ESC/P: Unknown command ESC %c (0x%02x). Unable to skip parameters.\n", 
+			pclog_lvl(PCLOG_CAT_DEV, PCLOG_WARNING,
+				"ESC/P: Unknown command ESC %c (0x%02x). Unable to skip parameters.\n", 
 				dev->esc_pending >= 0x20 ? dev->esc_pending : '?',
 				dev->esc_pending);
 			dev->esc_parms_req = 0;
@@ -1858,7 +1864,8 @@ escp_init(const lpt_device_t *info)
     if (ft_handle == NULL) {
 	ft_handle = dynld_module(PATH_FREETYPE_DLL, ft_imports);
 	if (ft_handle == NULL) {
-		pclog("ESC/P: unable to load FreeType DLL !\n");
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"ESC/P: unable to load FreeType DLL !\n");
 		return(NULL);
 	}
     }
@@ -1866,7 +1873,8 @@ escp_init(const lpt_device_t *info)
     /* Initialize FreeType. */
     if (ft_lib == NULL) {
 	if (ft_Init_FreeType(&ft_lib)) {
-		pclog("ESC/P: error initializing FreeType !\n");
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"ESC/P: error initializing FreeType !\n");
 		ft_lib = NULL;
 		return(NULL);
 	}
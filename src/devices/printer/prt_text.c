@@ -15,7 +15,7 @@
  *		printer mechanics. This would lead to a page being 66 lines
  *		of 80 characters each.
  *
- * Version:	@(#)prt_text.c	1.0.2	2018/09/02
+ * Version:	@(#)prt_text.c	1.0.3	2018/09/02
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -149,7 +149,8 @@ dump_page(prnt_t *dev)
     /* Create the file. */
     fp = plat_fopen(path, L"a");
     if (fp == NULL) {
-	pclog("PRNT: unable to create print page '%ls'\n", path);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"PRNT: unable to create print page '%ls'\n", path);
 	return;
     }
     fseek(fp, 0, SEEK_END);
@@ -17,7 +17,7 @@
  *		website (for 32bit and 64bit Windows) are working, and
  *		need no additional support files other than sound fonts.
  *
- * Version:	@(#)midi_fluidsynth.c	1.0.11	2018/05/24
+ * Version:	@(#)midi_fluidsynth.c	1.0.12	2018/05/24
  *
  *		Code borrowed from scummvm.
  *
@@ -427,7 +427,8 @@ fluidsynth_global_init(void)
     /* Try loading the DLL. */
     fluidsynth_handle = dynld_module(PATH_FS_DLL, fluidsynth_imports);
     if (fluidsynth_handle == NULL) {
-	pclog("SOUND: unable to load '%s', FluidSynth not available!\n",
+	pclog_lvl(PCLOG_CAT_SOUND, PCLOG_WARNING,
+		"SOUND: unable to load '%s', FluidSynth not available!\n",
 							PATH_FS_DLL);
     }
 }
@@ -8,7 +8,7 @@
  *
  *		Interface to the OpenAL sound processing library.
  *
- * Version:	@(#)openal.c	1.0.15	2018/08/27
+ * Version:	@(#)openal.c	1.0.16	2018/08/27
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -213,7 +213,8 @@ initalmain(int argc, char *argv[])
     if (openal_handle == NULL) {
 	openal_handle = dynld_module(PATH_AL_DLL, openal_imports);
 	if (openal_handle == NULL) {
-		pclog("SOUND: unable to load '%s' - sound disabled!\n",
+		pclog_lvl(PCLOG_CAT_SOUND, PCLOG_WARNING,
+			"SOUND: unable to load '%s' - sound disabled!\n",
 							PATH_AL_DLL);
 		ui_msgbox(MBX_ERROR, (wchar_t *)IDS_ERR_OPENAL);
 		return;
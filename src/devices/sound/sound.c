@@ -8,7 +8,7 @@
  *
  *		Sound emulation core.
  *
- * Version:	@(#)sound.c	1.0.11	2018/05/06
+ * Version:	@(#)sound.c	1.0.12	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -47,6 +47,7 @@
 #include "../../timer.h"
 #include "../../device.h"
 #include "../../plat.h"
+#include "../../worker.h"
 #include "../cdrom/cdrom.h"
 #include "sound.h"
 #include "midi.h"
@@ -76,9 +77,9 @@ static sndhnd_t	handlers[8];
 static sndhnd_t	process_handlers[8];
 static int	handlers_num;
 static int	process_handlers_num;
-static int64_t	poll_time = 0LL,
+static int64_t	poll_timer = -1,
 		poll_latch;
-static int32_t	*outbuffer;
+static worker_t	*out_worker;
 static float	*outbuffer_ex;
 static int16_t	*outbuffer_ex_int16;
 
@@ -239,41 +240,61 @@ cd_thread_end(void)
 }
 
 
+/*
+ * Convert a mixed buffer, and hand it to the sound API.
+ *
+ * This runs on the output worker, so the emulation does not have
+ * to wait for the host's audio layer. It only touches the buffer
+ * it was given and the output buffers, which nobody else uses.
+ */
+static void
+sound_output(void *priv, void *data)
+{
+    int32_t *outbuffer = (int32_t *)data;
+    int c;
+
+    for (c = 0; c < SOUNDBUFLEN * 2; c++) {
+	if (sound_is_float) {
+		outbuffer_ex[c] = (float)((outbuffer[c]) / 32768.0);
+	} else {
+		if (outbuffer[c] > 32767)
+			outbuffer[c] = 32767;
+		if (outbuffer[c] < -32768)
+			outbuffer[c] = -32768;
+
+		outbuffer_ex_int16[c] = outbuffer[c];
+	}
+    }
+
+    if (soundon) {
+	if (sound_is_float)
+		givealbuffer(outbuffer_ex);
+	else
+		givealbuffer(outbuffer_ex_int16);
+    }
+}
+
+
 static void
 sound_poll(void *priv)
 {
-    poll_time += poll_latch;
+    timer_reschedule(poll_timer, poll_latch);
 
     midi_poll();
 
     sound_pos_global++;
     if (sound_pos_global == SOUNDBUFLEN) {
+	int32_t *outbuffer;
 	int c;
 
+	/* The cards are mixed here, as they are part of the machine. */
+	outbuffer = (int32_t *)worker_get(out_worker);
 	memset(outbuffer, 0, SOUNDBUFLEN * 2 * sizeof(int32_t));
 
 	for (c = 0; c < handlers_num; c++)
 		handlers[c].get_buffer(outbuffer, SOUNDBUFLEN, handlers[c].priv);
 
-	for (c = 0; c < SOUNDBUFLEN * 2; c++) {
-		if (sound_is_float) {
-			outbuffer_ex[c] = (float)((outbuffer[c]) / 32768.0);
-		} else {
-			if (outbuffer[c] > 32767)
-				outbuffer[c] = 32767;
-			if (outbuffer[c] < -32768)
-				outbuffer[c] = -32768;
-
-			outbuffer_ex_int16[c] = outbuffer[c];
-		}
-	}
-	
-	if (soundon) {
-		if (sound_is_float)
-			givealbuffer(outbuffer_ex);
-		else
-			givealbuffer(outbuffer_ex_int16);
-	}
+	worker_post(out_worker, sound_output, NULL);
 	
 	if (cd_thread_enable) {
 		cd_buf_update--;
@@ -299,6 +320,9 @@ sound_reset(void)
     /* Kill the CD-Audio thread. */
     sound_cd_stop();
 
+    /* Let the output worker finish with the old buffers. */
+    worker_sync(out_worker);
+
     /* Reset the sound module buffers. */
     if (outbuffer_ex != NULL)
 	free(outbuffer_ex);
@@ -315,7 +339,8 @@ sound_reset(void)
     /* Reset OpenAL. */
     inital();
 
-    timer_add(sound_poll, &poll_time, TIMER_ALWAYS_ENABLED, NULL);
+    poll_timer = timer_new(sound_poll, NULL);
+    timer_arm(poll_timer, timer_get_time());
 
     handlers_num = 0;
 
@@ -354,7 +379,8 @@ sound_init(void)
     outbuffer_ex = NULL;
     outbuffer_ex_int16 = NULL;
 
-    outbuffer = malloc(SOUNDBUFLEN * 2 * sizeof(int32_t));
+    /* A few buffers in flight are enough to cover the host. */
+    out_worker = worker_create("sound", 4, SOUNDBUFLEN * 2 * sizeof(int32_t));
 
     /* Set up the CD-AUDIO thread. */
     for (i = 0; i < CDROM_NUM; i++) {
@@ -391,6 +417,10 @@ sound_close(void)
     /* Kill the CD-Audio thread if needed. */
     sound_cd_stop();
 
+    /* Stop the output worker, after it played what it has. */
+    worker_destroy(out_worker);
+    out_worker = NULL;
+
     /* Close down the MIDI module. */
     midi_close();
 
@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel DMA controllers.
  *
- * Version:	@(#)dma.c	1.0.6	2018/06/25
+ * Version:	@(#)dma.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -46,6 +46,7 @@
 #include "../../machines/machine.h"
 #include "../../mem.h"
 #include "../../io.h"
+#include "../../state.h"
 #include "../../plat.h"
 #include "mca.h"
 #include "dma.h"
@@ -851,7 +852,7 @@ dma_channel_write(int channel, uint16_t val)
 			dma_c->ac += 2;
 		  else
 			dma_c->ac = (dma_c->ac & 0xfe0000) | ((dma_c->ac + 2) & 0x1ffff);
-	}
+	}
     }
 
     dma_stat_rq |= (1 << channel);
@@ -913,3 +914,39 @@ DMAPageWrite(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize)
     mem_invalidate_range(PhysAddress, PhysAddress + TotalSize - 1);
 #endif
 }
+
+
+void
+dma_save_state(void)
+{
+    state_put(dma);
+    state_put(dmaregs);
+    state_put(dma16regs);
+    state_put(dmapages);
+    state_put(dma_wp);
+    state_put(dma16_wp);
+    state_put(dma_m);
+    state_put(dma_stat);
+    state_put(dma_stat_rq);
+    state_put(dma_command);
+    state_put(dma16_command);
+    state_put(dma_ps2);
+}
+
+
+void
+dma_load_state(int version)
+{
+    state_get(dma);
+    state_get(dmaregs);
+    state_get(dma16regs);
+    state_get(dmapages);
+    state_get(dma_wp);
+    state_get(dma16_wp);
+    state_get(dma_m);
+    state_get(dma_stat);
+    state_get(dma_stat_rq);
+    state_get(dma_command);
+    state_get(dma16_command);
+    state_get(dma_ps2);
+}
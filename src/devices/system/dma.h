@@ -8,7 +8,7 @@
  *
  *		Definitions for the Intel DMA controller.
  *
- * Version:	@(#)dma.h	1.0.3	2018/06/25
+ * Version:	@(#)dma.h	1.0.4	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -92,5 +92,8 @@ extern void	dma_alias_set(void);
 extern void	dma_alias_remove(void);
 extern void	dma_alias_remove_piix(void);
 
+extern void	dma_save_state(void);
+extern void	dma_load_state(int version);
+
 
 #endif	/*EMU_DMA_H*/
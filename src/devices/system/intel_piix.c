@@ -12,7 +12,7 @@
  *		    word 0 - base address
  *		    word 1 - bits 1-15 = byte count, bit 31 = end of transfer
  *
- * Version:	@(#)intel_piix.c	1.0.4	2018/05/06
+ * Version:	@(#)intel_piix.c	1.0.5	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -48,6 +48,7 @@
 #include "../../io.h"
 #include "../../mem.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../input/keyboard.h"
 #include "../disk/hdc.h"
 #include "../disk/hdc_ide.h"
@@ -758,6 +759,8 @@ void piix_init(int card)
 	device_add(&ide_pci_2ch_device);
 
         pci_add_card(card, piix_read, piix_write, NULL);
+	state_add("piix", card_piix, sizeof(card_piix));
+	state_add("piix_ide", card_piix_ide, sizeof(card_piix_ide));
 
 	piix_reset();
 
@@ -782,6 +785,8 @@ void piix3_init(int card)
 	device_add(&ide_pci_2ch_device);
 
         pci_add_card(card, piix_read, piix_write, NULL);
+	state_add("piix", card_piix, sizeof(card_piix));
+	state_add("piix_ide", card_piix_ide, sizeof(card_piix_ide));
         
 	piix3_reset();
 
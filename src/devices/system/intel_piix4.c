@@ -12,7 +12,7 @@
  *		    word 0 - base address
  *		    word 1 - bits 1-15 = byte count, bit 31 = end of transfer
  *
- * Version:	@(#)intel_piix4.c	1.0.3	2018/05/06
+ * Version:	@(#)intel_piix4.c	1.0.4	2018/09/16
  *
  * Author:	Miran Grca, <mgrca8@gmail.com>
  *
@@ -44,6 +44,7 @@
 #include "../../io.h"
 #include "../../mem.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../input/keyboard.h"
 #include "../disk/hdc.h"
 #include "../disk/hdc_ide.h"
@@ -396,6 +397,8 @@ void piix4_init(int card)
 	device_add(&ide_pci_2ch_device);
 
         pci_add_card(card, piix4_read, piix4_write, NULL);
+	state_add("piix4", card_piix4, sizeof(card_piix4));
+	state_add("piix4_ide", card_piix4_ide, sizeof(card_piix4_ide));
 
 	piix4_reset();
         
@@ -8,7 +8,7 @@
  *
  *		Emulation of Intel System I/O PCI chip.
  *
- * Version:	@(#)intel_sio.c	1.0.2	2018/05/06
+ * Version:	@(#)intel_sio.c	1.0.3	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -43,6 +43,7 @@
 #include "../../cpu/cpu.h"
 #include "../../io.h"
 #include "../../mem.h"
+#include "../../state.h"
 #include "dma.h"
 #include "pci.h"
 #include "intel_sio.h"
@@ -178,6 +179,7 @@ static void sio_reset(void)
 void sio_init(int card)
 {
         pci_add_card(card, sio_read, sio_write, NULL);
+	state_add("sio", card_sio, sizeof(card_sio));
         
 	sio_reset();
 
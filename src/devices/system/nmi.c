@@ -8,7 +8,7 @@
  *
  *		Implementation of the NMI handler.
  *
- * Version:	@(#)nmi.c	1.0.2	2018/05/06
+ * Version:	@(#)nmi.c	1.0.3	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -41,6 +41,7 @@
 #include <string.h>
 #include <wchar.h>
 #include "../../io.h"
+#include "../../state.h"
 #include "nmi.h"
 
 
@@ -60,3 +61,21 @@ nmi_init(void)
     io_sethandler(0x00a0, 1, NULL,NULL,NULL, nmi_write,NULL,NULL, NULL);
     nmi_mask = 0;
 }
+
+
+void
+nmi_save_state(void)
+{
+    state_put(nmi_mask);
+    state_put(nmi);
+    state_put(nmi_auto_clear);
+}
+
+
+void
+nmi_load_state(int version)
+{
+    state_get(nmi_mask);
+    state_get(nmi);
+    state_get(nmi_auto_clear);
+}
@@ -8,7 +8,7 @@
  *
  *		Definitions for the NMI handler.
  *
- * Version:	@(#)nmi.h	1.0.2	2018/05/06
+ * Version:	@(#)nmi.h	1.0.3	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -46,6 +46,8 @@ extern int	nmi_auto_clear;
 
 
 extern void	nmi_init(void);
+extern void	nmi_save_state(void);
+extern void	nmi_load_state(int version);
 //extern void	nmi_write(uint16_t port, uint8_t val, void *p);
 
 
@@ -189,7 +189,7 @@
  *		including the later update (DS12887A) which implemented a
  *		"century" register to be compatible with Y2K.
  *
- * Version:	@(#)nvr_at.c	1.0.10	2018/08/27
+ * Version:	@(#)nvr_at.c	1.0.11	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -232,6 +232,7 @@
 #include "../../timer.h"
 #include "../../device.h"
 #include "../../nvr.h"
+#include "../../state.h"
 #include "pic.h"
 #include "pit.h"
 #include "nmi.h"
@@ -709,13 +710,43 @@ nvr_at_close(void *priv)
 }
 
 
+/* The timers are saved by the timer module. */
+static void
+nvr_at_save(void *priv)
+{
+    nvr_t *nvr = (nvr_t *)priv;
+    local_t *local = (local_t *)nvr->data;
+
+    state_put(nvr->regs);
+    state_put(nvr->onesec_cnt);
+    state_put(nvr->onesec_time);
+    state_put(local->stat);
+    state_put(local->addr);
+}
+
+
+static void
+nvr_at_load(void *priv, int version)
+{
+    nvr_t *nvr = (nvr_t *)priv;
+    local_t *local = (local_t *)nvr->data;
+
+    state_get(nvr->regs);
+    state_get(nvr->onesec_cnt);
+    state_get(nvr->onesec_time);
+    state_get(local->stat);
+    state_get(local->addr);
+}
+
+
 const device_t at_nvr_device = {
     "PC/AT NVRAM",
     DEVICE_ISA | DEVICE_AT,
     0,
     nvr_at_init, nvr_at_close, NULL,
     NULL, NULL, NULL,
-    NULL
+    NULL, NULL,
+    nvr_at_save, nvr_at_load
 };
 
 const device_t ps_nvr_device = {
@@ -724,7 +755,8 @@ const device_t ps_nvr_device = {
     1,
     nvr_at_init, nvr_at_close, NULL,
     NULL, NULL, NULL,
-    NULL
+    NULL, NULL,
+    nvr_at_save, nvr_at_load
 };
 
 const device_t amstrad_nvr_device = {
@@ -733,5 +765,6 @@ const device_t amstrad_nvr_device = {
     2,
     nvr_at_init, nvr_at_close, NULL,
     NULL, NULL, NULL,
-    NULL
+    NULL, NULL,
+    nvr_at_save, nvr_at_load
 };
@@ -8,7 +8,7 @@
  *
  *		Implement the PCI bus.
  *
- * Version:	@(#)pci.c	1.0.5	2018/05/06
+ * Version:	@(#)pci.c	1.0.6	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -48,6 +48,7 @@
 #include "../../io.h"
 #include "../../mem.h"
 #include "../../device.h"
+#include "../../state.h"
 #include "../input/keyboard.h"
 #include "../disk/hdc.h"
 #include "../disk/hdc_ide.h"
@@ -837,3 +838,43 @@ uint8_t pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr, void
 	pcilog("pci_add_card(): Adding PCI CARD failed (unable to find a suitable PCI slot) [%s]\n", (add_type == PCI_ADD_NORMAL) ? "NORMAL" : ((add_type == PCI_ADD_VIDEO) ? "VIDEO" : "SPECIFIC"));
 	return 0xFF;
 }
+
+
+/*
+ * Save the state of the PCI bus. The cards themselves are
+ * saved by their own modules.
+ */
+void
+pci_save_state(void)
+{
+    state_put(pci_card_to_slot_mapping);
+    state_put(elcr);
+    state_put(pci_irqs);
+    state_put(pci_irq_hold);
+    state_put(pci_mirqs);
+    state_put(pci_index);
+    state_put(pci_func);
+    state_put(pci_card);
+    state_put(pci_bus);
+    state_put(pci_enable);
+    state_put(pci_key);
+    state_put(trc_reg);
+}
+
+
+void
+pci_load_state(int version)
+{
+    state_get(pci_card_to_slot_mapping);
+    state_get(elcr);
+    state_get(pci_irqs);
+    state_get(pci_irq_hold);
+    state_get(pci_mirqs);
+    state_get(pci_index);
+    state_get(pci_func);
+    state_get(pci_card);
+    state_get(pci_bus);
+    state_get(pci_enable);
+    state_get(pci_key);
+    state_get(trc_reg);
+}
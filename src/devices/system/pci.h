@@ -8,7 +8,7 @@
  *
  *		Definitions for the PCI handler module.
  *
- * Version:	@(#)pci.h	1.0.1	2018/02/14
+ * Version:	@(#)pci.h	1.0.2	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -107,5 +107,8 @@ extern uint8_t	pci_add_card(uint8_t add_type, uint8_t (*read)(int func, int addr
 
 extern void     trc_init(void);
 
+extern void     pci_save_state(void);
+extern void     pci_load_state(int version);
+
 
 #endif	/*EMU_PCI_H*/
@@ -8,7 +8,7 @@
  *
  *		Implementation of Intel 8259 interrupt controller.
  *
- * Version:	@(#)pic.c	1.0.2	2018/05/06
+ * Version:	@(#)pic.c	1.0.3	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -43,6 +43,7 @@
 #include "../../emu.h"
 #include "../../machines/machine.h"
 #include "../../io.h"
+#include "../../state.h"
 #include "pci.h"
 #include "pic.h"
 #include "pit.h"
@@ -621,3 +622,21 @@ dumppic(void)
 	pclog("PIC2 : MASK %02X PEND %02X INS %02X LEVEL %02X VECTOR %02X CASCADE %02X\n", pic2.mask, pic2.pend, pic2.ins, (pic2.icw1 & 8) ? 1 : 0, pic2.vector, pic2.icw3);
     }
 }
+
+
+void
+pic_save_state(void)
+{
+    state_put(pic);
+    state_put(pic2);
+    state_put(pic_intpending);
+}
+
+
+void
+pic_load_state(int version)
+{
+    state_get(pic);
+    state_get(pic2);
+    state_get(pic_intpending);
+}
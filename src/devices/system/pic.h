@@ -8,7 +8,7 @@
  *
  *		Definitions for the Intel 8259 module.
  *
- * Version:	@(#)pic.h	1.0.1	2018/02/14
+ * Version:	@(#)pic.h	1.0.2	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -63,5 +63,8 @@ extern uint8_t	picinterrupt(void);
 extern void	picclear(int num);
 extern void	dumppic(void);
 
+extern void	pic_save_state(void);
+extern void	pic_load_state(int version);
+
 
 #endif	/*EMU_PIC_H*/
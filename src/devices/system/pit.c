@@ -8,7 +8,7 @@
  *
  *		Implement the PIT (Programmable Interval Timer.)
  *
- * Version:	@(#)pit.c	1.0.6	2018/05/06
+ * Version:	@(#)pit.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -38,6 +38,7 @@
  */
 #include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
 #include <wchar.h>
 #include "../../emu.h"
@@ -46,6 +47,7 @@
 #include "../../io.h"
 #include "../../device.h"
 #include "../../timer.h"
+#include "../../state.h"
 #include "../sound/sound.h"
 #include "../sound/snd_speaker.h"
 #include "../video/video.h"
@@ -762,3 +764,24 @@ pit_refresh_timer_at(int new_out, int old_out)
     if (new_out && !old_out)
 	ppi.pb ^= 0x10;
 }
+
+
+/*
+ * Save the state of the PIT(s). We leave out the tail of
+ * the structure, which only holds pointers that are set
+ * up by the init code.
+ */
+void
+pit_save_state(void)
+{
+    state_write(&pit, offsetof(PIT, pit_nr));
+    state_write(&pit2, offsetof(PIT, pit_nr));
+}
+
+
+void
+pit_load_state(int version)
+{
+    state_read(&pit, offsetof(PIT, pit_nr));
+    state_read(&pit2, offsetof(PIT, pit_nr));
+}
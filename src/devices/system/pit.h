@@ -8,7 +8,7 @@
  *
  *		Definitions for Intel 8253 timer module.
  *
- * Version:	@(#)pit.h	1.0.3	2018/03/27
+ * Version:	@(#)pit.h	1.0.4	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -106,5 +106,8 @@ extern void	pit_irq0_timer_pcjr(int new_out, int old_out);
 extern void	pit_refresh_timer_xt(int new_out, int old_out);
 extern void	pit_refresh_timer_at(int new_out, int old_out);
 
+extern void	pit_save_state(void);
+extern void	pit_load_state(int version);
+
 
 #endif	/*EMU_PIT_H*/
@@ -9,7 +9,7 @@
  *		Emulation of the EGA, Chips & Technologies SuperEGA, and
  *		AX JEGA graphics cards.
  *
- * Version:	@(#)vid_ega.c	1.0.8	2018/05/06
+ * Version:	@(#)vid_ega.c	1.0.9	2018/05/06
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -1104,7 +1104,8 @@ static void LoadFontxFile(wchar_t *fname)
 	FILE * mfile=romfopen(fname,L"rb");
 	if (!mfile)
 	{
-		pclog("MSG: Can't open FONTX2 file: %s\n",fname);
+		pclog_lvl(PCLOG_CAT_VIDEO, PCLOG_ERROR,
+			"MSG: Can't open FONTX2 file: %s\n",fname);
 		return;
 	}
 	if (getfontx2header(mfile, &head) != 0)
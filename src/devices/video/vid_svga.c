@@ -11,7 +11,7 @@
  *		This is intended to be used by another SVGA driver,
  *		and not as a card in it's own right.
  *
- * Version:	@(#)vid_svga.c	1.0.10	2018/05/06
+ * Version:	@(#)vid_svga.c	1.0.14	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -52,6 +52,8 @@
 #include "../../mem.h"
 #include "../../rom.h"
 #include "../../timer.h"
+#include "../../worker.h"
+#include "../../state.h"
 #include "../system/pit.h"
 #include "video.h"
 #include "vid_svga.h"
@@ -61,6 +63,7 @@
 #define svga_output 0
 
 void svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga);
+static void svga_render_sync(svga_t *svga);
 
 extern uint8_t edatlookup[4][4];
 
@@ -81,6 +84,30 @@ void svga_set_override(svga_t *svga, int val)
         svga->override = val;
 }
 
+/*Map the memory window selected by GDC register 6.*/
+static void svga_set_window(svga_t *svga, uint8_t val)
+{
+        switch (val&0xC)
+        {
+                case 0x0: /*128k at A0000*/
+                mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x20000);
+                svga->banked_mask = 0xffff;
+                break;
+                case 0x4: /*64k at A0000*/
+                mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x10000);
+                svga->banked_mask = 0xffff;
+                break;
+                case 0x8: /*32k at B0000*/
+                mem_mapping_set_addr(&svga->mapping, 0xb0000, 0x08000);
+                svga->banked_mask = 0x7fff;
+                break;
+                case 0xC: /*32k at B8000*/
+                mem_mapping_set_addr(&svga->mapping, 0xb8000, 0x08000);
+                svga->banked_mask = 0x7fff;
+                break;
+        }
+}
+
 void svga_out(uint16_t addr, uint8_t val, void *p)
 {
         svga_t *svga = (svga_t *)p;
@@ -232,27 +259,7 @@ void svga_out(uint16_t addr, uint8_t val, void *p)
                         break;
                         case 6:
                         if ((svga->gdcreg[6] & 0xc) != (val & 0xc))
-                        {
-                                switch (val&0xC)
-                                {
-                                        case 0x0: /*128k at A0000*/
-                                        mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x20000);
-                                        svga->banked_mask = 0xffff;
-                                        break;
-                                        case 0x4: /*64k at A0000*/
-                                        mem_mapping_set_addr(&svga->mapping, 0xa0000, 0x10000);
-                                        svga->banked_mask = 0xffff;
-                                        break;
-                                        case 0x8: /*32k at B0000*/
-                                        mem_mapping_set_addr(&svga->mapping, 0xb0000, 0x08000);
-                                        svga->banked_mask = 0x7fff;
-                                        break;
-                                        case 0xC: /*32k at B8000*/
-                                        mem_mapping_set_addr(&svga->mapping, 0xb8000, 0x08000);
-                                        svga->banked_mask = 0x7fff;
-                                        break;
-                                }
-                        }
+                                svga_set_window(svga, val);
                         break;
                         case 7: svga->colournocare=val; break;
                 }
@@ -354,6 +361,7 @@ void svga_recalctimings(svga_t *svga)
 {
         double crtcconst;
         double _dispontime, _dispofftime, disptime;
+        int c;
 
         svga->vtotal = svga->crtc[6];
         svga->dispend = svga->crtc[0x12];
@@ -467,11 +475,16 @@ void svga_recalctimings(svga_t *svga)
         svga->linedbl = svga->crtc[9] & 0x80;
         svga->rowcount = svga->crtc[9] & 31;
 	if (enable_overscan) {
-		overscan_y = (svga->rowcount + 1) << 1;
+		c = (svga->rowcount + 1) << 1;
 		if (svga->seqregs[1] & 8) /*Low res (320)*/
-			overscan_y <<= 1;
-		if (overscan_y < 16)
-			overscan_y = 16;
+			c <<= 1;
+		if (c < 16)
+			c = 16;
+
+		/* Queued lines have to be drawn where they were. */
+		if (c != overscan_y)
+			svga_render_sync(svga);
+		overscan_y = c;
 	}
         if (svga->recalctimings_ex) 
                 svga->recalctimings_ex(svga);
@@ -494,9 +507,226 @@ void svga_recalctimings(svga_t *svga)
 }
 
 extern int cyc_total;
+/*Background rendering.
+
+  svga_poll() normally renders each line as it is displayed. With the
+  video_render_thread option, it instead captures what the renderer
+  needs for the line - ma, the mode registers, the dirty bits and the
+  VRAM the line shows, plus the palette if it changed - and a worker
+  renders the line from that copy into buffer32. Since the copy is
+  taken at the same point in emulated time as before, changing the
+  registers or palette mid-frame works exactly as it did. All lines
+  are done before the frame is blitted.
+
+  Only the generic graphics renderers are run this way, as we know
+  what they read. Text modes, card-specific renderers, lines with a
+  hardware cursor or overlay, and lines that wrap around in VRAM are
+  still rendered right away; they go to other rows of buffer32, so
+  they can be done while the worker is busy.*/
+#define SVGA_LINE_VRAM  (((2048 >> 3) + 2) * 32 + 4)
+#define SVGA_LINE_JOBS  64
+
+typedef struct
+{
+        void (*render)(svga_t *svga);
+        uint32_t ma;
+        int sc, displine, hdisp, scrollcache, fullchange;
+        int vram_display_mask;
+        uint8_t crtc17, plane_mask;
+        uint8_t changed[4];
+        int pal_changed;
+        uint8_t egapal[16];
+        uint32_t pallook[256];
+        uint8_t vram[SVGA_LINE_VRAM];
+} svga_line_t;
+
+/*Dirty-tile tracking. The part of the buffer32 row a line may touch is
+  saved before it is drawn, and compared afterwards; only the tiles that
+  really changed are marked for the blitter. Columns past that part are
+  always marked, in case a renderer goes further than we think it does.*/
+static int svga_dirty_save(svga_t *svga, uint32_t *old)
+{
+        int row = svga->displine + (enable_overscan ? (overscan_y >> 1) : 0);
+        int width = (svga->hdisp + 128 + VIDEO_TILE_W - 1) & ~(VIDEO_TILE_W - 1);
+
+        if (width < VIDEO_TILE_W || width > 2048)
+                width = 2048;
+
+        if (!svga->fullchange && row < 2048)
+                memcpy(old, buffer32->line[row], width << 2);
+
+        return width;
+}
+
+static void svga_dirty_check(svga_t *svga, uint32_t *old, int width)
+{
+        int row = svga->displine + (enable_overscan ? (overscan_y >> 1) : 0);
+        uint32_t *p, mask;
+        int c;
+
+        if (row >= 2048)
+                return;
+
+        /*A full redraw was asked for, so it has to go out in full too.*/
+        if (svga->fullchange)
+        {
+                video_dirty_line(row, ~0U);
+                return;
+        }
+
+        p = (uint32_t *)buffer32->line[row];
+        mask = (width >= 2048) ? 0 : ~((1U << (width / VIDEO_TILE_W)) - 1);
+        for (c = 0; c < width; c += VIDEO_TILE_W)
+        {
+                if (memcmp(&p[c], &old[c], VIDEO_TILE_W << 2))
+                        mask |= 1U << (c / VIDEO_TILE_W);
+        }
+
+        if (mask)
+                video_dirty_line(row, mask);
+}
+
+/*The renderers that can run on the worker, and how many bytes of VRAM
+  they read at most for every 8 pixels.*/
+static const struct
+{
+        void (*render)(svga_t *svga);
+        int bytes;
+} svga_line_renderers[] =
+{
+        {svga_render_4bpp_lowres,       4},
+        {svga_render_4bpp_highres,      4},
+        {svga_render_8bpp_lowres,       4},
+        {svga_render_8bpp_highres,      8},
+        {svga_render_15bpp_lowres,     16},
+        {svga_render_15bpp_highres,    16},
+        {svga_render_16bpp_lowres,     16},
+        {svga_render_16bpp_highres,    16},
+        {svga_render_24bpp_lowres,     24},
+        {svga_render_24bpp_highres,    24},
+        {svga_render_32bpp_lowres,     32},
+        {svga_render_32bpp_highres,    32},
+        {svga_render_ABGR8888_highres, 32},
+        {svga_render_RGBA8888_highres, 32},
+        {NULL,                          0}
+};
+
+static void svga_render_line(void *priv, void *data)
+{
+        svga_t *svga = (svga_t *)priv;
+        svga_line_t *l = (svga_line_t *)data;
+        uint32_t old[2048];
+        int width;
+
+        if (l->pal_changed)
+        {
+                memcpy(svga->egapal, l->egapal, sizeof(svga->egapal));
+                memcpy(svga->pallook, l->pallook, sizeof(svga->pallook));
+        }
+
+        svga->ma = l->ma;
+        svga->sc = l->sc;
+        svga->crtc[0x17] = l->crtc17;
+        svga->plane_mask = l->plane_mask;
+        svga->displine = l->displine;
+        svga->hdisp = l->hdisp;
+        svga->scrollcache = l->scrollcache;
+        svga->fullchange = l->fullchange;
+        svga->vram_display_mask = l->vram_display_mask;
+
+        /*The renderer indexes these with the real VRAM addresses.*/
+        svga->vram = l->vram - l->ma;
+        svga->changedvram = l->changed - (l->ma >> 12);
+
+        width = svga_dirty_save(svga, old);
+        l->render(svga);
+        svga_dirty_check(svga, old, width);
+}
+
+/*Hand the current line to the worker. Returns 0 if it has to be rendered
+  right away instead.*/
+static int svga_render_queue(svga_t *svga)
+{
+        svga_line_t *l;
+        int c, len;
+
+        if (!svga->render_worker || svga->hwcursor_on || svga->overlay_on)
+                return 0;
+
+        for (c = 0; svga_line_renderers[c].render; c++)
+        {
+                if (svga_line_renderers[c].render == svga->render)
+                        break;
+        }
+        if (!svga_line_renderers[c].render)
+                return 0;
+
+        len = ((svga->hdisp >> 3) + 2) * svga_line_renderers[c].bytes + 4;
+        if (svga->hdisp < 0 || len > SVGA_LINE_VRAM ||
+            (svga->ma + len) > (uint32_t)(svga->vram_display_mask + 1))
+                return 0;
+        if (svga->render == svga_render_4bpp_highres && (svga->sc & ~svga->crtc[0x17] & 3))
+                return 0;
+
+        l = (svga_line_t *)worker_get(svga->render_worker);
+
+        l->render = svga->render;
+        l->ma = svga->ma;
+        l->sc = svga->sc;
+        l->crtc17 = svga->crtc[0x17];
+        l->plane_mask = svga->plane_mask;
+        l->displine = svga->displine;
+        l->hdisp = svga->hdisp;
+        l->scrollcache = svga->scrollcache;
+        l->fullchange = svga->fullchange;
+        l->vram_display_mask = svga->vram_display_mask;
+        c = (0x800000 >> 12) - (svga->ma >> 12);
+        memcpy(l->changed, &svga->changedvram[svga->ma >> 12], (c < 4) ? c : 4);
+        memcpy(l->vram, &svga->vram[svga->ma], len);
+
+        l->pal_changed = !svga->render_pal_valid ||
+                         memcmp(svga->render_egapal, svga->egapal, sizeof(svga->egapal)) ||
+                         memcmp(svga->render_pallook, svga->pallook, sizeof(svga->pallook));
+        if (l->pal_changed)
+        {
+                memcpy(svga->render_egapal, svga->egapal, sizeof(svga->egapal));
+                memcpy(svga->render_pallook, svga->pallook, sizeof(svga->pallook));
+                memcpy(l->egapal, svga->egapal, sizeof(l->egapal));
+                memcpy(l->pallook, svga->pallook, sizeof(l->pallook));
+                svga->render_pal_valid = 1;
+        }
+
+        worker_post(svga->render_worker, svga_render_line, svga->render_svga);
+
+        /*The renderer would have moved ma along, but it is reloaded
+          from maback before it is used again.*/
+        return 1;
+}
+
+/*Wait for the worker to finish all lines, and merge the range of lines
+  it drew into ours.*/
+static void svga_render_sync(svga_t *svga)
+{
+        svga_t *r = svga->render_svga;
+
+        if (!svga->render_worker)
+                return;
+
+        worker_sync(svga->render_worker);
+
+        if (r->firstline_draw < svga->firstline_draw)
+                svga->firstline_draw = r->firstline_draw;
+        if (r->lastline_draw > svga->lastline_draw)
+                svga->lastline_draw = r->lastline_draw;
+        r->firstline_draw = 2000;
+        r->lastline_draw = 0;
+}
+
 void svga_poll(void *p)
 {
+        static uint32_t dirty_old[2048];
         svga_t *svga = (svga_t *)p;
+        int dirty_width = 0;
         uint32_t x;
 
         if (!svga->linepos) {
@@ -519,7 +749,7 @@ void svga_poll(void *p)
                         svga->overlay_oddeven = 1;
                 }
 
-                svga->vidtime += svga->dispofftime;
+                timer_reschedule(svga->vidtimer, svga->dispofftime);
                 svga->cgastat |= 1;
                 svga->linepos = 1;
 
@@ -535,8 +765,11 @@ void svga_poll(void *p)
                         if (svga->hwcursor_on || svga->overlay_on)
                                 svga->changedvram[svga->ma >> 12] = svga->changedvram[(svga->ma >> 12) + 1] = svga->interlace ? 3 : 2;
                       
-                        if (!svga->override)
+                        if (!svga->override && !svga_render_queue(svga))
+                        {
+                                dirty_width = svga_dirty_save(svga, dirty_old);
                                 svga->render(svga);
+                        }
                         
                         if (svga->overlay_on) {
                                 if (!svga->override)
@@ -554,6 +787,9 @@ void svga_poll(void *p)
                                         svga->hwcursor_on--;
                         }
 
+                        if (dirty_width)
+                                svga_dirty_check(svga, dirty_old, dirty_width);
+
                         if (svga->lastline < svga->displine) 
                                 svga->lastline = svga->displine;
                 }
@@ -567,7 +803,7 @@ void svga_poll(void *p)
                 if (svga->displine > 1500)
                         svga->displine = 0;
         } else {
-                svga->vidtime += svga->dispontime;
+                timer_reschedule(svga->vidtimer, svga->dispontime);
 
                 if (svga->dispon) 
                         svga->cgastat &= ~1;
@@ -633,6 +869,7 @@ void svga_poll(void *p)
                         wx = x;
                         wy = svga->lastline - svga->firstline;
 
+                        svga_render_sync(svga);
                         if (!svga->override)
                                 svga_doblit(svga->firstline_draw, svga->lastline_draw + 1, wx, wy, svga);
 
@@ -716,10 +953,19 @@ int svga_init(svga_t *svga, void *p, int memsize,
                         e = (e >> 1) | ((e & 1) ? 0x80 : 0);
                 }
         }
+        svga_kernel_init(-1);
+        if (vid_render_thread)
+        {
+                svga->render_svga = malloc(sizeof(svga_t));
+                memset(svga->render_svga, 0, sizeof(svga_t));
+                svga->render_svga->firstline_draw = 2000;
+                svga->render_worker = worker_create("svga", SVGA_LINE_JOBS, sizeof(svga_line_t));
+        }
         svga->readmode = 0;
 
 	svga->attrregs[0x11] = 0;
 	svga->overscan_color = 0x000000;
+	svga->dirty_overscan = ~0U;
 
 	overscan_x = 16;
 	overscan_y = 32;
@@ -743,7 +989,8 @@ int svga_init(svga_t *svga, void *p, int memsize,
 
         mem_mapping_add(&svga->mapping, 0xa0000, 0x20000, svga_read, svga_readw, svga_readl, svga_write, svga_writew, svga_writel, NULL, MEM_MAPPING_EXTERNAL, svga);
 
-        timer_add(svga_poll, &svga->vidtime, TIMER_ALWAYS_ENABLED, svga);
+        svga->vidtimer = timer_new(svga_poll, svga);
+        timer_arm(svga->vidtimer, timer_get_time());
 
         svga_pri = svga;
 
@@ -754,6 +1001,14 @@ int svga_init(svga_t *svga, void *p, int memsize,
 
 void svga_close(svga_t *svga)
 {
+        if (svga->render_worker)
+        {
+                worker_destroy(svga->render_worker);
+                free(svga->render_svga);
+                svga->render_worker = NULL;
+                svga->render_svga = NULL;
+        }
+
         free(svga->changedvram);
         free(svga->vram);
 
@@ -1292,6 +1547,7 @@ void svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga)
                 if (ysize<32) ysize = 200;
 
                 set_screen_size(xsize+x_add,ysize+y_add);
+                video_dirty_all();
 
 		if (video_force_resize_get())
 			video_force_resize_set(0);
@@ -1299,6 +1555,12 @@ void svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga)
 
 	if (enable_overscan && !suppress_overscan) {
 		if ((wx >= 160) && ((wy + 1) >= 120)) {
+			/* The border only has to go out if it changed. */
+			if (svga->dirty_overscan != svga_color_transform(svga->overscan_color)) {
+				svga->dirty_overscan = svga_color_transform(svga->overscan_color);
+				video_dirty_all();
+			}
+
 			/* Draw (overscan_size - scroll size) lines of overscan on top. */
 			for (i  = 0; i < (y_add >> 1); i++) {
 				p = &((uint32_t *)buffer32->line[i & 0x7ff])[32];
@@ -1323,10 +1585,12 @@ void svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga)
 					p[xsize + (x_add >> 1) + j] = svga_color_transform(svga->overscan_color);
 				}
 			}
-		}
-	}
+		} else
+			svga->dirty_overscan = ~0U;
+	} else
+		svga->dirty_overscan = ~0U;
 
-        video_blit_memtoscreen(32, 0, y1, y2 + y_add, xsize + x_add, ysize + y_add);
+        video_blit_memtoscreen_dirty(32, 0, y1, y2 + y_add, xsize + x_add, ysize + y_add);
 }
 
 void svga_writew(uint32_t addr, uint16_t val, void *p)
@@ -1577,3 +1841,167 @@ void svga_add_status_info(char *s, int max_len, void *p)
         svga->frames = 0;
         strncat(s, temps, max_len);
 }
+
+
+/*Save the state of the standard VGA part of the card. Extended
+  registers, linear apertures and accelerators are not saved, so a
+  card only uses this if it has none of those. The display timer is
+  saved with all other timers.*/
+void svga_save_state(svga_t *svga)
+{
+        state_put(svga->enabled);
+        state_put(svga->crtcreg);
+        state_put(svga->crtc);
+        state_put(svga->gdcreg);
+        state_put(svga->gdcaddr);
+        state_put(svga->attrregs);
+        state_put(svga->attraddr);
+        state_put(svga->attrff);
+        state_put(svga->attr_palette_enable);
+        state_put(svga->seqregs);
+        state_put(svga->seqaddr);
+        state_put(svga->miscout);
+        state_put(svga->vidclock);
+
+        state_put(svga->la);
+        state_put(svga->lb);
+        state_put(svga->lc);
+        state_put(svga->ld);
+
+        state_put(svga->dac_mask);
+        state_put(svga->dac_status);
+        state_put(svga->dac_read);
+        state_put(svga->dac_write);
+        state_put(svga->dac_pos);
+        state_put(svga->dac_r);
+        state_put(svga->dac_g);
+        state_put(svga->vgapal);
+        state_put(svga->pallook);
+        state_put(svga->egapal);
+
+        state_put(svga->cgastat);
+        state_put(svga->plane_mask);
+        state_put(svga->fast);
+        state_put(svga->colourcompare);
+        state_put(svga->colournocare);
+        state_put(svga->readmode);
+        state_put(svga->writemode);
+        state_put(svga->readplane);
+        state_put(svga->chain4);
+        state_put(svga->chain2_write);
+        state_put(svga->chain2_read);
+        state_put(svga->oddeven_page);
+        state_put(svga->oddeven_chain);
+        state_put(svga->extvram);
+        state_put(svga->writemask);
+        state_put(svga->charseta);
+        state_put(svga->charsetb);
+        state_put(svga->set_reset_disabled);
+        state_put(svga->write_bank);
+        state_put(svga->read_bank);
+
+        state_put(svga->ma_latch);
+        state_put(svga->ma);
+        state_put(svga->maback);
+        state_put(svga->ca);
+        state_put(svga->vc);
+        state_put(svga->sc);
+        state_put(svga->linepos);
+        state_put(svga->vslines);
+        state_put(svga->linecountff);
+        state_put(svga->oddeven);
+        state_put(svga->con);
+        state_put(svga->cursoron);
+        state_put(svga->blink);
+        state_put(svga->dispon);
+        state_put(svga->hdisp_on);
+        state_put(svga->displine);
+        state_put(svga->scrblank);
+
+        state_write_block(svga->vram, svga->vram_max);
+}
+
+void svga_load_state(svga_t *svga, int version)
+{
+        /*Do not pull the state from under the render worker.*/
+        svga_render_sync(svga);
+
+        state_get(svga->enabled);
+        state_get(svga->crtcreg);
+        state_get(svga->crtc);
+        state_get(svga->gdcreg);
+        state_get(svga->gdcaddr);
+        state_get(svga->attrregs);
+        state_get(svga->attraddr);
+        state_get(svga->attrff);
+        state_get(svga->attr_palette_enable);
+        state_get(svga->seqregs);
+        state_get(svga->seqaddr);
+        state_get(svga->miscout);
+        state_get(svga->vidclock);
+
+        state_get(svga->la);
+        state_get(svga->lb);
+        state_get(svga->lc);
+        state_get(svga->ld);
+
+        state_get(svga->dac_mask);
+        state_get(svga->dac_status);
+        state_get(svga->dac_read);
+        state_get(svga->dac_write);
+        state_get(svga->dac_pos);
+        state_get(svga->dac_r);
+        state_get(svga->dac_g);
+        state_get(svga->vgapal);
+        state_get(svga->pallook);
+        state_get(svga->egapal);
+
+        state_get(svga->cgastat);
+        state_get(svga->plane_mask);
+        state_get(svga->fast);
+        state_get(svga->colourcompare);
+        state_get(svga->colournocare);
+        state_get(svga->readmode);
+        state_get(svga->writemode);
+        state_get(svga->readplane);
+        state_get(svga->chain4);
+        state_get(svga->chain2_write);
+        state_get(svga->chain2_read);
+        state_get(svga->oddeven_page);
+        state_get(svga->oddeven_chain);
+        state_get(svga->extvram);
+        state_get(svga->writemask);
+        state_get(svga->charseta);
+        state_get(svga->charsetb);
+        state_get(svga->set_reset_disabled);
+        state_get(svga->write_bank);
+        state_get(svga->read_bank);
+
+        state_get(svga->ma_latch);
+        state_get(svga->ma);
+        state_get(svga->maback);
+        state_get(svga->ca);
+        state_get(svga->vc);
+        state_get(svga->sc);
+        state_get(svga->linepos);
+        state_get(svga->vslines);
+        state_get(svga->linecountff);
+        state_get(svga->oddeven);
+        state_get(svga->con);
+        state_get(svga->cursoron);
+        state_get(svga->blink);
+        state_get(svga->dispon);
+        state_get(svga->hdisp_on);
+        state_get(svga->displine);
+        state_get(svga->scrblank);
+
+        state_read_block(svga->vram, svga->vram_max);
+
+        /*Everything derived from the registers has to be redone.*/
+        svga_set_window(svga, svga->gdcreg[6]);
+        svga_recalctimings(svga);
+        memset(svga->changedvram, 0xff, 0x800000 >> 12);
+        svga->render_pal_valid = 0;
+        svga->dirty_overscan = ~0U;
+        svga->fullchange = changeframecount;
+}
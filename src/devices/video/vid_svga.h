@@ -8,7 +8,7 @@
  *
  *		Definitions for the generic SVGA driver.
  *
- * Version:	@(#)vid_svga.h	1.0.4	2018/03/26
+ * Version:	@(#)vid_svga.h	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -110,7 +110,7 @@ typedef struct svga_t
         int bpp;
 
         int64_t dispontime, dispofftime;
-        int64_t vidtime;
+        int64_t vidtimer;
 
         uint8_t scrblank;
 
@@ -176,6 +176,19 @@ typedef struct svga_t
         void (*overlay_draw)(struct svga_t *svga, int displine);
 
         void (*vblank_start)(struct svga_t *svga);
+
+        /*Lines rendered in the background (video_render_thread). The
+          worker renders into its own copy of the SVGA state; the last
+          palette sent to it is kept here, so it is only sent again if
+          it changed.*/
+        struct worker *render_worker;
+        struct svga_t *render_svga;
+        uint32_t render_pallook[256];
+        uint8_t render_egapal[16];
+        int render_pal_valid;
+
+        /*Overscan color last drawn by svga_doblit, for the dirty-tile map.*/
+        uint32_t dirty_overscan;
 } svga_t;
 
 extern int svga_init(svga_t *svga, void *p, int memsize, 
@@ -265,5 +278,8 @@ static __inline uint32_t svga_color_transform(uint32_t color)
 
 void svga_doblit(int y1, int y2, int wx, int wy, svga_t *svga);
 
+void svga_save_state(svga_t *svga);
+void svga_load_state(svga_t *svga, int version);
+
 
 #endif	/*VIDEO_SVGA_H*/
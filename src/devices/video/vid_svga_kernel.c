@@ -0,0 +1,524 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Scanline kernels for the SVGA renderers.
+ *
+ *		These convert a run of VRAM into 32-bit pixels, for the
+ *		common (high-resolution) graphics modes. Each kernel has a
+ *		plain C version, and where it pays off, SSE2 and/or AVX2
+ *		versions. The best set the host supports is selected at
+ *		runtime. All versions give exactly the same pixels as the
+ *		original per-pixel code in the renderers, including the
+ *		rounding of the video_15to32[] and video_16to32[] tables;
+ *		tests/svgakernel.c checks this, and times them.
+ *
+ *		The kernels do not know about VRAM wrapping or any of the
+ *		color transforms; the renderers only use them for runs that
+ *		do not wrap, and fall back to their own code otherwise.
+ *
+ * Version:	@(#)vid_svga_kernel.c	1.0.3	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include "../../emu.h"
+#include "../../mem.h"
+#include "video.h"
+#include "vid_svga.h"
+#include "vid_svga_render.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+# define USE_SSE2
+# include <emmintrin.h>
+#endif
+#if defined(USE_SSE2) && \
+    (defined(__clang__) || (defined(__GNUC__) && \
+     ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))) || \
+     (defined(_MSC_VER) && (_MSC_VER >= 1800)))
+# define USE_AVX2
+# include <immintrin.h>
+# ifdef _MSC_VER
+#  include <intrin.h>
+#  define AVX2_FUNC
+# else
+#  define AVX2_FUNC	__attribute__((target("avx2")))
+# endif
+#endif
+
+
+svga_kernel_t	svga_kernel;
+
+
+/*
+ * The 15/16bpp tables scale each 5-bit or 6-bit field to 0..255,
+ * rounding down. With the field in the top bits of a 16-bit word,
+ * an unsigned multiply-high by these does the same thing exactly.
+ */
+#define SCALE_5		33693			/* (x << 4) -> x * 255 / 31 */
+#define SCALE_6		33159			/* (x << 3) -> x * 255 / 63 */
+
+
+/* Spread the bits of a plane byte into the nibbles of 8 pixels. */
+static uint32_t	planar_expand[256];
+
+
+static void
+pal8_c(uint32_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    int x;
+
+    for (x = 0; x < (n & ~3); x += 4) {
+	dst[x]     = pal[src[x]];
+	dst[x + 1] = pal[src[x + 1]];
+	dst[x + 2] = pal[src[x + 2]];
+	dst[x + 3] = pal[src[x + 3]];
+    }
+    for (; x < n; x++)
+	dst[x] = pal[src[x]];
+}
+
+
+static void
+rgb555_c(uint32_t *dst, const uint8_t *src, int n)
+{
+    const uint16_t *s = (const uint16_t *)src;
+    int x;
+
+    for (x = 0; x < n; x++)
+	dst[x] = video_15to32[s[x]];
+}
+
+
+static void
+rgb565_c(uint32_t *dst, const uint8_t *src, int n)
+{
+    const uint16_t *s = (const uint16_t *)src;
+    int x;
+
+    for (x = 0; x < n; x++)
+	dst[x] = video_16to32[s[x]];
+}
+
+
+static void
+rgb888_c(uint32_t *dst, const uint8_t *src, int n)
+{
+    int x;
+
+    for (x = 0; x < n; x++, src += 3)
+	dst[x] = src[0] | (src[1] << 8) | (src[2] << 16);
+}
+
+
+static void
+xrgb8888_c(uint32_t *dst, const uint8_t *src, int n)
+{
+    const uint32_t *s = (const uint32_t *)src;
+    int x;
+
+    for (x = 0; x < n; x++)
+	dst[x] = s[x] & 0xffffff;
+}
+
+
+static void
+planar4_c(uint32_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    uint32_t w;
+    int x;
+
+    for (x = 0; x < n; x += 8, src += 4) {
+	w = planar_expand[src[0]] | (planar_expand[src[1]] << 1) |
+	    (planar_expand[src[2]] << 2) | (planar_expand[src[3]] << 3);
+
+	dst[x]     = pal[w & 15];
+	dst[x + 1] = pal[(w >> 4) & 15];
+	dst[x + 2] = pal[(w >> 8) & 15];
+	dst[x + 3] = pal[(w >> 12) & 15];
+	dst[x + 4] = pal[(w >> 16) & 15];
+	dst[x + 5] = pal[(w >> 20) & 15];
+	dst[x + 6] = pal[(w >> 24) & 15];
+	dst[x + 7] = pal[w >> 28];
+    }
+}
+
+
+#ifdef USE_SSE2
+/* Convert 8 pixels of 555 or 565 to 8888. */
+static __inline void
+rgb16_sse2(uint32_t *dst, __m128i v, int is565)
+{
+    __m128i mask5 = _mm_set1_epi16(0x1f << 4);
+    __m128i r, g, b;
+
+    b = _mm_and_si128(_mm_slli_epi16(v, 4), mask5);
+    if (is565) {
+	g = _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi16(0x3f << 3));
+	g = _mm_mulhi_epu16(g, _mm_set1_epi16((short)SCALE_6));
+	r = _mm_and_si128(_mm_srli_epi16(v, 7), mask5);
+    } else {
+	g = _mm_and_si128(_mm_srli_epi16(v, 1), mask5);
+	g = _mm_mulhi_epu16(g, _mm_set1_epi16((short)SCALE_5));
+	r = _mm_and_si128(_mm_srli_epi16(v, 6), mask5);
+    }
+    b = _mm_mulhi_epu16(b, _mm_set1_epi16((short)SCALE_5));
+    r = _mm_mulhi_epu16(r, _mm_set1_epi16((short)SCALE_5));
+
+    b = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(b, r));
+    _mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(b, r));
+}
+
+
+static void
+rgb555_sse2(uint32_t *dst, const uint8_t *src, int n)
+{
+    int x;
+
+    for (x = 0; x < (n & ~7); x += 8)
+	rgb16_sse2(&dst[x], _mm_loadu_si128((const __m128i *)&src[x << 1]), 0);
+
+    if (x < n)
+	rgb555_c(&dst[x], &src[x << 1], n - x);
+}
+
+
+static void
+rgb565_sse2(uint32_t *dst, const uint8_t *src, int n)
+{
+    int x;
+
+    for (x = 0; x < (n & ~7); x += 8)
+	rgb16_sse2(&dst[x], _mm_loadu_si128((const __m128i *)&src[x << 1]), 1);
+
+    if (x < n)
+	rgb565_c(&dst[x], &src[x << 1], n - x);
+}
+
+
+/* Load exactly 12 bytes, so we never read past the end of VRAM. */
+static __inline __m128i
+load12_sse2(const uint8_t *src)
+{
+    uint32_t hi;
+
+    memcpy(&hi, src + 8, 4);
+
+    return(_mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)src),
+			      _mm_cvtsi32_si128(hi)));
+}
+
+
+static void
+rgb888_sse2(uint32_t *dst, const uint8_t *src, int n)
+{
+    __m128i v, r;
+    int x;
+
+    /* Pixel i of 4 is at byte 3i, so shift it up by i bytes. */
+    for (x = 0; x < (n & ~3); x += 4, src += 12) {
+	v = load12_sse2(src);
+	r = _mm_and_si128(v, _mm_set_epi32(0, 0, 0, 0xffffff));
+	r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 1),
+					  _mm_set_epi32(0, 0, 0xffffff, 0)));
+	r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 2),
+					  _mm_set_epi32(0, 0xffffff, 0, 0)));
+	r = _mm_or_si128(r, _mm_and_si128(_mm_slli_si128(v, 3),
+					  _mm_set_epi32(0xffffff, 0, 0, 0)));
+	_mm_storeu_si128((__m128i *)&dst[x], r);
+    }
+
+    if (x < n)
+	rgb888_c(&dst[x], src, n - x);
+}
+
+
+static void
+xrgb8888_sse2(uint32_t *dst, const uint8_t *src, int n)
+{
+    __m128i mask = _mm_set1_epi32(0xffffff);
+    __m128i v;
+    int x;
+
+    for (x = 0; x < (n & ~3); x += 4) {
+	v = _mm_loadu_si128((const __m128i *)&src[x << 2]);
+	_mm_storeu_si128((__m128i *)&dst[x], _mm_and_si128(v, mask));
+    }
+
+    if (x < n)
+	xrgb8888_c(&dst[x], &src[x << 2], n - x);
+}
+#endif
+
+
+#ifdef USE_AVX2
+static AVX2_FUNC void
+pal8_avx2(uint32_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    __m256i idx;
+    int x;
+
+    for (x = 0; x < (n & ~7); x += 8) {
+	idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)&src[x]));
+	_mm256_storeu_si256((__m256i *)&dst[x],
+			    _mm256_i32gather_epi32((const int *)pal, idx, 4));
+    }
+
+    if (x < n)
+	pal8_c(&dst[x], &src[x], pal, n - x);
+}
+
+
+/* Convert 16 pixels of 555 or 565 to 8888. */
+static AVX2_FUNC void
+rgb16_avx2(uint32_t *dst, const uint8_t *src, int n, int is565)
+{
+    __m256i mask5 = _mm256_set1_epi16(0x1f << 4);
+    __m256i scale5 = _mm256_set1_epi16((short)SCALE_5);
+    __m256i v, r, g, b, lo, hi;
+    int x;
+
+    for (x = 0; x < (n & ~15); x += 16) {
+	v = _mm256_loadu_si256((const __m256i *)&src[x << 1]);
+
+	b = _mm256_and_si256(_mm256_slli_epi16(v, 4), mask5);
+	if (is565) {
+		g = _mm256_and_si256(_mm256_srli_epi16(v, 2),
+				     _mm256_set1_epi16(0x3f << 3));
+		g = _mm256_mulhi_epu16(g, _mm256_set1_epi16((short)SCALE_6));
+		r = _mm256_and_si256(_mm256_srli_epi16(v, 7), mask5);
+	} else {
+		g = _mm256_and_si256(_mm256_srli_epi16(v, 1), mask5);
+		g = _mm256_mulhi_epu16(g, scale5);
+		r = _mm256_and_si256(_mm256_srli_epi16(v, 6), mask5);
+	}
+	b = _mm256_mulhi_epu16(b, scale5);
+	r = _mm256_mulhi_epu16(r, scale5);
+
+	/* The unpacks work per 128-bit lane, so put the halves back. */
+	b = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+	lo = _mm256_unpacklo_epi16(b, r);
+	hi = _mm256_unpackhi_epi16(b, r);
+	_mm256_storeu_si256((__m256i *)&dst[x],
+			    _mm256_permute2x128_si256(lo, hi, 0x20));
+	_mm256_storeu_si256((__m256i *)&dst[x + 8],
+			    _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    if (x < n) {
+	if (is565)
+		rgb565_sse2(&dst[x], &src[x << 1], n - x);
+	  else
+		rgb555_sse2(&dst[x], &src[x << 1], n - x);
+    }
+}
+
+
+static void
+rgb555_avx2(uint32_t *dst, const uint8_t *src, int n)
+{
+    rgb16_avx2(dst, src, n, 0);
+}
+
+
+static void
+rgb565_avx2(uint32_t *dst, const uint8_t *src, int n)
+{
+    rgb16_avx2(dst, src, n, 1);
+}
+
+
+static AVX2_FUNC void
+rgb888_avx2(uint32_t *dst, const uint8_t *src, int n)
+{
+    __m256i shuf = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+				    6, 7, 8, -1, 9, 10, 11, -1,
+				    0, 1, 2, -1, 3, 4, 5, -1,
+				    6, 7, 8, -1, 9, 10, 11, -1);
+    __m256i v;
+    int x;
+
+    for (x = 0; x < (n & ~7); x += 8, src += 24) {
+	v = _mm256_inserti128_si256(_mm256_castsi128_si256(load12_sse2(src)),
+				    load12_sse2(src + 12), 1);
+	_mm256_storeu_si256((__m256i *)&dst[x], _mm256_shuffle_epi8(v, shuf));
+    }
+
+    if (x < n)
+	rgb888_sse2(&dst[x], src, n - x);
+}
+
+
+static AVX2_FUNC void
+xrgb8888_avx2(uint32_t *dst, const uint8_t *src, int n)
+{
+    __m256i mask = _mm256_set1_epi32(0xffffff);
+    __m256i v;
+    int x;
+
+    for (x = 0; x < (n & ~7); x += 8) {
+	v = _mm256_loadu_si256((const __m256i *)&src[x << 2]);
+	_mm256_storeu_si256((__m256i *)&dst[x], _mm256_and_si256(v, mask));
+    }
+
+    if (x < n)
+	xrgb8888_sse2(&dst[x], &src[x << 2], n - x);
+}
+
+
+/*
+ * The 16-entry palette does not fit in one register, so look up
+ * both halves, and pick one using bit 3 of the index.
+ */
+static AVX2_FUNC void
+planar4_avx2(uint32_t *dst, const uint8_t *src, const uint32_t *pal, int n)
+{
+    __m256i shift = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    __m256i nib = _mm256_set1_epi32(15);
+    __m256i pal_lo, pal_hi, idx, lo, hi;
+    uint32_t w;
+    int x;
+
+    pal_lo = _mm256_loadu_si256((const __m256i *)pal);
+    pal_hi = _mm256_loadu_si256((const __m256i *)(pal + 8));
+
+    for (x = 0; x < n; x += 8, src += 4) {
+	w = planar_expand[src[0]] | (planar_expand[src[1]] << 1) |
+	    (planar_expand[src[2]] << 2) | (planar_expand[src[3]] << 3);
+
+	idx = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(w), shift), nib);
+	lo = _mm256_permutevar8x32_epi32(pal_lo, idx);
+	hi = _mm256_permutevar8x32_epi32(pal_hi, idx);
+	lo = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(lo),
+				 _mm256_castsi256_ps(hi),
+				 _mm256_castsi256_ps(_mm256_slli_epi32(idx, 28))));
+	_mm256_storeu_si256((__m256i *)&dst[x], lo);
+    }
+}
+
+
+static int
+have_avx2(void)
+{
+#ifdef _MSC_VER
+    int regs[4];
+
+    __cpuid(regs, 0);
+    if (regs[0] < 7) return(0);
+
+    /* The OS has to save the YMM registers for us. */
+    __cpuid(regs, 1);
+    if ((regs[2] & 0x18000000) != 0x18000000) return(0);
+    if ((_xgetbv(0) & 6) != 6) return(0);
+
+    __cpuidex(regs, 7, 0);
+    return((regs[1] & 0x20) != 0);
+#else
+    __builtin_cpu_init();
+
+    return(__builtin_cpu_supports("avx2"));
+#endif
+}
+#endif
+
+
+/* Fill in a set of kernels, for the given level. */
+static void
+kernel_select(svga_kernel_t *k, int level)
+{
+    k->pal8 = pal8_c;
+    k->rgb555 = rgb555_c;
+    k->rgb565 = rgb565_c;
+    k->rgb888 = rgb888_c;
+    k->xrgb8888 = xrgb8888_c;
+    k->planar4 = planar4_c;
+
+#ifdef USE_SSE2
+    if (level >= 1) {
+	/* Without a gather, a table lookup is as good as it gets. */
+	k->rgb555 = rgb555_sse2;
+	k->rgb565 = rgb565_sse2;
+	k->rgb888 = rgb888_sse2;
+	k->xrgb8888 = xrgb8888_sse2;
+    }
+#endif
+#ifdef USE_AVX2
+    if (level >= 2) {
+	k->pal8 = pal8_avx2;
+	k->rgb555 = rgb555_avx2;
+	k->rgb565 = rgb565_avx2;
+	k->rgb888 = rgb888_avx2;
+	k->xrgb8888 = xrgb8888_avx2;
+	k->planar4 = planar4_avx2;
+    }
+#endif
+}
+
+
+/*
+ * Select the kernels to use, up to the given level.
+ *
+ * Level 0 is plain C, 1 adds SSE2, and 2 adds AVX2; -1 selects the
+ * best the host has. Returns the level actually selected.
+ */
+int
+svga_kernel_init(int level)
+{
+    static const char *names[] = { "C", "SSE2", "AVX2" };
+    int best, c, i;
+
+    for (c = 0; c < 256; c++) {
+	planar_expand[c] = 0;
+	for (i = 0; i < 8; i++) {
+		if (c & (0x80 >> i))
+			planar_expand[c] |= (1 << (i << 2));
+	}
+    }
+
+    best = 0;
+#ifdef USE_SSE2
+    best = 1;
+# ifdef USE_AVX2
+    if (have_avx2())
+	best = 2;
+# endif
+#endif
+
+    if ((level < 0) || (level > best))
+	level = best;
+
+    kernel_select(&svga_kernel, level);
+
+    pclog("SVGA: using %s scanline kernels\n", names[level]);
+
+    return(level);
+}
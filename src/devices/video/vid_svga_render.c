@@ -8,7 +8,7 @@
  *
  *		SVGA renderers.
  *
- * Version:	@(#)vid_svga_render.c	1.0.10	2018/05/06
+ * Version:	@(#)vid_svga_render.c	1.0.11	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -107,6 +107,24 @@ uint32_t shade[5][256] =
 	}
 };
 
+/*
+ * Return the VRAM for a scanline kernel to convert 'len' bytes at
+ * 'addr', or NULL if the run wraps around, or the colors have to be
+ * transformed. The renderer then does it one pixel at a time.
+ */
+static __inline uint8_t *svga_kernel_src(svga_t *svga, uint32_t addr, int len)
+{
+        if (vid_grayscale || invert_display)
+                return NULL;
+
+        addr &= svga->vram_display_mask;
+        if ((addr + len) > (svga->vram_display_mask + 1))
+                return NULL;
+
+        return &svga->vram[addr];
+}
+
+
 void svga_render_blank(svga_t *svga)
 {
         int x, xx;
@@ -541,13 +559,26 @@ void svga_render_4bpp_highres(svga_t *svga)
                 
         if (svga->changedvram[changed_offset] || svga->changedvram[changed_offset + 1] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint32_t pal[16];
                 int offset = (8 - svga->scrollcache) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
         
                 if (svga->firstline_draw == 2000) 
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
+
+                /* The kernel needs one unbroken run of VRAM. */
+                n = (svga->hdisp + 8) & ~7;
+                if (!(svga->sc & ~svga->crtc[0x17] & 3) &&
+                    (svga->ma + (n >> 1)) <= (svga->vram_display_mask + 1))
+                {
+                        for (x = 0; x < 16; x++)
+                                pal[x] = svga_color_transform(svga->pallook[svga->egapal[x & svga->plane_mask]]);
+                        svga_kernel.planar4(p, &svga->vram[svga->ma], pal, n);
+                        svga->ma = (svga->ma + (n >> 1)) & svga->vram_display_mask;
+                        return;
+                }
                 
                 for (x = 0; x <= svga->hdisp; x += 8)
                 {
@@ -616,13 +647,23 @@ void svga_render_8bpp_highres(svga_t *svga)
 
         if (svga->changedvram[svga->ma >> 12] || svga->changedvram[(svga->ma >> 12) + 1] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint8_t *src;
                 int offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
 
                 if (svga->firstline_draw == 2000) 
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
+
+                n = (svga->hdisp + 8) & ~7;
+                src = svga_kernel_src(svga, svga->ma, n);
+                if (src != NULL)
+                {
+                        svga_kernel.pal8(p, src, svga->pallook, n);
+                        svga->ma = (svga->ma + n) & svga->vram_display_mask;
+                        return;
+                }
                                                                 
                 for (x = 0; x <= svga->hdisp; x += 8)
                 {
@@ -685,7 +726,8 @@ void svga_render_15bpp_highres(svga_t *svga)
 
         if (svga->changedvram[svga->ma >> 12] || svga->changedvram[(svga->ma >> 12) + 1] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint8_t *src;
                 int offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
 
@@ -693,6 +735,15 @@ void svga_render_15bpp_highres(svga_t *svga)
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
 
+                n = (svga->hdisp + 8) & ~7;
+                src = svga_kernel_src(svga, svga->ma, n << 1);
+                if (src != NULL)
+                {
+                        svga_kernel.rgb555(p, src, n);
+                        svga->ma = (svga->ma + (n << 1)) & svga->vram_display_mask;
+                        return;
+                }
+
                 for (x = 0; x <= svga->hdisp; x += 8)
                 {
                         uint32_t dat = *(uint32_t *)(&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
@@ -755,7 +806,8 @@ void svga_render_16bpp_highres(svga_t *svga)
 
         if (svga->changedvram[svga->ma >> 12] || svga->changedvram[(svga->ma >> 12) + 1] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint8_t *src;
                 int offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
 
@@ -763,6 +815,15 @@ void svga_render_16bpp_highres(svga_t *svga)
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
 
+                n = (svga->hdisp + 8) & ~7;
+                src = svga_kernel_src(svga, svga->ma, n << 1);
+                if (src != NULL)
+                {
+                        svga_kernel.rgb565(p, src, n);
+                        svga->ma = (svga->ma + (n << 1)) & svga->vram_display_mask;
+                        return;
+                }
+
                 for (x = 0; x <= svga->hdisp; x += 8)
                 {
                         uint32_t dat = *(uint32_t *)(&svga->vram[(svga->ma + (x << 1)) & svga->vram_display_mask]);
@@ -819,7 +880,8 @@ void svga_render_24bpp_highres(svga_t *svga)
 
         if (svga->changedvram[svga->ma >> 12] || svga->changedvram[(svga->ma >> 12) + 1] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint8_t *src;
                 int offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
                 
@@ -827,6 +889,15 @@ void svga_render_24bpp_highres(svga_t *svga)
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
 
+                n = (svga->hdisp + 4) & ~3;
+                src = svga_kernel_src(svga, svga->ma, n * 3);
+                if (src != NULL)
+                {
+                        svga_kernel.rgb888(p, src, n);
+                        svga->ma = (svga->ma + (n * 3)) & svga->vram_display_mask;
+                        return;
+                }
+
                 for (x = 0; x <= svga->hdisp; x += 4)
                 {
                         uint32_t dat = *(uint32_t *)(&svga->vram[svga->ma & svga->vram_display_mask]);
@@ -882,7 +953,8 @@ void svga_render_32bpp_highres(svga_t *svga)
 
         if (svga->changedvram[svga->ma >> 12] ||  svga->changedvram[(svga->ma >> 12) + 1] || svga->changedvram[(svga->ma >> 12) + 2] || svga->fullchange)
         {
-                int x;
+                int x, n;
+                uint8_t *src;
                 int offset = (8 - ((svga->scrollcache & 6) >> 1)) + 24;
                 uint32_t *p = &((uint32_t *)buffer32->line[svga->displine + y_add])[offset + x_add];
                 
@@ -890,6 +962,15 @@ void svga_render_32bpp_highres(svga_t *svga)
                         svga->firstline_draw = svga->displine;
                 svga->lastline_draw = svga->displine;
 
+                n = svga->hdisp + 1;
+                src = svga_kernel_src(svga, svga->ma, n << 2);
+                if (src != NULL)
+                {
+                        svga_kernel.xrgb8888(p, src, n);
+                        svga->ma = (svga->ma + 4) & svga->vram_display_mask;
+                        return;
+                }
+
                 for (x = 0; x <= svga->hdisp; x++)
                 {
                         uint32_t dat = *(uint32_t *)(&svga->vram[(svga->ma + (x << 2)) & svga->vram_display_mask]);
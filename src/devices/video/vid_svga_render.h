@@ -8,7 +8,7 @@
  *
  *		Definitions for the SVGA renderers.
  *
- * Version:	@(#)vid_svga_render.h	1.0.2	2018/03/12
+ * Version:	@(#)vid_svga_render.h	1.0.3	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -51,6 +51,22 @@ extern int scrollcache;
 
 extern uint8_t edatlookup[4][4];
 
+/* Scanline kernels, see vid_svga_kernel.c. */
+typedef struct {
+    void	(*pal8)(uint32_t *dst, const uint8_t *src,
+			const uint32_t *pal, int n);
+    void	(*rgb555)(uint32_t *dst, const uint8_t *src, int n);
+    void	(*rgb565)(uint32_t *dst, const uint8_t *src, int n);
+    void	(*rgb888)(uint32_t *dst, const uint8_t *src, int n);
+    void	(*xrgb8888)(uint32_t *dst, const uint8_t *src, int n);
+    void	(*planar4)(uint32_t *dst, const uint8_t *src,
+			   const uint32_t *pal, int n);
+} svga_kernel_t;
+
+extern svga_kernel_t svga_kernel;
+
+extern int	svga_kernel_init(int level);
+
 void svga_render_blank(svga_t *svga);
 void svga_render_text_40(svga_t *svga);
 void svga_render_text_80(svga_t *svga);
@@ -8,7 +8,7 @@
  *
  *		IBM VGA emulation.
  *
- * Version:	@(#)vid_vga.c	1.0.6	2018/05/06
+ * Version:	@(#)vid_vga.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -213,6 +213,20 @@ void vga_force_redraw(void *p)
         vga->svga.fullchange = changeframecount;
 }
 
+static void vga_save(void *p)
+{
+        vga_t *vga = (vga_t *)p;
+
+        svga_save_state(&vga->svga);
+}
+
+static void vga_load(void *p, int version)
+{
+        vga_t *vga = (vga_t *)p;
+
+        svga_load_state(&vga->svga, version);
+}
+
 void vga_add_status_info(char *s, int max_len, void *p)
 {
         vga_t *vga = (vga_t *)p;
@@ -231,7 +245,10 @@ const device_t vga_device =
         vga_available,
         vga_speed_changed,
         vga_force_redraw,
-        vga_add_status_info
+        vga_add_status_info,
+        NULL,
+        vga_save,
+        vga_load
 };
 #ifdef DEV_BRANCH
 const device_t trigem_unk_device =
@@ -245,7 +262,10 @@ const device_t trigem_unk_device =
         vga_available,
         vga_speed_changed,
         vga_force_redraw,
-        vga_add_status_info
+        vga_add_status_info,
+        NULL,
+        vga_save,
+        vga_load
 };
 #endif
 const device_t ps1vga_device =
@@ -259,5 +279,8 @@ const device_t ps1vga_device =
         vga_available,
         vga_speed_changed,
         vga_force_redraw,
-        vga_add_status_info
+        vga_add_status_info,
+        NULL,
+        vga_save,
+        vga_load
 };
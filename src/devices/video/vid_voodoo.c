@@ -8,7 +8,7 @@
  *
  *		Emulation of the 3DFX Voodoo Graphics controller.
  *
- * Version:	@(#)vid_voodoo.c	1.0.10	2018/05/06
+ * Version:	@(#)vid_voodoo.c	1.0.13	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -154,12 +154,13 @@ enum
 #define PARAM_MASK (PARAM_SIZE - 1)
 #define PARAM_ENTRY_SIZE (1 << 31)
 
-#define PARAM_ENTRIES_1 (voodoo->params_write_idx - voodoo->params_read_idx[0])
-#define PARAM_ENTRIES_2 (voodoo->params_write_idx - voodoo->params_read_idx[1])
-#define PARAM_FULL_1 ((voodoo->params_write_idx - voodoo->params_read_idx[0]) >= PARAM_SIZE)
-#define PARAM_FULL_2 ((voodoo->params_write_idx - voodoo->params_read_idx[1]) >= PARAM_SIZE)
-#define PARAM_EMPTY_1   (voodoo->params_read_idx[0] == voodoo->params_write_idx)
-#define PARAM_EMPTY_2   (voodoo->params_read_idx[1] == voodoo->params_write_idx)
+/*All render threads read the same params ringbuffer, each with its own
+  read index; thread n draws the scanlines where (y & (threads-1)) == n.*/
+#define VOODOO_MAX_THREADS 8
+
+#define PARAM_ENTRIES(n) (voodoo->params_write_idx - voodoo->params_read_idx[n])
+#define PARAM_FULL(n)    ((voodoo->params_write_idx - voodoo->params_read_idx[n]) >= PARAM_SIZE)
+#define PARAM_EMPTY(n)   (voodoo->params_read_idx[n] == voodoo->params_write_idx)
 
 typedef struct
 {
@@ -253,13 +254,20 @@ typedef struct texture_t
 {
         uint32_t base;
         uint32_t tLOD;
-        volatile int refcount, refcount_r[2];
+        volatile int refcount, refcount_r[VOODOO_MAX_THREADS];
         int is16;
         uint32_t palette_checksum;
         uint32_t addr_start[4], addr_end[4];
         uint32_t *data;
 } texture_t;
 
+/*Argument passed to each render thread.*/
+typedef struct voodoo_render_t
+{
+        struct voodoo_t *voodoo;
+        int thread;
+} voodoo_render_t;
+
 typedef struct voodoo_t
 {
         mem_mapping_t mapping;
@@ -330,21 +338,22 @@ typedef struct voodoo_t
         int ncc_dirty[2];
 
         thread_t *fifo_thread;
-        thread_t *render_thread[2];
+        thread_t *render_thread[VOODOO_MAX_THREADS];
         event_t *wake_fifo_thread;
         event_t *wake_main_thread;
         event_t *fifo_not_full_event;
-        event_t *render_not_full_event[2];
-        event_t *wake_render_thread[2];
+        event_t *render_not_full_event[VOODOO_MAX_THREADS];
+        event_t *wake_render_thread[VOODOO_MAX_THREADS];
         
         int voodoo_busy;
-        int render_voodoo_busy[2];
+        int render_voodoo_busy[VOODOO_MAX_THREADS];
         
         int render_threads;
         int odd_even_mask;
+        voodoo_render_t render_data[VOODOO_MAX_THREADS];
         
-        int pixel_count[2], texel_count[2], tri_count, frame_count;
-        int pixel_count_old[2], texel_count_old[2];
+        int pixel_count[VOODOO_MAX_THREADS], texel_count[VOODOO_MAX_THREADS], tri_count, frame_count;
+        int pixel_count_old[VOODOO_MAX_THREADS], texel_count_old[VOODOO_MAX_THREADS];
         int wr_count, rd_count, tex_count;
         
         int retrace_count;
@@ -368,7 +377,7 @@ typedef struct voodoo_t
 	volatile int cmd_read, cmd_written, cmd_written_fifo;
 
         voodoo_params_t params_buffer[PARAM_SIZE];
-        volatile int params_read_idx[2], params_write_idx;
+        volatile int params_read_idx[VOODOO_MAX_THREADS], params_write_idx;
         
         uint32_t cmdfifo_base, cmdfifo_end;
         int cmdfifo_rp;
@@ -461,10 +470,14 @@ typedef struct voodoo_t
         int palette_dirty[2];
 
         uint64_t time;
-        int render_time[2];
+        int render_time[VOODOO_MAX_THREADS];
         
         int use_recompiler;        
         void *codegen_data;
+        void *codegen_cache;
+        int codegen_hits[VOODOO_MAX_THREADS];
+        int codegen_misses[VOODOO_MAX_THREADS];
+        int codegen_regens[VOODOO_MAX_THREADS];
         
         struct voodoo_set_t *set;
 } voodoo_t;
@@ -480,6 +493,19 @@ typedef struct voodoo_set_t
 
 static inline void wait_for_render_thread_idle(voodoo_t *voodoo);
 
+/*Check whether a texture is still used by a queued triangle.*/
+static inline int texture_in_use(voodoo_t *voodoo, texture_t *tex)
+{
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++)
+        {
+                if (tex->refcount != tex->refcount_r[c])
+                        return 1;
+        }
+        return 0;
+}
+
 enum
 {
         SST_status = 0x000,
@@ -1379,8 +1405,7 @@ static void use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
                 {
                         voodoo->texture_last_removed++;
                         voodoo->texture_last_removed &= (TEX_CACHE_MAX-1);
-                        if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] &&
-                            (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
+                        if (!texture_in_use(voodoo, &voodoo->texture_cache[tmu][voodoo->texture_last_removed]))
                                 break;
                 }
                 if (c == TEX_CACHE_MAX)
@@ -1713,8 +1738,7 @@ static void flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
                                         {
 //                                voodoo_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
 
-                                                if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] ||
-                                                    (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
+                                                if (texture_in_use(voodoo, &voodoo->texture_cache[tmu][c]))
                                                         wait_for_idle = 1;
                                         
                                                 voodoo->texture_cache[tmu][c].base = -1;
@@ -2708,11 +2732,9 @@ static inline void voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t
 #include "vid_voodoo_codegen_x86-64.h"
 #else
 #define NO_CODEGEN
-static int voodoo_recomp = 0;
 #endif
 #else
 #define NO_CODEGEN
-static int voodoo_recomp = 0;
 #endif
 
 static void voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
@@ -3603,26 +3625,37 @@ static void voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_e
 
 static inline void wake_render_thread(voodoo_t *voodoo)
 {
-        thread_set_event(voodoo->wake_render_thread[0]); /*Wake up render thread if moving from idle*/
-        if (voodoo->render_threads == 2)
-                thread_set_event(voodoo->wake_render_thread[1]); /*Wake up render thread if moving from idle*/
+        int c;
+
+        for (c = 0; c < voodoo->render_threads; c++)
+                thread_set_event(voodoo->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
 }
 
 static inline void wait_for_render_thread_idle(voodoo_t *voodoo)
 {
-        while (!PARAM_EMPTY_1 || (voodoo->render_threads == 2 && !PARAM_EMPTY_2) || voodoo->render_voodoo_busy[0] || (voodoo->render_threads == 2 && voodoo->render_voodoo_busy[1]))
+        int c, busy;
+
+        do
         {
-                wake_render_thread(voodoo);
-                if (!PARAM_EMPTY_1 || voodoo->render_voodoo_busy[0])
-                        thread_wait_event(voodoo->render_not_full_event[0], 1);
-                if (voodoo->render_threads == 2 && (!PARAM_EMPTY_2 || voodoo->render_voodoo_busy[1]))
-                        thread_wait_event(voodoo->render_not_full_event[1], 1);
-        }
+                busy = 0;
+                for (c = 0; c < voodoo->render_threads; c++)
+                {
+                        if (!PARAM_EMPTY(c) || voodoo->render_voodoo_busy[c])
+                        {
+                                if (!busy)
+                                        wake_render_thread(voodoo);
+                                busy = 1;
+                                thread_wait_event(voodoo->render_not_full_event[c], 1);
+                        }
+                }
+        } while (busy);
 }
 
-static void render_thread(void *param, int odd_even)
+static void render_thread(void *param)
 {
-        voodoo_t *voodoo = (voodoo_t *)param;
+        voodoo_render_t *render = (voodoo_render_t *)param;
+        voodoo_t *voodoo = render->voodoo;
+        int odd_even = render->thread;
         
         while (1)
         {
@@ -3631,7 +3664,7 @@ static void render_thread(void *param, int odd_even)
                 thread_reset_event(voodoo->wake_render_thread[odd_even]);
                 voodoo->render_voodoo_busy[odd_even] = 1;
 
-                while (!(odd_even ? PARAM_EMPTY_2 : PARAM_EMPTY_1))
+                while (!PARAM_EMPTY(odd_even))
                 {
                         uint64_t start_time = plat_timer_read();
                         uint64_t end_time;
@@ -3641,7 +3674,7 @@ static void render_thread(void *param, int odd_even)
 
                         voodoo->params_read_idx[odd_even]++;                                                
                         
-                        if ((odd_even ? PARAM_ENTRIES_2 : PARAM_ENTRIES_1) > (PARAM_SIZE - 10))
+                        if (PARAM_ENTRIES(odd_even) > (PARAM_SIZE - 10))
                                 thread_set_event(voodoo->render_not_full_event[odd_even]);
 
                         end_time = plat_timer_read();
@@ -3652,31 +3685,19 @@ static void render_thread(void *param, int odd_even)
         }
 }
 
-static void render_thread_1(void *param)
-{
-        render_thread(param, 0);
-}
-static void render_thread_2(void *param)
-{
-        render_thread(param, 1);
-}
-
 static inline void queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
         voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
+        int c, wake;
 
-        while (PARAM_FULL_1 || (voodoo->render_threads == 2 && PARAM_FULL_2))
+        for (c = 0; c < voodoo->render_threads; c++)
         {
-                thread_reset_event(voodoo->render_not_full_event[0]);
-                if (voodoo->render_threads == 2)
-                        thread_reset_event(voodoo->render_not_full_event[1]);
-                if (PARAM_FULL_1)
+                /*The slowest thread holds up the ringbuffer for all of them.*/
+                while (PARAM_FULL(c))
                 {
-                        thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-                }
-                if (voodoo->render_threads == 2 && PARAM_FULL_2)
-                {
-                        thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
+                        thread_reset_event(voodoo->render_not_full_event[c]);
+                        if (PARAM_FULL(c))
+                                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
                 }
         }
         
@@ -3688,7 +3709,13 @@ static inline void queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
         
         voodoo->params_write_idx++;
         
-        if (PARAM_ENTRIES_1 < 4 || (voodoo->render_threads == 2 && PARAM_ENTRIES_2 < 4))
+        wake = 0;
+        for (c = 0; c < voodoo->render_threads; c++)
+        {
+                if (PARAM_ENTRIES(c) < 4)
+                        wake = 1;
+        }
+        if (wake)
                 wake_render_thread(voodoo);
 }
 
@@ -7434,6 +7461,8 @@ void voodoo_callback(void *priv)
                                 }
                                 if (voodoo->line > voodoo->dirty_line_high)
                                         voodoo->dirty_line_high = voodoo->line;
+                                /*svga_doblit() only sends rows marked as changed*/
+                                video_dirty_line(voodoo->line + y_add, ~0U);
                                 
                                 if (voodoo->scrfilter && voodoo->scrfilterEnabled)
                                 {
@@ -7555,14 +7584,16 @@ static void voodoo_add_status_info(char *s, int max_len, void *p)
         voodoo_set_t *voodoo_set = (voodoo_set_t *)p;
         voodoo_t *voodoo = voodoo_set->voodoos[0];
         voodoo_t *voodoo_slave = voodoo_set->voodoos[1];
-        char temps[512], temps2[256];
-        int pixel_count_current[2];
+        char temps[1024], temps2[256];
+        int pixel_count_current[VOODOO_MAX_THREADS];
         int pixel_count_total;
-        int texel_count_current[2];
+        int texel_count_current[VOODOO_MAX_THREADS];
         int texel_count_total;
-        int render_time[2];
+        int render_time[VOODOO_MAX_THREADS];
+        int codegen_hits, codegen_misses, codegen_regens;
         uint64_t new_time = plat_timer_read();
         uint64_t status_diff = new_time - status_time;
+        int c;
         status_time = new_time;
 
         if (!status_diff)
@@ -7570,71 +7601,81 @@ static void voodoo_add_status_info(char *s, int max_len, void *p)
 
         svga_add_status_info(s, max_len, &voodoo->svga);
         
-        pixel_count_current[0] = voodoo->pixel_count[0];
-        pixel_count_current[1] = voodoo->pixel_count[1];
-        texel_count_current[0] = voodoo->texel_count[0];
-        texel_count_current[1] = voodoo->texel_count[1];
-        render_time[0] = voodoo->render_time[0];
-        render_time[1] = voodoo->render_time[1];
-        if (voodoo_set->nr_cards == 2)
+        pixel_count_total = texel_count_total = 0;
+        codegen_hits = codegen_misses = codegen_regens = 0;
+        for (c = 0; c < VOODOO_MAX_THREADS; c++)
         {
-                pixel_count_current[0] += voodoo_slave->pixel_count[0];
-                pixel_count_current[1] += voodoo_slave->pixel_count[1];
-                texel_count_current[0] += voodoo_slave->texel_count[0];
-                texel_count_current[1] += voodoo_slave->texel_count[1];
-                render_time[0] = (render_time[0] + voodoo_slave->render_time[0]) / 2;
-                render_time[1] = (render_time[1] + voodoo_slave->render_time[1]) / 2;
+                codegen_hits += voodoo->codegen_hits[c];
+                codegen_misses += voodoo->codegen_misses[c];
+                codegen_regens += voodoo->codegen_regens[c];
+                pixel_count_current[c] = voodoo->pixel_count[c];
+                texel_count_current[c] = voodoo->texel_count[c];
+                render_time[c] = voodoo->render_time[c];
+                if (voodoo_set->nr_cards == 2)
+                {
+                        pixel_count_current[c] += voodoo_slave->pixel_count[c];
+                        texel_count_current[c] += voodoo_slave->texel_count[c];
+                        render_time[c] = (render_time[c] + voodoo_slave->render_time[c]) / 2;
+                        codegen_hits += voodoo_slave->codegen_hits[c];
+                        codegen_misses += voodoo_slave->codegen_misses[c];
+                        codegen_regens += voodoo_slave->codegen_regens[c];
+                }
+                pixel_count_total += pixel_count_current[c] - voodoo->pixel_count_old[c];
+                texel_count_total += texel_count_current[c] - voodoo->texel_count_old[c];
         }
-        pixel_count_total = (pixel_count_current[0] + pixel_count_current[1]) - (voodoo->pixel_count_old[0] + voodoo->pixel_count_old[1]);
-        texel_count_total = (texel_count_current[0] + texel_count_current[1]) - (voodoo->texel_count_old[0] + voodoo->texel_count_old[1]);
-        sprintf(temps, "%f Mpixels/sec (%f)\n%f Mtexels/sec (%f)\n%f ktris/sec\n%f%% CPU (%f%% real)\n%d frames/sec (%i)\n%f%% CPU (%f%% real)\n"/*%d reads/sec\n%d write/sec\n%d tex/sec\n*/,
+        sprintf(temps, "%f Mpixels/sec (%f)\n%f Mtexels/sec (%f)\n%f ktris/sec\n%f%% CPU (%f%% real)\n%d frames/sec\n%f%% CPU (%f%% real)\n"/*%d reads/sec\n%d write/sec\n%d tex/sec\n*/,
                 (double)pixel_count_total/1000000.0,
                 ((double)pixel_count_total/1000000.0) / ((double)render_time[0] / status_diff),
                 (double)texel_count_total/1000000.0,
                 ((double)texel_count_total/1000000.0) / ((double)render_time[0] / status_diff),
-                (double)voodoo->tri_count/1000.0, ((double)voodoo->time * 100.0) / timer_freq, ((double)voodoo->time * 100.0) / status_diff, voodoo->frame_count, voodoo_recomp,
+                (double)voodoo->tri_count/1000.0, ((double)voodoo->time * 100.0) / timer_freq, ((double)voodoo->time * 100.0) / status_diff, voodoo->frame_count,
                 ((double)voodoo->render_time[0] * 100.0) / timer_freq, ((double)voodoo->render_time[0] * 100.0) / status_diff);
-        if (voodoo->render_threads == 2)
+        for (c = 1; c < voodoo->render_threads; c++)
         {
                 sprintf(temps2, "%f%% CPU (%f%% real)\n",
-                        ((double)voodoo->render_time[1] * 100.0) / timer_freq, ((double)voodoo->render_time[1] * 100.0) / status_diff);
-                strncat(temps, temps2, sizeof(temps)-1);
+                        ((double)voodoo->render_time[c] * 100.0) / timer_freq, ((double)voodoo->render_time[c] * 100.0) / status_diff);
+                strncat(temps, temps2, sizeof(temps) - strlen(temps) - 1);
         }
         if (voodoo_set->nr_cards == 2)
         {
-                sprintf(temps2, "%f%% CPU (%f%% real)\n",
-                        ((double)voodoo_slave->render_time[0] * 100.0) / timer_freq, ((double)voodoo_slave->render_time[0] * 100.0) / status_diff);
-                strncat(temps, temps2, sizeof(temps)-1);
-                        
-                if (voodoo_slave->render_threads == 2)
+                for (c = 0; c < voodoo_slave->render_threads; c++)
                 {
                         sprintf(temps2, "%f%% CPU (%f%% real)\n",
-                                ((double)voodoo_slave->render_time[1] * 100.0) / timer_freq, ((double)voodoo_slave->render_time[1] * 100.0) / status_diff);
-                        strncat(temps, temps2, sizeof(temps)-1);
+                                ((double)voodoo_slave->render_time[c] * 100.0) / timer_freq, ((double)voodoo_slave->render_time[c] * 100.0) / status_diff);
+                        strncat(temps, temps2, sizeof(temps) - strlen(temps) - 1);
                 }
         }
+        if (voodoo->use_recompiler)
+        {
+                sprintf(temps2, "%d codegen hits, %d misses (%d regenerated)\n",
+                        codegen_hits, codegen_misses, codegen_regens);
+                strncat(temps, temps2, sizeof(temps) - strlen(temps) - 1);
+        }
         strncat(s, temps, max_len);
 
-        voodoo->pixel_count_old[0] = pixel_count_current[0];
-        voodoo->pixel_count_old[1] = pixel_count_current[1];
-        voodoo->texel_count_old[0] = texel_count_current[0];
-        voodoo->texel_count_old[1] = texel_count_current[1];
+        for (c = 0; c < VOODOO_MAX_THREADS; c++)
+        {
+                voodoo->pixel_count_old[c] = pixel_count_current[c];
+                voodoo->texel_count_old[c] = texel_count_current[c];
+                voodoo->render_time[c] = 0;
+                voodoo->codegen_hits[c] = voodoo->codegen_misses[c] = voodoo->codegen_regens[c] = 0;
+        }
         voodoo->tri_count = voodoo->frame_count = 0;
         voodoo->rd_count = voodoo->wr_count = voodoo->tex_count = 0;
         voodoo->time = 0;
-        voodoo->render_time[0] = voodoo->render_time[1] = 0;
         if (voodoo_set->nr_cards == 2)
         {
-                voodoo_slave->pixel_count_old[0] = pixel_count_current[0];
-                voodoo_slave->pixel_count_old[1] = pixel_count_current[1];
-                voodoo_slave->texel_count_old[0] = texel_count_current[0];
-                voodoo_slave->texel_count_old[1] = texel_count_current[1];
+                for (c = 0; c < VOODOO_MAX_THREADS; c++)
+                {
+                        voodoo_slave->pixel_count_old[c] = pixel_count_current[c];
+                        voodoo_slave->texel_count_old[c] = texel_count_current[c];
+                        voodoo_slave->render_time[c] = 0;
+                        voodoo_slave->codegen_hits[c] = voodoo_slave->codegen_misses[c] = voodoo_slave->codegen_regens[c] = 0;
+                }
                 voodoo_slave->tri_count = voodoo_slave->frame_count = 0;
                 voodoo_slave->rd_count = voodoo_slave->wr_count = voodoo_slave->tex_count = 0;
                 voodoo_slave->time = 0;
-                voodoo_slave->render_time[0] = voodoo_slave->render_time[1] = 0;
         }
-        voodoo_recomp = 0;
 }
 
 static void voodoo_speed_changed(void *p)
@@ -7668,6 +7709,9 @@ void *voodoo_card_init()
         voodoo->fb_size = device_get_config_int("framebuffer_memory");
         voodoo->fb_mask = (voodoo->fb_size << 20) - 1;
         voodoo->render_threads = device_get_config_int("render_threads");
+        if (voodoo->render_threads < 1 || voodoo->render_threads > VOODOO_MAX_THREADS ||
+            (voodoo->render_threads & (voodoo->render_threads - 1)))
+                voodoo->render_threads = 2;
         voodoo->odd_even_mask = voodoo->render_threads - 1;
 #ifndef NO_CODEGEN
         voodoo->use_recompiler = device_get_config_int("recompiler");
@@ -7721,16 +7765,17 @@ void *voodoo_card_init()
         voodoo->fbiInit0 = 0;
 
         voodoo->wake_fifo_thread = thread_create_event();
-        voodoo->wake_render_thread[0] = thread_create_event();
-        voodoo->wake_render_thread[1] = thread_create_event();
         voodoo->wake_main_thread = thread_create_event();
         voodoo->fifo_not_full_event = thread_create_event();
-        voodoo->render_not_full_event[0] = thread_create_event();
-        voodoo->render_not_full_event[1] = thread_create_event();
         voodoo->fifo_thread = thread_create(fifo_thread, voodoo);
-        voodoo->render_thread[0] = thread_create(render_thread_1, voodoo);
-        if (voodoo->render_threads == 2)
-                voodoo->render_thread[1] = thread_create(render_thread_2, voodoo);
+        for (c = 0; c < voodoo->render_threads; c++)
+        {
+                voodoo->wake_render_thread[c] = thread_create_event();
+                voodoo->render_not_full_event[c] = thread_create_event();
+                voodoo->render_data[c].voodoo = voodoo;
+                voodoo->render_data[c].thread = c;
+                voodoo->render_thread[c] = thread_create(render_thread, &voodoo->render_data[c]);
+        }
 
         timer_add(voodoo_wake_timer, &voodoo->wake_timer, &voodoo->wake_timer, (void *)voodoo);
         
@@ -7883,16 +7928,16 @@ void voodoo_card_close(voodoo_t *voodoo)
 #endif
 
         thread_kill(voodoo->fifo_thread);
-        thread_kill(voodoo->render_thread[0]);
-        if (voodoo->render_threads == 2)
-                thread_kill(voodoo->render_thread[1]);
+        for (c = 0; c < voodoo->render_threads; c++)
+                thread_kill(voodoo->render_thread[c]);
         thread_destroy_event(voodoo->fifo_not_full_event);
         thread_destroy_event(voodoo->wake_main_thread);
         thread_destroy_event(voodoo->wake_fifo_thread);
-        thread_destroy_event(voodoo->wake_render_thread[0]);
-        thread_destroy_event(voodoo->wake_render_thread[1]);
-        thread_destroy_event(voodoo->render_not_full_event[0]);
-        thread_destroy_event(voodoo->render_not_full_event[1]);
+        for (c = 0; c < voodoo->render_threads; c++)
+        {
+                thread_destroy_event(voodoo->wake_render_thread[c]);
+                thread_destroy_event(voodoo->render_not_full_event[c]);
+        }
 
         for (c = 0; c < TEX_CACHE_MAX; c++)
         {
@@ -8020,6 +8065,14 @@ static const device_config_t voodoo_config[] =
                                 .description = "2",
                                 .value = 2
                         },
+                        {
+                                .description = "4",
+                                .value = 4
+                        },
+                        {
+                                .description = "8",
+                                .value = 8
+                        },
                         {
                                 .description = ""
                         }
@@ -8,7 +8,7 @@
  *
  *		Implementation of the Voodoo Recompiler (64bit.)
  *
- * Version:	@(#)vid_voodoo_codegen_x86-64.h	1.0.1	2018/02/14
+ * Version:	@(#)vid_voodoo_codegen_x86-64.h	1.0.4	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -57,15 +57,19 @@
 
 #include <xmmintrin.h>
 
-#define BLOCK_NUM 8
-#define BLOCK_MASK (BLOCK_NUM-1)
+#define BLOCK_NUM 64            /*Blocks per render thread*/
 #define BLOCK_SIZE 8192
+#define BLOCK_HASH_SIZE 256
+#define BLOCK_HASH_MASK (BLOCK_HASH_SIZE-1)
+#define BLOCK_EVICT_SIZE 1024
+#define BLOCK_EVICT_MASK (BLOCK_EVICT_SIZE-1)
 
 #define LOD_MASK (LOD_TMIRROR_S | LOD_TMIRROR_T)
 
-typedef struct voodoo_x86_data_t
+/*The render state a block was generated for. All members are 32 bits
+  wide, so there is no padding and it can be compared with memcmp().*/
+typedef struct voodoo_block_key_t
 {
-        uint8_t code_block[BLOCK_SIZE];
         int xdir;
         uint32_t alphaMode;
         uint32_t fbzMode;
@@ -73,13 +77,30 @@ typedef struct voodoo_x86_data_t
         uint32_t fbzColorPath;
         uint32_t textureMode[2];
         uint32_t tLOD[2];
-        uint32_t trexInit1;        
+        uint32_t trexInit1;
+} voodoo_block_key_t;
+
+typedef struct voodoo_x86_data_t
+{
+        uint8_t code_block[BLOCK_SIZE];
+        voodoo_block_key_t key;
+        uint32_t hash;
+        int valid;
+        int hash_next;          /*Next block in the same hash chain, or -1*/
+        int lru_prev, lru_next; /*Neighbours in the LRU list, or -1*/
 } voodoo_x86_data_t;
 
-//static voodoo_x86_data_t voodoo_x86_data[2][BLOCK_NUM];
+/*Lookup state for the blocks of one render thread. Blocks are found
+  through a hash of the render state they were generated for, and
+  recycled in least recently used order. The hashes of recycled blocks
+  are remembered for a while, so generating one again can be counted.*/
+typedef struct voodoo_codegen_cache_t
+{
+        int hash[BLOCK_HASH_SIZE];      /*First block of each chain, or -1*/
+        int lru_head, lru_tail;         /*Most and least recently used*/
+        uint32_t evicted[BLOCK_EVICT_SIZE];
+} voodoo_codegen_cache_t;
 
-static int last_block[2] = {0, 0};
-static int next_block_to_write[2] = {0, 0};
 
 #define addbyte(val)                                    \
         code_block[block_pos++] = val;                  \
@@ -3281,54 +3302,105 @@ static inline void voodoo_generate(uint8_t *code_block, voodoo_t *voodoo, voodoo
         
         addbyte(0xC3); /*RET*/
 }
-static int voodoo_recomp = 0;
+/*Hash the render state that a block was generated for.*/
+static inline uint32_t voodoo_block_hash(const voodoo_block_key_t *key)
+{
+        uint32_t hash = 2166136261u;
+
+        hash = (hash ^ key->xdir) * 16777619u;
+        hash = (hash ^ key->alphaMode) * 16777619u;
+        hash = (hash ^ key->fbzMode) * 16777619u;
+        hash = (hash ^ key->fogMode) * 16777619u;
+        hash = (hash ^ key->fbzColorPath) * 16777619u;
+        hash = (hash ^ key->textureMode[0]) * 16777619u;
+        hash = (hash ^ key->textureMode[1]) * 16777619u;
+        hash = (hash ^ key->tLOD[0]) * 16777619u;
+        hash = (hash ^ key->tLOD[1]) * 16777619u;
+        hash = (hash ^ key->trexInit1) * 16777619u;
+
+        return hash;
+}
+
+/*Make a block the most recently used one of its thread.*/
+static inline void voodoo_block_touch(voodoo_codegen_cache_t *cache, voodoo_x86_data_t *blocks, int b)
+{
+        voodoo_x86_data_t *data = &blocks[b];
+
+        if (cache->lru_head == b)
+                return;
+
+        /*Unlink...*/
+        blocks[data->lru_prev].lru_next = data->lru_next;
+        if (data->lru_next != -1)
+                blocks[data->lru_next].lru_prev = data->lru_prev;
+        else
+                cache->lru_tail = data->lru_prev;
+
+        /*...and put it in front.*/
+        data->lru_prev = -1;
+        data->lru_next = cache->lru_head;
+        blocks[cache->lru_head].lru_prev = b;
+        cache->lru_head = b;
+}
+
 static inline void *voodoo_get_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int odd_even)
 {
-        int c;
-        int b = last_block[odd_even];
-        voodoo_x86_data_t *voodoo_x86_data = voodoo->codegen_data;
+        voodoo_codegen_cache_t *cache = &((voodoo_codegen_cache_t *)voodoo->codegen_cache)[odd_even];
+        voodoo_x86_data_t *blocks = voodoo->codegen_data;
         voodoo_x86_data_t *data;
-        
-        for (c = 0; c < 8; c++)
+        voodoo_block_key_t key;
+        uint32_t hash;
+        int b, *prev;
+
+        key.xdir = state->xdir;
+        key.alphaMode = params->alphaMode;
+        key.fbzMode = params->fbzMode;
+        key.fogMode = params->fogMode;
+        key.fbzColorPath = params->fbzColorPath;
+        key.trexInit1 = voodoo->trexInit1[0] & (1 << 18);
+        key.textureMode[0] = params->textureMode[0];
+        key.textureMode[1] = params->textureMode[1];
+        key.tLOD[0] = params->tLOD[0] & LOD_MASK;
+        key.tLOD[1] = params->tLOD[1] & LOD_MASK;
+        hash = voodoo_block_hash(&key);
+
+        for (b = cache->hash[hash & BLOCK_HASH_MASK]; b != -1; b = data->hash_next)
         {
-                data = &voodoo_x86_data[odd_even + c*2]; //&voodoo_x86_data[odd_even][b];
-                
-                if (state->xdir == data->xdir &&
-                    params->alphaMode == data->alphaMode &&
-                    params->fbzMode == data->fbzMode &&
-                    params->fogMode == data->fogMode &&
-                    params->fbzColorPath == data->fbzColorPath &&
-                    (voodoo->trexInit1[0] & (1 << 18)) == data->trexInit1 &&
-                    params->textureMode[0] == data->textureMode[0] &&
-                    params->textureMode[1] == data->textureMode[1] &&
-                    (params->tLOD[0] & LOD_MASK) == data->tLOD[0] &&
-                    (params->tLOD[1] & LOD_MASK) == data->tLOD[1])
+                data = &blocks[b];
+
+                if (hash == data->hash && !memcmp(&key, &data->key, sizeof(key)))
                 {
-                        last_block[odd_even] = b;
+                        voodoo_block_touch(cache, blocks, b);
+                        voodoo->codegen_hits[odd_even]++;
                         return data->code_block;
                 }
-                
-                b = (b + 1) & 7;
         }
-voodoo_recomp++;
-        data = &voodoo_x86_data[odd_even + next_block_to_write[odd_even]*2];
-//        code_block = data->code_block;
-        
+
+        voodoo->codegen_misses[odd_even]++;
+        if (cache->evicted[hash & BLOCK_EVICT_MASK] == hash)
+                voodoo->codegen_regens[odd_even]++;
+
+        /*Recycle the least recently used block.*/
+        b = cache->lru_tail;
+        data = &blocks[b];
+        if (data->valid)
+        {
+                for (prev = &cache->hash[data->hash & BLOCK_HASH_MASK]; *prev != b; prev = &blocks[*prev].hash_next)
+                        ;
+                *prev = data->hash_next;
+                cache->evicted[data->hash & BLOCK_EVICT_MASK] = data->hash;
+        }
+
         voodoo_generate(data->code_block, voodoo, params, state, depth_op);
 
-        data->xdir = state->xdir;
-        data->alphaMode = params->alphaMode;
-        data->fbzMode = params->fbzMode;
-        data->fogMode = params->fogMode;
-        data->fbzColorPath = params->fbzColorPath;
-        data->trexInit1 = voodoo->trexInit1[0] & (1 << 18);
-        data->textureMode[0] = params->textureMode[0];
-        data->textureMode[1] = params->textureMode[1];
-        data->tLOD[0] = params->tLOD[0] & LOD_MASK;
-        data->tLOD[1] = params->tLOD[1] & LOD_MASK;
-
-        next_block_to_write[odd_even] = (next_block_to_write[odd_even] + 1) & 7;
-        
+        data->key = key;
+        data->hash = hash;
+        data->valid = 1;
+
+        data->hash_next = cache->hash[hash & BLOCK_HASH_MASK];
+        cache->hash[hash & BLOCK_HASH_MASK] = b;
+        voodoo_block_touch(cache, blocks, b);
+
         return data->code_block;
 }
 
@@ -3343,14 +3415,14 @@ static void voodoo_codegen_init(voodoo_t *voodoo)
 #endif
 
 #if WIN64
-        voodoo->codegen_data = VirtualAlloc(NULL, sizeof(voodoo_x86_data_t) * BLOCK_NUM * 2, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+        voodoo->codegen_data = VirtualAlloc(NULL, sizeof(voodoo_x86_data_t) * BLOCK_NUM * voodoo->render_threads, MEM_COMMIT, PAGE_EXECUTE_READWRITE);
 #else
-        voodoo->codegen_data = malloc(sizeof(voodoo_x86_data_t) * BLOCK_NUM * 2);
+        voodoo->codegen_data = malloc(sizeof(voodoo_x86_data_t) * BLOCK_NUM * voodoo->render_threads);
 #endif
 
 #ifdef __linux__
 	start = (void *)((long)voodoo->codegen_data & pagemask);
-	len = ((sizeof(voodoo_x86_data_t) * BLOCK_NUM * 2) + pagesize) & pagemask;
+	len = ((long)voodoo->codegen_data + (sizeof(voodoo_x86_data_t) * BLOCK_NUM * voodoo->render_threads) - (long)start + pagesize - 1) & pagemask;
 	if (mprotect(start, len, PROT_READ | PROT_WRITE | PROT_EXEC) != 0)
 	{
 		perror("mprotect");
@@ -3358,6 +3430,28 @@ static void voodoo_codegen_init(voodoo_t *voodoo)
 	}
 #endif
 
+        /*Each render thread gets BLOCK_NUM blocks of its own, all in one
+          LRU list, with empty hash chains.*/
+        voodoo->codegen_cache = malloc(sizeof(voodoo_codegen_cache_t) * voodoo->render_threads);
+        for (c = 0; c < voodoo->render_threads; c++)
+        {
+                voodoo_codegen_cache_t *cache = &((voodoo_codegen_cache_t *)voodoo->codegen_cache)[c];
+                voodoo_x86_data_t *blocks = voodoo->codegen_data;
+                int b;
+
+                memset(cache, 0, sizeof(voodoo_codegen_cache_t));
+                for (b = 0; b < BLOCK_HASH_SIZE; b++)
+                        cache->hash[b] = -1;
+                for (b = 0; b < BLOCK_NUM; b++)
+                {
+                        blocks[c*BLOCK_NUM + b].valid = 0;
+                        blocks[c*BLOCK_NUM + b].lru_prev = (b == 0) ? -1 : (c*BLOCK_NUM + b - 1);
+                        blocks[c*BLOCK_NUM + b].lru_next = (b == BLOCK_NUM-1) ? -1 : (c*BLOCK_NUM + b + 1);
+                }
+                cache->lru_head = c*BLOCK_NUM;
+                cache->lru_tail = c*BLOCK_NUM + BLOCK_NUM-1;
+        }
+
         for (c = 0; c < 256; c++)
         {
                 int d[4];
@@ -3382,6 +3476,7 @@ static void voodoo_codegen_init(voodoo_t *voodoo)
 
 static void voodoo_codegen_close(voodoo_t *voodoo)
 {
+        free(voodoo->codegen_cache);
 #if WIN64
         VirtualFree(voodoo->codegen_data, 0, MEM_RELEASE);
 #else
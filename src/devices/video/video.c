@@ -40,7 +40,7 @@
  *		W = 3 bus clocks
  *		L = 4 bus clocks
  *
- * Version:	@(#)video.c	1.0.17	2018/08/25
+ * Version:	@(#)video.c	1.0.20	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -218,6 +218,26 @@ static struct {
 static int	video_force_resize;
 
 
+/*
+ * Dirty-tile map.
+ *
+ * Every row of buffer32 has a mask with one bit for each VIDEO_TILE_W
+ * pixels wide column of that row.  Renderers which know what they did
+ * set the bits of the columns they really changed, and the map is then
+ * handed over to the blitter together with the frame, so the backends
+ * only have to convert, copy or send the tiles that are dirty.  Rows
+ * are grouped into bands of VIDEO_TILE_H for that, which makes for the
+ * 64x16 tiles that make up the consumer side.
+ *
+ * Rows that are not part of a blit keep their bits until they are.
+ * Producers that do not know about the map (and everything that goes
+ * through plain video_blit_memtoscreen) simply get a fully dirty frame.
+ */
+static uint32_t	video_dirty[2048];		/* marked by the renderers */
+static uint32_t	blit_dirty[2048];		/* snapshot for the blitter */
+static volatile int video_dirty_full;
+
+
 static void (*blit_func)(int x, int y, int y1, int y2, int w, int h);
 
 
@@ -243,6 +263,9 @@ void
 video_setblit(void(*blit)(int,int,int,int,int,int))
 {
     blit_func = blit;
+
+    /* A new backend starts out with nothing on its screen. */
+    video_dirty_all();
 }
 
 
@@ -273,13 +296,161 @@ video_wait_for_buffer(void)
 }
 
 
+/* Mark a rectangle of buffer32 as changed for the next blit. */
 void
-video_blit_memtoscreen(int x, int y, int y1, int y2, int w, int h)
+video_dirty_mark(int x, int y, int w, int h)
+{
+    uint32_t mask;
+    int c, e;
+
+    if (x < 0) {
+	w += x;
+	x = 0;
+    }
+    if ((x + w) > 2048)
+	w = 2048 - x;
+    if (y < 0) {
+	h += y;
+	y = 0;
+    }
+    if ((y + h) > 2048)
+	h = 2048 - y;
+    if ((w <= 0) || (h <= 0)) return;
+
+    c = x / VIDEO_TILE_W;
+    e = (x + w + VIDEO_TILE_W - 1) / VIDEO_TILE_W;
+    mask = (e >= 32) ? ~0U : ((1U << e) - 1);
+    mask &= ~((1U << c) - 1);
+
+    while (h--)
+	video_dirty[y++] |= mask;
+}
+
+
+/* Mark a set of columns of one row of buffer32 as changed. */
+void
+video_dirty_line(int y, uint32_t mask)
+{
+    if ((y >= 0) && (y < 2048))
+	video_dirty[y] |= mask;
+}
+
+
+/* Have the next blit send the entire frame. */
+void
+video_dirty_all(void)
+{
+    video_dirty_full = 1;
+}
+
+
+/* Get the dirty columns of the band starting at frame row yy. */
+static uint32_t
+video_blit_band(int yy, int *ye)
+{
+    uint32_t mask = 0;
+    int row;
+
+    *ye = yy + VIDEO_TILE_H - ((yy - blit_data.y1) % VIDEO_TILE_H);
+    if (*ye > blit_data.y2)
+	*ye = blit_data.y2;
+
+    for (; yy < *ye; yy++) {
+	row = blit_data.y + yy;
+	if ((row >= 0) && (row < 2048))
+		mask |= blit_dirty[row];
+    }
+
+    return(mask);
+}
+
+
+/*
+ * Get the next dirty rectangle of the frame being blitted.
+ *
+ * Backends call this with *pos set to zero, and then keep calling it
+ * for as long as it returns 1.  The rectangle is in frame coordinates,
+ * the same ones the blit function gets its y1..y2 and w in, and it is
+ * made of whole tiles (clipped to the frame.)  Runs of bands with the
+ * same set of dirty columns are merged into a single rectangle.
+ */
+int
+video_blit_dirty(int *pos, int *rx, int *ry, int *rw, int *rh)
 {
+    uint32_t cols, mask, next;
+    int yy, ye, c, e, l, r;
+
+    /* The columns that overlap the frame. */
+    c = blit_data.x / VIDEO_TILE_W;
+    e = (blit_data.x + blit_data.w + VIDEO_TILE_W - 1) / VIDEO_TILE_W;
+    if (c < 0) c = 0;
+    cols = (e >= 32) ? ~0U : ((1U << e) - 1);
+    cols &= ~((1U << c) - 1);
+
+    yy = blit_data.y1 + (*pos >> 6);
+    c = *pos & 63;
+
+    while (yy < blit_data.y2) {
+	/* Grow the band for as long as the next one looks the same. */
+	mask = video_blit_band(yy, &ye) & cols;
+	while (ye < blit_data.y2) {
+		next = video_blit_band(ye, &e) & cols;
+		if (next != mask) break;
+		ye = e;
+	}
+
+	/* Find the next run of dirty columns in it. */
+	while ((c < 32) && !(mask & (1U << c)))
+		c++;
+	if (c < 32) {
+		e = c;
+		while ((e < 32) && (mask & (1U << e)))
+			e++;
+
+		l = (c * VIDEO_TILE_W) - blit_data.x;
+		r = (e * VIDEO_TILE_W) - blit_data.x;
+		if (l < 0) l = 0;
+		if (r > blit_data.w) r = blit_data.w;
+
+		*rx = l;
+		*ry = yy;
+		*rw = r - l;
+		*rh = ye - yy;
+		*pos = ((yy - blit_data.y1) << 6) | e;
+
+		return(1);
+	}
+
+	yy = ye;
+	c = 0;
+    }
+
+    return(0);
+}
+
+
+/* Hand the frame and its dirty tiles to the blitter. */
+void
+video_blit_memtoscreen_dirty(int x, int y, int y1, int y2, int w, int h)
+{
+    int yy;
+
     if (h <= 0) return;
 
     video_wait_for_blit();
 
+    if (video_dirty_full) {
+	video_dirty_full = 0;
+	memset(video_dirty, 0xff, sizeof(video_dirty));
+    }
+    memcpy(blit_dirty, video_dirty, sizeof(blit_dirty));
+
+    /* Only the rows that go out now are done with. */
+    for (yy = y + y1; yy < (y + y2); yy++) {
+	if ((yy >= 0) && (yy < 2048))
+		video_dirty[yy] = 0;
+    }
+
     blit_data.busy = 1;
     blit_data.buffer_in_use = 1;
     blit_data.x = x;
@@ -293,6 +464,15 @@ video_blit_memtoscreen(int x, int y, int y1, int y2, int w, int h)
 }
 
 
+void
+video_blit_memtoscreen(int x, int y, int y1, int y2, int w, int h)
+{
+    video_dirty_full = 1;
+
+    video_blit_memtoscreen_dirty(x, y, y1, y2, w, h);
+}
+
+
 void
 video_blit_memtoscreen_8(int x, int y, int y1, int y2, int w, int h)
 {
@@ -668,6 +848,26 @@ video_init(void)
 }
 
 
+/*
+ * Restart the blitter in a forked child process.
+ *
+ * Only the forking thread survives a fork(), so the child has
+ * to create a new blitter thread (and fresh events for it, as
+ * the old ones may still count the lost thread as a waiter.)
+ */
+void
+video_blit_restart(void)
+{
+    blit_data.busy = 0;
+    blit_data.buffer_in_use = 0;
+
+    blit_data.wake_blit_thread = thread_create_event();
+    blit_data.blit_complete = thread_create_event();
+    blit_data.buffer_not_in_use = thread_create_event();
+    blit_data.blit_thread = thread_create(blit_thread, NULL);
+}
+
+
 void
 video_close(void)
 {
@@ -717,7 +917,8 @@ loadfont(const wchar_t *s, int format)
 
     f = plat_fopen(rom_path(s), L"rb");
     if (f == NULL) {
-	pclog("VIDEO: cannot load font '%ls', fmt=%d\n", s, format);
+	pclog_lvl(PCLOG_CAT_VIDEO, PCLOG_ERROR,
+		"VIDEO: cannot load font '%ls', fmt=%d\n", s, format);
 	return;
     }
 
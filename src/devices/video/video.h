@@ -8,7 +8,7 @@
  *
  *		Definitions for the video controller module.
  *
- * Version:	@(#)video.h	1.0.17	2018/08/25
+ * Version:	@(#)video.h	1.0.19	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -43,6 +43,10 @@
 #define FONT_ATIKOR_PATH	L"video/ati/ati28800/ati_ksc5601.rom"
 
 
+/* Size of a tile in the dirty-tile map, 32 of them span a row. */
+#define VIDEO_TILE_W	64
+#define VIDEO_TILE_H	16
+
 #define makecol(r, g, b)    ((b) | ((g) << 8) | ((r) << 16))
 #define makecol32(r, g, b)  ((b) | ((g) << 8) | ((r) << 16))
 
@@ -243,6 +247,11 @@ extern int 	video_is_ega_vga(void);
 extern void	video_setblit(void(*blit)(int,int,int,int,int,int));
 extern void	video_blit_memtoscreen(int x, int y, int y1, int y2, int w, int h);
 extern void	video_blit_memtoscreen_8(int x, int y, int y1, int y2, int w, int h);
+extern void	video_blit_memtoscreen_dirty(int x, int y, int y1, int y2, int w, int h);
+extern int	video_blit_dirty(int *pos, int *x, int *y, int *w, int *h);
+extern void	video_dirty_mark(int x, int y, int w, int h);
+extern void	video_dirty_line(int y, uint32_t mask);
+extern void	video_dirty_all(void);
 extern void	video_blit_complete(void);
 extern void	video_wait_for_blit(void);
 extern void	video_wait_for_buffer(void);
@@ -255,6 +264,7 @@ extern void	updatewindowsize(int x, int y);
 
 extern void	video_init(void);
 extern void	video_close(void);
+extern void	video_blit_restart(void);
 extern void	video_reset(void);
 extern uint8_t	video_force_resize_get(void);
 extern void	video_force_resize_set(uint8_t res);
@@ -8,7 +8,7 @@
  *
  *		Main include file for the application.
  *
- * Version:	@(#)emu.h	1.0.31	2018/09/01
+ * Version:	@(#)emu.h	1.0.42	2018/09/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -80,6 +80,49 @@
 #define ABS(x)		((x) > 0 ? (x) : -(x))
 
 
+/* Logging levels. A plain pclog() logs at PCLOG_INFO, in PCLOG_CAT_OTHER. */
+#define PCLOG_ERROR	0
+#define PCLOG_WARNING	1
+#define PCLOG_INFO	2
+#define PCLOG_DEBUG	3
+
+/* Messages above this level are not even compiled in. */
+#ifndef PCLOG_LEVEL_MAX
+# ifdef RELEASE_BUILD
+#  define PCLOG_LEVEL_MAX	-1
+# else
+#  define PCLOG_LEVEL_MAX	PCLOG_DEBUG
+# endif
+#endif
+
+/* Logging categories, one bit each. */
+#define PCLOG_CAT_EMU		0x0001		/* config, state, ROMs */
+#define PCLOG_CAT_CPU		0x0002
+#define PCLOG_CAT_MACHINE	0x0004
+#define PCLOG_CAT_DISK		0x0008
+#define PCLOG_CAT_VIDEO		0x0010
+#define PCLOG_CAT_SOUND		0x0020
+#define PCLOG_CAT_NET		0x0040
+#define PCLOG_CAT_DEV		0x0080		/* ports, printers, other */
+#define PCLOG_CAT_UI		0x0100
+#define PCLOG_CAT_OTHER		0x0200		/* plain pclog() */
+#define PCLOG_CAT_ALL		0xffff
+
+/* Messages in other categories are not even compiled in. */
+#ifndef PCLOG_CATEGORIES
+# define PCLOG_CATEGORIES	PCLOG_CAT_ALL
+#endif
+
+/* Check the category and level before formatting anything. */
+#define pclog_lvl(cat, lvl, ...) \
+	do { \
+		if (((cat) & PCLOG_CATEGORIES) && \
+		    ((lvl) <= PCLOG_LEVEL_MAX) && \
+		    ((lvl) <= log_level) && ((cat) & log_categories)) \
+			pclog_level((lvl), __VA_ARGS__); \
+	} while (0)
+
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -96,7 +139,23 @@ extern int	video_fps;			/* (O) render speed in fps */
 #endif
 extern int	config_ro;			/* (O) dont modify cfg file */
 extern int	settings_only;			/* (O) only the settings dlg */
+extern int	unthrottled;			/* (O) run as fast as possible */
+extern int	bench_secs;			/* (O) run benchmark for N secs */
+extern int	cpu_prof_rate;			/* (O) profiler samples per sec */
+extern int	cpu_prof_blocks;		/* (O) profiler times dynarec */
+extern int	worker_inline;			/* (O) run device jobs inline */
+extern int	log_level;			/* (O) log messages up to level */
+extern int	log_categories;			/* (O) log these categories */
 extern wchar_t	log_path[1024];			/* (O) full path of logfile */
+#ifdef USE_DYNAREC
+extern wchar_t	tcache_path[1024];		/* (O) recompiler block cache */
+#endif
+extern wchar_t	state_load_path[1024];		/* (O) restore state from */
+extern wchar_t	state_save_path[1024];		/* (O) save state on exit */
+#ifndef _WIN32
+extern int	fork_count;			/* (O) fork N child runs */
+extern int	fork_id;			/* child run number, or 0 */
+#endif
 
 
 /* Configuration variables. */
@@ -112,6 +171,7 @@ extern int	vid_api,			/* (C) video renderer */
 		vid_fullscreen_scale,		/* (C) video */
 		vid_grayscale,			/* (C) video */
 		vid_graytype,			/* (C) video */
+		vid_render_thread,		/* (C) render in background */
 		invert_display,			/* (C) invert the display */
 		suppress_overscan,		/* (C) suppress overscans */
 		scale,				/* (C) screen scale factor */
@@ -147,6 +207,7 @@ extern int	mem_size;			/* (C) memory size */
 extern int	cpu_manufacturer,		/* (C) cpu manufacturer */
 		cpu,				/* (C) cpu type */
 		cpu_use_dynarec,		/* (C) cpu uses/needs Dyna */
+		cpu_fast_interp,		/* (C) block-batched interp */
 		enable_external_fpu;		/* (C) enable external FPU */
 extern int	network_type;			/* (C) net provider type */
 extern int	network_card;			/* (C) net interface num */
@@ -175,7 +236,11 @@ extern int	config_changed;			/* config has changed */
 extern void		pclog_ex(const char *fmt, va_list);
 #endif
 extern void		pclog(const char *fmt, ...);
+extern void		pclog_level(int level, const char *fmt, ...);
 extern void		pclog_repeat(int enabled);
+extern void		pclog_start(void);
+extern void		pclog_stop(void);
+extern void		pclog_flush(void);
 extern void		pclog_dump(int num);
 extern void		fatal(const char *fmt, ...);
 extern void		pc_version(const char *platform);
@@ -187,6 +252,9 @@ extern void		pc_reset_hard_close(void);
 extern void		pc_reset_hard_init(void);
 extern void		pc_reset_hard(void);
 extern void		pc_reset(int hard);
+#ifndef _WIN32
+extern void		pc_fork_child(int id);
+#endif
 extern void		pc_reload(const wchar_t *fn);
 extern void		pc_full_speed(void);
 extern void		pc_speed_changed(void);
@@ -0,0 +1,450 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Handle the logging of (debug) information.
+ *
+ *		Once the emulator is running, log messages are formatted
+ *		into a ring of slots, and a background thread writes them
+ *		out to the logfile. Any thread can log; slots are claimed
+ *		without locks, so logging never waits for the disk. If the
+ *		ring is full, the message is dropped and counted, and the
+ *		count is logged when there is room again.
+ *
+ *		Before the thread is started (and after it is stopped),
+ *		messages are written out directly, as they always were.
+ *
+ *		To avoid excessively-large logfiles because some module
+ *		repeatedly logs, the writer keeps track of what is being
+ *		logged, and catches repeating entries. Turning this off
+ *		and on goes through the ring as well, so that it applies
+ *		to the messages logged in between, and only the writer
+ *		ever looks at the repeat state.
+ *
+ *		Messages logged with a plain pclog() have no category of
+ *		their own, they are all in PCLOG_CAT_OTHER.
+ *
+ * Version:	@(#)log.c	1.0.3	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2017,2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <wchar.h>
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+#define HAVE_STDARG_H
+#include "emu.h"
+#include "plat.h"
+
+
+/*
+ * Note: we need fairly large buffers here, to allow
+ *       for the network code dumping packet content
+ *       with this.
+ */
+#define PCLOG_BUFF_SIZE	8192			/* has to be big enough!! */
+
+#define LOG_SLOTS	4096			/* must be a power of 2 */
+#define LOG_CHUNK	248			/* text bytes per slot */
+#define LOG_WAIT	20			/* flush at least every N ms */
+
+
+#ifdef _MSC_VER
+# define CAS(p,o,n)	(_InterlockedCompareExchange((volatile long *)(p), \
+						(long)(n), (long)(o)) == (long)(o))
+# define INC(p)		_InterlockedIncrement((volatile long *)(p))
+# define BARRIER()	_ReadWriteBarrier()
+#else
+# define CAS(p,o,n)	__sync_bool_compare_and_swap((p), (o), (n))
+# define INC(p)		__sync_fetch_and_add((p), 1)
+# define BARRIER()	__sync_synchronize()
+#endif
+
+
+/*
+ * A message takes one or more consecutive slots. A slot at ring
+ * position 'pos' is free when its 'seq' equals pos, and holds a
+ * message when it equals pos+1. The writer frees it again by
+ * setting it to pos+LOG_SLOTS, which is where it is next used.
+ *
+ * A slot with no text is a pclog_repeat() call, with the new
+ * setting in the first byte of the text.
+ */
+typedef struct {
+    volatile uint32_t seq;
+    uint16_t	nslots;				/* slots in this message */
+    uint16_t	len;				/* bytes in this slot */
+    char	text[LOG_CHUNK];
+} logslot_t;
+
+
+#ifndef RELEASE_BUILD
+static int	pclog_seen = 0;
+static int	pclog_detect = 1;
+
+static logslot_t ring[LOG_SLOTS];
+static volatile uint32_t ring_head,		/* next position to claim */
+		ring_tail,			/* next position to write */
+		ring_lost;			/* messages dropped */
+static volatile int log_running = 0,
+		log_quit;
+static thread_t	*log_thread;
+static event_t	*log_wake,
+		*log_empty;
+#endif
+
+
+#ifndef RELEASE_BUILD
+static void
+log_open(void)
+{
+    if (stdlog != NULL) return;
+
+    if (log_path[0] != L'\0') {
+	stdlog = plat_fopen(log_path, L"w");
+	if (stdlog != NULL) return;
+    }
+
+#ifdef _WIN32
+    stdlog = stdout;
+#else
+    stdlog = stderr;
+#endif
+}
+
+
+/* Write out one message, unless it is a repeat of the previous one. */
+static void
+log_output(const char *msg)
+{
+    static char buff[PCLOG_BUFF_SIZE];
+
+    if (pclog_detect && !strcmp(buff, msg)) {
+	pclog_seen++;
+	return;
+    }
+
+    if (pclog_seen)
+	fprintf(stdlog, "*** %d repeats ***\n", pclog_seen);
+    pclog_seen = 0;
+
+    strcpy(buff, msg);
+    fputs(msg, stdlog);
+}
+
+
+/* Write out all messages in the ring. Returns 1 if there were any. */
+static int
+log_drain(void)
+{
+    char temp[PCLOG_BUFF_SIZE];
+    logslot_t *s;
+    uint32_t lost;
+    int i, n, len;
+
+    if (ring_lost != 0) {
+	/* Only we ever clear it, so this cannot lose a count. */
+	do {
+		lost = ring_lost;
+	} while (! CAS(&ring_lost, lost, 0));
+
+	fprintf(stdlog, "*** %u messages lost ***\n", lost);
+    }
+
+    s = &ring[ring_tail & (LOG_SLOTS - 1)];
+    if (s->seq != (ring_tail + 1)) return(0);
+
+    do {
+	BARRIER();
+
+	n = s->nslots;
+	if (s->len == 0) {
+		pclog_detect = s->text[0];
+		pclog_seen = 0;
+	} else {
+		for (i = len = 0; i < n; i++) {
+			s = &ring[(ring_tail + i) & (LOG_SLOTS - 1)];
+
+			/* The first slot is published last, so this is done. */
+			memcpy(&temp[len], s->text, s->len);
+			len += s->len;
+		}
+		temp[len] = '\0';
+
+		log_output(temp);
+	}
+
+	/* Free the slots for their next round. */
+	for (i = 0; i < n; i++) {
+		s = &ring[(ring_tail + i) & (LOG_SLOTS - 1)];
+		s->seq = ring_tail + i + LOG_SLOTS;
+	}
+	ring_tail += n;
+
+	s = &ring[ring_tail & (LOG_SLOTS - 1)];
+    } while (s->seq == (ring_tail + 1));
+
+    return(1);
+}
+
+
+static void
+log_writer(void *param)
+{
+    while (! log_quit) {
+	thread_wait_event(log_wake, LOG_WAIT);
+
+	log_open();
+
+	/* One flush per round, not one per message. */
+	if (log_drain())
+		fflush(stdlog);
+
+	thread_set_event(log_empty);
+    }
+
+    (void)log_drain();
+    fflush(stdlog);
+}
+
+
+/*
+ * Put a message into the ring, or with 'len' 0, a change of the
+ * repeat detection to msg[0]. Returns 0 if there was no room.
+ */
+static int
+log_queue(const char *msg, int len)
+{
+    logslot_t *s;
+    uint32_t pos, last;
+    int i, n;
+
+    n = (len > 0) ? ((len + LOG_CHUNK - 1) / LOG_CHUNK) : 1;
+
+    /*
+     * Claim 'n' slots. The writer frees slots in order, so if
+     * the last one is free, so are the ones before it.
+     */
+    pos = ring_head;
+    for (;;) {
+	last = pos + n - 1;
+	s = &ring[last & (LOG_SLOTS - 1)];
+
+	i = (int)(s->seq - last);
+	if (i == 0) {
+		if (CAS(&ring_head, pos, pos + n)) break;
+		pos = ring_head;
+	} else if (i < 0) {
+		/* Ring is full. */
+		if (len > 0)
+			INC(&ring_lost);
+		return(0);
+	} else
+		pos = ring_head;
+    }
+
+    for (i = 0; i < n; i++) {
+	s = &ring[(pos + i) & (LOG_SLOTS - 1)];
+	s->nslots = n;
+	s->len = (len > LOG_CHUNK) ? LOG_CHUNK : len;
+	memcpy(s->text, msg, (len > 0) ? s->len : 1);
+	msg += s->len;
+	len -= s->len;
+    }
+
+    /* Publish the slots, the first one last. */
+    BARRIER();
+    for (i = n - 1; i >= 0; i--)
+	ring[(pos + i) & (LOG_SLOTS - 1)].seq = pos + i + 1;
+
+    /* Do not let the ring fill up before the next round. */
+    if ((pos + n - ring_tail) > (LOG_SLOTS / 2))
+	thread_set_event(log_wake);
+
+    return(1);
+}
+#endif
+
+
+/* Log something. We only do this in non-release builds. */
+void
+pclog_ex(const char *fmt, va_list ap)
+{
+#ifndef RELEASE_BUILD
+    char temp[PCLOG_BUFF_SIZE];
+    int len;
+
+    len = vsnprintf(temp, sizeof(temp), fmt, ap);
+    if (len <= 0) return;
+    if (len >= (int)sizeof(temp))
+	len = sizeof(temp) - 1;
+
+    if (log_running) {
+	(void)log_queue(temp, len);
+	return;
+    }
+
+    log_open();
+    log_output(temp);
+    fflush(stdlog);
+#endif
+}
+
+
+void
+pclog(const char *fmt, ...)
+{
+#ifndef RELEASE_BUILD
+    va_list ap;
+
+    if (! (PCLOG_CATEGORIES & log_categories & PCLOG_CAT_OTHER)) return;
+    if (log_level < PCLOG_INFO) return;
+
+    va_start(ap, fmt);
+    pclog_ex(fmt, ap);
+    va_end(ap);
+#endif
+}
+
+
+/* Log something at the given level. Use the pclog_lvl() macro. */
+void
+pclog_level(int level, const char *fmt, ...)
+{
+#ifndef RELEASE_BUILD
+    va_list ap;
+
+    if (level > log_level) return;
+
+    va_start(ap, fmt);
+    pclog_ex(fmt, ap);
+    va_end(ap);
+#endif
+}
+
+
+/* Enable or disable detection of repeated info being logged. */
+void
+pclog_repeat(int enabled)
+{
+#ifndef RELEASE_BUILD
+    char c = (char)enabled;
+
+    if (log_running) {
+	/* Wait for room, it must not get lost. */
+	while (! log_queue(&c, 0)) {
+		thread_set_event(log_wake);
+		thread_wait_event(log_empty, 10);
+	}
+	return;
+    }
+
+    pclog_detect = enabled;
+    pclog_seen = 0;
+#endif
+}
+
+
+/*
+ * Start the log writer thread.
+ *
+ * This is also used in a forked child, which inherits the state
+ * of its parent, but not its writer thread.
+ */
+void
+pclog_start(void)
+{
+#ifndef RELEASE_BUILD
+    int i;
+
+    for (i = 0; i < LOG_SLOTS; i++)
+	ring[i].seq = i;
+    ring_head = ring_tail = 0;
+    ring_lost = 0;
+
+    log_quit = 0;
+    log_wake = thread_create_event();
+    log_empty = thread_create_event();
+    log_thread = thread_create(log_writer, NULL);
+
+    log_running = 1;
+#endif
+}
+
+
+/* Stop the writer thread, after it wrote out everything. */
+void
+pclog_stop(void)
+{
+#ifndef RELEASE_BUILD
+    if (! log_running) return;
+
+    /* Keep queueing until the writer is gone, it drains on the way out. */
+    log_quit = 1;
+    thread_set_event(log_wake);
+    thread_wait(log_thread, -1);
+    log_thread = NULL;
+
+    log_running = 0;
+
+    /* Pick up whatever got queued after the writer's last round. */
+    log_open();
+    if (log_drain())
+	fflush(stdlog);
+
+    thread_destroy_event(log_empty);
+    thread_destroy_event(log_wake);
+#endif
+}
+
+
+/* Wait until everything logged so far is written out. */
+void
+pclog_flush(void)
+{
+#ifndef RELEASE_BUILD
+    int i;
+
+    if (log_running) {
+	/* Do not hang forever if the writer is stuck. */
+	for (i = 0; i < 100; i++) {
+		if (ring_tail == ring_head) break;
+
+		thread_set_event(log_wake);
+		thread_wait_event(log_empty, 10);
+	}
+    }
+
+    if (stdlog != NULL)
+	fflush(stdlog);
+#endif
+}
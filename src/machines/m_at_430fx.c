@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel 430FX PCISet chip.
  *
- * Version:	@(#)m_at_430fx.c	1.0.12	2018/05/06
+ * Version:	@(#)m_at_430fx.c	1.0.13	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -44,6 +44,7 @@
 #include "../mem.h"
 #include "../rom.h"
 #include "../device.h"
+#include "../state.h"
 #include "../devices/system/pci.h"
 #include "../devices/system/memregs.h"
 #include "../devices/system/intel_piix.h"
@@ -217,6 +218,7 @@ static void i430fx_pci_reset(void)
 static void i430fx_init(void)
 {
         pci_add_card(0, i430fx_read, i430fx_write, NULL);
+	state_add("i430fx", card_i430fx, sizeof(card_i430fx));
 
 	i430fx_reset();
         
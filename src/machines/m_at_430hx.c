@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel 430HX PCISet chip.
  *
- * Version:	@(#)m_at_430hx.c	1.0.6	2018/05/06
+ * Version:	@(#)m_at_430hx.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -44,6 +44,7 @@
 #include "../io.h"
 #include "../mem.h"
 #include "../device.h"
+#include "../state.h"
 #include "../devices/system/memregs.h"
 #include "../devices/system/pci.h"
 #include "../devices/system/intel_piix.h"
@@ -203,6 +204,7 @@ static void i430hx_pci_reset(void)
 static void i430hx_init(void)
 {
         pci_add_card(0, i430hx_read, i430hx_write, NULL);
+	state_add("i430hx", card_i430hx, sizeof(card_i430hx));
 
 	i430hx_reset();
 
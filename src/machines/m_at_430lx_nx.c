@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel 430LX and 430NX PCISet chips.
  *
- * Version:	@(#)m_at_430lx_nx.c	1.0.6	2018/05/06
+ * Version:	@(#)m_at_430lx_nx.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -44,6 +44,7 @@
 #include "../mem.h"
 #include "../rom.h"
 #include "../device.h"
+#include "../state.h"
 #include "../devices/system/pci.h"
 #include "../devices/system/memregs.h"
 #include "../devices/system/intel.h"
@@ -213,6 +214,7 @@ static void i430lx_nx_pci_reset(void)
 static void i430lx_init(void)
 {
         pci_add_card(0, i430lx_nx_read, i430lx_nx_write, NULL);
+	state_add("i430lx_nx", card_i430_lx_nx, sizeof(card_i430_lx_nx));
 
 	i430lx_reset();
 
@@ -223,6 +225,7 @@ static void i430lx_init(void)
 static void i430nx_init(void)
 {
         pci_add_card(0, i430lx_nx_read, i430lx_nx_write, NULL);
+	state_add("i430lx_nx", card_i430_lx_nx, sizeof(card_i430_lx_nx));
 
 	i430nx_reset();
 
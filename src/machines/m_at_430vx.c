@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel 430VX PCISet chip.
  *
- * Version:	@(#)m_at_430vx.c	1.0.5	2018/05/06
+ * Version:	@(#)m_at_430vx.c	1.0.6	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -44,6 +44,7 @@
 #include "../io.h"
 #include "../mem.h"
 #include "../device.h"
+#include "../state.h"
 #include "../devices/system/pci.h"
 #include "../devices/system/memregs.h"
 #include "../devices/system/intel_piix.h"
@@ -205,6 +206,7 @@ static void i430vx_pci_reset(void)
 void i430vx_init(void)
 {
 	pci_add_card(0, i430vx_read, i430vx_write, NULL);
+	state_add("i430vx", card_i430vx, sizeof(card_i430vx));
 
 	i430vx_reset();
 
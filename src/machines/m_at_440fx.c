@@ -8,7 +8,7 @@
  *
  *		Implementation of the Intel 440FX PCISet chip.
  *
- * Version:	@(#)m_at_440fx.c	1.0.6	2018/05/06
+ * Version:	@(#)m_at_440fx.c	1.0.7	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -44,6 +44,7 @@
 #include "../io.h"
 #include "../mem.h"
 #include "../device.h"
+#include "../state.h"
 #include "../devices/system/pci.h"
 #include "../devices/system/memregs.h"
 #include "../devices/system/intel_piix.h"
@@ -207,6 +208,7 @@ static void i440fx_pci_reset(void)
 static void i440fx_init(void)
 {
 	pci_add_card(0, i440fx_read, i440fx_write, NULL);
+	state_add("i440fx", card_i440fx, sizeof(card_i440fx));
 
 	i440fx_reset();
 
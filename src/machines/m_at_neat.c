@@ -13,7 +13,7 @@
  *		8MB of DRAM chips', because it works fine with bus-based
  *		memory expansion.
  *
- * Version:	@(#)m_at_neat.c	1.0.1	2018/07/22
+ * Version:	@(#)m_at_neat.c	1.0.2	2018/07/22
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -842,7 +842,8 @@ neat_init(void)
 		break;
 
 	default:
-		pclog("NEAT: **INVALID DRAM SIZE %iKB !**\n", mem_size);
+		pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_WARNING,
+			"NEAT: **INVALID DRAM SIZE %iKB !**\n", mem_size);
     }
     if (i > 0)
 	pclog("NEAT: using DRAM mode #%i (mem=%iKB)\n", i, mem_size);
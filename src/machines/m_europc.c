@@ -66,7 +66,7 @@
  *				bit 1: b8000 memory available
  *		  0000:046a:	00 jim 250 01 jim 350
  *
- * Version:	@(#)m_europc.c	1.0.16	2018/08/27
+ * Version:	@(#)m_europc.c	1.0.17	2018/08/27
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -478,7 +478,8 @@ jim_write(uint16_t addr, uint8_t val, void *priv)
 		break;
 
 	default:
-		pclog("EuroPC: invalid JIM write %02x, val %02x\n", addr, val);
+		pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_WARNING,
+			"EuroPC: invalid JIM write %02x, val %02x\n", addr, val);
 		break;
     }
 }
@@ -525,7 +526,8 @@ jim_read(uint16_t addr, void *priv)
 		break;
 
 	default:
-		pclog("EuroPC: invalid JIM read %02x\n", addr);
+		pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_WARNING,
+			"EuroPC: invalid JIM read %02x\n", addr);
 		break;
     }
 
@@ -22,7 +22,7 @@
  *		The reserved 384K is remapped to the top of extended memory.
  *		If this is not done then you get an error on startup.
  *
- * Version:	@(#)m_ps1.c	1.0.20	2018/08/20
+ * Version:	@(#)m_ps1.c	1.0.21	2018/08/20
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -474,7 +474,8 @@ ps1_setup(int model, romdef_t *bios)
 		if (! rom_init(&ps->high_rom,
 			       L"machines/ibm/ps1_2011/fc0000_105775_us.bin",
 			       0xfc0000, 0x20000, 0x01ffff, 0, MEM_MAPPING_EXTERNAL)) {
-			pclog("PS1: unable to load ROM Shell !\n");
+			pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_ERROR,
+				"PS1: unable to load ROM Shell !\n");
 		}
 	}
 
@@ -513,7 +514,8 @@ ps1_setup(int model, romdef_t *bios)
 		if (! rom_init(&ps->high_rom,
 			       L"machines/ibm/ps1_2121/fc0000_92f9674.bin",
 			       0xfc0000, 0x20000, 0x1ffff, 0, MEM_MAPPING_EXTERNAL)) {
-			pclog("PS1: unable to load ROM Shell !\n");
+			pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_ERROR,
+				"PS1: unable to load ROM Shell !\n");
 		}
 	}
 
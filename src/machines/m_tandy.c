@@ -8,7 +8,7 @@
  *
  *		Emulation of Tandy models 1000, 1000HX and 1000SL2.
  *
- * Version:	@(#)m_tandy.c	1.0.12	2018/05/06
+ * Version:	@(#)m_tandy.c	1.0.13	2018/05/06
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -1854,7 +1854,8 @@ init_rom(tandy_t *dev)
     if (! rom_load_interleaved(L"machines/tandy1000sl2/8079047.hu1",
 			       L"machines/tandy1000sl2/8079048.hu2",
 			       0x000000, 0x80000, 0, dev->rom)) {
-	pclog("TANDY: unable to load BIOS for 1000/SL2 !\n");
+	pclog_lvl(PCLOG_CAT_MACHINE, PCLOG_ERROR,
+		"TANDY: unable to load BIOS for 1000/SL2 !\n");
 	free(dev->rom);
 	dev->rom = NULL;
 	return;
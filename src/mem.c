@@ -8,11 +8,29 @@
  *
  *		Memory handling and MMU.
  *
+ *		Linear addresses are translated using the per-page arrays
+ *		readlookup2[] and writelookup2[], which hold host pointers
+ *		for pages of RAM and are indexed directly by the readmem
+ *		macros and by recompiled code. These are backed by a small
+ *		set-associative software TLB, which holds the translations
+ *		made by mmutranslatereal() with their permissions, and owns
+ *		the slots filled in the per-page arrays.
+ *
+ *		TLB entries are tagged with a number assigned to each page
+ *		directory (CR3 value) seen, so a task switch back to a recent
+ *		address space finds its translations still there. As the x86
+ *		has no such tags, guests are free to edit page tables that
+ *		are not currently in use, and rely on the CR3 load to flush
+ *		them. Pages used as page tables are therefore marked when
+ *		walked, writes to them are routed through the page handlers,
+ *		and translations made through a written page are dropped at
+ *		the next flush.
+ *
  * NOTE:	Experimenting with dynamically allocated lookup tables;
  *		the DYNAMIC_TABLES=1 enables this. Will eventually go
  *		away, either way...
  *
- * Version:	@(#)mem.c	1.0.20	2018/09/03
+ * Version:	@(#)mem.c	1.0.28	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -55,6 +73,8 @@
 #include "io.h"
 #include "mem.h"
 #include "rom.h"
+#include "plat.h"
+#include "state.h"
 #ifdef USE_DYNAREC
 # include "cpu/codegen.h"
 #else
@@ -67,6 +87,30 @@
 
 #define DYNAMIC_TABLES		0		/* experimental */
 
+#define TLB_SETS		128
+#define TLB_WAYS		4
+#define TLB_SIZE		(TLB_SETS * TLB_WAYS)
+#define TLB_SET(v,a)		((((v) ^ ((a) << 4)) & (TLB_SETS-1)) * TLB_WAYS)
+#define TLB_ASIDS		8		/* address spaces kept */
+#define TLB_ASID_PHYS		0		/* paging disabled */
+#define TLB_DIRTY_MAX		16		/* written page tables kept */
+
+#define TLB_VALID		0x01		/* translation is usable */
+#define TLB_WRITE		0x02		/* page is writable (PTE R/W) */
+#define TLB_USER		0x04		/* page is user (PTE U/S) */
+#define TLB_DIRTY		0x08		/* PTE dirty bit already set */
+#define TLB_L1_READ		0x10		/* owns readlookup2 slot */
+#define TLB_L1_WRITE		0x20		/* owns writelookup2 slot */
+
+
+typedef struct {
+    uint32_t	vpage,				/* linear page number */
+		phys,				/* physical page address */
+		pt;				/* page table it came from */
+    uint8_t	asid,				/* address space number */
+		flags;				/* TLB_xxx, 0 if unused */
+} tlb_t;
+
 
 mem_mapping_t		base_mapping,
 			ram_low_mapping,	/* 0..640K mapping */
@@ -93,13 +137,7 @@ uint32_t		biosmask;
 uint32_t		pccache;
 uint8_t			*pccache2;
 
-int			readlnext;
-int			readlookup[256],
-			readlookupp[256];
 uintptr_t		*readlookup2;
-int			writelnext;
-int			writelookup[256],
-			writelookupp[256];
 uintptr_t		*writelookup2;
 
 uint32_t		mem_logical_addr;
@@ -109,7 +147,6 @@ int			shadowbios = 0,
 int			readlnum = 0,
 			writelnum = 0;
 int			pctrans = 0;
-int			cachesize = 256;
 
 uint32_t		ram_mapped_addr[64];
 
@@ -124,30 +161,282 @@ int			mmuflush = 0;
 int			mmu_perm = 4;
 
 
-/* FIXME: re-do this with a 'mem_ops' struct. */
-static uint8_t		(*_mem_read_b[0x40000])(uint32_t addr, void *priv);
-static uint16_t		(*_mem_read_w[0x40000])(uint32_t addr, void *priv);
-static uint32_t		(*_mem_read_l[0x40000])(uint32_t addr, void *priv);
-static void		(*_mem_write_b[0x40000])(uint32_t addr, uint8_t  val, void *priv);
-static void		(*_mem_write_w[0x40000])(uint32_t addr, uint16_t val, void *priv);
-static void		(*_mem_write_l[0x40000])(uint32_t addr, uint32_t val, void *priv);
-static uint8_t		*_mem_exec[0x40000];
-static void		*_mem_priv_r[0x40000];
-static void		*_mem_priv_w[0x40000];
+/*
+ * Each 16K chunk of the address space has a pointer to the mapping
+ * handling reads from it, and one to the mapping handling writes to
+ * it. The mapping carries the handlers and their private data, so a
+ * chunk without one points to an empty mapping instead of to NULL.
+ */
+static mem_mapping_t	mem_mapping_none;
 static mem_mapping_t	*_mem_mapping_r[0x40000];
 static mem_mapping_t	*_mem_mapping_w[0x40000];
-static int		_mem_state[0x40000];
+static uint8_t		*_mem_exec[0x40000];
+static uint8_t		_mem_state[0x40000];
+
+static mem_mapping_t	**recalc_maps;
+static int		recalc_maps_sz;
+
+#define MEM_READ(a)	_mem_mapping_r[(a) >> 14]
+#define MEM_WRITE(a)	_mem_mapping_w[(a) >> 14]
 
 static uint8_t		ff_pccache[4] = { 0xff, 0xff, 0xff, 0xff };
 
 static int		port_92_reg = 0;
+static uint32_t		ram_size;		/* size of RAM block */
 
+static tlb_t		tlb[TLB_SIZE];
+static uint8_t		tlb_next[TLB_SETS];
+static uint32_t		tlb_asid_cr3[TLB_ASIDS];
+static int		tlb_asid,
+			tlb_asid_next;
+static uint32_t		tlb_cr4;
+static uint32_t		tlb_pt_gen = 1;
+static uint32_t		tlb_dirty_pt[TLB_DIRTY_MAX];
+static int		tlb_dirty_cnt;		/* > TLB_DIRTY_MAX: overflow */
 
-void
-resetreadlookup(void)
+
+/* Release the per-page array slots owned by a TLB entry. */
+static void
+tlb_clear_l1(tlb_t *e)
+{
+    if (e->flags & TLB_L1_READ)
+	readlookup2[e->vpage] = -1;
+
+    if (e->flags & TLB_L1_WRITE) {
+	writelookup2[e->vpage] = -1;
+	page_lookup[e->vpage] = NULL;
+    }
+
+    e->flags &= ~(TLB_L1_READ | TLB_L1_WRITE);
+}
+
+
+/* Release all per-page array slots. Entries without a translation go. */
+static void
+tlb_flush_l1(void)
 {
+    tlb_t *e;
+
+    for (e = tlb; e < &tlb[TLB_SIZE]; e++) {
+	if (e->flags & (TLB_L1_READ | TLB_L1_WRITE))
+		tlb_clear_l1(e);
+	if (! (e->flags & TLB_VALID))
+		e->flags = 0;
+    }
+}
+
+
+static tlb_t *
+tlb_find(uint32_t vpage)
+{
+    tlb_t *e = &tlb[TLB_SET(vpage, tlb_asid)];
+    int c;
+
+    for (c = 0; c < TLB_WAYS; c++, e++) {
+	if (e->flags && e->vpage == vpage && e->asid == tlb_asid)
+		return(e);
+    }
+
+    return(NULL);
+}
+
+
+/* Find or allocate the entry for a page in the current address space. */
+static tlb_t *
+tlb_get(uint32_t vpage)
+{
+    int set = TLB_SET(vpage, tlb_asid);
+    tlb_t *e;
     int c;
 
+    e = tlb_find(vpage);
+    if (e != NULL) return(e);
+
+    for (c = 0; c < TLB_WAYS; c++) {
+	if (! tlb[set + c].flags) {
+		e = &tlb[set + c];
+		break;
+	}
+    }
+
+    if (e == NULL) {
+	c = set / TLB_WAYS;
+	e = &tlb[set + tlb_next[c]];
+	tlb_next[c] = (tlb_next[c] + 1) & (TLB_WAYS - 1);
+	tlb_clear_l1(e);
+    }
+
+    e->vpage = vpage;
+    e->phys = e->pt = 0;
+    e->asid = tlb_asid;
+    e->flags = 0;
+
+    return(e);
+}
+
+
+/* Drop all translations of an address space. */
+static void
+tlb_drop_asid(int asid)
+{
+    tlb_t *e;
+
+    for (e = tlb; e < &tlb[TLB_SIZE]; e++) {
+	if (e->flags && e->asid == asid) {
+		tlb_clear_l1(e);
+		e->flags = 0;
+	}
+    }
+    seg_cache_flush();
+}
+
+
+static int
+tlb_pt_dirty(uint32_t pt)
+{
+    int c;
+
+    if (tlb_dirty_cnt > TLB_DIRTY_MAX) return(1);
+
+    for (c = 0; c < tlb_dirty_cnt; c++) {
+	if (tlb_dirty_pt[c] == pt) return(1);
+    }
+
+    return(0);
+}
+
+
+/* Was this translation made through a page table written to since? */
+static int
+tlb_stale(tlb_t *e)
+{
+    return(tlb_pt_dirty(e->pt) || tlb_pt_dirty(tlb_asid_cr3[e->asid]));
+}
+
+
+/* Drop the translations made through written page tables. */
+static void
+tlb_drop_dirty(void)
+{
+    tlb_t *e;
+
+    if (! tlb_dirty_cnt) return;
+
+    /* Descriptors may have been read through these translations. */
+    seg_cache_flush();
+
+    for (e = tlb; e < &tlb[TLB_SIZE]; e++) {
+	if ((e->flags & TLB_VALID) && tlb_stale(e)) {
+		tlb_clear_l1(e);
+		e->flags = 0;
+	}
+    }
+
+    /* Lost track, start over with marking page tables. */
+    if (tlb_dirty_cnt > TLB_DIRTY_MAX)
+	tlb_pt_gen++;
+
+    tlb_dirty_cnt = 0;
+}
+
+
+/* Select the address space for the current CR3. */
+static void
+tlb_select(void)
+{
+    uint32_t pd = cr3 & ~0xfff;
+    int c;
+
+    /* Translations made with the other page size setting are useless. */
+    if ((cr4 & CR4_PSE) != tlb_cr4) {
+	tlb_cr4 = cr4 & CR4_PSE;
+	for (c = 1; c < TLB_ASIDS; c++)
+		tlb_drop_asid(c);
+    }
+
+    if (! (cr0 >> 31)) {
+	if (tlb_asid != TLB_ASID_PHYS)
+		seg_cache_flush();
+	tlb_asid = TLB_ASID_PHYS;
+	return;
+    }
+
+    for (c = 1; c < TLB_ASIDS; c++) {
+	if (tlb_asid_cr3[c] == pd) {
+		if (tlb_asid != c)
+			seg_cache_flush();
+		tlb_asid = c;
+		return;
+	}
+    }
+
+    /* Not seen recently, recycle the oldest number. */
+    tlb_asid_next = (tlb_asid_next % (TLB_ASIDS - 1)) + 1;
+    tlb_asid = tlb_asid_next;
+    tlb_drop_asid(tlb_asid);
+    tlb_asid_cr3[tlb_asid] = pd;
+}
+
+
+static void
+tlb_reset(void)
+{
+    int c;
+
+    memset(tlb, 0x00, sizeof(tlb));
+    memset(tlb_next, 0x00, sizeof(tlb_next));
+    for (c = 0; c < TLB_ASIDS; c++)
+	tlb_asid_cr3[c] = 0xffffffff;
+    tlb_asid = TLB_ASID_PHYS;
+    tlb_asid_next = 0;
+    tlb_cr4 = 0;
+    tlb_dirty_cnt = 0;
+    tlb_pt_gen++;
+    seg_cache_flush();
+}
+
+
+/*
+ * Mark a page as holding a page table. Writes to it go through the
+ * page write handlers from now on, so we see them.
+ */
+static void
+tlb_mark_pt(uint32_t pt)
+{
+    tlb_t *e;
+
+    if ((pt >> 12) >= pages_sz) return;
+
+    if (pages[pt >> 12].pt_gen == tlb_pt_gen) return;
+    pages[pt >> 12].pt_gen = tlb_pt_gen;
+
+    for (e = tlb; e < &tlb[TLB_SIZE]; e++) {
+	if ((e->flags & TLB_L1_WRITE) && e->phys == pt) {
+		writelookup2[e->vpage] = -1;
+		page_lookup[e->vpage] = NULL;
+		e->flags &= ~TLB_L1_WRITE;
+	}
+    }
+}
+
+
+/* Called by the page write handlers when a page table is modified. */
+static void
+tlb_pt_write(page_t *p)
+{
+    uint32_t pt = (uint32_t)(p - pages) << 12;
+
+    if (tlb_pt_dirty(pt)) return;
+
+    if (tlb_dirty_cnt < TLB_DIRTY_MAX)
+	tlb_dirty_pt[tlb_dirty_cnt] = pt;
+    tlb_dirty_cnt++;
+}
+
+
+void
+resetreadlookup(void)
+{
     /* This is NULL after app startup, when mem_init() has not yet run. */
 #if DYNAMIC_TABLES
 pclog("MEM: reset_lookup: pages=%08lx, lookup=%08lx, pages_sz=%i\n", pages, page_lookup, pages_sz);
@@ -160,11 +449,8 @@ pclog("MEM: reset_lookup: pages=%08lx, lookup=%08lx, pages_sz=%i\n", pages, page
     memset(page_lookup, 0x00, (1<<20)*sizeof(page_t *));
 #endif
 
-    /* Initialize the tables for lower (<= 1024K) RAM. */
-    for (c = 0; c < 256; c++) {
-	readlookup[c] = 0xffffffff;
-	writelookup[c] = 0xffffffff;
-    }
+    /* Initialize the TLB. */
+    tlb_reset();
 
     /* Initialize the tables for high (> 1024K) RAM. */
 #if DYNAMIC_TABLES
@@ -175,8 +461,6 @@ pclog("MEM: reset_lookup: pages=%08lx, lookup=%08lx, pages_sz=%i\n", pages, page
     memset(writelookup2, 0xff, (1<<20)*sizeof(uintptr_t));
 #endif
 
-    readlnext = 0;
-    writelnext = 0;
     pccache = 0xffffffff;
 }
 
@@ -184,19 +468,9 @@ pclog("MEM: reset_lookup: pages=%08lx, lookup=%08lx, pages_sz=%i\n", pages, page
 void
 flushmmucache(void)
 {
-    int c;
-
-    for (c = 0; c < 256; c++) {
-	if (readlookup[c] != 0xffffffff) {
-		readlookup2[readlookup[c]] = -1;
-		readlookup[c] = 0xffffffff;
-	}
-	if (writelookup[c] != 0xffffffff) {
-		page_lookup[writelookup[c]] = NULL;
-		writelookup2[writelookup[c]] = -1;
-		writelookup[c] = 0xffffffff;
-	}
-    }
+    tlb_flush_l1();
+    tlb_drop_dirty();
+    tlb_select();
     mmuflush++;
 
     pccache = (uint32_t)0xffffffff;
@@ -211,38 +485,26 @@ flushmmucache(void)
 void
 flushmmucache_nopc(void)
 {
-    int c;
+    tlb_flush_l1();
+    tlb_drop_dirty();
+    tlb_select();
 
-    for (c = 0; c < 256; c++) {
-	if (readlookup[c] != 0xffffffff) {
-		readlookup2[readlookup[c]] = -1;
-		readlookup[c] = 0xffffffff;
-	}
-	if (writelookup[c] != 0xffffffff) {
-		page_lookup[writelookup[c]] = NULL;
-		writelookup2[writelookup[c]] = -1;
-		writelookup[c] = 0xffffffff;
-	}
-    }
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
 }
 
 
 void
 flushmmucache_cr3(void)
 {
-    int c;
+    tlb_flush_l1();
+    tlb_drop_dirty();
+    tlb_select();
 
-    for (c = 0; c < 256; c++) {
-	if (readlookup[c] != 0xffffffff) {
-		readlookup2[readlookup[c]] = -1;
-		readlookup[c] = 0xffffffff;
-	}
-	if (writelookup[c] != 0xffffffff) {
-		page_lookup[writelookup[c]] = NULL;
-		writelookup2[writelookup[c]] = -1;
-		writelookup[c] = 0xffffffff;
-	}
-    }
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
 }
 
 
@@ -250,22 +512,46 @@ void
 mem_flush_write_page(uint32_t addr, uint32_t virt)
 {
     page_t *page_target = &pages[addr >> 12];
-    int c;
+    tlb_t *e;
 
-    for (c = 0; c < 256; c++) {
-	if (writelookup[c] != 0xffffffff) {
-		uintptr_t target = (uintptr_t)&ram[(uintptr_t)(addr & ~0xfff) - (virt & ~0xfff)];
+    for (e = tlb; e < &tlb[TLB_SIZE]; e++) {
+	if (! (e->flags & TLB_L1_WRITE)) continue;
 
-		if (writelookup2[writelookup[c]] == target || page_lookup[writelookup[c]] == page_target) {
-			writelookup2[writelookup[c]] = -1;
-			page_lookup[writelookup[c]] = NULL;
-			writelookup[c] = 0xffffffff;
-		}
+	if (e->phys == (addr & ~0xfff) || page_lookup[e->vpage] == page_target) {
+		writelookup2[e->vpage] = -1;
+		page_lookup[e->vpage] = NULL;
+		e->flags &= ~TLB_L1_WRITE;
 	}
     }
 }
 
 
+/* Enter a translation made by walking the page tables. */
+static void
+tlb_add(uint32_t addr, uint32_t phys, uint32_t pt, int perm)
+{
+    tlb_t *e = tlb_get(addr >> 12);
+
+    /*
+     * The page moved, so the old array slots are no good. Descriptors
+     * read through the old translation are only stale if it was valid,
+     * not when a fresh entry gets its first page.
+     */
+    if (e->phys != phys) {
+	if (e->flags & TLB_VALID)
+		seg_cache_flush();
+	tlb_clear_l1(e);
+    }
+
+    e->phys = phys;
+    e->pt = pt;
+    e->flags = (e->flags & (TLB_L1_READ | TLB_L1_WRITE)) | TLB_VALID | perm;
+
+    tlb_mark_pt(cr3 & ~0xfff);
+    tlb_mark_pt(pt);
+}
+
+
 #define mmutranslate_read(addr) mmutranslatereal(addr,0)
 #define mmutranslate_write(addr) mmutranslatereal(addr,1)
 #define rammap(x)	((uint32_t *)(_mem_exec[(x) >> 14]))[((x) >> 2) & 0xfff]
@@ -275,9 +561,32 @@ mmutranslatereal(uint32_t addr, int rw)
 {
     uint32_t temp,temp2,temp3;
     uint32_t addr2;
+    int user, use_tlb;
+    tlb_t *e;
 
     if (cpu_state.abrt) return -1;
 
+    /* Paging gets enabled before CR0 is set, and CR3 can be loaded without a flush. */
+    if (tlb_asid_cr3[tlb_asid] != (cr3 & ~0xfff)) {
+	tlb_flush_l1();
+	tlb_select();
+    }
+    use_tlb = (tlb_asid != TLB_ASID_PHYS);
+
+    if (use_tlb) {
+	e = tlb_find(addr >> 12);
+	if (e != NULL && (e->flags & TLB_VALID) &&
+	    !(tlb_dirty_cnt && tlb_stale(e))) {
+		user = (CPL == 3 && !cpl_override);
+
+		/* Anything else is a fault, or needs the dirty bit set. */
+		if (!(user && !(e->flags & TLB_USER)) &&
+		    !(rw && !(e->flags & TLB_DIRTY)) &&
+		    !(rw && !(e->flags & TLB_WRITE) && (user || (cr0 & WP_FLAG))))
+			return e->phys + (addr & 0xfff);
+	}
+    }
+
     addr2 = ((cr3 & ~0xfff) + ((addr >> 20) & 0xffc));
     temp = temp2 = rammap(addr2);
     if (! (temp&1)) {
@@ -308,6 +617,12 @@ mmutranslatereal(uint32_t addr, int rw)
 	mmu_perm = temp & 4;
 	rammap(addr2) |= 0x20;
 
+	if (use_tlb) {
+		/* The dirty bit is not emulated for 4MB pages. */
+		tlb_add(addr, (temp & ~0x3fffff) + (addr & 0x3ff000),
+			addr2 & ~0xfff, (temp & (TLB_WRITE | TLB_USER)) | TLB_DIRTY);
+	}
+
 	return (temp & ~0x3fffff) + (addr & 0x3fffff);
     }
 
@@ -327,6 +642,12 @@ mmutranslatereal(uint32_t addr, int rw)
     rammap(addr2) |= 0x20;
     rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw?0x60:0x20);
 
+    if (use_tlb) {
+	tlb_add(addr, temp & ~0xfff, temp2 & ~0xfff,
+		(temp3 & (TLB_WRITE | TLB_USER)) |
+		((rw || (temp & 0x40)) ? TLB_DIRTY : 0));
+    }
+
     return (temp&~0xfff)+(addr&0xfff);
 }
 
@@ -367,7 +688,21 @@ mmutranslate_noabrt(uint32_t addr, int rw)
 void
 mmu_invalidate(uint32_t addr)
 {
-    flushmmucache_cr3();
+    tlb_t *e;
+
+    e = tlb_find(addr >> 12);
+    if (e != NULL) {
+	tlb_clear_l1(e);
+	e->flags = 0;
+    }
+
+    /* The guest is done editing its page tables, most likely. */
+    tlb_drop_dirty();
+    seg_cache_flush();
+
+#ifdef USE_DYNAREC
+    codegen_flush();
+#endif
 }
 
 
@@ -395,19 +730,19 @@ mem_addr_translate(uint32_t addr, uint32_t chunk_start, uint32_t len)
 void
 addreadlookup(uint32_t virt, uint32_t phys)
 {
+    tlb_t *e;
+
     if (virt == 0xffffffff) return;
 
     if (readlookup2[virt>>12] != -1) return;
 
-    if (readlookup[readlnext] != 0xffffffff)
-	readlookup2[readlookup[readlnext]] = -1;
+    e = tlb_get(virt >> 12);
+    if (! (e->flags & TLB_VALID))
+	e->phys = phys & ~0xfff;
+    e->flags |= TLB_L1_READ;
 
     readlookup2[virt>>12] = (uintptr_t)&ram[(uintptr_t)(phys & ~0xFFF) - (uintptr_t)(virt & ~0xfff)];
 
-    readlookupp[readlnext] = mmu_perm;
-    readlookup[readlnext++] = virt >> 12;
-    readlnext &= (cachesize-1);
-
     cycles -= 9;
 }
 
@@ -415,28 +750,27 @@ addreadlookup(uint32_t virt, uint32_t phys)
 void
 addwritelookup(uint32_t virt, uint32_t phys)
 {
+    tlb_t *e;
+
     if (virt == 0xffffffff) return;
 
     if (page_lookup[virt >> 12]) return;
 
-    if (writelookup[writelnext] != -1) {
-	page_lookup[writelookup[writelnext]] = NULL;
-	writelookup2[writelookup[writelnext]] = -1;
-    }
+    e = tlb_get(virt >> 12);
+    if (! (e->flags & TLB_VALID))
+	e->phys = phys & ~0xfff;
+    e->flags |= TLB_L1_WRITE;
 
+    /* Pages holding code, page tables or descriptors must see all writes. */
 #ifdef USE_DYNAREC
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || (phys & ~0xfff) == recomp_page)
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || (phys & ~0xfff) == recomp_page || pages[phys >> 12].pt_gen == tlb_pt_gen || pages[phys >> 12].dt_gen == seg_cache_gen)
 #else
-    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3])
+    if (pages[phys >> 12].block[0] || pages[phys >> 12].block[1] || pages[phys >> 12].block[2] || pages[phys >> 12].block[3] || pages[phys >> 12].pt_gen == tlb_pt_gen || pages[phys >> 12].dt_gen == seg_cache_gen)
 #endif
 	page_lookup[virt >> 12] = &pages[phys >> 12];
       else
 	writelookup2[virt>>12] = (uintptr_t)&ram[(uintptr_t)(phys & ~0xFFF) - (uintptr_t)(virt & ~0xfff)];
 
-    writelookupp[writelnext] = mmu_perm;
-    writelookup[writelnext++] = virt >> 12;
-    writelnext &= (cachesize - 1);
-
     cycles -= 9;
 }
 
@@ -496,8 +830,8 @@ readmembl(uint32_t addr)
     }
     addr &= rammask;
 
-    if (_mem_read_b[addr >> 14])
-	return _mem_read_b[addr >> 14](addr, _mem_priv_r[addr >> 14]);
+    if (MEM_READ(addr)->read_b)
+	return MEM_READ(addr)->read_b(addr, MEM_READ(addr)->p);
 
     return 0xff;
 }
@@ -527,8 +861,8 @@ writemembl(uint32_t addr, uint8_t val)
     }
     addr &= rammask;
 
-    if (_mem_write_b[addr >> 14])
-	_mem_write_b[addr >> 14](addr, val, _mem_priv_w[addr >> 14]);
+    if (MEM_WRITE(addr)->write_b)
+	MEM_WRITE(addr)->write_b(addr, val, MEM_WRITE(addr)->p);
 }
 
 
@@ -557,8 +891,8 @@ readmemb386l(uint32_t seg, uint32_t addr)
 
     addr &= rammask;
 
-    if (_mem_read_b[addr >> 14])
-	return _mem_read_b[addr >> 14](addr, _mem_priv_r[addr >> 14]);
+    if (MEM_READ(addr)->read_b)
+	return MEM_READ(addr)->read_b(addr, MEM_READ(addr)->p);
 
     return 0xff;
 }
@@ -593,8 +927,8 @@ writememb386l(uint32_t seg, uint32_t addr, uint8_t val)
 
     addr &= rammask;
 
-    if (_mem_write_b[addr >> 14])
-	_mem_write_b[addr >> 14](addr, val, _mem_priv_w[addr >> 14]);
+    if (MEM_WRITE(addr)->write_b)
+	MEM_WRITE(addr)->write_b(addr, val, MEM_WRITE(addr)->p);
 }
 
 
@@ -638,14 +972,14 @@ readmemwl(uint32_t seg, uint32_t addr)
 
 	addr2 &= rammask;
 
-	if (_mem_read_w[addr2 >> 14])
-		return _mem_read_w[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]);
+	if (MEM_READ(addr2)->read_w)
+		return MEM_READ(addr2)->read_w(addr2, MEM_READ(addr2)->p);
 
-	if (_mem_read_b[addr2 >> 14]) {
+	if (MEM_READ(addr2)->read_b) {
 		if (AT)
-			return _mem_read_b[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]) | (_mem_read_b[(addr2 + 1) >> 14](addr2 + 1, _mem_priv_r[addr2 >> 14]) << 8);
+			return MEM_READ(addr2)->read_b(addr2, MEM_READ(addr2)->p) | (MEM_READ((addr2 + 1))->read_b(addr2 + 1, MEM_READ(addr2)->p) << 8);
 		else
-			return _mem_read_b[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]) | (_mem_read_b[(seg + ((addr + 1) & 0xffff)) >> 14](seg + ((addr + 1) & 0xffff), _mem_priv_r[addr2 >> 14]) << 8);
+			return MEM_READ(addr2)->read_b(addr2, MEM_READ(addr2)->p) | (MEM_READ((seg + ((addr + 1) & 0xffff)))->read_b(seg + ((addr + 1) & 0xffff), MEM_READ(addr2)->p) << 8);
     }
 
     return 0xffff;
@@ -708,14 +1042,14 @@ writememwl(uint32_t seg, uint32_t addr, uint16_t val)
 	   pclog("writememwl %08X %02X\n", addr2, val);
 #endif
 
-    if (_mem_write_w[addr2 >> 14]) {
-	_mem_write_w[addr2 >> 14](addr2, val, _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_w) {
+	MEM_WRITE(addr2)->write_w(addr2, val, MEM_WRITE(addr2)->p);
 	return;
     }
 
-    if (_mem_write_b[addr2 >> 14]) {
-	_mem_write_b[addr2 >> 14](addr2, (uint8_t)(val&0xff), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[(addr2 + 1) >> 14](addr2 + 1, (uint8_t)(val>>8), _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_b) {
+	MEM_WRITE(addr2)->write_b(addr2, (uint8_t)(val&0xff), MEM_WRITE(addr2)->p);
+	MEM_WRITE((addr2 + 1))->write_b(addr2 + 1, (uint8_t)(val>>8), MEM_WRITE(addr2)->p);
 	return;
     }
 }
@@ -759,14 +1093,14 @@ readmemll(uint32_t seg, uint32_t addr)
 
     addr2 &= rammask;
 
-    if (_mem_read_l[addr2 >> 14])
-	return _mem_read_l[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]);
+    if (MEM_READ(addr2)->read_l)
+	return MEM_READ(addr2)->read_l(addr2, MEM_READ(addr2)->p);
 
-    if (_mem_read_w[addr2 >> 14])
-	return _mem_read_w[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]) | (_mem_read_w[addr2 >> 14](addr2 + 2, _mem_priv_r[addr2 >> 14]) << 16);
+    if (MEM_READ(addr2)->read_w)
+	return MEM_READ(addr2)->read_w(addr2, MEM_READ(addr2)->p) | (MEM_READ(addr2)->read_w(addr2 + 2, MEM_READ(addr2)->p) << 16);
 
-    if (_mem_read_b[addr2 >> 14])
-	return _mem_read_b[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]) | (_mem_read_b[addr2 >> 14](addr2 + 1, _mem_priv_r[addr2 >> 14]) << 8) | (_mem_read_b[addr2 >> 14](addr2 + 2, _mem_priv_r[addr2 >> 14]) << 16) | (_mem_read_b[addr2 >> 14](addr2 + 3, _mem_priv_r[addr2 >> 14]) << 24);
+    if (MEM_READ(addr2)->read_b)
+	return MEM_READ(addr2)->read_b(addr2, MEM_READ(addr2)->p) | (MEM_READ(addr2)->read_b(addr2 + 1, MEM_READ(addr2)->p) << 8) | (MEM_READ(addr2)->read_b(addr2 + 2, MEM_READ(addr2)->p) << 16) | (MEM_READ(addr2)->read_b(addr2 + 3, MEM_READ(addr2)->p) << 24);
 
     return 0xffffffff;
 }
@@ -818,20 +1152,20 @@ writememll(uint32_t seg, uint32_t addr, uint32_t val)
 
     addr2 &= rammask;
 
-    if (_mem_write_l[addr2 >> 14]) {
-	_mem_write_l[addr2 >> 14](addr2, val,	   _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_l) {
+	MEM_WRITE(addr2)->write_l(addr2, val,	   MEM_WRITE(addr2)->p);
 	return;
     }
-    if (_mem_write_w[addr2 >> 14]) {
-	_mem_write_w[addr2 >> 14](addr2,     val,       _mem_priv_w[addr2 >> 14]);
-	_mem_write_w[addr2 >> 14](addr2 + 2, val >> 16, _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_w) {
+	MEM_WRITE(addr2)->write_w(addr2,     val,       MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_w(addr2 + 2, val >> 16, MEM_WRITE(addr2)->p);
 	return;
     }
-    if (_mem_write_b[addr2 >> 14]) {
-	_mem_write_b[addr2 >> 14](addr2,     val,       _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2 + 1, val >> 8,  _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2 + 2, val >> 16, _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2 + 3, val >> 24, _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_b) {
+	MEM_WRITE(addr2)->write_b(addr2,     val,       MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2 + 1, val >> 8,  MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2 + 2, val >> 16, MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2 + 3, val >> 24, MEM_WRITE(addr2)->p);
 	return;
     }
 }
@@ -874,9 +1208,9 @@ readmemql(uint32_t seg, uint32_t addr)
 
     addr2 &= rammask;
 
-    if (_mem_read_l[addr2 >> 14])
-	return _mem_read_l[addr2 >> 14](addr2, _mem_priv_r[addr2 >> 14]) |
-			 ((uint64_t)_mem_read_l[addr2 >> 14](addr2 + 4, _mem_priv_r[addr2 >> 14]) << 32);
+    if (MEM_READ(addr2)->read_l)
+	return MEM_READ(addr2)->read_l(addr2, MEM_READ(addr2)->p) |
+			 ((uint64_t)MEM_READ(addr2)->read_l(addr2 + 4, MEM_READ(addr2)->p) << 32);
 
     return readmemll(seg,addr) | ((uint64_t)readmemll(seg,addr+4)<<32);
 }
@@ -928,27 +1262,27 @@ writememql(uint32_t seg, uint32_t addr, uint64_t val)
 
     addr2 &= rammask;
 
-    if (_mem_write_l[addr2 >> 14]) {
-	_mem_write_l[addr2 >> 14](addr2,   (uint32_t)(val&0xffffffff), _mem_priv_w[addr2 >> 14]);
-	_mem_write_l[addr2 >> 14](addr2+4, (uint32_t)(val>>32), _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_l) {
+	MEM_WRITE(addr2)->write_l(addr2,   (uint32_t)(val&0xffffffff), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_l(addr2+4, (uint32_t)(val>>32), MEM_WRITE(addr2)->p);
 	return;
     }
-    if (_mem_write_w[addr2 >> 14]) {
-	_mem_write_w[addr2 >> 14](addr2,   (uint16_t)(val&0xffff), _mem_priv_w[addr2 >> 14]);
-	_mem_write_w[addr2 >> 14](addr2+2, (uint16_t)(val>>16), _mem_priv_w[addr2 >> 14]);
-	_mem_write_w[addr2 >> 14](addr2+4, (uint16_t)(val>>32), _mem_priv_w[addr2 >> 14]);
-	_mem_write_w[addr2 >> 14](addr2+6, (uint16_t)(val>>48), _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_w) {
+	MEM_WRITE(addr2)->write_w(addr2,   (uint16_t)(val&0xffff), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_w(addr2+2, (uint16_t)(val>>16), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_w(addr2+4, (uint16_t)(val>>32), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_w(addr2+6, (uint16_t)(val>>48), MEM_WRITE(addr2)->p);
 	return;
     }
-    if (_mem_write_b[addr2 >> 14]) {
-	_mem_write_b[addr2 >> 14](addr2,   (uint8_t)(val&0xff), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+1, (uint8_t)(val>>8),  _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+2, (uint8_t)(val>>16), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+3, (uint8_t)(val>>24), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+4, (uint8_t)(val>>32), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+5, (uint8_t)(val>>40), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+6, (uint8_t)(val>>48), _mem_priv_w[addr2 >> 14]);
-	_mem_write_b[addr2 >> 14](addr2+7, (uint8_t)(val>>56), _mem_priv_w[addr2 >> 14]);
+    if (MEM_WRITE(addr2)->write_b) {
+	MEM_WRITE(addr2)->write_b(addr2,   (uint8_t)(val&0xff), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+1, (uint8_t)(val>>8),  MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+2, (uint8_t)(val>>16), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+3, (uint8_t)(val>>24), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+4, (uint8_t)(val>>32), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+5, (uint8_t)(val>>40), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+6, (uint8_t)(val>>48), MEM_WRITE(addr2)->p);
+	MEM_WRITE(addr2)->write_b(addr2+7, (uint8_t)(val>>56), MEM_WRITE(addr2)->p);
 	return;
     }
 }
@@ -959,8 +1293,8 @@ mem_readb_phys(uint32_t addr)
 {
     mem_logical_addr = 0xffffffff;
 
-    if (_mem_read_b[addr >> 14]) 
-	return _mem_read_b[addr >> 14](addr, _mem_priv_r[addr >> 14]);
+    if (MEM_READ(addr)->read_b) 
+	return MEM_READ(addr)->read_b(addr, MEM_READ(addr)->p);
 
     return 0xff;
 }
@@ -979,8 +1313,8 @@ mem_readb_phys_dma(uint32_t addr)
 
     if (_mem_exec[addr >> 14])
 	return _mem_exec[addr >> 14][addr & 0x3fff];
-    else if (_mem_read_b[addr >> 14])
-       	return _mem_read_b[addr >> 14](addr, _mem_priv_r[addr >> 14]);
+    else if (MEM_READ(addr)->read_b)
+       	return MEM_READ(addr)->read_b(addr, MEM_READ(addr)->p);
     else
 	return 0xff;
 }
@@ -991,8 +1325,8 @@ mem_readw_phys(uint32_t addr)
 {
     mem_logical_addr = 0xffffffff;
 
-    if (_mem_read_w[addr >> 14]) 
-	return _mem_read_w[addr >> 14](addr, _mem_priv_r[addr >> 14]);
+    if (MEM_READ(addr)->read_w) 
+	return MEM_READ(addr)->read_w(addr, MEM_READ(addr)->p);
 
     return 0xff;
 }
@@ -1003,8 +1337,8 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
 {
     mem_logical_addr = 0xffffffff;
 
-    if (_mem_write_b[addr >> 14]) 
-	_mem_write_b[addr >> 14](addr, val, _mem_priv_w[addr >> 14]);
+    if (MEM_WRITE(addr)->write_b) 
+	MEM_WRITE(addr)->write_b(addr, val, MEM_WRITE(addr)->p);
 }
 
 
@@ -1021,8 +1355,8 @@ mem_writeb_phys_dma(uint32_t addr, uint8_t val)
 
     if (_mem_exec[addr >> 14])
 	_mem_exec[addr >> 14][addr & 0x3fff] = val;
-    else if (_mem_write_b[addr >> 14])
-       	_mem_write_b[addr >> 14](addr, val, _mem_priv_w[addr >> 14]);
+    else if (MEM_WRITE(addr)->write_b)
+       	MEM_WRITE(addr)->write_b(addr, val, MEM_WRITE(addr)->p);
 }
 
 
@@ -1031,8 +1365,8 @@ mem_writew_phys(uint32_t addr, uint16_t val)
 {
     mem_logical_addr = 0xffffffff;
 
-    if (_mem_write_w[addr >> 14])
-	_mem_write_w[addr >> 14](addr, val, _mem_priv_w[addr >> 14]);
+    if (MEM_WRITE(addr)->write_w)
+	MEM_WRITE(addr)->write_w(addr, val, MEM_WRITE(addr)->p);
 }
 
 
@@ -1074,6 +1408,10 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *p)
 	uint64_t mask = (uint64_t)1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
 	p->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
 	p->mem[addr & 0xfff] = val;
+	if (p->pt_gen == tlb_pt_gen)
+		tlb_pt_write(p);
+	if (p->dt_gen == seg_cache_gen)
+		seg_cache_flush();
     }
 }
 
@@ -1091,6 +1429,10 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *p)
 		mask |= (mask << 1);
 	p->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
 	*(uint16_t *)&p->mem[addr & 0xfff] = val;
+	if (p->pt_gen == tlb_pt_gen)
+		tlb_pt_write(p);
+	if (p->dt_gen == seg_cache_gen)
+		seg_cache_flush();
     }
 }
 
@@ -1108,6 +1450,10 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *p)
 		mask |= (mask << 1);
 	p->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
 	*(uint32_t *)&p->mem[addr & 0xfff] = val;
+	if (p->pt_gen == tlb_pt_gen)
+		tlb_pt_write(p);
+	if (p->dt_gen == seg_cache_gen)
+		seg_cache_flush();
     }
 }
 
@@ -1324,68 +1670,92 @@ mem_mapping_write_allowed(uint32_t fl, int state)
 }
 
 
-static void
+/*
+ * Re-resolve the mappings for a range of the address space. Only the
+ * chunks whose mapping actually changed are updated, and the MMU cache
+ * is flushed only if there were any. Returns non-zero if it was.
+ */
+static int
 mem_mapping_recalc(uint64_t base, uint64_t size)
 {
-    mem_mapping_t *map = base_mapping.next;
-    uint64_t c;
-
-    if (! size) return;
-
-    /* Clear out old mappings. */
-    for (c = base; c < base + size; c += 0x4000) {
-	_mem_read_b[c >> 14] = NULL;
-	_mem_read_w[c >> 14] = NULL;
-	_mem_read_l[c >> 14] = NULL;
-	_mem_exec[c >> 14] = NULL;
-	_mem_priv_r[c >> 14] = NULL;
-	_mem_mapping_r[c >> 14] = NULL;
-	_mem_write_b[c >> 14] = NULL;
-	_mem_write_w[c >> 14] = NULL;
-	_mem_write_l[c >> 14] = NULL;
-	_mem_priv_w[c >> 14] = NULL;
-	_mem_mapping_w[c >> 14] = NULL;
-    }
-
-    /* Walk mapping list. */
-    while (map != NULL) {
-	/*In range?*/
-	if (map->enable && (uint64_t)map->base < ((uint64_t)base + (uint64_t)size) && ((uint64_t)map->base + (uint64_t)map->size) > (uint64_t)base) {
-		uint64_t start = (map->base < base) ? map->base : base;
-		uint64_t end   = (((uint64_t)map->base + (uint64_t)map->size) < (base + size)) ? ((uint64_t)map->base + (uint64_t)map->size) : (base + size);
-		if (start < map->base)
-			start = map->base;
-
-		for (c = start; c < end; c += 0x4000) {
-			if ((map->read_b || map->read_w || map->read_l) &&
-			     mem_mapping_read_allowed(map->flags, _mem_state[c >> 14])) {
-				_mem_read_b[c >> 14] = map->read_b;
-				_mem_read_w[c >> 14] = map->read_w;
-				_mem_read_l[c >> 14] = map->read_l;
-				if (map->exec)
-					_mem_exec[c >> 14] = map->exec + (c - map->base);
-				else
-					_mem_exec[c >> 14] = NULL;
-				_mem_priv_r[c >> 14] = map->p;
-				_mem_mapping_r[c >> 14] = map;
-			}
-			if ((map->write_b || map->write_w || map->write_l) &&
-			     mem_mapping_write_allowed(map->flags, _mem_state[c >> 14])) {
-				_mem_write_b[c >> 14] = map->write_b;
-				_mem_write_w[c >> 14] = map->write_w;
-				_mem_write_l[c >> 14] = map->write_l;
-				_mem_priv_w[c >> 14] = map->p;
-				_mem_mapping_w[c >> 14] = map;
-			}
+    mem_mapping_t *map, *rd, *wr;
+    uint64_t end = base + size;
+    uint64_t start;
+    uint8_t *exec;
+    uint32_t c;
+    int changed = 0;
+    int i, n = 0;
+
+    if (! size) return(0);
+
+    /* Collect the enabled mappings in range, later ones take priority. */
+    for (map = base_mapping.next; map != NULL; map = map->next) {
+	if (!map->enable || (uint64_t)map->base >= end ||
+	    ((uint64_t)map->base + (uint64_t)map->size) <= base) continue;
+
+	if (n == recalc_maps_sz) {
+		recalc_maps_sz += 32;
+		recalc_maps = (mem_mapping_t **)realloc(recalc_maps,
+					recalc_maps_sz * sizeof(mem_mapping_t *));
+		if (recalc_maps == NULL)
+			fatal("MEM: out of memory for mapping recalc\n");
+	}
+	recalc_maps[n++] = map;
+    }
+
+    for (c = (uint32_t)(base >> 14); c <= (uint32_t)((end - 1) >> 14); c++) {
+	rd = wr = &mem_mapping_none;
+	exec = NULL;
+
+	for (i = 0; i < n; i++) {
+		map = recalc_maps[i];
+		if (c < (map->base >> 14) ||
+		    c > (((uint64_t)map->base + map->size - 1) >> 14)) continue;
+
+		if ((map->read_b || map->read_w || map->read_l) &&
+		     mem_mapping_read_allowed(map->flags, _mem_state[c])) {
+			rd = map;
+			if (map->exec) {
+				start = ((uint64_t)c << 14);
+				if (start < map->base)
+					start = map->base;
+				exec = map->exec + (start - map->base);
+			} else
+				exec = NULL;
 		}
+		if ((map->write_b || map->write_w || map->write_l) &&
+		     mem_mapping_write_allowed(map->flags, _mem_state[c]))
+			wr = map;
+	}
+
+	if (_mem_mapping_r[c] != rd || _mem_mapping_w[c] != wr ||
+	    _mem_exec[c] != exec) {
+		_mem_mapping_r[c] = rd;
+		_mem_mapping_w[c] = wr;
+		_mem_exec[c] = exec;
+		changed = 1;
 	}
-	map = map->next;
     }
 
-    flushmmucache_cr3();
+    if (changed)
+	flushmmucache_cr3();
+
+    return(changed);
 }
 
 
+static void
+mem_mapping_clear(void)
+{
+    int c;
+
+    for (c = 0; c < 0x40000; c++) {
+	_mem_mapping_r[c] = &mem_mapping_none;
+	_mem_mapping_w[c] = &mem_mapping_none;
+    }
+    memset(_mem_exec, 0x00, sizeof(_mem_exec));
+}
+
 void
 mem_mapping_del(mem_mapping_t *map)
 {
@@ -1464,7 +1834,9 @@ mem_mapping_set_handler(mem_mapping_t *map,
     map->write_w = write_w;
     map->write_l = write_l;
 
-    mem_mapping_recalc(map->base, map->size);
+    /* Same mappings, but any cached RAM pointers may be wrong now. */
+    if (! mem_mapping_recalc(map->base, map->size))
+	flushmmucache_cr3();
 }
 
 
@@ -1529,11 +1901,18 @@ void
 mem_set_mem_state(uint32_t base, uint32_t size, int state)
 {
     uint32_t c;
+    int changed = 0;
 
-    for (c = 0; c < size; c += 0x4000)
-	_mem_state[(c + base) >> 14] = state;
+    for (c = 0; c < size; c += 0x4000) {
+	if (_mem_state[(c + base) >> 14] != state) {
+		_mem_state[(c + base) >> 14] = state;
+		changed = 1;
+	}
+    }
 
-    mem_mapping_recalc(base, size);
+    /* Chipsets rewrite their shadow RAM settings a lot. */
+    if (changed)
+	mem_mapping_recalc(base, size);
 }
 
 
@@ -1677,9 +2056,20 @@ mem_reset(void)
 	m = 1024UL * 16384;
       else
 	m = 1024UL * mem_size;
-    if (ram != NULL) free(ram);
-    ram = (uint8_t *)malloc(m);		/* allocate and clear the RAM block */
-    memset(ram, 0x00, m);
+    /*
+     * The RAM block is an anonymous mapping, which the host only
+     * backs with real memory as pages get touched. This keeps it
+     * cheap when the guest uses little of it, and lets forked
+     * children share it copy-on-write with their parent.
+     */
+    if (ram != NULL)
+	plat_munmap(ram, ram_size);
+    ram_size = m;
+    ram = (uint8_t *)plat_mmap(m);	/* allocate the (zeroed) RAM block */
+    if (ram == NULL) {
+	fatal("MEM: unable to allocate %luKB of RAM\n", m >> 10);
+	return;
+    }
 
     /*
      * Allocate the page table based on how much RAM we have.
@@ -1750,13 +2140,7 @@ pclog("MEM: reset: new pages=%08lx, pages_sz=%i\n", pages, pages_sz);
     /* Initialize the tables. */
     resetreadlookup();
 
-    memset(_mem_read_b,  0x00, sizeof(_mem_read_b));
-    memset(_mem_read_w,  0x00, sizeof(_mem_read_w));
-    memset(_mem_read_l,  0x00, sizeof(_mem_read_l));
-    memset(_mem_write_b, 0x00, sizeof(_mem_write_b));
-    memset(_mem_write_w, 0x00, sizeof(_mem_write_w));
-    memset(_mem_write_l, 0x00, sizeof(_mem_write_l));
-    memset(_mem_exec,    0x00, sizeof(_mem_exec));
+    mem_mapping_clear();
 
     memset(&base_mapping, 0x00, sizeof(base_mapping));
 
@@ -1837,6 +2221,8 @@ mem_init(void)
 #endif
 
     memset(ram_mapped_addr, 0x00, 64 * sizeof(uint32_t));
+
+    mem_mapping_clear();
 }
 
 
@@ -1884,6 +2270,7 @@ mem_reset_page_blocks(void)
 			    pages[c].block[2] = pages[c].block[3] = NULL;
 	pages[c].block_2[0] = pages[c].block_2[1] =
 			      pages[c].block_2[2] = pages[c].block_2[3] = NULL;
+	pages[c].smc_count = 0;
     }
 }
 
@@ -1970,3 +2357,97 @@ port_92_reset(void)
 
     flushmmucache();
 }
+
+
+/* Save the state of the memory system, and the contents of RAM. */
+void
+mem_save_state(void)
+{
+    mem_mapping_t *map;
+    uint32_t n, off;
+
+    state_put(rammask);
+    state_put(mem_a20_key);
+    state_put(mem_a20_alt);
+    state_put(mem_a20_state);
+    state_put(port_92_reg);
+    state_put(shadowbios);
+    state_put(shadowbios_write);
+    state_put(ram_mapped_addr);
+    state_write_block(_mem_state, sizeof(_mem_state));
+
+    /*
+     * The list of mappings is built in the same order for
+     * identically configured machines, so we only have to
+     * save what can change at runtime. The exec pointer is
+     * saved if it points into RAM, others do not move.
+     */
+    n = 0;
+    for (map = base_mapping.next; map != NULL; map = map->next)
+	n++;
+    state_put(n);
+    for (map = base_mapping.next; map != NULL; map = map->next) {
+	if ((map->exec >= ram) && (map->exec < (ram + ram_size)))
+		off = (uint32_t)(map->exec - ram);
+	  else
+		off = 0xffffffff;
+	state_put(map->enable);
+	state_put(map->base);
+	state_put(map->size);
+	state_put(off);
+    }
+
+    state_write_block(ram, ram_size);
+}
+
+
+void
+mem_load_state(int version)
+{
+    mem_mapping_t *map;
+    uint32_t n, c, off;
+    uint32_t base, size;
+    int enable, skip;
+
+    state_get(rammask);
+    state_get(mem_a20_key);
+    state_get(mem_a20_alt);
+    state_get(mem_a20_state);
+    state_get(port_92_reg);
+    state_get(shadowbios);
+    state_get(shadowbios_write);
+    state_get(ram_mapped_addr);
+    state_read_block(_mem_state, sizeof(_mem_state));
+
+    c = 0;
+    for (map = base_mapping.next; map != NULL; map = map->next)
+	c++;
+    state_get(n);
+    skip = (n != c);
+    if (skip)
+	pclog("MEM: state has %lu mappings, we have %lu, ignored\n", n, c);
+
+    map = base_mapping.next;
+    for (c = 0; c < n; c++) {
+	state_get(enable);
+	state_get(base);
+	state_get(size);
+	state_get(off);
+	if (skip) continue;
+
+	/* We cannot use the regular functions, they recalc. */
+	map->enable = enable;
+	map->base = base;
+	map->size = size;
+	if (off != 0xffffffff)
+		map->exec = ram + off;
+	map = map->next;
+    }
+
+    state_read_block(ram, ram_size);
+
+    /* Re-resolve the entire address space. */
+    mem_mapping_clear();
+    mem_mapping_recalc(0, 0x100000000ULL);
+    tlb_reset();
+}
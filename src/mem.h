@@ -8,7 +8,7 @@
  *
  *		Definitions for the memory interface.
  *
- * Version:	@(#)mem.h	1.0.9	2018/08/20
+ * Version:	@(#)mem.h	1.0.13	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Sarah Walker, <tommowalker@tommowalker.co.uk>
@@ -96,6 +96,15 @@ typedef struct _page_ {
 
     /*Head of codeblock tree associated with this page*/
     struct codeblock_t *head;
+
+    /*Number of blocks evicted from this page by self-modifying code*/
+    uint32_t	smc_count;
+
+    /*Page holds a page table if this matches the TLB's generation*/
+    uint32_t	pt_gen;
+
+    /*Page holds a descriptor table if this matches the descriptor cache's generation*/
+    uint32_t	dt_gen;
 } page_t;
 
 
@@ -106,14 +115,8 @@ extern uint8_t		*rom;
 extern uint8_t		romext[32768];
 extern uint32_t		biosmask;
 
-extern int		readlookup[256],
-			readlookupp[256];
 extern uintptr_t	*readlookup2;
-extern int		readlnext;
-extern int		writelookup[256],
-			writelookupp[256];
 extern uintptr_t	*writelookup2;
-extern int		writelnext;
 extern uint32_t		ram_mapped_addr[64];
 
 mem_mapping_t		base_mapping,
@@ -260,6 +263,8 @@ extern void	mem_add_bios(void);
 extern void	mem_init(void);
 extern void	mem_reset(void);
 extern void	mem_remap_top(int kb);
+extern void	mem_save_state(void);
+extern void	mem_load_state(int version);
 
 extern uint8_t	port_92_read(uint16_t port, void *priv);
 extern void	port_92_write(uint16_t port, uint8_t val, void *priv);
@@ -8,7 +8,7 @@
  *
  *		Main emulator module where most things are controlled.
  *
- * Version:	@(#)pc.c	1.0.53	2018/09/03
+ * Version:	@(#)pc.c	1.0.67	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -53,6 +53,7 @@
 # include "cpu/codegen.h"
 #endif
 #include "cpu/x86_ops.h"
+#include "cpu/cpu_prof.h"
 #include "machines/machine.h"
 #include "io.h"
 #include "mem.h"
@@ -89,9 +90,11 @@
 #include "devices/misc/isartc.h"
 #include "ui/ui.h"
 #include "plat.h"
+#include "state.h"
+#include "worker.h"
 
 
-#define PCLOG_BUFF_SIZE	8192			/* has to be big enough!! */
+#define BENCH_SEED	0x56415243		/* "VARC" */
 
 
 /* Commandline options. */
@@ -106,7 +109,23 @@ int	video_fps = RENDER_FPS;			/* (O) render speed in fps */
 #endif
 int	settings_only = 0;			/* (O) only the settings dlg */
 int	config_ro = 0;				/* (O) dont modify cfg file */
+int	unthrottled = 0;			/* (O) run as fast as possible */
+int	bench_secs = 0;				/* (O) run benchmark for N secs */
+int	cpu_prof_rate = 0;			/* (O) profiler samples per sec */
+int	cpu_prof_blocks = 0;			/* (O) profiler times dynarec */
+int	worker_inline = 0;			/* (O) run device jobs inline */
+int	log_level = PCLOG_INFO;			/* (O) log messages up to level */
+int	log_categories = PCLOG_CAT_ALL;		/* (O) log these categories */
 wchar_t log_path[1024] = { L'\0'};		/* (O) full path of logfile */
+#ifdef USE_DYNAREC
+wchar_t tcache_path[1024] = { L'\0'};		/* (O) recompiler block cache */
+#endif
+wchar_t state_load_path[1024] = { L'\0'};	/* (O) restore state from */
+wchar_t state_save_path[1024] = { L'\0'};	/* (O) save state on exit */
+#ifndef _WIN32
+int	fork_count = 0;				/* (O) fork N child runs */
+int	fork_id = 0;				/* child run number, or 0 */
+#endif
 
 /* Configuration values. */
 int	lang_id = 0x0409;			/* (C) language ID */
@@ -121,6 +140,7 @@ int	vid_api = 0,				/* (C) video renderer */
 	vid_fullscreen_first = 0,		/* (C) video */
 	vid_grayscale = 0,			/* (C) video */
 	vid_graytype = 0,			/* (C) video */
+	vid_render_thread = 0,			/* (C) render in background */
 	invert_display = 0,			/* (C) invert the display */
 	suppress_overscan = 0,			/* (C) suppress overscans */
 	scale = 0,				/* (C) screen scale factor */
@@ -155,6 +175,7 @@ int	joystick_type = 0;			/* (C) joystick type */
 int	mem_size = 0;				/* (C) memory size */
 int	cpu_manufacturer = 0,			/* (C) cpu manufacturer */
 	cpu_use_dynarec = 0,			/* (C) cpu uses/needs Dyna */
+	cpu_fast_interp = 0,			/* (C) block-batched interp */
 	cpu = 3,				/* (C) cpu type */
 	enable_external_fpu = 0;		/* (C) enable external FPU */
 int	network_type;				/* (C) net provider type */
@@ -203,90 +224,6 @@ int	title_update;
 int64_t	main_time;
 
 
-/*
- * Log something to the logfile or stdout.
- *
- * To avoid excessively-large logfiles because some
- * module repeatedly logs, we keep track of what is
- * being logged, and catch repeating entries.
- *
- * Note: we need fairly large buffers here, to allow
- *       for the network code dumping packet content
- *       with this.
- */
-void
-pclog_ex(const char *fmt, va_list ap)
-{
-#ifndef RELEASE_BUILD
-    static char buff[PCLOG_BUFF_SIZE];
-    static int seen = 0;
-    static int detect = 1;
-    char temp[PCLOG_BUFF_SIZE];
-
-    if (fmt == NULL) {
-	/* Initialize. */
-	detect = (ap != NULL) ? 1 : 0;
-	seen = 0;
-	return;
-    }
-
-    if (stdlog == NULL) {
-	if (log_path[0] != L'\0') {
-		stdlog = plat_fopen(log_path, L"w");
-		if (stdlog == NULL)
-#ifdef _WIN32
-			stdlog = stdout;
-#else
-			stdlog = stderr;
-#endif
-	} else {
-#ifdef _WIN32
-		stdlog = stdout;
-#else
-			stdlog = stderr;
-#endif
-	}
-    }
-
-    vsprintf(temp, fmt, ap);
-    if (detect && !strcmp(buff, temp)) {
-	seen++;
-    } else {
-	if (seen) {
-		fprintf(stdlog, "*** %d repeats ***\n", seen);
-	}
-	seen = 0;
-	strcpy(buff, temp);
-	fprintf(stdlog, temp, ap);
-    }
-
-    fflush(stdlog);
-#endif
-}
-
-
-/* Log something. We only do this in non-release builds. */
-void
-pclog(const char *fmt, ...)
-{
-#ifndef RELEASE_BUILD
-    va_list ap;
-
-    va_start(ap, fmt);
-    pclog_ex(fmt, ap);
-    va_end(ap);
-#endif
-}
-
-
-/* Enable or disable detection of repeated info being logged. */
-void
-pclog_repeat(int enabled)
-{
-    pclog_ex(NULL, (va_list)enabled);
-}
-
-
 #ifdef _DEBUG
 /* Log a block of code around the current CS:IP. */
 void
@@ -344,6 +281,9 @@ fatal(const char *fmt, ...)
 
     va_start(ap, fmt);
 
+    /* Make sure this comes after everything logged before it. */
+    pclog_flush();
+
     if (stdlog == NULL) {
 	if (log_path[0] != L'\0') {
 		stdlog = plat_fopen(log_path, L"w");
@@ -536,20 +476,49 @@ usage:
 		printf("\nUsage: varcem [options] [cfg-file]\n\n");
 		printf("Valid options are:\n\n");
 		printf("  -? or --help         - show this information\n");
+		printf("  -B or --bench secs   - run benchmark for 'secs' emulated seconds\n");
 		printf("  -C or --dumpcfg      - dump config file after loading\n");
 #ifdef _WIN32
 		printf("  -D or --debug        - force debug output logging\n");
 #endif
 		printf("  -F or --fullscreen   - start in fullscreen mode\n");
+		printf("  -G or --logcat mask  - log only the categories in 'mask'\n");
+		printf("  -I or --loadstate fn - restore machine state from 'fn'\n");
 		printf("  -L or --logfile path - set 'path' to be the logfile\n");
+#ifndef _WIN32
+		printf("  -N or --fork num     - run 'num' copies, forked after start\n");
+#endif
+		printf("  -O or --savestate fn - save machine state to 'fn' on exit\n");
 		printf("  -P or --vmpath path  - set 'path' to be root for vm\n");
 #ifdef USE_WX
 		printf("  -R or --fps num      - set render speed to 'num' fps\n");
 #endif
 		printf("  -S or --settings     - show only the settings dialog\n");
+#ifdef USE_DYNAREC
+		printf("  -T or --tcache path  - remember recompiled blocks in 'path'\n");
+#endif
+		printf("  -U or --unthrottled  - run as fast as possible\n");
+		printf("  -V or --loglevel num - log messages up to level 'num' (0-3)\n");
 		printf("  -W or --readonly     - do not modify the config file\n");
+		printf("  -X or --profile rate - sample the CPU 'rate' times per second\n");
+#ifdef USE_DYNAREC
+		printf("  -Y or --profblocks   - also time the recompiled blocks\n");
+#endif
+		printf("  -Z or --nothreads    - run all device jobs on the main thread\n");
 		printf("\nA config file can be specified. If none is, the default file will be used.\n");
 		return(ret);
+	} else if (!wcscasecmp(argv[c], L"--bench") ||
+		   !wcscasecmp(argv[c], L"-B")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		bench_secs = wcstol(argv[++c], NULL, 10);
+		if (bench_secs <= 0) {
+			ret = -1;
+			goto usage;
+		}
+		unthrottled = 1;
 	} else if (!wcscasecmp(argv[c], L"--dumpcfg") ||
 		   !wcscasecmp(argv[c], L"-C")) {
 		do_dump_config = 1;
@@ -561,6 +530,20 @@ usage:
 	} else if (!wcscasecmp(argv[c], L"--fullscreen") ||
 		   !wcscasecmp(argv[c], L"-F")) {
 		start_in_fullscreen = 1;
+	} else if (!wcscasecmp(argv[c], L"--logcat") ||
+		   !wcscasecmp(argv[c], L"-G")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		log_categories = wcstol(argv[++c], NULL, 0);
+	} else if (!wcscasecmp(argv[c], L"--loadstate") ||
+		   !wcscasecmp(argv[c], L"-I")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		wcscpy(state_load_path, argv[++c]);
 	} else if (!wcscasecmp(argv[c], L"--logfile") ||
 		   !wcscasecmp(argv[c], L"-L")) {
 		if ((c+1) == argc) {
@@ -568,6 +551,26 @@ usage:
 			goto usage;
 		}
 		wcscpy(log_path, argv[++c]);
+#ifndef _WIN32
+	} else if (!wcscasecmp(argv[c], L"--fork") ||
+		   !wcscasecmp(argv[c], L"-N")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		fork_count = wcstol(argv[++c], NULL, 10);
+		if (fork_count <= 0) {
+			ret = -1;
+			goto usage;
+		}
+#endif
+	} else if (!wcscasecmp(argv[c], L"--savestate") ||
+		   !wcscasecmp(argv[c], L"-O")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		wcscpy(state_save_path, argv[++c]);
 	} else if (!wcscasecmp(argv[c], L"--vmpath") ||
 		   !wcscasecmp(argv[c], L"-P")) {
 		if ((c+1) == argc) {
@@ -587,9 +590,51 @@ usage:
 	} else if (!wcscasecmp(argv[c], L"--settings") ||
 		   !wcscasecmp(argv[c], L"-S")) {
 		settings_only = 1;
+#ifdef USE_DYNAREC
+	} else if (!wcscasecmp(argv[c], L"--tcache") ||
+		   !wcscasecmp(argv[c], L"-T")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		wcscpy(tcache_path, argv[++c]);
+#endif
+	} else if (!wcscasecmp(argv[c], L"--unthrottled") ||
+		   !wcscasecmp(argv[c], L"-U")) {
+		unthrottled = 1;
+	} else if (!wcscasecmp(argv[c], L"--loglevel") ||
+		   !wcscasecmp(argv[c], L"-V")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		log_level = wcstol(argv[++c], NULL, 10);
+		if ((log_level < PCLOG_ERROR) || (log_level > PCLOG_DEBUG)) {
+			ret = -1;
+			goto usage;
+		}
 	} else if (!wcscasecmp(argv[c], L"--readonly") ||
 		   !wcscasecmp(argv[c], L"-W")) {
 		config_ro = 1;
+	} else if (!wcscasecmp(argv[c], L"--profile") ||
+		   !wcscasecmp(argv[c], L"-X")) {
+		if ((c+1) == argc) {
+			ret = -1;
+			goto usage;
+		}
+		cpu_prof_rate = wcstol(argv[++c], NULL, 10);
+		if (cpu_prof_rate <= 0) {
+			ret = -1;
+			goto usage;
+		}
+#ifdef USE_DYNAREC
+	} else if (!wcscasecmp(argv[c], L"--profblocks") ||
+		   !wcscasecmp(argv[c], L"-Y")) {
+		cpu_prof_blocks = 1;
+#endif
+	} else if (!wcscasecmp(argv[c], L"--nothreads") ||
+		   !wcscasecmp(argv[c], L"-Z")) {
+		worker_inline = 1;
 	} else if (!wcscasecmp(argv[c], L"--test")) {
 		/* some (undocumented) test function here.. */
 
@@ -747,6 +792,9 @@ pc_speed_changed(void)
 	setpitclock((float)machines[machine].cpu[cpu_manufacturer].cpus[cpu_effective].rspeed);
       else
 	setpitclock(14318184.0);
+
+    /* Restart the profiler, if enabled. */
+    cpu_prof_reset();
 }
 
 
@@ -859,11 +907,24 @@ pc_init(void)
      * video card are available, so we can proceed with the
      * initialization of things.
      */
+
+    /* From now on, the log is written by a thread of its own. */
+    pclog_start();
+
     cpuspeed2 = (AT) ? 2 : 1;
     atfullspeed = 0;
 
     random_init();
 
+    /*
+     * For benchmark runs, we want every run to be the same, so
+     * use a fixed seed, and do not sync the RTC to the host.
+     */
+    if (bench_secs > 0) {
+	srand(BENCH_SEED);
+	enable_sync = 0;
+    }
+
     mem_init();
 
 #ifdef USE_DYNAREC
@@ -924,6 +985,19 @@ pc_close(thread_t *ptr)
 
     nvr_save();
 
+    /* Let the device workers finish what they were doing. */
+    worker_sync_all();
+
+    /* The main thread is stopped between frames, so this is safe. */
+    if (state_save_path[0] != L'\0')
+	(void)state_save(state_save_path);
+
+#ifdef USE_DYNAREC
+    codegen_cache_save();
+#endif
+
+    cpu_prof_dump();
+
     machine_close();
 
     config_save();
@@ -953,6 +1027,9 @@ pc_close(thread_t *ptr)
     ide_destroy_buffers();
 
     cdrom_destroy_drives();
+
+    /* Write out whatever is left in the log. */
+    pclog_stop();
 }
 
 
@@ -963,6 +1040,9 @@ pc_reset_hard_close(void)
 
     nvr_save();
 
+    /* No device jobs may be left when the devices go away. */
+    worker_sync_all();
+
     machine_close();
 
     mouse_close();
@@ -1096,6 +1176,84 @@ pc_reset(int hard)
 }
 
 
+#ifndef _WIN32
+/*
+ * Prepare a forked child process to run on its own.
+ *
+ * The child shares the machine state of its parent, but not
+ * its threads or its right to update the disk images.
+ */
+void
+pc_fork_child(int id)
+{
+    int i;
+
+    fork_id = id;
+
+    /* Only the forking thread survives, so restart the blitter. */
+    video_blit_restart();
+    worker_restart_all();
+    pclog_start();
+
+    /*
+     * The config, NVR and tcache files belong to the parent. Do
+     * this first, so a fatal() below does not write them.
+     */
+    config_ro = 1;
+#ifdef USE_DYNAREC
+    tcache_path[0] = L'\0';
+#endif
+
+    /* Keep all disk writes private to this child. */
+    for (i = 0; i < HDD_NUM; i++)
+	(void)hdd_image_cow(i);
+
+    /* Each child saves its state into a file of its own. */
+    if (state_save_path[0] != L'\0') {
+	i = (int)wcslen(state_save_path);
+	swprintf(&state_save_path[i], sizeof_w(state_save_path) - i,
+		 L".%d", fork_id);
+    }
+
+    pclog("PC: running as child %d\n", fork_id);
+}
+#endif
+
+
+/* Report the results of a benchmark run. */
+static void
+pc_bench_report(uint64_t ins, uint64_t host, uint64_t exec, uint64_t input)
+{
+    double secs, cpu, dev, other;
+
+    secs = (double)host / (double)timer_freq;
+    cpu = (double)(exec - timer_host_time) / (double)timer_freq;
+    dev = (double)timer_host_time / (double)timer_freq;
+    other = secs - cpu - dev - ((double)input / (double)timer_freq);
+
+    printf("\n%s %s\n", emu_title, emu_fullversion);
+    printf("Benchmark: %s, %s\n", machine_getname(),
+	   machines[machine].cpu[cpu_manufacturer].cpus[cpu_effective].name);
+#ifndef _WIN32
+    if (fork_id > 0)
+	printf("  Child:             %d\n", fork_id);
+#endif
+    printf("  Emulated time:     %d s\n", bench_secs);
+    printf("  Host time:         %.3f s (%.1f%% of real time)\n",
+	   secs, (secs > 0.0) ? ((double)bench_secs * 100.0 / secs) : 0.0);
+    printf("  Emulated MIPS:     %.2f\n",
+	   (secs > 0.0) ? ((double)ins / 1000000.0 / secs) : 0.0);
+    printf("  CPU:               %.3f s\n", cpu);
+    printf("  Devices (timers):  %.3f s\n", dev);
+    printf("  Input:             %.3f s\n", (double)input / (double)timer_freq);
+    printf("  Other:             %.3f s\n", other);
+    fflush(stdout);
+
+    pclog("PC: benchmark %ds in %.3fs, %.2f MIPS\n", bench_secs, secs,
+	  (secs > 0.0) ? ((double)ins / 1000000.0 / secs) : 0.0);
+}
+
+
 /*
  * The main thread runs the actual emulator code.
  *
@@ -1107,8 +1265,10 @@ void
 pc_thread(void *param)
 {
     wchar_t temp[200];
-    uint64_t start_time, end_time;
+    uint64_t start_time, end_time, t;
+    uint64_t bench_start, bench_ins, bench_exec, bench_input;
     uint32_t old_time, new_time;
+    uint64_t idle_us;
     int status_update_needed;
     int done, drawits, frm;
     int *quitp = (int *)param;
@@ -1116,7 +1276,20 @@ pc_thread(void *param)
 
     pclog("PC: starting main thread...\n");
 
+    /* Restore a saved machine state, if we have one. */
+    if (state_load_path[0] != L'\0') {
+	if (state_load(state_load_path) < 0)
+		pc_reset_hard();
+    }
+
+    /* If benchmarking, we want to know where the time goes. */
+    bench_ins = bench_exec = bench_input = 0;
+    timer_profile = (bench_secs > 0) || cpu_prof_blocks;
+    timer_host_time = 0;
+    bench_start = plat_timer_read();
+
     main_time = 0;
+    idle_us = 0;
     framecountx = 0;
     status_update_needed = title_update = 1;
     old_time = plat_get_ticks();
@@ -1132,18 +1305,17 @@ pc_thread(void *param)
 	new_time = plat_get_ticks();
 	drawits += (new_time - old_time);
 	old_time = new_time;
-	if (drawits > 0 && !dopause) {
+	if ((drawits > 0 || unthrottled) && !dopause) {
 		/* Yes, so do one frame now. */
 		start_time = plat_timer_read();
 		drawits -= 10;
-		if (drawits > 50)
+		if ((drawits > 50) || unthrottled)
 			drawits = 0;
 
 		/* Run a block of code. */
 		plat_startblit();
 		clockrate = machines[machine].cpu[cpu_manufacturer].cpus[cpu_effective].rspeed;
-
-pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
+		cpu_idle_cycles = 0;
 		if (is386) {
 #ifdef USE_DYNAREC
 			if (cpu_use_dynarec)
@@ -1157,10 +1329,15 @@ pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
 			execx86(clockrate/100);
 		}
 
+		t = plat_timer_read();
+		bench_exec += (t - start_time);
+
 		mouse_process();
 
 		joystick_process();
 
+		bench_input += (plat_timer_read() - t);
+
 		plat_endblit();
 
 		/* Done with this frame, update statistics. */
@@ -1170,6 +1347,7 @@ pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
 
 			/* FIXME: all this should go into a "stats" struct! */
 			mips = (float)insc/1000000.0f;
+			bench_ins += insc;
 			insc = 0;
 			flops = (float)fpucount/1000000.0f;
 			fpucount = 0;
@@ -1188,6 +1366,10 @@ pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
 			cpu_recomp_evicted_latched = cpu_recomp_evicted;
 			cpu_recomp_reuse_latched = cpu_recomp_reuse;
 			cpu_recomp_removed_latched = cpu_recomp_removed;
+			cpu_recomp_flags_dropped_latched = cpu_recomp_flags_dropped;
+			cpu_recomp_cached_latched = cpu_recomp_cached;
+			cpu_recomp_smc_saved_latched = cpu_recomp_smc_saved;
+			cpu_recomp_smc_interp_latched = cpu_recomp_smc_interp;
 			cpu_reps_latched = cpu_reps;
 			cpu_notreps_latched = cpu_notreps;
 
@@ -1199,6 +1381,10 @@ pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
 			cpu_recomp_evicted = 0;
 			cpu_recomp_reuse = 0;
 			cpu_recomp_removed = 0;
+			cpu_recomp_flags_dropped = 0;
+			cpu_recomp_cached = 0;
+			cpu_recomp_smc_saved = 0;
+			cpu_recomp_smc_interp = 0;
 			cpu_reps = 0;
 			cpu_notreps = 0;
 #endif
@@ -1240,9 +1426,34 @@ pclog("PC: clockrate=%lu cpuspeed=%lu\n", clockrate, cpuspeed);
 
 		end_time = plat_timer_read();
 		main_time += (end_time - start_time);
+
+		/* If benchmarking, see if we are done. */
+		if ((bench_secs > 0) && (done >= (bench_secs * 100))) {
+			pc_bench_report(bench_ins + insc,
+					end_time - bench_start,
+					bench_exec, bench_input);
+			*quitp = 1;
+		}
+
+		/*
+		 * When running unthrottled, whatever part of the frame
+		 * the guest spent halted is given back to the host as
+		 * real time, so an idle machine does not race ahead at
+		 * full host speed. Benchmark runs are never slowed down.
+		 */
+		if (unthrottled && (bench_secs == 0) && cpu_idle_cycles) {
+			idle_us += ((uint64_t)cpu_idle_cycles * 10000) / (clockrate / 100);
+			if (idle_us >= 1000) {
+				plat_delay_ms((uint32_t)(idle_us / 1000));
+				idle_us %= 1000;
+			}
+		}
 	} else {
-		/* Just so we dont overload the host OS. */
-		plat_delay_ms(1);
+		/*
+		 * Sleep until the next frame is due, so we do not
+		 * overload the host OS.
+		 */
+		plat_delay_ms((drawits < 0) ? (1 - drawits) : 1);
 	}
 
 	/* If needed, handle a screen resize. */
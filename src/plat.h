@@ -8,7 +8,7 @@
  *
  *		Define the various platform support functions.
  *
- * Version:	@(#)plat.h	1.0.17	2018/08/31
+ * Version:	@(#)plat.h	1.0.18	2018/09/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -143,6 +143,8 @@ extern int	plat_dir_create(const wchar_t *path);
 extern uint64_t	plat_timer_read(void);
 extern uint32_t	plat_get_ticks(void);
 extern void	plat_delay_ms(uint32_t count);
+extern void	*plat_mmap(size_t size);
+extern void	plat_munmap(void *ptr, size_t size);
 extern void	plat_pause(int p);
 extern void	plat_mouse_capture(int on);
 extern void	plat_setfullscreen(int on);
@@ -8,7 +8,7 @@
  *
  *		Provide centralized access to the PNG image handler.
  *
- * Version:	@(#)png.c	1.0.2	2018/09/02
+ * Version:	@(#)png.c	1.0.3	2018/09/02
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -130,14 +130,16 @@ static const dllimp_t png_imports[] = {
 static void
 error_handler(png_structp arg, const char *str)
 {
-    pclog("PNG: stream 0x%08lx error '%s'\n", arg, str);
+    pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+	"PNG: stream 0x%08lx error '%s'\n", arg, str);
 }
 
 
 static void
 warning_handler(png_structp arg, const char *str)
 {
-    pclog("PNG: stream 0x%08lx warning '%s'\n", arg, str);
+    pclog_lvl(PCLOG_CAT_EMU, PCLOG_WARNING,
+	"PNG: stream 0x%08lx warning '%s'\n", arg, str);
 }
 
 
@@ -149,7 +151,7 @@ write_handler(png_struct *png_ptr, png_byte *bufp, png_size_t len)
     FILE *fp = (FILE *)PNGFUNC(get_io_ptr)(png_ptr);
 
     if (fwrite(bufp, 1, len, fp) != len)
-	pclog("PNG: error writing file!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR, "PNG: error writing file!\n");
 }
 
 
@@ -175,7 +177,8 @@ png_load(void)
     /* Try loading the DLL. */
     png_handle = dynld_module(PATH_PNG_DLL, png_imports);
     if (png_handle == NULL) {
-	pclog("PNG: unable to load '%s'; format disabled!\n", PATH_PNG_DLL);
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_WARNING,
+		"PNG: unable to load '%s'; format disabled!\n", PATH_PNG_DLL);
 	return(0);
     }
 #else
@@ -220,7 +223,8 @@ png_write_gray(const wchar_t *fn, int inv, uint8_t *pix, int16_t w, int16_t h)
 		pclog("PNG: file %ls could not be opened for writing!\n", fn);
 	  else
 error:
-	pclog("PNG: fatal error, bailing out, error = %i\n", errno);
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"PNG: fatal error, bailing out, error = %i\n", errno);
 	if (png != NULL)
 		PNGFUNC(destroy_write_struct)(&png, &info);
 	if (fp != NULL)
@@ -232,13 +236,15 @@ error:
     png = PNGFUNC(create_write_struct)(PNG_LIBPNG_VER_STRING, NULL,
 				       error_handler, warning_handler);
     if (png == NULL) {
-	pclog("PNG: create_write_struct failed!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"PNG: create_write_struct failed!\n");
 	goto error;
     }
 
     info = PNGFUNC(create_info_struct)(png);
     if (info == NULL) {
-	pclog("PNG: create_info_struct failed!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"PNG: create_info_struct failed!\n");
 	goto error;
     }
 
@@ -331,13 +337,15 @@ error:
     png = PNGFUNC(create_write_struct)(PNG_LIBPNG_VER_STRING, NULL,
 				       error_handler, warning_handler);
     if (png == NULL) {
-	pclog("PNG: create_write_struct failed!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"PNG: create_write_struct failed!\n");
 	goto error;
     }
 
     info = PNGFUNC(create_info_struct)(png);
     if (info == NULL) {
-	pclog("PNG: create_info_struct failed!\n");
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"PNG: create_info_struct failed!\n");
 	goto error;
     }
 
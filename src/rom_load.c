@@ -17,7 +17,7 @@
  *		or to use a generic handler, and then pass it a pointer
  *		to a command table. For now, we don't.
  *
- * Version:	@(#)rom_load.c	1.0.12	2018/06/14
+ * Version:	@(#)rom_load.c	1.0.13	2018/06/14
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -88,7 +88,8 @@ again:
 	  else if (! strcmp(argv[1], "interleaved"))
 		r->mode = 1;
 	  else {
-		pclog("ROM: invalid mode '%s' on line %d.\n", argv[1], ln);
+		pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+			"ROM: invalid mode '%s' on line %d.\n", argv[1], ln);
 		return(0);
 	}
     } else if (! strcmp(argv[0], "optional")) {
@@ -136,7 +137,8 @@ again:
 	mbstowcs(r->vidfn, argv[1], sizeof_w(r->vidfn));
 	sscanf(argv[2], "%i", &r->vidsz);
     } else {
-	pclog("ROM: invalid command '%s' on line %d.\n", argv[0], ln);
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"ROM: invalid command '%s' on line %d.\n", argv[0], ln);
 	return(0);
     }
 
@@ -219,7 +221,8 @@ parser(FILE *fp, romdef_t *r)
 					break;
 
 				default:
-					pclog("ROM: syntax error: escape '\\%c'", c);
+					pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+						"ROM: syntax error: escape '\\%c'", c);
 					*sp++ = '\\';
 					*sp++ = (char)c;
 			}
@@ -267,7 +270,9 @@ parser(FILE *fp, romdef_t *r)
 		/* Quoting means raw insertion. */
 		if (doquot) {
 			/* We are quoting, so insert as is. */
-			if (c == '\n') pclog("ROM: syntax error: unexpected newline, expected (\")\n");
+			if (c == '\n')
+				pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+					"ROM: syntax error: unexpected newline, expected (\")\n");
 			*sp++ = (char)c;
 			continue;
 		}
@@ -322,7 +327,8 @@ parser(FILE *fp, romdef_t *r)
 	*sp = '\0';
 	if (feof(fp)) break;
 	if (ferror(fp)) {
-		pclog("ROM: Read Error on line '%s'\n", l);
+		pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+			"ROM: Read Error on line '%s'\n", l);
 		return(0);
 	}
 	l++;
@@ -375,7 +381,8 @@ rom_load_bios(romdef_t *r, const wchar_t *fn, int test_only)
 
     /* Open the script file. */
     if ((fp = plat_fopen(rom_path(script), L"rb")) == NULL) {
-	pclog("ROM: unable to open '%ls'\n", rom_path(script));
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"ROM: unable to open '%ls'\n", rom_path(script));
 	return(0);
     }
 
@@ -471,7 +478,9 @@ rom_load_bios(romdef_t *r, const wchar_t *fn, int test_only)
 				i, r->total, biosmask);
     }
 
-    if (! i) pclog("ROM: error in script '%ls'\n", script);
+    if (! i)
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"ROM: error in script '%ls'\n", script);
 
     return(i);
 }
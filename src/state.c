@@ -0,0 +1,605 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Save and restore the state of a running machine.
+ *
+ *		A snapshot file starts with a header that identifies the
+ *		machine it was taken from (machine, CPU and memory size),
+ *		as a snapshot can only be restored into a machine that has
+ *		been configured identically. After that, the file consists
+ *		of tagged sections, each holding the state of one module:
+ *
+ *		  tag[4]	name of the section ("CPU ", "MEM " ..)
+ *		  len[4]	length of the section data
+ *		  data[len]	module-specific data
+ *
+ *		and it is closed off by an "END " section. Sections with
+ *		an unknown tag are skipped, and a module can never read
+ *		past the end of its own section, so older snapshots will
+ *		still load (as far as they go) if a module adds data.
+ *
+ *		Devices save their state using the save and load hooks
+ *		in their device_t, each into a "DEV " section of its own.
+ *		Simple modules without a device_t (like chipsets keeping
+ *		their registers in a static array) can register a block
+ *		of data with state_add(), which is saved as-is.
+ *
+ *		Not all devices have those hooks yet. A machine with a
+ *		video card, disk controller, disk drive or sound card that
+ *		can not save its state is refused, as its snapshot would
+ *		not restore. The contents of disk images are not part of
+ *		a snapshot, so they must not be changed after saving it.
+ *
+ *		Large blocks of data (RAM, mostly) are saved in pages of
+ *		4KB, with pages containing only zeroes skipped, and the
+ *		other ones compressed with LZF.
+ *
+ * Version:	@(#)state.c	1.0.4	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "emu.h"
+#include "cpu/cpu.h"
+#include "machines/machine.h"
+#include "mem.h"
+#include "timer.h"
+#include "device.h"
+#include "devices/system/dma.h"
+#include "devices/system/nmi.h"
+#include "devices/system/pic.h"
+#include "devices/system/pit.h"
+#include "devices/system/pci.h"
+#include "devices/disk/hdd.h"
+#include "devices/disk/hdc.h"
+#include "devices/disk/zip.h"
+#include "devices/cdrom/cdrom.h"
+#include "devices/scsi/scsi.h"
+#include "devices/sound/sound.h"
+#include "devices/video/video.h"
+#include "devices/floppy/lzf/lzf.h"
+#include "plat.h"
+#include "state.h"
+
+
+#define STATE_MAGIC	"VSTA"
+#define STATE_PAGE	4096			/* block page size */
+#define STATE_NAMELEN	64
+
+
+typedef struct _data_ {
+    char		name[STATE_NAMELEN];
+    void		*ptr;
+    uint32_t		size;
+    struct _data_	*next;
+} data_t;
+
+typedef struct {
+    char	tag[5];
+    void	(*save)(void);
+    void	(*load)(int version);
+} section_t;
+
+
+static FILE	*state_fp;
+static long	sect_start,			/* start of section data */
+		sect_end;			/* end of section (load) */
+static int	state_err;
+static data_t	*data_blocks = NULL;
+
+
+extern const device_t ps1vga_device;
+
+
+static void	data_save_state(void);
+static void	data_load_state(int version);
+
+
+/* All sections, in the order they are saved. */
+static const section_t sections[] = {
+  { "CPU ",	cpu_save_state,		cpu_load_state		},
+  { "MEM ",	mem_save_state,		mem_load_state		},
+  { "TIMR",	timer_save_state,	timer_load_state	},
+  { "PIC ",	pic_save_state,		pic_load_state		},
+  { "PIT ",	pit_save_state,		pit_load_state		},
+  { "DMA ",	dma_save_state,		dma_load_state		},
+  { "NMI ",	nmi_save_state,		nmi_load_state		},
+  { "PCI ",	pci_save_state,		pci_load_state		},
+  { "DATA",	data_save_state,	data_load_state		},
+  { "DEV ",	NULL,			device_load_state	},
+  { "",		NULL,			NULL			}
+};
+
+
+/* Start a new section. Its length is filled in by state_end(). */
+void
+state_begin(const char *tag)
+{
+    uint32_t len = 0;
+
+    (void)fwrite(tag, 1, 4, state_fp);
+    (void)fwrite(&len, sizeof(len), 1, state_fp);
+
+    sect_start = ftell(state_fp);
+}
+
+
+void
+state_end(void)
+{
+    uint32_t len;
+    long pos;
+
+    pos = ftell(state_fp);
+    len = (uint32_t)(pos - sect_start);
+
+    (void)fseek(state_fp, sect_start - (long)sizeof(len), SEEK_SET);
+    (void)fwrite(&len, sizeof(len), 1, state_fp);
+    (void)fseek(state_fp, pos, SEEK_SET);
+}
+
+
+void
+state_write(const void *ptr, uint32_t len)
+{
+    if (fwrite(ptr, 1, len, state_fp) != len)
+	state_err = 1;
+}
+
+
+/*
+ * Read data from the current section. Whatever is not in
+ * the file (short section, or a read error) is zeroed, and
+ * flagged as an error.
+ */
+void
+state_read(void *ptr, uint32_t len)
+{
+    uint32_t avail, got = 0;
+    long pos;
+
+    pos = ftell(state_fp);
+    avail = (pos < sect_end) ? (uint32_t)(sect_end - pos) : 0;
+    if (avail > len)
+	avail = len;
+
+    if (avail > 0)
+	got = (uint32_t)fread(ptr, 1, avail, state_fp);
+
+    if (got < len) {
+	memset((uint8_t *)ptr + got, 0x00, len - got);
+	state_err = 1;
+    }
+}
+
+
+void
+state_write_str(const char *str)
+{
+    uint8_t len = (uint8_t)strlen(str);
+
+    state_put(len);
+    state_write(str, len);
+}
+
+
+void
+state_read_str(char *bufp, int max_len)
+{
+    char temp[256];
+    uint8_t len;
+
+    state_get(len);
+    state_read(temp, len);
+    temp[len] = '\0';
+
+    if (len >= max_len)
+	temp[max_len - 1] = '\0';
+    strcpy(bufp, temp);
+}
+
+
+/*
+ * Write a large block of data.
+ *
+ * Each page is preceded by a 16-bit length, which is 0 for a
+ * page of zeroes (no data follows), the page size if the page
+ * did not compress (raw data follows), or the length of the
+ * LZF-compressed data that follows.
+ */
+void
+state_write_block(const uint8_t *ptr, uint32_t len)
+{
+    uint8_t buff[STATE_PAGE];
+    uint32_t i, n, c;
+    uint16_t plen;
+
+    state_put(len);
+
+    for (i = 0; i < len; i += n) {
+	n = len - i;
+	if (n > STATE_PAGE)
+		n = STATE_PAGE;
+
+	for (c = 0; c < n; c++)
+		if (ptr[i + c] != 0x00) break;
+	if (c == n) {
+		plen = 0;
+		state_put(plen);
+		continue;
+	}
+
+	c = lzf_compress(&ptr[i], n, buff, n - 1);
+	if (c > 0) {
+		plen = (uint16_t)c;
+		state_put(plen);
+		state_write(buff, c);
+	} else {
+		plen = (uint16_t)n;
+		state_put(plen);
+		state_write(&ptr[i], n);
+	}
+    }
+}
+
+
+void
+state_read_block(uint8_t *ptr, uint32_t len)
+{
+    uint8_t buff[STATE_PAGE];
+    uint32_t i, n, flen;
+    uint16_t plen;
+
+    state_get(flen);
+    if (flen != len) {
+	pclog("STATE: block size %lu, expected %lu\n", flen, len);
+	state_err = 1;
+	return;
+    }
+
+    for (i = 0; i < len; i += n) {
+	n = len - i;
+	if (n > STATE_PAGE)
+		n = STATE_PAGE;
+
+	state_get(plen);
+	if (state_err) break;
+
+	if (plen == 0) {
+		memset(&ptr[i], 0x00, n);
+	} else if (plen == n) {
+		state_read(&ptr[i], n);
+	} else if (plen < n) {
+		state_read(buff, plen);
+		if (lzf_decompress(buff, plen, &ptr[i], n) != n)
+			state_err = 1;
+	} else
+		state_err = 1;
+    }
+}
+
+
+int
+state_error(void)
+{
+    return(state_err);
+}
+
+
+/* Used by a module that can not use the data in its section. */
+void
+state_set_error(void)
+{
+    state_err = 1;
+}
+
+
+/*
+ * Register a block of static data to be saved. Blocks are
+ * identified by their name, so registering a name again
+ * (after a hard reset, for example) updates the entry.
+ */
+void
+state_add(const char *name, void *ptr, uint32_t size)
+{
+    data_t *dp;
+
+    for (dp = data_blocks; dp != NULL; dp = dp->next)
+	if (! strcmp(dp->name, name)) break;
+
+    if (dp == NULL) {
+	dp = (data_t *)malloc(sizeof(data_t));
+	memset(dp, 0x00, sizeof(data_t));
+	strncpy(dp->name, name, sizeof(dp->name) - 1);
+	dp->next = data_blocks;
+	data_blocks = dp;
+    }
+
+    dp->ptr = ptr;
+    dp->size = size;
+}
+
+
+static void
+data_save_state(void)
+{
+    data_t *dp;
+
+    for (dp = data_blocks; dp != NULL; dp = dp->next) {
+	state_write_str(dp->name);
+	state_put(dp->size);
+	state_write(dp->ptr, dp->size);
+    }
+}
+
+
+static void
+data_load_state(int version)
+{
+    char name[STATE_NAMELEN];
+    data_t *dp;
+    uint32_t size;
+
+    while (ftell(state_fp) < sect_end) {
+	state_read_str(name, sizeof(name));
+	state_get(size);
+	if (state_err) break;
+
+	for (dp = data_blocks; dp != NULL; dp = dp->next)
+		if (! strcmp(dp->name, name)) break;
+
+	if ((dp != NULL) && (dp->size == size)) {
+		state_read(dp->ptr, size);
+	} else {
+		pclog("STATE: skipping unknown data block '%s'\n", name);
+		(void)fseek(state_fp, size, SEEK_CUR);
+	}
+    }
+}
+
+
+/*
+ * Check if the state of the machine can be saved. This returns
+ * the name of the first device that is in the way, or NULL.
+ */
+static const char *
+state_check(void)
+{
+    const device_t *d;
+    int c;
+
+    /* Of the internal video devices, only the PS/1 VGA can. */
+    if ((video_card == VID_INTERNAL) || machines[machine].fixed_vidcard) {
+	if (((machines[machine].flags & MACHINE_VIDEO) ||
+	     machines[machine].fixed_vidcard) &&
+	    (device_get_priv(&ps1vga_device) == NULL))
+		return("internal video");
+    } else if (video_card != VID_NONE) {
+	d = video_card_getdevice(video_old_to_new(video_card));
+	if ((d != NULL) && (d->save == NULL))
+		return(d->name);
+    }
+    if (voodoo_enabled)
+	return("3Dfx Voodoo Graphics");
+
+    /* Hard disks can only be on an IDE controller that can. */
+    if (hdc_type > HDC_INTERNAL) {
+	d = hdc_get_device(hdc_type);
+	if ((d != NULL) && (d->save == NULL))
+		return(d->name);
+    }
+    for (c = 0; c < HDD_NUM; c++) {
+	if ((hdd[c].bus != HDD_BUS_DISABLED) &&
+	    (hdd[c].bus != HDD_BUS_IDE) && (hdd[c].bus != HDD_BUS_EIDE))
+		return("hard disk controller");
+    }
+    if (scsi_card != 0) {
+	d = scsi_card_getdevice(scsi_card);
+	if ((d != NULL) && (d->save == NULL))
+		return(d->name);
+    }
+
+    /* The CD-ROM and ZIP drives do not save their state. */
+    for (c = 0; c < CDROM_NUM; c++) {
+	if (cdrom_drives[c].bus_type != CDROM_BUS_DISABLED)
+		return("CD-ROM drive");
+    }
+    for (c = 0; c < ZIP_NUM; c++) {
+	if (zip_drives[c].bus_type != ZIP_BUS_DISABLED)
+		return("ZIP drive");
+    }
+
+    if (machines[machine].flags & MACHINE_SOUND)
+	return("internal sound");
+    if (sound_card != 0) {
+	d = sound_card_getdevice(sound_card);
+	if ((d != NULL) && (d->save == NULL))
+		return(d->name);
+    }
+
+    return(NULL);
+}
+
+
+/* Save the state of the machine to a file. */
+int
+state_save(const wchar_t *fn)
+{
+    const section_t *sp;
+    const char *str;
+    uint32_t ver;
+    int i;
+
+    str = state_check();
+    if (str != NULL) {
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"STATE: can not save the state of the %s, not saved\n", str);
+	return(0);
+    }
+
+    state_fp = plat_fopen(fn, L"wb");
+    if (state_fp == NULL) {
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"STATE: unable to create '%ls'\n", fn);
+	return(0);
+    }
+    state_err = 0;
+
+    /* Write the header. */
+    state_write(STATE_MAGIC, 4);
+    ver = STATE_VERSION;
+    state_put(ver);
+    state_write_str(machine_get_internal_name());
+    state_put(cpu_manufacturer);
+    state_put(cpu);
+    state_put(mem_size);
+
+    for (sp = sections; sp->tag[0] != '\0'; sp++) {
+	if (sp->save == NULL) continue;
+
+	state_begin(sp->tag);
+	sp->save();
+	state_end();
+    }
+
+    /* Devices write a section for each device. */
+    device_save_state();
+
+    state_begin("END ");
+    state_end();
+
+    i = !state_err;
+    if (fclose(state_fp) != 0)
+	i = 0;
+    state_fp = NULL;
+
+    if (i)
+	pclog("STATE: saved machine state to '%ls'\n", fn);
+      else
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"STATE: error writing '%ls'\n", fn);
+
+    return(i);
+}
+
+
+/*
+ * Restore the state of the machine from a file.
+ *
+ * Nothing is changed unless the header matches the machine
+ * as it is configured. If the file turns out to be damaged
+ * after that, the machine state is undefined, and the caller
+ * should reset the machine.
+ */
+int
+state_load(const wchar_t *fn)
+{
+    char temp[STATE_NAMELEN];
+    char tag[5];
+    const section_t *sp;
+    uint32_t ver, len;
+    int man, typ, sz;
+
+    state_fp = plat_fopen(fn, L"rb");
+    if (state_fp == NULL) {
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"STATE: unable to open '%ls'\n", fn);
+	return(0);
+    }
+    state_err = 0;
+
+    /* The header is not in a section, so allow it all. */
+    sect_end = 0x7fffffff;
+    memset(tag, 0x00, sizeof(tag));
+    state_read(tag, 4);
+    state_get(ver);
+    state_read_str(temp, sizeof(temp));
+    state_get(man);
+    state_get(typ);
+    state_get(sz);
+    if (state_err || strcmp(tag, STATE_MAGIC) || (ver > STATE_VERSION)) {
+	pclog("STATE: '%ls' is not a valid state file\n", fn);
+	(void)fclose(state_fp);
+	return(0);
+    }
+    if (strcmp(temp, machine_get_internal_name()) ||
+	(man != cpu_manufacturer) || (typ != cpu) || (sz != mem_size)) {
+	pclog("STATE: '%ls' is for a different machine (%s)\n", fn, temp);
+	(void)fclose(state_fp);
+	return(0);
+    }
+
+    for (;;) {
+	sect_end = 0x7fffffff;
+	state_read(tag, 4);
+	state_get(len);
+	if (state_err || !strcmp(tag, "END ")) break;
+
+	sect_start = ftell(state_fp);
+	sect_end = sect_start + (long)len;
+
+	for (sp = sections; sp->tag[0] != '\0'; sp++)
+		if (! strcmp(sp->tag, tag)) break;
+	if (sp->load != NULL)
+		sp->load((int)ver);
+	  else
+		pclog("STATE: skipping unknown section '%s'\n", tag);
+
+	if (state_err) {
+		pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+			"STATE: error in section '%s'\n", tag);
+		break;
+	}
+
+	(void)fseek(state_fp, sect_end, SEEK_SET);
+    }
+
+    (void)fclose(state_fp);
+    state_fp = NULL;
+
+    if (state_err) {
+	pclog_lvl(PCLOG_CAT_EMU, PCLOG_ERROR,
+		"STATE: error reading '%ls'\n", fn);
+	return(-1);
+    }
+
+    /* Make sure nothing cached refers to the old state. */
+    flushmmucache();
+    cpu_update_waitstates();
+#ifdef USE_DYNAREC
+    codegen_reset();
+#endif
+
+    pclog("STATE: restored machine state from '%ls'\n", fn);
+
+    return(1);
+}
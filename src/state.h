@@ -0,0 +1,73 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the machine state (snapshot) module.
+ *
+ * Version:	@(#)state.h	1.0.2	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef EMU_STATE_H
+# define EMU_STATE_H
+
+
+#define STATE_VERSION	2			/* bump on any format change */
+
+
+/* Save or load a single variable or structure. */
+#define state_put(x)	state_write(&(x), sizeof(x))
+#define state_get(x)	state_read(&(x), sizeof(x))
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int	state_save(const wchar_t *fn);
+extern int	state_load(const wchar_t *fn);
+
+/* Used by the modules to save and restore their data. */
+extern void	state_begin(const char *tag);
+extern void	state_end(void);
+extern void	state_write(const void *ptr, uint32_t len);
+extern void	state_read(void *ptr, uint32_t len);
+extern void	state_write_block(const uint8_t *ptr, uint32_t len);
+extern void	state_read_block(uint8_t *ptr, uint32_t len);
+extern void	state_write_str(const char *str);
+extern void	state_read_str(char *bufp, int max_len);
+extern int	state_error(void);
+extern void	state_set_error(void);
+
+extern void	state_add(const char *name, void *ptr, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/*EMU_STATE_H*/
@@ -0,0 +1,292 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Cycle count test for the 8088/8086 interpreter.
+ *
+ *		Runs a set of short instruction sequences one instruction
+ *		at a time with the timers frozen, and two longer programs
+ *		with the DRAM refresh, PIT and (for the second one) timer
+ *		interrupts running, and prints the cycles taken and the
+ *		resulting machine state.
+ *
+ *		The output has no meaning on its own. The "test808x"
+ *		target of the UNIX makefile links this program once with
+ *		the current core and once with the core from before the
+ *		prefetch queue became a ring buffer, runs both for the
+ *		8088 and the 8086, and fails if the outputs differ.
+ *
+ * Version:	@(#)cycles808x.c	1.0.1	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../cpu/cpu.h"
+#include "../cpu/x86.h"
+#include "../mem.h"
+#include "../timer.h"
+#include "../machines/machine.h"
+#include "../devices/system/pit.h"
+#include "../devices/system/pic.h"
+#include "../devices/system/dma.h"
+
+
+#define SEQ_SEG		0x0100		/* scratch area at 0x01000-0x01fff */
+#define SEQ_DATA	0x0800
+
+
+/* Internal to the core, but needed to start it up cleanly. */
+#ifdef USE_DYNAREC
+extern void	codegen_init(void);
+#endif
+extern int	nextcyc,
+		fetchcycles;
+
+
+static const struct {
+    const char	*name;
+    int		len;
+    uint8_t	code[48];
+} sequences[] = {
+  { "alu reg", 27, { 0x01,0xd8, 0x29,0xcb, 0x31,0xd1, 0x21,0xc2, 0x09,0xd0,
+		     0x39,0xc3, 0x88,0xc4, 0x8b,0xca, 0x05,0x34,0x12,
+		     0x24,0x0f, 0x83,0xc3,0x05, 0x80,0xf1,0x0f }		},
+  { "alu mem", 46, { 0x03,0x07, 0x03,0x04, 0x03,0x05, 0x03,0x00, 0x03,0x01,
+		     0x03,0x02, 0x03,0x03, 0x03,0x06,0x00,0x08,
+		     0x03,0x47,0x04, 0x03,0x46,0x08, 0x03,0x87,0x00,0x01,
+		     0x01,0x07, 0x26,0x03,0x07, 0x8a,0x4f,0x02,
+		     0x89,0x4c,0x06, 0x80,0x07,0x05, 0x83,0x6f,0x02,0x03 }	},
+  { "mul div", 37, { 0xb8,0x34,0x12, 0xb1,0x40, 0xf6,0xf1, 0xf7,0xe3,
+		     0x90, 0x90, 0x90, 0x90, 0xd1,0xe0, 0xd3,0xe0,
+		     0x31,0xd2, 0xb8,0x00,0x10, 0xbb,0x10,0x00, 0xf7,0xf3,
+		     0x90, 0x90, 0x90, 0x90, 0x90, 0x90,
+		     0xf6,0xe1, 0xf7,0x2f }					},
+  { "jumps",   24, { 0xeb,0x00, 0x74,0x00, 0x75,0x00, 0xe8,0x00,0x00, 0x58,
+		     0xe9,0x00,0x00, 0xb9,0x03,0x00, 0xe2,0xfe,
+		     0x72,0x00, 0x73,0x00, 0xe3,0x00 }				},
+  { "string",  32, { 0xfc, 0xbe,0x00,0x08, 0xbf,0x00,0x09, 0xb9,0x10,0x00,
+		     0xf3,0xa4, 0xb9,0x08,0x00, 0xf3,0xa5,
+		     0xb9,0x04,0x00, 0xf3,0xab, 0xac, 0xaa, 0xa6, 0xae, 0xa7,
+		     0xb9,0x05,0x00, 0xf3,0xa6 }				},
+  { "stack",   22, { 0x50, 0x53, 0x51, 0x52, 0x5a, 0x59, 0x5b, 0x58,
+		     0x9c, 0x9d, 0x1e, 0x1f, 0xff,0x37, 0x8f,0x07,
+		     0xe8,0x02,0x00, 0xeb,0x01, 0xc3 }				},
+  { "misc",    30, { 0x86,0xc3, 0x93, 0x98, 0x99, 0x9f, 0x9e, 0xd7,
+		     0x8d,0x40,0x05, 0xf5, 0x27, 0x2f, 0x37,
+		     0xd4,0x0a, 0xd5,0x0a, 0x2e,0x8b,0x07, 0x36,0x8b,0x07,
+		     0x3e,0x8b,0x07, 0xc4,0x1f }				}
+};
+
+
+/* Programs PIT channel 1 and DMA channel 0 for DRAM refresh, then
+ * loops over a mix of loads, ALU operations and MUL on a data area. */
+static const uint8_t prog1[] = {
+  0xb0,0x54, 0xe6,0x43, 0xb0,0x12, 0xe6,0x41, 0xe6,0x0c, 0xb0,0x58,
+  0xe6,0x0b, 0xb0,0xff, 0xe6,0x01, 0xe6,0x01, 0xb0,0x00, 0xe6,0x0a,
+  0xbe,0x00,0x20, 0xb9,0x40,0x00,
+  0xac, 0x00,0xc3, 0xd1,0xc3, 0x31,0x1e,0x00,0x30, 0x89,0xd8, 0xf7,0xe1,
+  0x01,0xc7, 0xff,0x06,0x02,0x30, 0xe2,0xeb,
+  0x50, 0x5a, 0xeb,0xe1
+};
+
+/* The same refresh setup, plus the PIC and a 1 kHz timer interrupt;
+ * the loop does string moves and HLTs every eighth time around. */
+static const uint8_t prog2[] = {
+  0xb0,0x54, 0xe6,0x43, 0xb0,0x12, 0xe6,0x41, 0xe6,0x0c, 0xb0,0x58,
+  0xe6,0x0b, 0xb0,0xff, 0xe6,0x01, 0xe6,0x01, 0xb0,0x00, 0xe6,0x0a,
+  0xb0,0x13, 0xe6,0x20, 0xb0,0x08, 0xe6,0x21, 0xb0,0x01, 0xe6,0x21,
+  0xb0,0xfe, 0xe6,0x21,
+  0xb0,0x34, 0xe6,0x43, 0xb0,0xe8, 0xe6,0x40, 0xb0,0x03, 0xe6,0x40,
+  0xc7,0x06,0x20,0x00,0x00,0x12, 0xc7,0x06,0x22,0x00,0x00,0x00, 0xfb,
+  0xfc, 0xbe,0x00,0x20, 0xbf,0x00,0x40, 0xb9,0x64,0x00, 0xf3,0xa4,
+  0x26,0x8b,0x1e,0x10,0x20, 0x01,0xd8, 0xf7,0xe3, 0xd1,0xe8,
+  0xa8,0x07, 0x75,0x01, 0xf4, 0xeb,0xe2
+};
+
+/* IRQ0 handler for prog2, counts the interrupts at 0000:3004. */
+static const uint8_t isr[] = {
+  0x50, 0xff,0x06,0x04,0x30, 0xb0,0x20, 0xe6,0x20, 0x58, 0xcf
+};
+
+
+static int
+find_cpu(const char *name)
+{
+    int k;
+
+    for (machine = 0; machines[machine].name != NULL; machine++) {
+	if (machines[machine].flags & MACHINE_AT) continue;
+
+	for (k = 0; k < 5; k++) {
+		if (machines[machine].cpu[k].cpus == NULL) continue;
+
+		for (cpu = 0; machines[machine].cpu[k].cpus[cpu].cpu_type != -1; cpu++) {
+			if (! strcmp(machines[machine].cpu[k].cpus[cpu].name, name)) {
+				cpu_manufacturer = k;
+				return(1);
+			}
+		}
+	}
+    }
+
+    return(0);
+}
+
+
+static void
+regs_print(void)
+{
+    printf(" ax=%04x bx=%04x cx=%04x dx=%04x si=%04x di=%04x bp=%04x sp=%04x fl=%04x %04x:%04x",
+	   AX, BX, CX, DX, SI, DI, BP, SP, flags, CS, cpu_state.pc);
+}
+
+
+/* Run the sequences with no time passing for the timers. */
+static void
+run_sequences(void)
+{
+    int c, d, steps, used, step;
+
+    xt_cpu_multi = 0;
+
+    for (c = 0; c < (int)(sizeof(sequences) / sizeof(sequences[0])); c++) {
+	/* Start each one as after a reset, with an empty queue. */
+	resetx86();
+
+	memset(&ram[SEQ_SEG << 4], 0x00, 4096);
+	memcpy(&ram[SEQ_SEG << 4], sequences[c].code, sequences[c].len);
+	for (d = SEQ_DATA; d < 4096; d++)
+		ram[(SEQ_SEG << 4) + d] = d * 37 + 5;
+
+	loadcs(SEQ_SEG);
+	loadseg(SEQ_SEG, &_ds);
+	loadseg(SEQ_SEG, &_es);
+	loadseg(SEQ_SEG, &_ss);
+	AX = 0x0102; BX = SEQ_DATA; CX = 3; DX = 0;
+	SI = 0x10; DI = 0x20; BP = 0x30; SP = 0xf00;
+	flags = 2;
+	cpu_state.pc = 0;
+	cpu_state.ssegs = 0;
+	cycles = 0;
+	nextcyc = 0;
+	fetchcycles = 0;
+
+	printf("%-8s", sequences[c].name);
+	used = 0;
+	for (steps = 0; steps < 1000; steps++) {
+		if (CS != SEQ_SEG || cpu_state.pc == sequences[c].len) break;
+
+		execx86(1 - cycles);
+		step = 1 - cycles;
+		used += step;
+		printf(" %i", step);
+	}
+	printf(" = %i\n        ", used);
+	regs_print();
+	printf("\n");
+    }
+}
+
+
+static void
+run_program(const char *name, const uint8_t *code, int len, int frames)
+{
+    uint32_t h = 0;
+    int i;
+
+    resetx86();
+
+    memset(ram, 0x00, 0x10000);
+    memcpy(&ram[0x1000], code, len);
+    memcpy(&ram[0x1200], isr, sizeof(isr));
+    for (i = 0; i < 64; i++)
+	ram[0x2000 + i] = i * 37 + 5;
+
+    loadcs(0x0000);
+    loadseg(0x0000, &_ds);
+    loadseg(0x0000, &_es);
+    loadseg(0x0000, &_ss);
+    cpu_state.pc = 0x1000;
+    SP = 0x8000;
+    ins = 0;
+
+    for (i = 0; i < frames; i++)
+	execx86(machines[machine].cpu[cpu_manufacturer].cpus[cpu].rspeed / 100);
+
+    for (i = 0; i < 0x10000; i++)
+	h = h * 31 + ram[i];
+
+    printf("%-8s ins=%i cyc=%i", name, ins, cycles);
+    regs_print();
+    printf("\n         [3000]=%04x [3002]=%04x [3004]=%04x dma0=%x pit1=%lld tc=%lld h=%08x\n",
+	   *(uint16_t *)&ram[0x3000], *(uint16_t *)&ram[0x3002],
+	   *(uint16_t *)&ram[0x3004], dma[0].ac, (long long)pit.c[1],
+	   (long long)timer_count, h);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    if (argc != 2) {
+	fprintf(stderr, "Usage: %s <cpu name>, for example 8088/4.77\n", argv[0]);
+	return(2);
+    }
+    if (! find_cpu(argv[1])) {
+	fprintf(stderr, "%s: no XT class machine with a '%s' processor\n", argv[0], argv[1]);
+	return(2);
+    }
+
+    AT = 0;
+    mem_size = 640;
+    cpu_set();
+    mem_init();
+    mem_reset();
+#ifdef USE_DYNAREC
+    codegen_init();
+#endif
+
+    printf("%s\n", argv[1]);
+    run_sequences();
+
+    timer_reset();
+    pic_init();
+    dma_init();
+    pit_init();
+    setpitclock(14318184.0);
+    pit_set_out_func(&pit, 1, pit_refresh_timer_xt);
+
+    run_program("prog1", prog1, sizeof(prog1), 100);
+    run_program("prog2", prog2, sizeof(prog2), 100);
+
+    return(0);
+}
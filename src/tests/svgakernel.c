@@ -0,0 +1,293 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Test and benchmark for the SVGA scanline kernels.
+ *
+ *		The high-resolution SVGA renderers convert a scanline with
+ *		a kernel when it is one unbroken run of VRAM, and do it one
+ *		pixel at a time themselves when it wraps around the end of
+ *		VRAM. This program feeds the same random scanline to both
+ *		paths of each renderer, once with the line starting where
+ *		it wraps and once with it at an ordinary address, for each
+ *		kernel level the host supports, and checks that the pixels
+ *		written and the address the renderer ends at are the same.
+ *		It then times a 1024x768 frame on both paths.
+ *
+ *		Run it with the "testsvga" target of the UNIX makefile.
+ *		It exits with a non-zero status if anything differs.
+ *
+ * Version:	@(#)svgakernel.c	1.0.1	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../mem.h"
+#include "../devices/video/video.h"
+#include "../devices/video/vid_svga.h"
+#include "../devices/video/vid_svga_render.h"
+
+
+#define VRAM_SIZE	(4 << 20)
+#define VRAM_SLACK	16		/* renderers read a little past ma */
+#define LINE_MAX	2048		/* width of buffer32 */
+#define KERNEL_BASE	(1 << 20)	/* where the unbroken runs go */
+#define BENCH_WIDTH	1024
+#define BENCH_LINES	768
+#define BENCH_FRAMES	50
+
+
+static const struct {
+    const char	*name;
+    void	(*render)(svga_t *svga);
+    int		align;			/* pixels done per step */
+    int		nibbles;		/* VRAM nibbles per pixel */
+} modes[] = {
+  { "4bpp",  svga_render_4bpp_highres,  8, 1 },
+  { "8bpp",  svga_render_8bpp_highres,  8, 2 },
+  { "15bpp", svga_render_15bpp_highres, 8, 4 },
+  { "16bpp", svga_render_16bpp_highres, 8, 4 },
+  { "24bpp", svga_render_24bpp_highres, 4, 6 },
+  { "32bpp", svga_render_32bpp_highres, 1, 8 }
+};
+#define NR_MODES	(int)(sizeof(modes) / sizeof(modes[0]))
+
+static const char *level_names[] = { "C", "SSE2", "AVX2" };
+
+
+static svga_t	svga;
+static uint8_t	line_data[LINE_MAX * 4];
+static uint32_t	seed = 0x12345678;
+
+
+static uint32_t
+random_next(void)
+{
+    seed = (seed * 1103515245) + 12345;
+
+    return(seed >> 8);
+}
+
+
+/* Number of pixels and VRAM bytes the renderers do for a width. */
+static int
+mode_pixels(int mode, int hdisp)
+{
+    return((hdisp + modes[mode].align) & ~(modes[mode].align - 1));
+}
+
+
+static int
+mode_bytes(int mode, int hdisp)
+{
+    return((mode_pixels(mode, hdisp) * modes[mode].nibbles) >> 1);
+}
+
+
+/* Keep the bytes past the end of VRAM the same as its start. */
+static void
+vram_mirror(void)
+{
+    memcpy(&svga.vram[VRAM_SIZE], svga.vram, VRAM_SLACK);
+}
+
+
+/* Put the scanline at 'ma', wrapping around the end of VRAM. */
+static void
+vram_put(uint32_t ma, int len)
+{
+    int c;
+
+    for (c = 0; c < len; c++)
+	svga.vram[(ma + c) & svga.vram_display_mask] = line_data[c];
+}
+
+
+/* Render one scanline into row 'displine' of buffer32. */
+static uint32_t
+render(int mode, uint32_t ma, int hdisp, int displine)
+{
+    svga.ma = ma;
+    svga.hdisp = hdisp;
+    svga.displine = displine;
+    svga.firstline_draw = 2000;
+
+    modes[mode].render(&svga);
+
+    return(svga.ma);
+}
+
+
+/*
+ * Check one mode at one kernel level, for every width up to a few
+ * steps (to cover the tails), some real ones, and all alignments
+ * of the source. Returns the number of cases that differ.
+ */
+static int
+check_mode(int mode, int level)
+{
+    static const int widths[] = { 640, 720, 800, 1024, 1152, 1280, 1600 };
+    uint32_t ma_s, ma_k, end_s, end_k;
+    uint32_t *row_s, *row_k;
+    int c, i, hdisp, len, o;
+
+    row_s = (uint32_t *)buffer32->line[0];
+    row_k = (uint32_t *)buffer32->line[1];
+
+    for (c = 0; c < 72 + (int)(sizeof(widths) / sizeof(widths[0])); c++) {
+	hdisp = (c < 72) ? c : (widths[c - 72] - 1);
+	len = mode_bytes(mode, hdisp);
+
+	for (o = 0; o < 4; o++) {
+		for (i = 0; i < len; i++)
+			line_data[i] = (uint8_t)random_next();
+
+		/* Start about halfway through, so that it wraps. */
+		ma_s = VRAM_SIZE - ((len + o) >> 1);
+		ma_k = KERNEL_BASE + o;
+		vram_put(ma_s, len);
+		vram_put(ma_k, len);
+		vram_mirror();
+
+		memset(row_s, 0x55, LINE_MAX * sizeof(uint32_t));
+		memset(row_k, 0x55, LINE_MAX * sizeof(uint32_t));
+
+		end_s = render(mode, ma_s, hdisp, 0);
+		end_k = render(mode, ma_k, hdisp, 1);
+
+		if (memcmp(row_s, row_k, LINE_MAX * sizeof(uint32_t)) ||
+		    (((end_s - ma_s) & svga.vram_display_mask) !=
+		     ((end_k - ma_k) & svga.vram_display_mask))) {
+			printf("%s %s: width %i offset %i differs\n",
+			       modes[mode].name, level_names[level], hdisp + 1, o);
+			return(1);
+		}
+	}
+    }
+
+    return(0);
+}
+
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return(ts.tv_sec + (ts.tv_nsec / 1e9));
+}
+
+
+/*
+ * Time a frame of a mode. With 'wrap' set, every scanline starts
+ * where it wraps around the end of VRAM, so the renderer does all
+ * of them by itself. Returns the time for one frame, in ms.
+ */
+static double
+bench_mode(int mode, int wrap)
+{
+    uint32_t ma;
+    double t;
+    int f, y, len;
+
+    len = mode_bytes(mode, BENCH_WIDTH - 1);
+    for (y = 0; y < len; y++)
+	line_data[y] = (uint8_t)random_next();
+    for (y = 0; y < BENCH_LINES; y++)
+	vram_put(KERNEL_BASE + (y * len), len);
+    vram_put(VRAM_SIZE - 8, len);
+    vram_mirror();
+
+    t = now();
+    for (f = 0; f < BENCH_FRAMES; f++) {
+	for (y = 0; y < BENCH_LINES; y++) {
+		ma = wrap ? (VRAM_SIZE - 8) : (KERNEL_BASE + (y * len));
+		render(mode, ma, BENCH_WIDTH - 1, y);
+	}
+    }
+
+    return(((now() - t) * 1000.0) / BENCH_FRAMES);
+}
+
+
+int
+main(int argc, char **argv)
+{
+    double kernel, scalar[NR_MODES];
+    int bad, c, level, mode;
+
+    video_init();
+
+    svga.vram = malloc(VRAM_SIZE + VRAM_SLACK);
+    svga.changedvram = malloc((VRAM_SIZE >> 12) + 4);
+    memset(svga.vram, 0x00, VRAM_SIZE + VRAM_SLACK);
+    memset(svga.changedvram, 0x00, (VRAM_SIZE >> 12) + 4);
+    svga.vram_display_mask = VRAM_SIZE - 1;
+    svga.fullchange = 1;
+    svga.plane_mask = 0x0f;
+    for (c = 0; c < 16; c++)
+	svga.egapal[c] = (uint8_t)random_next();
+    for (c = 0; c < 256; c++)
+	svga.pallook[c] = random_next() & 0xffffff;
+
+    printf("%-6s %-5s %10s %10s %8s\n",
+	   "mode", "level", "kernel", "renderer", "speedup");
+
+    for (mode = 0; mode < NR_MODES; mode++)
+	scalar[mode] = bench_mode(mode, 1);
+
+    bad = 0;
+    for (level = 0; level < 3; level++) {
+	/* Levels the host does not have are not selected. */
+	if (svga_kernel_init(level) != level) break;
+
+	for (mode = 0; mode < NR_MODES; mode++) {
+		if (check_mode(mode, level)) {
+			bad++;
+			continue;
+		}
+
+		kernel = bench_mode(mode, 0);
+		printf("%-6s %-5s %8.3fms %8.3fms %7.2fx\n",
+		       modes[mode].name, level_names[level],
+		       kernel, scalar[mode], scalar[mode] / kernel);
+	}
+    }
+
+    if (bad)
+	printf("%i kernels differ from the renderers\n", bad);
+
+    return(bad ? 1 : 0);
+}
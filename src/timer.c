@@ -8,7 +8,19 @@
  *
  *		System timer module.
  *
- * Version:	@(#)timer.c	1.0.1	2018/02/14
+ *		Timers come in two flavors. Legacy timers, registered
+ *		using timer_add(), have their count and enable values
+ *		owned by the device, which modifies them directly. We
+ *		cannot know when those change, so they are scanned on
+ *		every timer event.
+ *
+ *		Scheduled timers, created with timer_new(), are armed
+ *		with an absolute deadline, and live in a binary heap
+ *		ordered by that deadline. Only the top of the heap has
+ *		to be checked to see if anything is due, and arming,
+ *		disarming or re-arming one is O(log n).
+ *
+ * Version:	@(#)timer.c	1.0.5	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -42,135 +54,490 @@
 #include <wchar.h>
 #include "emu.h"
 #include "timer.h"
+#include "state.h"
+#include "plat.h"
+
+
+#define TIMERS_MAX	64
+
+#define TMR_PRESENT	0x01			/* slot is in use */
+#define TMR_LEGACY	0x02			/* old-style count/enable */
+
+
+typedef struct {
+    int		flags;
+    int		heap;				/* position in heap, or -1 */
+    void	(*callback)(void *priv);
+    void	*priv;
+    int64_t	*enable;			/* legacy timers only */
+    int64_t	*count;				/* legacy timers only */
+    int64_t	when;				/* absolute deadline */
+} tmr_t;
+
+
+int64_t		TIMER_USEC;
+int64_t		timers_present = 0;
+int64_t		timer_one = 1;
+int64_t		timer_count = 0,
+		timer_latch = 0;
+int64_t		timer_start = 0;
+int		timer_profile = 0;
+uint64_t	timer_host_time = 0;
+
+
+static tmr_t	timers[TIMERS_MAX];
+static int	legacy[TIMERS_MAX];		/* slots of legacy timers */
+static int	legacy_num;
+static int	heap[TIMERS_MAX];		/* min-heap of armed timers */
+static int	heap_num;
+static int64_t	timer_time;			/* time at last event */
+
+
+/* Swap two heap entries, and update their back-pointers. */
+static void
+heap_swap(int a, int b)
+{
+    int t = heap[a];
+
+    heap[a] = heap[b];
+    heap[b] = t;
+    timers[heap[a]].heap = a;
+    timers[heap[b]].heap = b;
+}
 
 
-#define TIMERS_MAX 64
+static void
+heap_up(int i)
+{
+    int p;
+
+    while (i > 0) {
+	p = (i - 1) >> 1;
+	if (timers[heap[p]].when <= timers[heap[i]].when)
+		break;
+	heap_swap(i, p);
+	i = p;
+    }
+}
+
+
+static void
+heap_down(int i)
+{
+    int c;
+
+    for (;;) {
+	c = (i << 1) + 1;
+	if (c >= heap_num)
+		break;
+	if ((c + 1) < heap_num &&
+	    timers[heap[c + 1]].when < timers[heap[c]].when)
+		c++;
+	if (timers[heap[i]].when <= timers[heap[c]].when)
+		break;
+	heap_swap(i, c);
+	i = c;
+    }
+}
 
 
-static struct
+static void
+heap_remove(tmr_t *tmr)
 {
-	int64_t present;
-	void (*callback)(void *priv);
-	void *priv;
-	int64_t *enable;
-	int64_t *count;
-} timers[TIMERS_MAX];
+    int i = tmr->heap;
 
+    tmr->heap = -1;
+    if (--heap_num == i)
+	return;
 
-int64_t TIMER_USEC;
-int64_t timers_present = 0;
-int64_t timer_one = 1;
-	
-int64_t timer_count = 0, timer_latch = 0;
-int64_t timer_start = 0;
+    heap[i] = heap[heap_num];
+    timers[heap[i]].heap = i;
+    heap_up(i);
+    heap_down(timers[heap[i]].heap);
+}
 
 
-void timer_process(void)
+/* Run a timer's callback, and optionally measure the host time it took. */
+static void
+timer_call(tmr_t *tmr)
 {
-	int64_t c;
-	int64_t process = 0;
-	/*Get actual elapsed time*/
-	int64_t diff = timer_latch - timer_count;
-	int64_t enable[TIMERS_MAX];
+    static int depth = 0;
+    uint64_t start;
+
+    /* Callbacks can cause timer events, so only count the outer one. */
+    if (!timer_profile || depth) {
+	tmr->callback(tmr->priv);
+	return;
+    }
+
+    depth++;
+    start = plat_timer_read();
+    tmr->callback(tmr->priv);
+    timer_host_time += (plat_timer_read() - start);
+    depth--;
+}
 
-	timer_latch = 0;
 
-        for (c = 0; c < timers_present; c++)
-        {
-		/* This is needed to avoid timer crashes on hard reset. */
-		if ((timers[c].enable == NULL) || (timers[c].count == NULL))
-		{
-			continue;
+/*
+ * If the new deadline is before the end of the current
+ * execution period, shorten that period. We keep the
+ * elapsed time (timer_latch - timer_count) intact, so
+ * timer_process() still sees the right difference.
+ */
+static void
+shorten_period(int64_t when)
+{
+    int64_t diff = (when - timer_get_time()) - timer_count;
+
+    if (diff < 0) {
+	timer_count += diff;
+	timer_latch += diff;
+    }
+}
+
+
+void
+timer_process(void)
+{
+    int64_t enable[TIMERS_MAX];
+    int64_t diff, lowest;
+    int c, lowest_c;
+    int process = 0;
+
+    /* Get actual elapsed time. */
+    diff = timer_latch - timer_count;
+    timer_time += diff;
+    timer_latch = timer_count;
+
+    for (c = 0; c < legacy_num; c++) {
+	tmr_t *tmr = &timers[legacy[c]];
+
+	/* This is needed to avoid timer crashes on hard reset. */
+	if ((tmr->enable == NULL) || (tmr->count == NULL)) {
+		enable[c] = 0;
+		continue;
+	}
+
+	enable[c] = *tmr->enable;
+	if (enable[c]) {
+		*tmr->count -= diff;
+		if (*tmr->count <= 0)
+			process = 1;
+	}
+    }
+
+    if (!process && (!heap_num || (timers[heap[0]].when > timer_time)))
+	return;
+
+    /*
+     * Run the callbacks for all timers that are due, the
+     * most overdue one first. A callback can (re-)arm any
+     * timer, including itself, so we have to look at the
+     * heap again after each one.
+     */
+    for (;;) {
+	lowest = 1;
+	lowest_c = -1;
+
+	for (c = 0; c < legacy_num; c++) {
+		if (enable[c] && (*timers[legacy[c]].count < lowest)) {
+			lowest = *timers[legacy[c]].count;
+			lowest_c = c;
 		}
-                enable[c] = *timers[c].enable;
-                if (*timers[c].enable)
-                {
-                        *timers[c].count = *timers[c].count - diff;
-                        if (*timers[c].count <= 0)
-                                process = 1;
-                }
-        }
-        
-        if (!process)
-                return;
-
-        while (1)
-        {
-                int64_t lowest = 1, lowest_c;
-                
-                for (c = 0; c < timers_present; c++)
-                {
-                        if (enable[c])
-                        {
-                                if (*timers[c].count < lowest)
-                                {
-                                        lowest = *timers[c].count;
-                                        lowest_c = c;
-                                }
-                        }
-                }
-                
-                if (lowest > 0)
-                        break;
-
-                timers[lowest_c].callback(timers[lowest_c].priv);
-                enable[lowest_c] = *timers[lowest_c].enable;
-        }              
-}
-
-
-void timer_update_outstanding(void)
-{
-	int64_t c;
-	timer_latch = 0x7fffffffffffffff;
-	for (c = 0; c < timers_present; c++)
-	{
-		if (*timers[c].enable && *timers[c].count < timer_latch)
-			timer_latch = *timers[c].count;
 	}
-	timer_count = timer_latch = (timer_latch + ((1 << TIMER_SHIFT) - 1));
+
+	if (heap_num && ((timers[heap[0]].when - timer_time) < lowest)) {
+		tmr_t *tmr = &timers[heap[0]];
+
+		/* Expired, so it is no longer armed. */
+		heap_remove(tmr);
+		timer_call(tmr);
+		continue;
+	}
+
+	if (lowest_c < 0)
+		break;
+
+	timer_call(&timers[legacy[lowest_c]]);
+	enable[lowest_c] = *timers[legacy[lowest_c]].enable;
+    }
 }
 
 
-void timer_reset(void)
+void
+timer_update_outstanding(void)
 {
-	/* pclog("timer_reset\n"); */
-	timers_present = 0;
-	timer_latch = timer_count = 0;
+    int64_t *count;
+    int c;
+
+    timer_latch = 0x7fffffffffffffff;
+
+    for (c = 0; c < legacy_num; c++) {
+	count = timers[legacy[c]].count;
+	if (*timers[legacy[c]].enable && (*count < timer_latch))
+		timer_latch = *count;
+    }
+
+    if (heap_num && ((timers[heap[0]].when - timer_time) < timer_latch))
+	timer_latch = timers[heap[0]].when - timer_time;
+
+    timer_count = timer_latch = (timer_latch + ((1 << TIMER_SHIFT) - 1));
 }
 
 
-int64_t timer_add(void (*callback)(void *priv), int64_t *count, int64_t *enable, void *priv)
+void
+timer_reset(void)
 {
-	int64_t i = 0;
+    /* pclog("timer_reset\n"); */
+    timers_present = 0;
+    legacy_num = heap_num = 0;
+    timer_latch = timer_count = 0;
+    timer_time = 0;
+}
 
-	if (timers_present < TIMERS_MAX)
-	{
-		if (timers_present != 0)
-		{
-			/* This is the sanity check - it goes through all present timers and makes sure we're not adding a timer that already exists. */
-			for (i = 0; i < timers_present; i++)
-			{
-				if (timers[i].present && (timers[i].callback == callback) && (timers[i].priv == priv) && (timers[i].count == count) && (timers[i].enable == enable))
-				{
-					return 0;
-				}
-			}
-		}
 
-		timers[timers_present].present = 1;
-		timers[timers_present].callback = callback;
-		timers[timers_present].priv = priv;
-		timers[timers_present].count = count;
-		timers[timers_present].enable = enable;
-		timers_present++;
-		return timers_present - 1;
+/* Register an old-style timer, using device-owned count and enable. */
+int64_t
+timer_add(void (*callback)(void *priv), int64_t *count, int64_t *enable, void *priv)
+{
+    tmr_t *tmr;
+    int i;
+
+    if (timers_present >= TIMERS_MAX)
+	return(-1);
+
+    /*
+     * This is the sanity check - it goes through all present timers
+     * and makes sure we're not adding a timer that already exists.
+     */
+    for (i = 0; i < legacy_num; i++) {
+	tmr = &timers[legacy[i]];
+	if ((tmr->callback == callback) && (tmr->priv == priv) &&
+	    (tmr->count == count) && (tmr->enable == enable))
+		return(0);
+    }
+
+    tmr = &timers[timers_present];
+    tmr->flags = (TMR_PRESENT | TMR_LEGACY);
+    tmr->heap = -1;
+    tmr->callback = callback;
+    tmr->priv = priv;
+    tmr->count = count;
+    tmr->enable = enable;
+    legacy[legacy_num++] = (int)timers_present;
+
+    return(timers_present++);
+}
+
+
+void
+timer_set_callback(int64_t timer, void (*callback)(void *priv))
+{
+    timers[timer].callback = callback;
+}
+
+
+/* Create a new (unarmed) scheduled timer. */
+int64_t
+timer_new(void (*callback)(void *priv), void *priv)
+{
+    tmr_t *tmr;
+    int i;
+
+    if (timers_present >= TIMERS_MAX)
+	return(-1);
+
+    /* Same sanity check as for the legacy timers. */
+    for (i = 0; i < timers_present; i++) {
+	tmr = &timers[i];
+	if (!(tmr->flags & TMR_LEGACY) &&
+	    (tmr->callback == callback) && (tmr->priv == priv))
+		return(i);
+    }
+
+    tmr = &timers[timers_present];
+    memset(tmr, 0x00, sizeof(tmr_t));
+    tmr->flags = TMR_PRESENT;
+    tmr->heap = -1;
+    tmr->callback = callback;
+    tmr->priv = priv;
+
+    return(timers_present++);
+}
+
+
+/* Arm (or re-arm) a timer to expire at absolute time 'when'. */
+void
+timer_arm(int64_t timer, int64_t when)
+{
+    tmr_t *tmr;
+
+    if (timer < 0)
+	return;
+    tmr = &timers[timer];
+    if (tmr->flags & TMR_LEGACY)
+	return;
+
+    tmr->when = when;
+    if (tmr->heap < 0) {
+	tmr->heap = heap_num;
+	heap[heap_num++] = (int)timer;
+	heap_up(tmr->heap);
+    } else {
+	heap_up(tmr->heap);
+	heap_down(tmr->heap);
+    }
+
+    shorten_period(when);
+}
+
+
+void
+timer_disarm(int64_t timer)
+{
+    if ((timer < 0) || (timers[timer].heap < 0))
+	return;
+
+    heap_remove(&timers[timer]);
+}
+
+
+/*
+ * Re-arm a timer 'delay' units after its previous deadline.
+ *
+ * This is what periodic timers should use from their callback,
+ * as it does not accumulate any drift caused by the callback
+ * being called a little late.
+ */
+void
+timer_reschedule(int64_t timer, int64_t delay)
+{
+    if (timer < 0)
+	return;
+
+    timer_arm(timer, timers[timer].when + delay);
+}
+
+
+int
+timer_is_armed(int64_t timer)
+{
+    if (timer < 0)
+	return(0);
+
+    return(timers[timer].heap >= 0);
+}
+
+
+/* Return the current emulated time, in timer units. */
+int64_t
+timer_get_time(void)
+{
+    return(timer_time + (timer_latch - timer_count));
+}
+
+
+int64_t
+timer_get_deadline(int64_t timer)
+{
+    return(timers[timer].when);
+}
+
+
+/*
+ * Save the state of all timers.
+ *
+ * Timers are always created in the same order for identically
+ * configured machines, so we can simply save them by slot. For
+ * legacy timers, we also save the device-owned count and enable
+ * values, so devices do not have to do that themselves.
+ */
+void
+timer_save_state(void)
+{
+    int64_t count, enable;
+    tmr_t *tmr;
+    int c, armed;
+
+    state_put(timers_present);
+    state_put(timer_time);
+    state_put(timer_count);
+    state_put(timer_latch);
+    state_put(timer_start);
+
+    for (c = 0; c < timers_present; c++) {
+	tmr = &timers[c];
+
+	armed = (tmr->heap >= 0);
+	count = enable = 0;
+	if ((tmr->flags & TMR_LEGACY) &&
+	    (tmr->count != NULL) && (tmr->enable != NULL)) {
+		count = *tmr->count;
+		enable = *tmr->enable;
 	}
-	return -1;
+
+	state_put(tmr->flags);
+	state_put(tmr->when);
+	state_put(armed);
+	state_put(count);
+	state_put(enable);
+    }
 }
 
 
-void timer_set_callback(int64_t timer, void (*callback)(void *priv))
+void
+timer_load_state(int version)
 {
-	timers[timer].callback = callback;
+    int64_t n, when, count, enable, old_time;
+    tmr_t *tmr;
+    int c, fl, armed;
+
+    state_get(n);
+    if (n != timers_present) {
+	pclog("TIMER: state has %i timers, we have %i, ignored\n",
+					(int)n, (int)timers_present);
+	return;
+    }
+
+    old_time = timer_time;
+    state_get(timer_time);
+    state_get(timer_count);
+    state_get(timer_latch);
+    state_get(timer_start);
+
+    heap_num = 0;
+    for (c = 0; c < timers_present; c++) {
+	tmr = &timers[c];
+
+	state_get(fl);
+	state_get(when);
+	state_get(armed);
+	state_get(count);
+	state_get(enable);
+
+	/*
+	 * The heap is rebuilt from scratch, so whatever position the
+	 * timer had is gone. If it does not match, keep it as it was,
+	 * moved to the new clock, as a periodic timer is only armed
+	 * again from its own callback and would otherwise stop.
+	 */
+	if (fl != tmr->flags) {
+		pclog("TIMER: timer %i does not match, kept\n", c);
+		armed = (tmr->heap >= 0);
+		when = timer_time + (tmr->when - old_time);
+	} else if (tmr->flags & TMR_LEGACY) {
+		if (tmr->count != NULL)
+			*tmr->count = count;
+		if ((tmr->enable != NULL) && (tmr->enable != &timer_one))
+			*tmr->enable = enable;
+	}
+
+	tmr->heap = -1;
+	tmr->when = when;
+	if (armed && !(tmr->flags & TMR_LEGACY)) {
+		tmr->heap = heap_num;
+		heap[heap_num++] = c;
+		heap_up(tmr->heap);
+	}
+    }
 }
@@ -8,7 +8,7 @@
  *
  *		Definitions for the system timer module.
  *
- * Version:	@(#)timer.h	1.0.2	2018/05/04
+ * Version:	@(#)timer.h	1.0.4	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -80,14 +80,50 @@ extern int64_t timer_start;
 extern void timer_process(void);
 extern void timer_update_outstanding(void);
 extern void timer_reset(void);
+
+/*
+ * Legacy interface.
+ *
+ * The device owns the count and enable variables, and modifies
+ * them directly. The scheduler has to poll these, so they cost
+ * a (short) linear scan on every timer event. New code should
+ * use the event scheduler interface below instead.
+ */
 extern int64_t timer_add(void (*callback)(void *priv), int64_t *count, int64_t *enable, void *priv);
 extern void timer_set_callback(int64_t timer, void (*callback)(void *priv));
 
+/*
+ * Event scheduler interface.
+ *
+ * Timers are armed with an absolute deadline, expressed in the
+ * same units as the legacy counts (TIMER_USEC per microsecond),
+ * and relative to timer_get_time(). Armed timers are kept in a
+ * priority queue, so arming and disarming are O(log n), and the
+ * scheduler never has to look at timers which are not due.
+ *
+ * Note that, just like with the legacy interface, the current
+ * time is only exact after a timer_clock() if called from an
+ * I/O handler in the middle of an execution period.
+ */
+extern int64_t timer_new(void (*callback)(void *priv), void *priv);
+extern void timer_arm(int64_t timer, int64_t when);
+extern void timer_disarm(int64_t timer);
+extern void timer_reschedule(int64_t timer, int64_t delay);
+extern int timer_is_armed(int64_t timer);
+extern int64_t timer_get_time(void);
+extern int64_t timer_get_deadline(int64_t timer);
+
+extern void timer_save_state(void);
+extern void timer_load_state(int version);
+
 #define TIMER_ALWAYS_ENABLED &timer_one
 
 extern int64_t timer_count;
 extern int64_t timer_one;
 
+extern int timer_profile;			/* measure callback time */
+extern uint64_t timer_host_time;		/* host time in callbacks */
+
 #define TIMER_SHIFT 6
 
 extern int64_t TIMER_USEC;
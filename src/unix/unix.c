@@ -0,0 +1,611 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Platform main support module for (headless) UNIX systems.
+ *
+ *		This platform has no user interface at all; it is meant
+ *		for running the emulator unattended, for example with the
+ *		--bench option, on build and test servers.
+ *
+ * Version:	@(#)unix.c	1.0.4	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <locale.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../config.h"
+#include "../ui/ui.h"
+#include "../ui/ui_resource.h"
+#include "../ui/lang/VARCem-EN.str"
+#define GLOBAL
+#include "../plat.h"
+#include "../state.h"
+#include "../worker.h"
+#include "unix.h"
+
+
+/* The list with supported VidAPI modules. */
+const vidapi_t *plat_vidapis[] = {
+    &null_vidapi,
+
+    NULL
+};
+
+/* Our (English-only) strings table, generated from the resources. */
+static const string_t	unix_strings[] = {
+#include "unix_strings.h"
+    { 0, NULL }
+};
+const string_t		*plat_strings;
+
+
+/* Local data. */
+static pthread_mutex_t	blit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static thread_t		*thMain;		/* main thread */
+static char		self_path[1024];	/* our executable */
+
+
+/* Handle the termination signals, we just ask the emulator to stop. */
+static void
+sig_handler(int sig)
+{
+    quited = 1;
+}
+
+
+/* Report how much memory we use, and how much of it is shared. */
+static void
+mem_report(void)
+{
+    char temp[128];
+    long rss, pss, shr, prv, val;
+    FILE *fp;
+
+    fp = fopen("/proc/self/smaps_rollup", "r");
+    if (fp == NULL) return;
+
+    rss = pss = shr = prv = 0;
+    while (fgets(temp, sizeof(temp), fp) != NULL) {
+	if (sscanf(temp, "Rss: %ld", &val) == 1)
+		rss = val;
+	  else if (sscanf(temp, "Pss: %ld", &val) == 1)
+		pss = val;
+	  else if (! strncmp(temp, "Shared_", 7) &&
+		   (sscanf(strchr(temp, ':') + 1, "%ld", &val) == 1))
+		shr += val;
+	  else if (! strncmp(temp, "Private_", 8) &&
+		   (sscanf(strchr(temp, ':') + 1, "%ld", &val) == 1))
+		prv += val;
+    }
+    (void)fclose(fp);
+
+    printf("Child %d: RSS %ld KB (shared %ld KB, private %ld KB), PSS %ld KB\n",
+	   fork_id, rss, shr, prv, pss);
+    fflush(stdout);
+
+    pclog("UNIX: child %d RSS %ldKB shared %ldKB private %ldKB PSS %ldKB\n",
+	  fork_id, rss, shr, prv, pss);
+}
+
+
+/*
+ * Fan out into a number of child processes.
+ *
+ * All children continue from the machine as it is right now,
+ * and share its memory with the parent copy-on-write, so they
+ * start without copying anything; only pages a child modifies
+ * become its own. The parent just waits for them to finish.
+ *
+ * Returns 0 in a child, or 1 in the parent when all are done.
+ */
+static int
+do_fork(int num)
+{
+    struct rusage ru;
+    pid_t *pids, pid;
+    int i, n, status;
+
+    pids = (pid_t *)malloc(sizeof(pid_t) * num);
+
+    /* Do not let the children inherit unwritten buffers. */
+    pclog_flush();
+    fflush(NULL);
+
+    /* Or device jobs that nobody would run. */
+    worker_sync_all();
+
+    for (n = 0; n < num; n++) {
+	pid = fork();
+	if (pid == 0) {
+		free(pids);
+		pc_fork_child(n + 1);
+		return(0);
+	}
+	if (pid < 0) {
+		fprintf(stderr, "UNIX: fork: %s\n", strerror(errno));
+		break;
+	}
+	pids[n] = pid;
+    }
+
+    pclog("UNIX: started %d children, waiting..\n", n);
+
+    while (n > 0) {
+	pid = wait4(-1, &status, 0, &ru);
+	if (pid < 0) {
+		if (errno == EINTR) continue;
+		break;
+	}
+
+	for (i = 0; i < num; i++)
+		if (pids[i] == pid) break;
+	printf("Child %d: exit status %d, max RSS %ld KB\n", i + 1,
+	       WIFEXITED(status) ? WEXITSTATUS(status) : -1, ru.ru_maxrss);
+	fflush(stdout);
+	n--;
+    }
+
+    free(pids);
+
+    return(1);
+}
+
+
+/* For the UNIX platform, this is the start of the application. */
+int
+main(int argc, char **argv)
+{
+    wchar_t **argw;
+    int i;
+
+    /* We need this to convert strings to and from wide strings. */
+    (void)setlocale(LC_ALL, "");
+
+    /* Save the full path to ourselves, if we can find it. */
+    i = readlink("/proc/self/exe", self_path, sizeof(self_path) - 1);
+    if (i > 0)
+	self_path[i] = '\0';
+      else if (realpath(argv[0], self_path) == NULL)
+	strncpy(self_path, argv[0], sizeof(self_path) - 1);
+
+    /* We only have the one language. */
+    (void)plat_set_language(lang_id);
+
+    /* Initialize the version data. */
+    pc_version("UNIX");
+
+    /* Convert the commandline to wide strings. */
+    argw = (wchar_t **)malloc(sizeof(wchar_t *) * (argc + 1));
+    for (i = 0; i < argc; i++) {
+	argw[i] = (wchar_t *)malloc(sizeof(wchar_t) * (strlen(argv[i]) + 1));
+	mbstowcs(argw[i], argv[i], strlen(argv[i]) + 1);
+    }
+    argw[argc] = NULL;
+
+    /* Pre-initialize the system, this loads the config file. */
+    if (pc_setup(argc, argw) <= 0)
+	return(1);
+
+    /* We do not have a Settings dialog. */
+    if (settings_only) {
+	fprintf(stderr, "%s: no settings dialog on this platform.\n", argv[0]);
+	return(1);
+    }
+
+    /* Set up the machine. */
+    switch (pc_init()) {
+	case 1:		/* All good. */
+		break;
+
+	case 2:		/* Configuration error, we cannot re-config. */
+		fprintf(stderr, "%s: configuration error.\n", argv[0]);
+		return(1);
+
+	default:	/* General failure, or user wants to exit. */
+		return(1);
+    }
+
+    /* Initialize the (only) Video API. */
+    (void)vidapi_set(vid_api);
+
+    /* Stop gracefully when asked to. */
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    /* Fire up the machine. */
+    pc_reset_hard();
+
+    /*
+     * If we are to run several copies, restore the state (if we
+     * have one) right here, so all children will share it, and
+     * then fork them off.
+     */
+    if (fork_count > 0) {
+	if (state_load_path[0] != L'\0') {
+		if (state_load(state_load_path) < 0)
+			pc_reset_hard();
+		state_load_path[0] = L'\0';
+	}
+
+	if (do_fork(fork_count))
+		return(0);
+    }
+
+    /* Set the PAUSE mode. */
+    plat_pause(0);
+
+    /* Start the emulator and wait for it to be done. */
+    plat_start();
+    while (! quited)
+	plat_delay_ms(100);
+
+    if (fork_id > 0)
+	mem_report();
+
+    plat_stop();
+
+    return(0);
+}
+
+
+/*
+ * We do this here since there is platform-specific stuff
+ * going on here, and we do it in a function separate from
+ * main() so we can call it from the UI module as well.
+ */
+void
+plat_start(void)
+{
+    /* We have not stopped yet. */
+    quited = 0;
+
+    /* Our timer runs in nanoseconds. */
+    timer_freq = 1000000000ULL;
+    pclog("Main timer precision: %llu\n", timer_freq);
+
+    /* Start the emulator, really. */
+    thMain = thread_create(pc_thread, &quited);
+}
+
+
+/* Cleanly stop the emulator. */
+void
+plat_stop(void)
+{
+    quited = 1;
+
+    plat_delay_ms(100);
+
+    pc_close(thMain);
+
+    thMain = NULL;
+}
+
+
+/* We only have the built-in (English) language. */
+int
+plat_set_language(int id)
+{
+    plat_strings = unix_strings;
+
+    if (id != 0x0409) {
+	pclog("UI: language not supported, not setting.\n");
+	return(0);
+    }
+
+    return(1);
+}
+
+
+/* Return icon number based on drive type. */
+int
+plat_fdd_icon(int type)
+{
+    int ret = 512;
+
+    if ((type >= 1) && (type <= 6))
+	ret = 128;
+      else if ((type >= 7) && (type <= 13))
+	ret = 144;
+
+    return(ret);
+}
+
+
+void
+plat_get_exe_name(wchar_t *bufp, int size)
+{
+    mbstowcs(bufp, self_path, size);
+}
+
+
+void
+plat_tempfile(wchar_t *bufp, const wchar_t *prefix, const wchar_t *suffix)
+{
+    struct timespec ts;
+    struct tm *tm;
+    char temp[1024];
+
+    if (prefix != NULL)
+	sprintf(temp, "%ls-", prefix);
+      else
+	strcpy(temp, "");
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    tm = gmtime(&ts.tv_sec);
+    sprintf(&temp[strlen(temp)], "%d%02d%02d-%02d-%02d-%02d-%03d%ls",
+	tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday, tm->tm_hour,
+	tm->tm_min, tm->tm_sec, (int)(ts.tv_nsec / 1000000), suffix);
+    mbstowcs(bufp, temp, strlen(temp)+1);
+}
+
+
+int
+plat_getcwd(wchar_t *bufp, int max)
+{
+    char temp[PATH_MAX];
+
+    if (getcwd(temp, sizeof(temp)) == NULL)
+	return(-1);
+
+    mbstowcs(bufp, temp, max);
+
+    return(0);
+}
+
+
+int
+plat_chdir(const wchar_t *path)
+{
+    char temp[PATH_MAX];
+
+    wcstombs(temp, path, sizeof(temp));
+
+    return(chdir(temp));
+}
+
+
+FILE *
+plat_fopen(const wchar_t *path, const wchar_t *mode)
+{
+    char temp[PATH_MAX], tmode[16];
+
+    wcstombs(temp, path, sizeof(temp));
+    wcstombs(tmode, mode, sizeof(tmode));
+
+    return(fopen(temp, tmode));
+}
+
+
+void
+plat_remove(const wchar_t *path)
+{
+    char temp[PATH_MAX];
+
+    wcstombs(temp, path, sizeof(temp));
+
+    (void)remove(temp);
+}
+
+
+/* Make sure a path ends with a trailing slash. */
+void
+plat_append_slash(wchar_t *path)
+{
+    if (path[wcslen(path)-1] != L'/')
+	wcscat(path, L"/");
+}
+
+
+/* Check if the given path is absolute or not. */
+int
+plat_path_abs(const wchar_t *path)
+{
+    return(path[0] == L'/');
+}
+
+
+/* Return the last element of a pathname. */
+wchar_t *
+plat_get_basename(const wchar_t *path)
+{
+    int c = wcslen(path);
+
+    while (c > 0) {
+	if (path[c] == L'/')
+	   return((wchar_t *)&path[c]);
+       c--;
+    }
+
+    return((wchar_t *)path);
+}
+
+
+wchar_t *
+plat_get_filename(const wchar_t *path)
+{
+    int c = wcslen(path) - 1;
+
+    while (c > 0) {
+	if (path[c] == L'/')
+	   return((wchar_t *)&path[c+1]);
+       c--;
+    }
+
+    return((wchar_t *)path);
+}
+
+
+wchar_t *
+plat_get_extension(const wchar_t *path)
+{
+    int c = wcslen(path) - 1;
+
+    if (c <= 0)
+	return((wchar_t *)path);
+
+    while (c && path[c] != L'.')
+		c--;
+
+    if (!c)
+	return((wchar_t *)&path[wcslen(path)]);
+
+    return((wchar_t *)&path[c+1]);
+}
+
+
+void
+plat_append_filename(wchar_t *dest, const wchar_t *s1, const wchar_t *s2)
+{
+    wcscat(dest, s1);
+    wcscat(dest, s2);
+}
+
+
+int
+plat_dir_check(const wchar_t *path)
+{
+    char temp[PATH_MAX];
+    struct stat st;
+
+    wcstombs(temp, path, sizeof(temp));
+    if (stat(temp, &st) != 0)
+	return(0);
+
+    return(S_ISDIR(st.st_mode) ? 1 : 0);
+}
+
+
+int
+plat_dir_create(const wchar_t *path)
+{
+    char temp[PATH_MAX];
+
+    wcstombs(temp, path, sizeof(temp));
+
+    return((mkdir(temp, 0755) == 0) ? 1 : 0);
+}
+
+
+uint64_t
+plat_timer_read(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return(((uint64_t)ts.tv_sec * 1000000000ULL) + ts.tv_nsec);
+}
+
+
+uint32_t
+plat_get_ticks(void)
+{
+    return((uint32_t)(plat_timer_read() / 1000000ULL));
+}
+
+
+void
+plat_delay_ms(uint32_t count)
+{
+    struct timespec ts;
+
+    ts.tv_sec = count / 1000;
+    ts.tv_nsec = (count % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) != 0)
+	;
+}
+
+
+/*
+ * Allocate a block of zeroed, anonymous memory.
+ *
+ * Pages are only backed by real memory once they are touched,
+ * and after a fork() they remain shared until written to.
+ */
+void *
+plat_mmap(size_t size)
+{
+    void *ptr;
+
+    ptr = mmap(NULL, size, PROT_READ|PROT_WRITE,
+	       MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+
+    return((ptr == MAP_FAILED) ? NULL : ptr);
+}
+
+
+void
+plat_munmap(void *ptr, size_t size)
+{
+    (void)munmap(ptr, size);
+}
+
+
+/*
+ * Get number of VidApi entries.
+ *
+ * This has to be in this module because only we know
+ * the actual size of the plat_vidapis[] array. Not a
+ * nice way to do it, but so it is...
+ */
+int
+vidapi_count(void)
+{
+    return((sizeof(plat_vidapis)/sizeof(vidapi_t *)) - 1);
+}
+
+
+void
+plat_startblit(void)
+{
+    pthread_mutex_lock(&blit_mutex);
+}
+
+
+void
+plat_endblit(void)
+{
+    pthread_mutex_unlock(&blit_mutex);
+}
@@ -0,0 +1,89 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Try to load a support DLL (shared library) on UNIX systems.
+ *
+ * Version:	@(#)unix_dynld.c	1.0.1	2018/09/15
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../plat.h"
+
+
+void *
+dynld_module(const char *name, const dllimp_t *table)
+{
+    const dllimp_t *imp;
+    void *h, *func;
+
+    /* See if we can load the desired module. */
+    if ((h = dlopen(name, RTLD_LAZY)) == NULL) {
+#ifdef _DEBUG
+	pclog("DynLd(\"%s\"): library not found!\n", name);
+#endif
+	return(NULL);
+    }
+
+    /* If no table was given, we just detect library presence. */
+    if (table == NULL) {
+	dlclose(h);
+	return(h);
+    }
+
+    /* Now load the desired function pointers. */
+    for (imp = table; imp->name != NULL; imp++) {
+	func = dlsym(h, imp->name);
+	if (func == NULL) {
+		pclog("DynLd(\"%s\"): function '%s' not found!\n",
+						name, imp->name);
+		dlclose(h);
+		return(NULL);
+	}
+
+	/* To overcome typing issues.. */
+	*(char **)imp->func = (char *)func;
+    }
+
+    /* All good. */
+    return(h);
+}
+
+
+void
+dynld_close(void *handle)
+{
+    if (handle != NULL)
+	dlclose(handle);
+}
@@ -0,0 +1,120 @@
+    { IDS_ERROR, L"" STR_2100 },
+    { IDS_FATAL_ERROR, L"" STR_2101 },
+    { IDS_CONFIG_ERROR, L"" STR_2102 },
+    { IDS_WARNING, L"" STR_2103 },
+    { IDS_ERR_ACCEL, L"" STR_2200 },
+    { IDS_ERR_INPUT, L"" STR_2201 },
+    { IDS_ERR_PCAP, L"" STR_2202 },
+    { IDS_ERR_PCAP_NO, L"" STR_2203 },
+    { IDS_ERR_PCAP_DEV, L"" STR_2204 },
+    { IDS_ERR_OPENAL, L"" STR_2205 },
+    { IDS_ERR_FSYNTH, L"" STR_2206 },
+    { IDS_ERR_SCRSHOT, L"" STR_2300 },
+    { IDS_ERR_NOROMS, L"" STR_2301 },
+    { IDS_ERR_NOCONF, L"" STR_2302 },
+    { IDS_ERR_NOMACH, L"" STR_2303 },
+    { IDS_ERR_NOVIDEO, L"" STR_2304 },
+    { IDS_ERR_NORENDR, L"" STR_2305 },
+    { IDS_ERR_NOCDROM, L"" STR_2306 },
+    { IDS_ERR_NO_USB, L"" STR_2307 },
+    { IDS_ERR_SAVEIT, L"" STR_2308 },
+    { IDS_MSG_SAVE, L"" STR_2400 },
+    { IDS_MSG_RESTART, L"" STR_2401 },
+    { IDS_MSG_UNSTABL, L"" STR_2402 },
+    { IDS_MSG_CAPTURE, L"" STR_2403 },
+    { IDS_MSG_MRLS_1, L"" STR_2404 },
+    { IDS_MSG_MRLS_2, L"" STR_2405 },
+    { IDS_MSG_WINDOW, L"" STR_2406 },
+    { IDS_2500, L"" STR_2500 },
+    { IDS_3278, L"" STR_3278 },
+    { IDS_3279, L"" STR_3279 },
+    { IDS_3280, L"" STR_3280 },
+    { IDS_3281, L"" STR_3281 },
+    { IDS_3282, L"" STR_3282 },
+    { IDS_3283, L"" STR_3283 },
+    { IDS_3284, L"" STR_3284 },
+    { IDS_3285, L"" STR_3285 },
+    { IDS_3286, L"" STR_3286 },
+    { IDS_3287, L"" STR_3287 },
+    { IDS_3288, L"" STR_3288 },
+    { IDS_3289, L"" STR_3289 },
+    { IDS_3290, L"" STR_3290 },
+    { IDS_3291, L"" STR_3291 },
+    { IDS_3292, L"" STR_3292 },
+    { IDS_3293, L"" STR_3293 },
+    { IDS_3294, L"" STR_3294 },
+    { IDS_3295, L"" STR_3295 },
+    { IDS_3310, L"" STR_3310 },
+    { IDS_3311, L"" STR_3311 },
+    { IDS_3312, L"" STR_3312 },
+    { IDS_3313, L"" STR_3313 },
+    { IDS_3314, L"" STR_3314 },
+    { IDS_3315, L"" STR_3315 },
+    { IDS_3316, L"" STR_3316 },
+    { IDS_3317, L"" STR_3317 },
+    { IDS_3318, L"" STR_3318 },
+    { IDS_3319, L"" STR_3319 },
+    { IDS_3330, L"" STR_3330 },
+    { IDS_3334, L"" STR_3334 },
+    { IDS_3335, L"" STR_3335 },
+    { IDS_3353, L"" STR_3353 },
+    { IDS_3354, L"" STR_3354 },
+    { IDS_3355, L"" STR_3355 },
+    { IDS_3356, L"" STR_3356 },
+    { IDS_3357, L"" STR_3357 },
+    { IDS_3358, L"" STR_3358 },
+    { IDS_3359, L"" STR_3359 },
+    { IDS_3504, L"" STR_3504 },
+    { IDS_3505, L"" STR_3505 },
+    { IDS_3506, L"" STR_3506 },
+    { IDS_3507, L"" STR_3507 },
+    { IDS_3508, L"" STR_3508 },
+    { IDS_3509, L"" STR_3509 },
+    { IDS_3510, L"" STR_3510 },
+    { IDS_3511, L"" STR_3511 },
+    { IDS_3512, L"" STR_3512 },
+    { IDS_3515, L"" STR_3515 },
+    { IDS_3516, L"" STR_3516 },
+    { IDS_3517, L"" STR_3517 },
+    { IDS_3518, L"" STR_3518 },
+    { IDS_3519, L"" STR_3519 },
+    { IDS_3520, L"" STR_3520 },
+    { IDS_3526, L"" STR_3526 },
+    { IDS_3527, L"" STR_3527 },
+    { IDS_3533, L"" STR_3533 },
+    { IDS_3534, L"" STR_3534 },
+    { IDS_3535, L"" STR_3535 },
+    { IDS_3536, L"" STR_3536 },
+    { IDS_3537, L"" STR_3537 },
+    { IDS_3554, L"" STR_3554 },
+    { IDS_3555, L"" STR_3555 },
+    { IDS_3579, L"" STR_3579 },
+    { IDS_3580, L"" STR_3580 },
+    { IDS_3581, L"" STR_3581 },
+    { IDS_3582, L"" STR_3582 },
+    { IDS_3583, L"" STR_3583 },
+    { IDS_3584, L"" STR_3584 },
+    { IDS_3900, L"" STR_3900 },
+    { IDS_3901, L"" STR_3901 },
+    { IDS_3902, L"" STR_3902 },
+    { IDS_3903, L"" STR_3903 },
+    { IDS_3904, L"" STR_3904 },
+    { IDS_3905, L"" STR_3905 },
+    { IDS_3906, L"" STR_3906 },
+    { IDS_3910, L"" STR_3910 },
+    { IDS_3911, L"" STR_3911 },
+    { IDS_3912, L"" STR_3912 },
+    { IDS_3913, L"" STR_3913 },
+    { IDS_3914, L"" STR_3914 },
+    { IDS_3920, L"" STR_3920 },
+    { IDS_3921, L"" STR_3921 },
+    { IDS_3922, L"" STR_3922 },
+    { IDS_3923, L"" STR_3923 },
+    { IDS_3930, L"" STR_3930 },
+    { IDS_3940, L"" STR_3940 },
+    { IDS_3941, L"" STR_3941 },
+    { IDS_3950, L"" STR_3950 },
+    { IDS_3951, L"" STR_3951 },
+    { IDS_3952, L"" STR_3952 },
+    { IDS_3960, L"" STR_3960 },
+    { IDS_3970, L"" STR_3970 },
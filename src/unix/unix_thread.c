@@ -0,0 +1,282 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Implement threads, events and mutexes for UNIX systems,
+ *		using the POSIX threads library.
+ *
+ * Version:	@(#)unix_thread.c	1.0.1	2018/09/15
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../plat.h"
+
+
+/* Auto-reset events, like the Win32 ones we emulate. */
+typedef struct {
+    pthread_cond_t	cond;
+    pthread_mutex_t	mutex;
+    int			state;
+} unix_event_t;
+
+
+typedef struct {
+    pthread_t		thread;
+    void		(*func)(void *param);
+    void		*param;
+} unix_thread_t;
+
+
+static void *
+thread_run(void *arg)
+{
+    unix_thread_t *thr = (unix_thread_t *)arg;
+
+    thr->func(thr->param);
+
+    return(NULL);
+}
+
+
+thread_t *
+thread_create(void (*func)(void *param), void *param)
+{
+    unix_thread_t *thr = (unix_thread_t *)malloc(sizeof(unix_thread_t));
+
+    thr->func = func;
+    thr->param = param;
+    if (pthread_create(&thr->thread, NULL, thread_run, thr) != 0) {
+	free(thr);
+	return(NULL);
+    }
+
+    return((thread_t *)thr);
+}
+
+
+void
+thread_kill(void *arg)
+{
+    unix_thread_t *thr = (unix_thread_t *)arg;
+
+    if (arg == NULL) return;
+
+    pthread_cancel(thr->thread);
+    pthread_join(thr->thread, NULL);
+
+    free(thr);
+}
+
+
+/*
+ * Wait for a thread to finish.
+ *
+ * POSIX has no portable timed join, so we always wait for
+ * the thread to end. Callers only use this for threads they
+ * have already told to terminate.
+ */
+int
+thread_wait(thread_t *arg, int timeout)
+{
+    unix_thread_t *thr = (unix_thread_t *)arg;
+
+    if (arg == NULL) return(0);
+
+    if (pthread_join(thr->thread, NULL) != 0) return(1);
+
+    free(thr);
+
+    return(0);
+}
+
+
+event_t *
+thread_create_event(void)
+{
+    unix_event_t *ev = (unix_event_t *)malloc(sizeof(unix_event_t));
+
+    pthread_cond_init(&ev->cond, NULL);
+    pthread_mutex_init(&ev->mutex, NULL);
+    ev->state = 0;
+
+    return((event_t *)ev);
+}
+
+
+void
+thread_set_event(event_t *arg)
+{
+    unix_event_t *ev = (unix_event_t *)arg;
+
+    if (arg == NULL) return;
+
+    pthread_mutex_lock(&ev->mutex);
+    ev->state = 1;
+    pthread_cond_signal(&ev->cond);
+    pthread_mutex_unlock(&ev->mutex);
+}
+
+
+void
+thread_reset_event(event_t *arg)
+{
+    unix_event_t *ev = (unix_event_t *)arg;
+
+    if (arg == NULL) return;
+
+    pthread_mutex_lock(&ev->mutex);
+    ev->state = 0;
+    pthread_mutex_unlock(&ev->mutex);
+}
+
+
+static void
+event_unlock(void *arg)
+{
+    unix_event_t *ev = (unix_event_t *)arg;
+
+    pthread_mutex_unlock(&ev->mutex);
+}
+
+
+/* Wait for an event. Returns 0 if it was set, 1 on timeout. */
+int
+thread_wait_event(event_t *arg, int timeout)
+{
+    unix_event_t *ev = (unix_event_t *)arg;
+    struct timespec abstime;
+    struct timeval now;
+    int ret = 0;
+
+    if (arg == NULL) return(0);
+
+    if (timeout != -1) {
+	gettimeofday(&now, NULL);
+	abstime.tv_sec = now.tv_sec + (timeout / 1000);
+	abstime.tv_nsec = (now.tv_usec * 1000) + ((timeout % 1000) * 1000000);
+	if (abstime.tv_nsec >= 1000000000) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000;
+	}
+    }
+
+    pthread_mutex_lock(&ev->mutex);
+
+    /* Waiting is a cancellation point, do not leave the mutex locked. */
+    pthread_cleanup_push(event_unlock, ev);
+
+    while (! ev->state) {
+	if (timeout == -1) {
+		pthread_cond_wait(&ev->cond, &ev->mutex);
+	} else if (pthread_cond_timedwait(&ev->cond, &ev->mutex,
+					  &abstime) == ETIMEDOUT) {
+		ret = 1;
+		break;
+	}
+    }
+
+    /* Auto-reset, so only one waiter gets woken up. */
+    if (! ret)
+	ev->state = 0;
+
+    pthread_cleanup_pop(1);
+
+    return(ret);
+}
+
+
+void
+thread_destroy_event(event_t *arg)
+{
+    unix_event_t *ev = (unix_event_t *)arg;
+
+    if (arg == NULL) return;
+
+    pthread_cond_destroy(&ev->cond);
+    pthread_mutex_destroy(&ev->mutex);
+
+    free(ev);
+}
+
+
+mutex_t *
+thread_create_mutex(const wchar_t *name)
+{
+    pthread_mutex_t *mutex;
+    pthread_mutexattr_t attr;
+
+    /* Win32 mutexes are recursive, so ours must be as well. */
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+
+    mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init(mutex, &attr);
+
+    pthread_mutexattr_destroy(&attr);
+
+    return((mutex_t *)mutex);
+}
+
+
+void
+thread_close_mutex(mutex_t *mutex)
+{
+    if (mutex == NULL) return;
+
+    pthread_mutex_destroy((pthread_mutex_t *)mutex);
+
+    free(mutex);
+}
+
+
+int
+thread_wait_mutex(mutex_t *mutex)
+{
+    if (mutex == NULL) return(0);
+
+    if (pthread_mutex_lock((pthread_mutex_t *)mutex) == 0) return(1);
+
+    return(0);
+}
+
+
+int
+thread_release_mutex(mutex_t *mutex)
+{
+    if (mutex == NULL) return(0);
+
+    return(pthread_mutex_unlock((pthread_mutex_t *)mutex) == 0);
+}
@@ -0,0 +1,464 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Implement the (null) user interface for headless systems.
+ *
+ *		There is no window, no menus and no status bar, so most
+ *		of the functions here do nothing. Message boxes go to the
+ *		standard error stream, and every question is answered in
+ *		the negative, so we never wait for a user.
+ *
+ *		The null renderer just throws away all frames, and the
+ *		input and MIDI devices are not present.
+ *
+ * Version:	@(#)unix_ui.c	1.0.1	2018/09/15
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#include "../emu.h"
+#include "../version.h"
+#include "../device.h"
+#include "../devices/input/mouse.h"
+#include "../devices/input/game/joystick.h"
+#include "../devices/video/video.h"
+#include "../plat.h"
+#include "../ui/ui.h"
+#include "../ui/ui_resource.h"
+#include "unix.h"
+
+
+/* Platform Public data, specific. */
+uint8_t		host_cdrom_drive_available[26];
+uint8_t		host_cdrom_drive_available_num = 0;
+
+
+static wchar_t	wTitle[512];
+
+
+/* The null renderer just tells the blitter it is done. */
+static void
+null_blit(int x, int y, int y1, int y2, int w, int h)
+{
+    video_blit_complete();
+}
+
+
+static int
+null_init(int fs)
+{
+    video_setblit(null_blit);
+
+    return(1);
+}
+
+
+static void
+null_close(void)
+{
+    video_setblit(NULL);
+}
+
+
+const vidapi_t null_vidapi = {
+    "null",
+    0,
+    null_init,
+    null_close,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int
+ui_msgbox(int flags, const void *arg)
+{
+    wchar_t temp[512];
+    const wchar_t *str;
+    const wchar_t *cap;
+    int ret = 0;
+
+    switch(flags & 0x1f) {
+	case MBX_WARNING:	/* warning message */
+		cap = get_string(IDS_WARNING);
+		ret = 1;
+		break;
+
+	case MBX_ERROR:		/* error message */
+		if (flags & MBX_FATAL)
+			cap = get_string(IDS_FATAL_ERROR);
+		  else
+			cap = get_string(IDS_ERROR);
+		break;
+
+	case MBX_QUESTION:	/* question */
+		cap = L"" EMU_NAME;
+		ret = 1;
+		break;
+
+	case MBX_CONFIG:	/* configuration */
+		cap = get_string(IDS_CONFIG_ERROR);
+		ret = 1;
+		break;
+
+	case MBX_INFO:		/* just an informational message */
+	default:
+		cap = L"" EMU_NAME;
+		break;
+    }
+
+    /* If ANSI string, convert it. */
+    str = (const wchar_t *)arg;
+    if (flags & MBX_ANSI) {
+	mbstowcs(temp, (const char *)arg, sizeof_w(temp));
+	str = temp;
+    } else if (((uintptr_t)arg) < ((uintptr_t)65636)) {
+	/* Not a string, but the ID of one. */
+	str = get_string((intptr_t)arg);
+    }
+
+    fprintf(stderr, "%ls: %ls\n", cap, str);
+
+    /*
+     * Questions are answered with "No", so the caller
+     * will not go ahead with whatever it wanted to do.
+     */
+    return(ret);
+}
+
+
+wchar_t *
+ui_window_title(const wchar_t *s)
+{
+    if (s != NULL)
+	wcsncpy(wTitle, s, sizeof_w(wTitle) - 1);
+
+    return(wTitle);
+}
+
+
+void
+ui_show_cursor(int on)
+{
+}
+
+
+void
+ui_show_render(int on)
+{
+}
+
+
+void
+ui_resize(int x, int y)
+{
+}
+
+
+void
+ui_update(void)
+{
+}
+
+
+void
+plat_pause(int p)
+{
+    /* If un-pausing, ask the renderer if that's OK. */
+    if (p == 0)
+	p = vidapi_pause();
+
+    dopause = p;
+}
+
+
+void
+plat_mouse_capture(int on)
+{
+    mouse_capture = 0;
+}
+
+
+void
+plat_setfullscreen(int on)
+{
+}
+
+
+void
+menu_add_item(int idm, int id, const wchar_t *str)
+{
+}
+
+
+void
+menu_enable_item(int idm, int val)
+{
+}
+
+
+void
+menu_set_item(int idm, int val)
+{
+}
+
+
+void
+menu_set_radio_item(int idm, int num, int val)
+{
+}
+
+
+void
+sb_setup(int parts, const int *widths)
+{
+}
+
+
+void
+sb_menu_destroy(void)
+{
+}
+
+
+void
+sb_menu_create(int part)
+{
+}
+
+
+void
+sb_menu_add_item(int part, int idm, const wchar_t *str)
+{
+}
+
+
+void
+sb_menu_enable_item(int part, int idm, int val)
+{
+}
+
+
+void
+sb_menu_set_item(int part, int idm, int val)
+{
+}
+
+
+void
+sb_set_icon(int part, int icon)
+{
+}
+
+
+void
+sb_set_text(int part, const wchar_t *str)
+{
+}
+
+
+void
+sb_set_tooltip(int part, const wchar_t *str)
+{
+}
+
+
+void
+dlg_about(void)
+{
+}
+
+
+int
+dlg_settings(int ask)
+{
+    return(0);
+}
+
+
+void
+dlg_status(void)
+{
+}
+
+
+void
+dlg_status_update(void)
+{
+}
+
+
+void
+dlg_new_image(int drive, int part, int is_zip)
+{
+}
+
+
+void
+dlg_sound_gain(void)
+{
+}
+
+
+int
+dlg_file(const wchar_t *filt, const wchar_t *ifn, wchar_t *fn, int save)
+{
+    return(0);
+}
+
+
+/* We do not (yet) support any host CD-ROM drives. */
+void
+cdrom_init_host_drives(void)
+{
+    host_cdrom_drive_available_num = 0;
+    memset(host_cdrom_drive_available, 0x00,
+	   sizeof(host_cdrom_drive_available));
+}
+
+
+void
+cdrom_eject(uint8_t id)
+{
+}
+
+
+void
+cdrom_reload(uint8_t id)
+{
+}
+
+
+void
+zip_eject(uint8_t id)
+{
+}
+
+
+void
+zip_reload(uint8_t id)
+{
+}
+
+
+void
+removable_disk_unload(uint8_t id)
+{
+}
+
+
+void
+removable_disk_eject(uint8_t id)
+{
+}
+
+
+void
+removable_disk_reload(uint8_t id)
+{
+}
+
+
+/* There is no host mouse. */
+void
+mouse_poll(void)
+{
+}
+
+
+/* There are no host joysticks. */
+void
+joystick_init(void)
+{
+    joysticks_present = 0;
+}
+
+
+void
+joystick_close(void)
+{
+}
+
+
+void
+joystick_process(void)
+{
+}
+
+
+/* There is no host MIDI device. */
+void
+plat_midi_init(void)
+{
+}
+
+
+void
+plat_midi_close(void)
+{
+}
+
+
+int
+plat_midi_get_num_devs(void)
+{
+    return(0);
+}
+
+
+void
+plat_midi_get_dev_name(int num, char *s)
+{
+    strcpy(s, "None");
+}
+
+
+void
+plat_midi_play_msg(uint8_t *msg)
+{
+}
+
+
+void
+plat_midi_play_sysex(uint8_t *sysex, unsigned int len)
+{
+}
+
+
+int
+plat_midi_write(uint8_t val)
+{
+    return(0);
+}
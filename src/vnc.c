@@ -10,7 +10,7 @@
  *
  * TODO:	Implement screenshots, and maybe Audio?
  *
- * Version:	@(#)vnc.c	1.0.5	2018/08/27
+ * Version:	@(#)vnc.c	1.0.7	2018/09/16
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Based on raw code by RichardG, <richardg867@gmail.com>
@@ -222,19 +222,24 @@ static void
 vnc_blit(int x, int y, int y1, int y2, int w, int h)
 {
     uint32_t *p;
+    int pos, rx, ry, rw, rh;
     int yy;
 
-    for (yy=y1; yy<y2; yy++) {
-	p = (uint32_t *)&(((uint32_t *)rfb->frameBuffer)[yy*VNC_MAX_X]);
+    /* Only copy (and send) the tiles that changed. */
+    pos = 0;
+    while (video_blit_dirty(&pos, &rx, &ry, &rw, &rh)) {
+	for (yy=ry; yy<(ry+rh); yy++) {
+		p = (uint32_t *)&(((uint32_t *)rfb->frameBuffer)[yy*VNC_MAX_X]);
 
-	if ((y+yy) >= 0 && (y+yy) < VNC_MAX_Y)
-		memcpy(p, &(((uint32_t *)buffer32->line[y+yy])[x]), w*4);
+		if ((y+yy) >= 0 && (y+yy) < VNC_MAX_Y)
+			memcpy(&p[rx], &(((uint32_t *)buffer32->line[y+yy])[x+rx]), rw*4);
+	}
+
+	if (! updatingSize)
+		f_rfbMarkRectAsModified(rfb, rx,ry, rx+rw,ry+rh);
     }
  
     video_blit_complete();
-
-    if (! updatingSize)
-	f_rfbMarkRectAsModified(rfb, 0,0, allowedX,allowedY);
 }
 
 
@@ -265,7 +270,8 @@ vnc_init(int fs)
     /* Try loading the DLL. */
     vnc_handle = dynld_module(PATH_VNC_DLL, vnc_imports);
     if (vnc_handle == NULL) {
-	pclog("VNC: unable to load '%s', VNC not available.\n", PATH_VNC_DLL);
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_WARNING,
+		"VNC: unable to load '%s', VNC not available.\n", PATH_VNC_DLL);
 	return(0);
     }
 
@@ -339,7 +345,8 @@ vnc_resize(int x, int y)
 
     /* TightVNC doesn't like certain sizes.. */
     if (x < VNC_MIN_X || x > VNC_MAX_X || y < VNC_MIN_Y || y > VNC_MAX_Y) {
-	pclog("VNC: invalid resoltion %dx%d requested!\n", x, y);
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"VNC: invalid resoltion %dx%d requested!\n", x, y);
 	return;
     }
 
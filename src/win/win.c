@@ -8,7 +8,7 @@
  *
  *		Platform main support module for Windows.
  *
- * Version:	@(#)win.c	1.0.19	2018/09/03
+ * Version:	@(#)win.c	1.0.20	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -557,6 +557,26 @@ plat_delay_ms(uint32_t count)
 }
 
 
+/*
+ * Allocate a block of zeroed, anonymous memory.
+ *
+ * Pages are only backed by real memory once they are touched,
+ * so large, mostly unused blocks (like guest RAM) stay cheap.
+ */
+void *
+plat_mmap(size_t size)
+{
+    return(VirtualAlloc(NULL, size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE));
+}
+
+
+void
+plat_munmap(void *ptr, size_t size)
+{
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+
 /*
  * Get number of VidApi entries.
  *
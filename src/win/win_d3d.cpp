@@ -8,7 +8,7 @@
  *
  *		Rendering module for Microsoft Direct3D 9.
  *
- * Version:	@(#)win_d3d.cpp	1.0.11	2018/05/07
+ * Version:	@(#)win_d3d.cpp	1.0.12	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -182,15 +182,52 @@ d3d_size(RECT w_rect, double *l, double *t, double *r, double *b, int w, int h)
 }
 
 
+/*
+ * Copy the tiles that changed into the texture. It lives in the
+ * managed pool, so whatever we leave alone keeps its contents.
+ */
+static HRESULT
+d3d_update(int x, int y)
+{
+    HRESULT hr = D3D_OK;
+    D3DLOCKED_RECT dr;
+    RECT r;
+    int pos, rx, ry, rw, rh;
+    int yy;
+
+    if (buffer32 == NULL)
+	return(hr);
+
+    pos = 0;
+    while (video_blit_dirty(&pos, &rx, &ry, &rw, &rh)) {
+	r.top    = ry;
+	r.left   = rx;
+	r.bottom = ry + rh;
+	r.right  = rx + rw;
+
+	hr = d3dTexture->LockRect(0, &dr, &r, 0);
+	if (hr != D3D_OK)
+		break;
+
+	for (yy = ry; yy < (ry + rh); yy++) {
+		if ((y + yy) >= 0 && (y + yy) < buffer32->h)
+			memcpy((void *)((uintptr_t)dr.pBits + ((yy - ry) * dr.Pitch)), &(((uint32_t *)buffer32->line[yy + y])[x + rx]), rw * 4);
+	}
+
+	d3dTexture->UnlockRect(0);
+    }
+
+    return(hr);
+}
+
+
 static void
 d3d_blit_fs(int x, int y, int y1, int y2, int w, int h)
 {
     HRESULT hr = D3D_OK;
     HRESULT hbsr = D3D_OK;
     VOID* pVoid = 0;
-    D3DLOCKED_RECT dr;
     RECT w_rect;
-    int yy;
     double l = 0, t = 0, r = 0, b = 0;
 
     if ((y1 == y2) || (h <= 0)) {
@@ -199,24 +236,10 @@ d3d_blit_fs(int x, int y, int y1, int y2, int w, int h)
     }
 
     if (hr == D3D_OK && !(y1 == 0 && y2 == 0)) {
-	RECT lock_rect;
-
-	lock_rect.top    = y1;
-	lock_rect.left   = 0;
-	lock_rect.bottom = y2;
-	lock_rect.right  = 2047;
-
-	hr = d3dTexture->LockRect(0, &dr, &lock_rect, 0);
-	if (hr == D3D_OK) {
-		for (yy = y1; yy < y2; yy++)
-			if (buffer32)  memcpy((void *)((uintptr_t)dr.pBits + ((yy - y1) * dr.Pitch)), &(((uint32_t *)buffer32->line[yy + y])[x]), w * 4);
-
-		video_blit_complete();
-		d3dTexture->UnlockRect(0);
-	} else {
-		video_blit_complete();
+	hr = d3d_update(x, y);
+	video_blit_complete();
+	if (hr != D3D_OK)
 		return;
-	}
     } else
 	video_blit_complete();
 
@@ -296,34 +319,17 @@ d3d_blit(int x, int y, int y1, int y2, int w, int h)
     HRESULT hr = D3D_OK;
     HRESULT hbsr = D3D_OK;
     VOID* pVoid = 0;
-    D3DLOCKED_RECT dr;
     RECT r;
-    int yy;
 
     if ((y1 == y2) || (h <= 0)) {
 	video_blit_complete();
 	return; /*Nothing to do*/
     }
 
-    r.top    = y1;
-    r.left   = 0;
-    r.bottom = y2;
-    r.right  = 2047;
-
-    hr = d3dTexture->LockRect(0, &dr, &r, 0);
-    if (hr == D3D_OK) {	
-	for (yy = y1; yy < y2; yy++) {
-		if (buffer32)
-			if ((y + yy) >= 0 && (y + yy) < buffer32->h)
-				memcpy((void *)((uintptr_t)dr.pBits + ((yy - y1) * dr.Pitch)), &(((uint32_t *)buffer32->line[yy + y])[x]), w * 4);
-	}
-
-	video_blit_complete();
-	d3dTexture->UnlockRect(0);
-    } else {
-	video_blit_complete();
+    hr = d3d_update(x, y);
+    video_blit_complete();
+    if (hr != D3D_OK)
 	return;
-    }
 
     d3d_verts[0].tu = d3d_verts[2].tu = d3d_verts[3].tu = 0;//0.5 / 2048.0;
     d3d_verts[0].tv = d3d_verts[3].tv = d3d_verts[4].tv = 0;//0.5 / 2048.0;
@@ -8,7 +8,7 @@
  *
  *		Handle language support for the platform.
  *
- * Version:	@(#)win_lang.c	1.0.6	2018/09/03
+ * Version:	@(#)win_lang.c	1.0.7	2018/09/03
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -88,7 +88,8 @@ lang_setname(lang_t *ptr)
     /* Convert the language ID to a (localized) name. */
     lcid = MAKELCID(ptr->id, SORT_DEFAULT);
     if (! GetLocaleInfo(lcid, LOCALE_SLANGUAGE, name, sizeof_w(name))) {
-	pclog("UI: unable to get name for language ID 0x%04X\n", ptr->id);
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"UI: unable to get name for language ID 0x%04X\n", ptr->id);
 	return;
     }
 
@@ -197,7 +198,8 @@ lang_scan(void)
 
 		/* Grab the version info block from the DLL. */
 		if (! GetFileVersionInfo(temp, 0, sizeof(buffer), buffer)) {
-			pclog("UI: unable to access '%ls', skipping!\n", temp);
+			pclog_lvl(PCLOG_CAT_UI, PCLOG_WARNING,
+				"UI: unable to access '%ls', skipping!\n", temp);
 			free((void *)lang.dll);
 			continue;
 		}
@@ -213,7 +215,8 @@ lang_scan(void)
 			 lptr->wLanguage, lptr->wCodePage, L"FileVersion");
 		if (! VerQueryValue(buffer, temp, (LPVOID*)&str, (PUINT)&l)) {
 #ifdef _DEBUG
-			pclog("UI: invalid data in DLL, skipping!\n");
+			pclog_lvl(PCLOG_CAT_UI, PCLOG_WARNING,
+				"UI: invalid data in DLL, skipping!\n");
 #endif
 			free((void *)lang.dll);
 			continue;
@@ -234,7 +237,8 @@ lang_scan(void)
 			 lptr->wLanguage, lptr->wCodePage, L"Comments");
 		if (! VerQueryValue(buffer, temp, (LPVOID*)&str, (PUINT)&l)) {
 #ifdef _DEBUG
-			pclog("UI: invalid data in DLL, skipping!\n");
+			pclog_lvl(PCLOG_CAT_UI, PCLOG_WARNING,
+				"UI: invalid data in DLL, skipping!\n");
 #endif
 			free((void *)lang.version);
 			free((void *)lang.dll);
@@ -392,7 +396,8 @@ plat_set_language(int id)
 				    LOAD_LIBRARY_AS_IMAGE_RESOURCE | \
 				    LOAD_LIBRARY_AS_DATAFILE);
 	if (lang_handle == NULL) {
-		pclog("UI: unable to load resource DLL '%ls' !\n", ptr->dll);
+		pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+			"UI: unable to load resource DLL '%ls' !\n", ptr->dll);
 		return(0);
 	}
     }
@@ -8,7 +8,7 @@
  *
  *		Implementation of the System MIDI interface.
  *
- * Version:	@(#)win_midi.c	1.0.4	2018/05/06
+ * Version:	@(#)win_midi.c	1.0.5	2018/05/06
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -92,12 +92,14 @@ plat_midi_init(void)
     hr = midiOutOpen(&midi_out_device, midi_id, (uintptr_t) m_event,
 		     0, CALLBACK_EVENT);
     if (hr != MMSYSERR_NOERROR) {
-	pclog("midiOutOpen error - %08X\n",hr);
+	pclog_lvl(PCLOG_CAT_SOUND, PCLOG_ERROR,
+		"midiOutOpen error - %08X\n",hr);
 	midi_id = 0;
 	hr = midiOutOpen(&midi_out_device, midi_id, (uintptr_t) m_event,
 			 0, CALLBACK_EVENT);
 	if (hr != MMSYSERR_NOERROR) {
-		pclog("midiOutOpen error - %08X\n",hr);
+		pclog_lvl(PCLOG_CAT_SOUND, PCLOG_ERROR,
+			"midiOutOpen error - %08X\n",hr);
 		return;
 	}
     }
@@ -151,7 +153,7 @@ plat_midi_play_sysex(uint8_t *sysex, unsigned int len)
     MMRESULT result;
 
     if (WaitForSingleObject(m_event, 2000) == WAIT_TIMEOUT) {
-	pclog("Can't send MIDI message\n");
+	pclog_lvl(PCLOG_CAT_SOUND, PCLOG_ERROR, "Can't send MIDI message\n");
 	return;
     }
 
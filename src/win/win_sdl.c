@@ -12,7 +12,7 @@
  *		we will not use that, but, instead, use a new window which
  *		coverrs the entire desktop.
  *
- * Version:	@(#)win_sdl.c  	1.0.4	2018/06/10
+ * Version:	@(#)win_sdl.c  	1.0.6	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Michael Dring, <michael@drueing.de>
@@ -104,6 +104,9 @@ static int 		(*sdl_LockTexture)(SDL_Texture *texture,
 						const SDL_Rect *rect,
 						void **pixels, int *pitch);
 static void	 	(*sdl_UnlockTexture)(SDL_Texture *texture);
+static int 		(*sdl_UpdateTexture)(SDL_Texture *texture,
+						const SDL_Rect *rect,
+						const void *pixels, int pitch);
 static int 		(*sdl_RenderCopy)(SDL_Renderer *renderer,
 						SDL_Texture *texture,
 						const SDL_Rect *srcrect,
@@ -124,6 +127,7 @@ static const dllimp_t sdl_imports[] = {
   { "SDL_DestroyTexture",	&sdl_DestroyTexture	},
   { "SDL_LockTexture",		&sdl_LockTexture	},
   { "SDL_UnlockTexture",	&sdl_UnlockTexture	},
+  { "SDL_UpdateTexture",	&sdl_UpdateTexture	},
   { "SDL_RenderCopy",		&sdl_RenderCopy		},
   { "SDL_RenderPresent",	&sdl_RenderPresent	},
   { NULL,			NULL			}
@@ -134,9 +138,7 @@ static void
 sdl_blit(int x, int y, int y1, int y2, int w, int h)
 {
     SDL_Rect r_src;
-    void *pixeldata;
-    int pitch;
-    int yy;
+    int pos;
 
     if ((y1 == y2) || (buffer32 == NULL)) {
 	video_blit_complete();
@@ -144,26 +146,26 @@ sdl_blit(int x, int y, int y1, int y2, int w, int h)
     }
 
     /*
-     * TODO:
-     * SDL_UpdateTexture() might be better here, as it is
-     * (reportedly) slightly faster.
+     * Update the texture with just the tiles that changed; unlike
+     * a locked one, an updated texture keeps the rest of its data.
      */
-    sdl_LockTexture(sdl_tex, 0, &pixeldata, &pitch);
+    pos = 0;
+    while (video_blit_dirty(&pos, &r_src.x, &r_src.y, &r_src.w, &r_src.h)) {
+	if ((y + r_src.y) < 0) {
+		r_src.h += (y + r_src.y);
+		r_src.y = -y;
+	}
+	if ((y + r_src.y + r_src.h) > buffer32->h)
+		r_src.h = buffer32->h - (y + r_src.y);
+	if (r_src.h <= 0) continue;
 
-    for (yy = y1; yy < y2; yy++) {
-        if ((y + yy) >= 0 && (y + yy) < buffer32->h)
-#if 0
-		if (video_grayscale || invert_display)
-			video_transform_copy((uint32_t *) &(((uint8_t *)pixeldata)[yy * pitch]), &(((uint32_t *)buffer32->line[y + yy])[x]), w);
-		  else
-#endif
-			memcpy((uint32_t *) &(((uint8_t *)pixeldata)[yy * pitch]), &(((uint32_t *)buffer32->line[y + yy])[x]), w * 4);
+	sdl_UpdateTexture(sdl_tex, &r_src,
+			  &(((uint32_t *)buffer32->line[y + r_src.y])[x + r_src.x]),
+			  buffer32->w * 4);
     }
 
     video_blit_complete();
 
-    sdl_UnlockTexture(sdl_tex);
-
     r_src.x = 0;
     r_src.y = 0;
     r_src.w = w;
@@ -231,7 +233,8 @@ sdl_init(int fs)
     /* Try loading the DLL. */
     sdl_handle = dynld_module(PATH_SDL_DLL, sdl_imports);
     if (sdl_handle == NULL) {
-	pclog("SDL: unable to load '%s', SDL not available.\n", PATH_SDL_DLL);
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_WARNING,
+		"SDL: unable to load '%s', SDL not available.\n", PATH_SDL_DLL);
 	return(0);
     }
 
@@ -241,7 +244,8 @@ sdl_init(int fs)
 
     /* Initialize the SDL system. */
     if (sdl_Init(SDL_INIT_VIDEO) < 0) {
-	pclog("SDL: initialization failed (%s)\n", sdl_GetError());
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: initialization failed (%s)\n", sdl_GetError());
 	return(0);
     }
 
@@ -277,7 +281,8 @@ pclog("SDL: FS %dx%d window at %08lx\n", sdl_w, sdl_h, sdl_hwnd);
 	sdl_win = sdl_CreateWindowFrom((void *)hwndRender);
     }
     if (sdl_win == NULL) {
-	pclog("SDL: unable to CreateWindowFrom (%s)\n", sdl_GetError());
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: unable to CreateWindowFrom (%s)\n", sdl_GetError());
 	sdl_close();
 	return(0);
     }
@@ -291,7 +296,8 @@ pclog("SDL: FS %dx%d window at %08lx\n", sdl_w, sdl_h, sdl_hwnd);
      */
     sdl_render = sdl_CreateRenderer(sdl_win, -1, SDL_RENDERER_SOFTWARE);
     if (sdl_render == NULL) {
-	pclog("SDL: unable to create renderer (%s)\n", sdl_GetError());
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: unable to create renderer (%s)\n", sdl_GetError());
 	sdl_close();
         return(0);
     }
@@ -305,7 +311,8 @@ pclog("SDL: FS %dx%d window at %08lx\n", sdl_w, sdl_h, sdl_hwnd);
     sdl_tex = sdl_CreateTexture(sdl_render, SDL_PIXELFORMAT_ARGB8888,
 				SDL_TEXTUREACCESS_STREAMING, 2048, 2048);
     if (sdl_tex == NULL) {
-	pclog("SDL: unable to create texture (%s)\n", sdl_GetError());
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: unable to create texture (%s)\n", sdl_GetError());
 	sdl_close();
         return(0);
     }
@@ -347,14 +354,16 @@ sdl_screenshot(const wchar_t *fn)
     /* initialize stuff */
     png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
     if (png_ptr == NULL) {
-	pclog("SDL: screenshot: create_write_struct failed\n");
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: screenshot: create_write_struct failed\n");
 	fclose(fp);
 	return;
     }
 
     info_ptr = png_create_info_struct(png_ptr);
     if (info_ptr == NULL) {
-	pclog("SDL: screenshot: create_info_struct failed");
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: screenshot: create_info_struct failed");
 	fclose(fp);
 	return;
     }
@@ -367,7 +376,8 @@ sdl_screenshot(const wchar_t *fn)
 
     pixels = (uint8_t *)malloc(width * height * 4);
     if (pixels == NULL) {
-	pclog("SDL: screenshot: unable to allocate RGBA Bitmap memory\n");
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: screenshot: unable to allocate RGBA Bitmap memory\n");
 	fclose(fp);
 	return;
     }
@@ -375,7 +385,8 @@ sdl_screenshot(const wchar_t *fn)
     res = sdl_RenderReadPixels(sdl_render, NULL,
 			       SDL_PIXELFORMAT_ABGR8888, pixels, width * 4);
     if (res != 0) {
-	pclog("SDL: screenshot: error reading render pixels\n");
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"SDL: screenshot: error reading render pixels\n");
 	free(pixels);
 	fclose(fp);
 	return;
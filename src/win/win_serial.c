@@ -12,7 +12,7 @@
  *		Windows and UNIX systems, with support for FTDI and Prolific
  *		USB ports. Support for these has been removed.
  *
- * Version:	@(#)win_serial.c	1.0.3	2018/05/06
+ * Version:	@(#)win_serial.c	1.0.4	2018/05/06
  *
  * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
  *
@@ -77,14 +77,16 @@ bhtty_reader(void *arg)
 		n = GetLastError();
 		if (n != ERROR_IO_PENDING) {
 			/* Not good, we got an error. */
-			pclog("%s: I/O error %d in read!\n", pp->name, n);
+			pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+				"%s: I/O error %d in read!\n", pp->name, n);
 			break;
 		}
 
 		/* The read is pending, wait for it.. */
 		if (GetOverlappedResult(pp->handle, &pp->rov, &n, TRUE) == FALSE) {
 			n = GetLastError();
-			pclog("%s: I/O error %d in read!\n", pp->name, n);
+			pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+				"%s: I/O error %d in read!\n", pp->name, n);
 			break;
 		}
 	}
@@ -119,7 +121,8 @@ bhtty_sstate(BHTTY *pp, void *arg)
 {
     /* Make sure we can do this. */
     if (arg == NULL) {
-	pclog("%s: invalid argument\n", pp->name);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: invalid argument\n", pp->name);
 	return(-1);
     }
 
@@ -139,7 +142,8 @@ bhtty_gstate(BHTTY *pp, void *arg)
 {
     /* Make sure we can do this. */
     if (arg == NULL) {
-	pclog("%s: invalid argument\n", pp->name);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: invalid argument\n", pp->name);
 	return(-1);
     }
 
@@ -184,7 +188,8 @@ bhtty_crtscts(BHTTY *pp, char yesno)
 		break;
 
 	default:
-		pclog("%s: invalid parameter '%d'!\n", pp->name, yesno);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: invalid parameter '%d'!\n", pp->name, yesno);
 		return(-1);
     }
 
@@ -218,7 +223,8 @@ bhtty_params(BHTTY *pp, char dbit, char par, char sbit)
 		break;
 
 	default:
-		pclog("%s: invalid parameter '%d'!\n", pp->name, dbit);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: invalid parameter '%d'!\n", pp->name, dbit);
 		return(-1);
     }
 
@@ -253,7 +259,8 @@ bhtty_params(BHTTY *pp, char dbit, char par, char sbit)
 		break;
 
 	default:
-		pclog("%s: invalid parameter '%c'!\n", pp->name, par);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: invalid parameter '%c'!\n", pp->name, par);
 		return(-1);
     }
 
@@ -271,7 +278,8 @@ bhtty_params(BHTTY *pp, char dbit, char par, char sbit)
 		break;
 
 	default:
-		pclog("%s: invalid parameter '%d'!\n", pp->name, sbit);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: invalid parameter '%d'!\n", pp->name, sbit);
 		return(-1);
     }
 
@@ -290,7 +298,8 @@ bhtty_raw(BHTTY *pp, void *arg)
 
     /* Make sure we can do this. */
     if (arg == NULL) {
-	pclog("%s: invalid parameter\n", pp->name);
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: invalid parameter\n", pp->name);
 	return;
     }
 
@@ -369,7 +378,8 @@ bhtty_flush(BHTTY *pp)
 
     /* Re-clear any errors. */
     if (ClearCommError(pp->handle, &dwErrs, &cst) == FALSE) {
-	pclog("%s: clear errors: %d\n", pp->name, GetLastError());
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: clear errors: %d\n", pp->name, GetLastError());
 	return(-1);
     }
 
@@ -498,7 +508,8 @@ bhtty_open(char *port, int tmo)
 
     /* Set new timeout values. */
     if (GetCommTimeouts(pp->handle, &to) == FALSE) {
-	pclog("%s: error %d while getting current TO\n",
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: error %d while getting current TO\n",
 				pp->name, GetLastError());
 	(void)bhtty_close(pp);
 	return(NULL);
@@ -518,7 +529,8 @@ bhtty_open(char *port, int tmo)
 	to.ReadTotalTimeoutConstant = tmo;
     }
     if (SetCommTimeouts(pp->handle, &to) == FALSE) {
-	pclog("%s: error %d while setting TO\n", pp->name, GetLastError());
+	pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+		"%s: error %d while setting TO\n", pp->name, GetLastError());
 	(void)bhtty_close(pp);
 	return(NULL);
     }
@@ -563,14 +575,16 @@ pclog("%s: writing byte %02x\n", pp->name, val);
 	n = GetLastError();
 	if (n != ERROR_IO_PENDING) {
 		/* Not good, we got an error. */
-		pclog("%s: I/O error %d in write!\n", pp->name, n);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: I/O error %d in write!\n", pp->name, n);
 		return(-1);
 	}
 
 	/* The write is pending, wait for it.. */
 	if (GetOverlappedResult(pp->handle, &pp->wov, &n, TRUE) == FALSE) {
 		n = GetLastError();
-		pclog("%s: I/O error %d in write!\n", pp->name, n);
+		pclog_lvl(PCLOG_CAT_DEV, PCLOG_ERROR,
+			"%s: I/O error %d in write!\n", pp->name, n);
 		return(-1);
 	}
     }
@@ -8,7 +8,7 @@
  *
  *		Implementation of the Status Window dialog.
  *
- * Version:	@(#)win_status.c	1.0.7	2018/05/19
+ * Version:	@(#)win_status.c	1.0.10	2018/09/16
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -97,7 +97,7 @@ dlg_proc(HWND hdlg, UINT message, WPARAM wParam, LPARAM lParam)
 
 #ifdef USE_DYNAREC
 			"New blocks : %i\nOld blocks : %i\nRecompiled speed : %f MIPS\nAverage size : %f\n"
-			"Flushes : %i\nEvicted : %i\nReused : %i\nRemoved : %i"
+			"Flushes : %i\nEvicted : %i\nReused : %i\nRemoved : %i\nFlags dropped : %i\nCached : %i\nSMC kept : %i\nSMC interp : %i"
 #endif
 			,mips,
 			flops,
@@ -111,7 +111,9 @@ dlg_proc(HWND hdlg, UINT message, WPARAM wParam, LPARAM lParam)
 #ifdef USE_DYNAREC
 			, cpu_new_blocks_latched, cpu_recomp_blocks_latched, (double)cpu_recomp_ins_latched / 1000000.0, (double)cpu_recomp_ins_latched/cpu_recomp_blocks_latched,
 			cpu_recomp_flushes_latched, cpu_recomp_evicted_latched,
-			cpu_recomp_reuse_latched, cpu_recomp_removed_latched
+			cpu_recomp_reuse_latched, cpu_recomp_removed_latched,
+			cpu_recomp_flags_dropped_latched, cpu_recomp_cached_latched,
+			cpu_recomp_smc_saved_latched, cpu_recomp_smc_interp_latched
 #endif
 		);
 		main_time = 0;
@@ -8,7 +8,7 @@
  *
  *		Implement the user Interface module.
  *
- * Version:	@(#)win_ui.c	1.0.25	2018/05/27
+ * Version:	@(#)win_ui.c	1.0.26	2018/05/27
  *
  * Authors:	Fred N. van Kempen, <decwiz@yahoo.com>
  *		Miran Grca, <mgrca8@gmail.com>
@@ -1054,7 +1054,8 @@ menu_add_item(int idm, int new_id, const wchar_t *str)
     info.cbSize = sizeof(info);
     info.fMask = MIIM_SUBMENU;
     if (! GetMenuItemInfo(menuMain, idm, FALSE, &info)) {
-	pclog("UI: cannot find submenu %d\n", idm);
+	pclog_lvl(PCLOG_CAT_UI, PCLOG_ERROR,
+		"UI: cannot find submenu %d\n", idm);
 	return;
     }
     menu = info.hSubMenu;
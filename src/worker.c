@@ -0,0 +1,281 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Implement worker threads for device emulation.
+ *
+ *		Each worker owns a ring of job slots. The emulation thread
+ *		fills in the next free slot (worker_get), and then hands it
+ *		to the worker (worker_post.) The worker runs the jobs in
+ *		order, and then frees the slot. Only the emulation thread
+ *		moves the head of the ring, and only the worker moves the
+ *		tail, so no locks are needed; the events are only used to
+ *		wake up whoever is waiting.
+ *
+ *		With the --nothreads option, jobs are run right away on the
+ *		emulation thread, which is handy when debugging a device.
+ *
+ * Version:	@(#)worker.c	1.0.1	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <wchar.h>
+#ifdef _MSC_VER
+# include <intrin.h>
+#endif
+#include "emu.h"
+#include "plat.h"
+#include "worker.h"
+
+
+/* Make sure the slot is written before the index that publishes it. */
+#ifdef _MSC_VER
+# define BARRIER()	_ReadWriteBarrier()
+#else
+# define BARRIER()	__sync_synchronize()
+#endif
+
+
+typedef struct {
+    worker_func_t func;
+    void	*priv;
+} job_t;
+
+struct worker {
+    struct worker *next;
+
+    char	name[16];
+    int		slots,				/* must be a power of 2 */
+		size;				/* size of a slot's data */
+    job_t	*jobs;
+    uint8_t	*data;
+
+    volatile uint32_t head,			/* next slot to post */
+		tail;				/* next slot to run */
+    volatile int quit;
+
+    thread_t	*thread;
+    event_t	*wake,				/* new jobs were posted */
+		*done;				/* a job was finished */
+};
+
+
+static worker_t	*workers = NULL;
+
+
+static void
+worker_thread(void *param)
+{
+    worker_t *w = (worker_t *)param;
+    job_t *job;
+    uint32_t i;
+
+    for (;;) {
+	while (w->tail == w->head) {
+		if (w->quit) return;
+
+		thread_wait_event(w->wake, -1);
+	}
+	BARRIER();
+
+	i = w->tail & (w->slots - 1);
+	job = &w->jobs[i];
+	job->func(job->priv, &w->data[i * w->size]);
+
+	BARRIER();
+	w->tail++;
+
+	thread_set_event(w->done);
+    }
+}
+
+
+static void
+worker_start(worker_t *w)
+{
+    w->quit = 0;
+    w->wake = thread_create_event();
+    w->done = thread_create_event();
+    w->thread = thread_create(worker_thread, w);
+}
+
+
+/* Create a worker with 'slots' job slots of 'size' bytes each. */
+worker_t *
+worker_create(const char *name, int slots, int size)
+{
+    worker_t *w;
+
+    w = (worker_t *)malloc(sizeof(worker_t));
+    memset(w, 0x00, sizeof(worker_t));
+    strncpy(w->name, name, sizeof(w->name) - 1);
+
+    /* Round up to a power of two, so we can mask the indices. */
+    w->slots = 1;
+    while (w->slots < slots)
+	w->slots <<= 1;
+    w->size = (size + 15) & ~15;
+
+    w->jobs = (job_t *)malloc(w->slots * sizeof(job_t));
+    memset(w->jobs, 0x00, w->slots * sizeof(job_t));
+    w->data = (uint8_t *)malloc(w->slots * w->size);
+    memset(w->data, 0x00, w->slots * w->size);
+
+    if (! worker_inline)
+	worker_start(w);
+
+    w->next = workers;
+    workers = w;
+
+    pclog("WORKER: created '%s' (%d slots of %d bytes)%s\n",
+	  w->name, w->slots, w->size, worker_inline ? ", inline" : "");
+
+    return(w);
+}
+
+
+/* Finish all jobs, and then stop the worker. */
+void
+worker_destroy(worker_t *w)
+{
+    worker_t **pp;
+
+    if (w == NULL) return;
+
+    if (w->thread != NULL) {
+	worker_sync(w);
+
+	w->quit = 1;
+	thread_set_event(w->wake);
+	thread_wait(w->thread, -1);
+
+	thread_destroy_event(w->done);
+	thread_destroy_event(w->wake);
+    }
+
+    for (pp = &workers; *pp != NULL; pp = &(*pp)->next) {
+	if (*pp == w) {
+		*pp = w->next;
+		break;
+	}
+    }
+
+    free(w->data);
+    free(w->jobs);
+    free(w);
+}
+
+
+/* Return the data area of the next free slot, waiting for one if needed. */
+void *
+worker_get(worker_t *w)
+{
+    if (w->thread != NULL) {
+	while ((w->head - w->tail) >= (uint32_t)w->slots)
+		thread_wait_event(w->done, 1);
+    }
+
+    return(&w->data[(w->head & (w->slots - 1)) * w->size]);
+}
+
+
+/* Hand the slot from worker_get() to the worker. Returns its ticket. */
+uint32_t
+worker_post(worker_t *w, worker_func_t func, void *priv)
+{
+    job_t *job = &w->jobs[w->head & (w->slots - 1)];
+
+    job->func = func;
+    job->priv = priv;
+
+    if (w->thread == NULL) {
+	func(priv, &w->data[(w->head & (w->slots - 1)) * w->size]);
+	w->tail = ++w->head;
+
+	return(w->head);
+    }
+
+    BARRIER();
+    w->head++;
+
+    thread_set_event(w->wake);
+
+    return(w->head);
+}
+
+
+/* Wait until the job with the given ticket has been run. */
+void
+worker_wait(worker_t *w, uint32_t ticket)
+{
+    while ((int32_t)(w->tail - ticket) < 0)
+	thread_wait_event(w->done, 1);
+
+    BARRIER();
+}
+
+
+/* Wait until all posted jobs have been run. */
+void
+worker_sync(worker_t *w)
+{
+    worker_wait(w, w->head);
+}
+
+
+/* Wait for all workers to be idle, so their devices can be saved. */
+void
+worker_sync_all(void)
+{
+    worker_t *w;
+
+    for (w = workers; w != NULL; w = w->next)
+	worker_sync(w);
+}
+
+
+/*
+ * Restart all workers in a forked child process.
+ *
+ * Only the forking thread survives a fork(), so the child needs
+ * new threads, and new events for them. The parent synced all its
+ * workers before forking, so there are no jobs left to run.
+ */
+void
+worker_restart_all(void)
+{
+    worker_t *w;
+
+    for (w = workers; w != NULL; w = w->next) {
+	if (w->thread != NULL)
+		worker_start(w);
+    }
+}
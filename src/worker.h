@@ -0,0 +1,75 @@
+/*
+ * VARCem	Virtual ARchaeological Computer EMulator.
+ *		An emulator of (mostly) x86-based PC systems and devices,
+ *		using the ISA,EISA,VLB,MCA  and PCI system buses, roughly
+ *		spanning the era between 1981 and 1995.
+ *
+ *		This file is part of the VARCem Project.
+ *
+ *		Definitions for the device worker threads module.
+ *
+ *		A worker is a host thread that runs jobs posted to it by
+ *		the emulation (CPU) thread, in the order they were posted.
+ *		Jobs are passed through a single-producer/single-consumer
+ *		ring, so posting a job does not take any locks.
+ *
+ *		To keep the emulation deterministic, a job may only use
+ *		the data in its slot and state owned by the worker. If the
+ *		emulation needs a result, it waits for the job's ticket at
+ *		a fixed point in emulated time (usually in the timer that
+ *		posted it), never "whenever the worker is done".
+ *
+ * Version:	@(#)worker.h	1.0.1	2018/09/16
+ *
+ * Author:	Fred N. van Kempen, <decwiz@yahoo.com>
+ *
+ *		Copyright 2018 Fred N. van Kempen.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free  Software  Foundation; either  version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is  distributed in the hope that it will be useful, but
+ * WITHOUT   ANY  WARRANTY;  without  even   the  implied  warranty  of
+ * MERCHANTABILITY  or FITNESS  FOR A PARTICULAR  PURPOSE. See  the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the:
+ *
+ *   Free Software Foundation, Inc.
+ *   59 Temple Place - Suite 330
+ *   Boston, MA 02111-1307
+ *   USA.
+ */
+#ifndef EMU_WORKER_H
+# define EMU_WORKER_H
+
+
+typedef struct worker	worker_t;
+
+typedef void		(*worker_func_t)(void *priv, void *data);
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern worker_t	*worker_create(const char *name, int slots, int size);
+extern void	worker_destroy(worker_t *);
+
+extern void	*worker_get(worker_t *);
+extern uint32_t	worker_post(worker_t *, worker_func_t func, void *priv);
+extern void	worker_wait(worker_t *, uint32_t ticket);
+extern void	worker_sync(worker_t *);
+
+extern void	worker_sync_all(void);
+extern void	worker_restart_all(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/*EMU_WORKER_H*/